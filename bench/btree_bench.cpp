@@ -0,0 +1,658 @@
+// Benchmarks de BTree y BTreeMap contra std::set, std::map y un vector ordenado.
+//
+// No hay sistema de build: se compila a mano desde la raíz del repo, por ejemplo con
+//
+//     g++ -std=c++20 -O2 -DNDEBUG -march=native -pthread bench/btree_bench.cpp -o btree_bench
+//
+// El arnés imita a Google Benchmark: cada benchmark recibe un State y repite su cuerpo con
+// `for (auto _ : state)` hasta correr al menos --benchmark_min_time, y --benchmark_out escribe los
+// resultados en el mismo formato JSON, así que sirven sus herramientas (compare.py) para comparar
+// dos corridas y seguir regresiones entre versiones.
+//
+// Opciones:
+//     --benchmark_filter=<regex>  solo los benchmarks cuyo nombre calza con regex
+//     --benchmark_min_time=<s>    tiempo mínimo de cada benchmark (0.5 s por defecto)
+//     --benchmark_out=<archivo>   además escribe los resultados en JSON
+//     --benchmark_list_tests      lista los nombres sin correr nada
+//     --sizes=1e3,1e6             cantidades de keys (1e3, 1e4, 1e5 y 1e6 por defecto; hasta 1e8)
+//     --orders=3,64               órdenes M de BTree y BTreeMap (todos los de `orders` por defecto)
+//
+// Los nombres son operación/carga/contenedor/key/n, por ejemplo insert/random/btree<64>/int/1000.
+// Cada iteración procesa un lote de n operaciones; ns/op es el tiempo de una de ellas.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <regex>
+#include <set>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <utility>
+#include <vector>
+#include "../btree.h"
+#include "../btree_map.h"
+#include "harness.h"
+
+namespace bench {
+    // Keys de cada carga, generadas una sola vez por tamaño y tipo de key. Los benchmarks se
+    // registran con el tamaño como loop de más afuera y el tipo de key adentro, así que hay un solo
+    // cache para todos los tipos: al cambiar de tamaño o de tipo se descartan las keys anteriores y
+    // las de int no siguen ocupando memoria mientras corren las de string.
+    struct KeyCache {
+        std::type_index type = typeid(void);
+        std::size_t size = 0;
+        std::map<Workload, std::shared_ptr<const void>> keys;
+    };
+
+    KeyCache key_cache;
+
+    template<typename TK>
+    const std::vector<TK>& keys_of(const Workload workload, const std::size_t n) {
+        KeyCache& cache = key_cache;
+        if (cache.type != typeid(TK) || cache.size != n) {
+            cache.keys.clear();
+            cache.type = typeid(TK);
+            cache.size = n;
+        }
+
+        auto [it, inserted] = cache.keys.try_emplace(workload);
+        if (inserted) {
+            const std::vector<std::uint64_t> values = values_of(workload, n);
+            auto keys = std::make_shared<std::vector<TK>>();
+            keys->reserve(n);
+            for (const std::uint64_t value : values)
+                keys->push_back(make_key<TK>(value));
+            it->second = std::move(keys);
+        }
+        return *static_cast<const std::vector<TK>*>(it->second.get());
+    }
+
+    // Contenedores. Cada adaptador expone las mismas operaciones sobre lotes de keys.
+
+    template<typename Element>
+    const auto& key_of(const Element& element) {
+        if constexpr (requires { element.first; })
+            return element.first;
+        else
+            return element;
+    }
+
+    template<typename TK, std::size_t M>
+    struct BTreeSet {
+        using Container = BTree<TK, M>;
+        using Element = TK;
+
+        static std::string name() {
+            return "btree<" + std::to_string(M) + ">";
+        }
+
+        static Element element(const TK& key) {
+            return key;
+        }
+
+        static void insert_all(Container& tree, const std::span<const TK> keys) {
+            for (const TK& key : keys)
+                tree.insert(key);
+        }
+
+        static bool contains(const Container& tree, const TK& key) {
+            return tree.search(key);
+        }
+
+        static void erase_all(Container& tree, const std::span<const TK> keys) {
+            for (const TK& key : keys)
+                tree.remove(key);
+        }
+
+        template<typename Fn>
+        static void for_range(const Container& tree, const TK& lo, const TK& hi, Fn&& fn) {
+            for (const TK& key : tree.range(lo, hi))
+                fn(key);
+        }
+
+        static std::unique_ptr<Container> build(const std::vector<Element>& sorted) {
+            return std::unique_ptr<Container>(Container::build_from_ordered_vector(sorted));
+        }
+    };
+
+    template<typename TK, std::size_t M>
+    struct BTreeMapOf {
+        using Container = BTreeMap<TK, std::uint64_t, M>;
+        using Element = std::pair<TK, std::uint64_t>;
+
+        static std::string name() {
+            return "btree_map<" + std::to_string(M) + ">";
+        }
+
+        static Element element(const TK& key) {
+            return {key, 0};
+        }
+
+        static void insert_all(Container& tree, const std::span<const TK> keys) {
+            std::uint64_t value = 0;
+            for (const TK& key : keys)
+                tree.insert(key, value++);
+        }
+
+        static bool contains(const Container& tree, const TK& key) {
+            return tree.find(key) != nullptr;
+        }
+
+        static void erase_all(Container& tree, const std::span<const TK> keys) {
+            for (const TK& key : keys)
+                tree.remove(key);
+        }
+
+        template<typename Fn>
+        static void for_range(const Container& tree, const TK& lo, const TK& hi, Fn&& fn) {
+            for (const auto& entry : tree.range(lo, hi))
+                fn(entry.first);
+        }
+
+        static std::unique_ptr<Container> build(const std::vector<Element>& sorted) {
+            return std::unique_ptr<Container>(Container::build_from_ordered_vector(sorted));
+        }
+    };
+
+    template<typename TK>
+    struct StdSet {
+        using Container = std::set<TK>;
+        using Element = TK;
+
+        static std::string name() {
+            return "std::set";
+        }
+
+        static Element element(const TK& key) {
+            return key;
+        }
+
+        static void insert_all(Container& set, const std::span<const TK> keys) {
+            for (const TK& key : keys)
+                set.insert(key);
+        }
+
+        static bool contains(const Container& set, const TK& key) {
+            return set.find(key) != set.end();
+        }
+
+        static void erase_all(Container& set, const std::span<const TK> keys) {
+            for (const TK& key : keys)
+                set.erase(key);
+        }
+
+        template<typename Fn>
+        static void for_range(const Container& set, const TK& lo, const TK& hi, Fn&& fn) {
+            for (auto it = set.lower_bound(lo); it != set.end() && !(hi < *it); ++it)
+                fn(*it);
+        }
+
+        // Con la entrada ordenada el constructor de rango es lineal
+        static std::unique_ptr<Container> build(const std::vector<Element>& sorted) {
+            return std::make_unique<Container>(sorted.begin(), sorted.end());
+        }
+    };
+
+    template<typename TK>
+    struct StdMap {
+        using Container = std::map<TK, std::uint64_t>;
+        using Element = std::pair<TK, std::uint64_t>;
+
+        static std::string name() {
+            return "std::map";
+        }
+
+        static Element element(const TK& key) {
+            return {key, 0};
+        }
+
+        static void insert_all(Container& map, const std::span<const TK> keys) {
+            std::uint64_t value = 0;
+            for (const TK& key : keys)
+                map.emplace(key, value++);
+        }
+
+        static bool contains(const Container& map, const TK& key) {
+            return map.find(key) != map.end();
+        }
+
+        static void erase_all(Container& map, const std::span<const TK> keys) {
+            for (const TK& key : keys)
+                map.erase(key);
+        }
+
+        template<typename Fn>
+        static void for_range(const Container& map, const TK& lo, const TK& hi, Fn&& fn) {
+            for (auto it = map.lower_bound(lo); it != map.end() && !(hi < it->first); ++it)
+                fn(it->first);
+        }
+
+        static std::unique_ptr<Container> build(const std::vector<Element>& sorted) {
+            return std::make_unique<Container>(sorted.begin(), sorted.end());
+        }
+    };
+
+    // Insertar una key a la vez en un vector ordenado es O(n) y con n = 1e6 ya no termina, así que
+    // se usa como se usa en la práctica: los lotes se agregan al final y se ordena una vez, y se
+    // borran con una sola pasada de set_difference
+    template<typename TK>
+    struct SortedVector {
+        using Container = std::vector<TK>;
+        using Element = TK;
+
+        static std::string name() {
+            return "sorted_vector";
+        }
+
+        static Element element(const TK& key) {
+            return key;
+        }
+
+        static void insert_all(Container& vector, const std::span<const TK> keys) {
+            vector.insert(vector.end(), keys.begin(), keys.end());
+            std::sort(vector.begin(), vector.end());
+            vector.erase(std::unique(vector.begin(), vector.end()), vector.end());
+        }
+
+        static bool contains(const Container& vector, const TK& key) {
+            return std::binary_search(vector.begin(), vector.end(), key);
+        }
+
+        static void erase_all(Container& vector, const std::span<const TK> keys) {
+            std::vector<TK> sorted(keys.begin(), keys.end());
+            std::sort(sorted.begin(), sorted.end());
+
+            Container rest;
+            rest.reserve(vector.size());
+            std::set_difference(vector.begin(), vector.end(), sorted.begin(), sorted.end(),
+                                std::back_inserter(rest));
+            vector.swap(rest);
+        }
+
+        template<typename Fn>
+        static void for_range(const Container& vector, const TK& lo, const TK& hi, Fn&& fn) {
+            for (auto it = std::lower_bound(vector.begin(), vector.end(), lo);
+                 it != vector.end() && !(hi < *it); ++it)
+                fn(*it);
+        }
+
+        static std::unique_ptr<Container> build(const std::vector<Element>& sorted) {
+            return std::make_unique<Container>(sorted);
+        }
+    };
+
+    // Benchmarks sobre un adaptador
+
+    // Las n keys de los datos, ordenadas, como las recibe Adapter::build
+    template<typename Adapter, typename TK>
+    std::vector<typename Adapter::Element> sorted_elements(const std::size_t n) {
+        std::vector<typename Adapter::Element> elements;
+        elements.reserve(n);
+        for (const TK& key : keys_of<TK>(Workload::sequential, n))
+            elements.push_back(Adapter::element(key));
+        return elements;
+    }
+
+    template<typename Adapter, typename TK>
+    void insert(State& state, const Workload workload, const std::size_t n) {
+        const std::vector<TK>& keys = keys_of<TK>(workload, n);
+        for (auto _ : state) {
+            state.pause();
+            auto container = std::make_unique<typename Adapter::Container>();
+            state.resume();
+
+            Adapter::insert_all(*container, keys);
+
+            state.pause();
+            container.reset();
+            state.resume();
+        }
+        state.set_items_processed(state.iterations() * n);
+    }
+
+    template<typename Adapter, typename TK>
+    void search(State& state, const Workload workload, const std::size_t n) {
+        const auto container = Adapter::build(sorted_elements<Adapter, TK>(n));
+        const std::vector<TK>& queries = keys_of<TK>(workload, n);
+
+        for (auto _ : state) {
+            std::size_t found = 0;
+            for (const TK& key : queries)
+                found += static_cast<std::size_t>(Adapter::contains(*container, key));
+            do_not_optimize(found);
+        }
+        state.set_items_processed(state.iterations() * n);
+    }
+
+    template<typename Adapter, typename TK>
+    void remove(State& state, const std::size_t n) {
+        const std::vector<typename Adapter::Element> elements = sorted_elements<Adapter, TK>(n);
+        const std::vector<TK>& keys = keys_of<TK>(Workload::lookups, n);
+
+        for (auto _ : state) {
+            state.pause();
+            auto container = Adapter::build(elements);
+            state.resume();
+
+            Adapter::erase_all(*container, keys);
+
+            state.pause();
+            container.reset();
+            state.resume();
+        }
+        state.set_items_processed(state.iterations() * n);
+    }
+
+    // Rangos de `width` keys que empiezan en keys al azar, hasta visitar unas n keys por iteración
+    template<typename Adapter, typename TK>
+    void range(State& state, const std::size_t n) {
+        constexpr std::size_t width = 100;
+
+        const auto container = Adapter::build(sorted_elements<Adapter, TK>(n));
+        const std::size_t count = std::max<std::size_t>(1, n / width);
+        std::vector<std::pair<TK, TK>> bounds;
+        bounds.reserve(count);
+        std::mt19937_64 rng(n);
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint64_t lo = 2 * (rng() % n);
+            bounds.emplace_back(make_key<TK>(lo), make_key<TK>(lo + 2 * (width - 1)));
+        }
+
+        std::size_t visited = 0;
+        for (auto _ : state) {
+            for (const auto& [lo, hi] : bounds)
+                Adapter::for_range(*container, lo, hi, [&](const TK& key) {
+                    do_not_optimize(key);
+                    ++visited;
+                });
+        }
+        state.set_items_processed(visited);
+    }
+
+    template<typename Adapter, typename TK>
+    void iterate(State& state, const std::size_t n) {
+        const auto container = Adapter::build(sorted_elements<Adapter, TK>(n));
+
+        for (auto _ : state) {
+            for (const auto& element : *container)
+                do_not_optimize(key_of(element));
+        }
+        state.set_items_processed(state.iterations() * n);
+    }
+
+    template<typename Adapter, typename TK>
+    void build(State& state, const std::size_t n) {
+        const std::vector<typename Adapter::Element> elements = sorted_elements<Adapter, TK>(n);
+
+        for (auto _ : state) {
+            auto container = Adapter::build(elements);
+
+            state.pause();
+            container.reset();
+            state.resume();
+        }
+        state.set_items_processed(state.iterations() * n);
+    }
+
+    template<typename Adapter, typename TK>
+    void clear(State& state, const std::size_t n) {
+        const std::vector<typename Adapter::Element> elements = sorted_elements<Adapter, TK>(n);
+
+        for (auto _ : state) {
+            state.pause();
+            auto container = Adapter::build(elements);
+            state.resume();
+
+            container->clear();
+        }
+        state.set_items_processed(state.iterations() * n);
+    }
+
+    // Registro
+
+    // Órdenes de BTree y BTreeMap que se instancian
+    template<std::size_t... Ms>
+    using Orders = std::index_sequence<Ms...>;
+    using AllOrders = Orders<3, 4, 8, 16, 32, 64, 128, 256, 512>;
+
+    struct Options {
+        std::regex filter{".*"};
+        double min_time = 0.5;
+        std::string out;
+        bool list = false;
+        std::vector<std::size_t> sizes{1'000, 10'000, 100'000, 1'000'000};
+        std::vector<std::size_t> orders;  // Vacío = todos
+    };
+
+    template<typename TK>
+    std::string key_name() {
+        if constexpr (std::is_same_v<TK, int>)
+            return "int";
+        else if constexpr (std::is_same_v<TK, std::int64_t>)
+            return "int64_t";
+        else
+            return "string";
+    }
+
+    class Registry {
+        const Options& options;
+        std::vector<Benchmark> benchmarks;
+
+        void add(const std::string& operation,
+                 const std::string& workload,
+                 const std::string& container,
+                 const std::string& key_type,
+                 const std::size_t order,
+                 const std::size_t size,
+                 std::function<void(State&)> run) {
+            std::string name = operation + "/" + workload + "/" + container + "/" + key_type + "/" +
+                               std::to_string(size);
+            if (!std::regex_search(name, options.filter))
+                return;
+
+            benchmarks.push_back({std::move(name), operation, workload, container, key_type, order,
+                                  size, std::move(run)});
+        }
+
+        template<typename Adapter, typename TK>
+        void add_container(const std::size_t order, const std::size_t n) {
+            const std::string container = Adapter::name();
+            const std::string key = key_name<TK>();
+            const auto with = [&](const std::string& operation, const std::string& workload,
+                                  std::function<void(State&)> run) {
+                add(operation, workload, container, key, order, n, std::move(run));
+            };
+
+            with("insert", "sequential",
+                 [n](State& s) { insert<Adapter, TK>(s, Workload::sequential, n); });
+            with("insert", "random",
+                 [n](State& s) { insert<Adapter, TK>(s, Workload::random, n); });
+            with("insert", "zipfian",
+                 [n](State& s) { insert<Adapter, TK>(s, Workload::zipfian, n); });
+            with("search", "hit", [n](State& s) { search<Adapter, TK>(s, Workload::lookups, n); });
+            with("search", "miss", [n](State& s) { search<Adapter, TK>(s, Workload::misses, n); });
+            with("remove", "random", [n](State& s) { remove<Adapter, TK>(s, n); });
+            with("range", "100", [n](State& s) { range<Adapter, TK>(s, n); });
+            with("iterate", "all", [n](State& s) { iterate<Adapter, TK>(s, n); });
+            with("build", "sorted", [n](State& s) { build<Adapter, TK>(s, n); });
+            with("clear", "all", [n](State& s) { clear<Adapter, TK>(s, n); });
+        }
+
+        [[nodiscard]] bool wanted(const std::size_t order) const {
+            return options.orders.empty() ||
+                   std::find(options.orders.begin(), options.orders.end(), order) !=
+                       options.orders.end();
+        }
+
+        template<typename TK, std::size_t... Ms>
+        void add_key_type(const std::size_t n, Orders<Ms...> /*orders*/) {
+            ((wanted(Ms) ? add_container<BTreeSet<TK, Ms>, TK>(Ms, n) : void()), ...);
+            ((wanted(Ms) ? add_container<BTreeMapOf<TK, Ms>, TK>(Ms, n) : void()), ...);
+            add_container<StdSet<TK>, TK>(0, n);
+            add_container<StdMap<TK>, TK>(0, n);
+            add_container<SortedVector<TK>, TK>(0, n);
+        }
+
+    public:
+        explicit Registry(const Options& options)
+            : options(options) {
+            for (const std::size_t n : options.sizes) {
+                add_key_type<int>(n, AllOrders());
+                add_key_type<std::int64_t>(n, AllOrders());
+                add_key_type<std::string>(n, AllOrders());
+            }
+        }
+
+        [[nodiscard]] const std::vector<Benchmark>& all() const {
+            return benchmarks;
+        }
+    };
+
+    // Salida
+
+    std::string escape(const std::string& text) {
+        std::string escaped;
+        for (const char c : text) {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    std::string now_iso8601() {
+        const std::time_t now = std::time(nullptr);
+        std::tm local{};
+        localtime_r(&now, &local);
+        std::ostringstream text;
+        text << std::put_time(&local, "%FT%T%z");
+        return text.str();
+    }
+
+    // Mismo esquema que --benchmark_out_format=json de Google Benchmark, con los parámetros de
+    // cada benchmark como campos extra
+    void write_json(std::ostream& out,
+                    const char* const executable,
+                    const std::vector<std::pair<const Benchmark*, Result>>& results) {
+        out << std::setprecision(10);
+        out << "{\n  \"context\": {\n";
+        out << "    \"date\": \"" << now_iso8601() << "\",\n";
+        out << "    \"executable\": \"" << escape(executable) << "\",\n";
+        out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+        out << "    \"library_build_type\": \"release\"\n";
+#else
+        out << "    \"library_build_type\": \"debug\"\n";
+#endif
+        out << "  },\n  \"benchmarks\": [";
+
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& [benchmark, result] = results[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {\n";
+            out << "      \"name\": \"" << escape(benchmark->name) << "\",\n";
+            out << "      \"run_name\": \"" << escape(benchmark->name) << "\",\n";
+            out << "      \"run_type\": \"iteration\",\n";
+            out << "      \"repetitions\": 1,\n";
+            out << "      \"repetition_index\": 0,\n";
+            out << "      \"threads\": 1,\n";
+            out << "      \"iterations\": " << result.iterations << ",\n";
+            out << "      \"real_time\": " << result.real_ns << ",\n";
+            out << "      \"cpu_time\": " << result.cpu_ns << ",\n";
+            out << "      \"time_unit\": \"ns\",\n";
+            out << "      \"items_per_second\": " << result.items_per_second << ",\n";
+            out << "      \"operation\": \"" << benchmark->operation << "\",\n";
+            out << "      \"workload\": \"" << benchmark->workload << "\",\n";
+            out << "      \"container\": \"" << escape(benchmark->container) << "\",\n";
+            out << "      \"key_type\": \"" << benchmark->key_type << "\",\n";
+            out << "      \"order\": " << benchmark->order << ",\n";
+            out << "      \"size\": " << benchmark->size << "\n";
+            out << "    }";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    std::vector<std::size_t> parse_list(const std::string& text) {
+        std::vector<std::size_t> values;
+        std::istringstream items(text);
+        for (std::string item; std::getline(items, item, ',');)
+            values.push_back(static_cast<std::size_t>(std::stod(item)));
+        return values;
+    }
+
+    Options parse_options(const int argc, char** const argv) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const std::size_t eq = arg.find('=');
+            const std::string flag = arg.substr(0, eq);
+            const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+            if (flag == "--benchmark_filter")
+                options.filter = std::regex(value);
+            else if (flag == "--benchmark_min_time")
+                options.min_time = std::stod(value);
+            else if (flag == "--benchmark_out")
+                options.out = value;
+            else if (flag == "--benchmark_list_tests")
+                options.list = true;
+            else if (flag == "--sizes")
+                options.sizes = parse_list(value);
+            else if (flag == "--orders")
+                options.orders = parse_list(value);
+            else
+                throw std::invalid_argument("unknown option " + arg);
+        }
+        return options;
+    }
+}  // namespace bench
+
+int main(int argc, char** argv) {
+    using namespace bench;
+
+    try {
+        const Options options = parse_options(argc, argv);
+        const Registry registry(options);
+
+        if (options.list) {
+            for (const Benchmark& benchmark : registry.all())
+                std::cout << benchmark.name << '\n';
+            return 0;
+        }
+
+        std::printf("%-52s %14s %14s %12s %10s\n", "Benchmark", "Time", "CPU", "Iterations",
+                    "ns/op");
+        std::vector<std::pair<const Benchmark*, Result>> results;
+        for (const Benchmark& benchmark : registry.all()) {
+            const Result result = measure(benchmark, options.min_time);
+            std::printf("%-52s %11.0f ns %11.0f ns %12zu %10.2f\n", benchmark.name.c_str(),
+                        result.real_ns, result.cpu_ns, result.iterations,
+                        result.items_per_second > 0 ? 1e9 / result.items_per_second : 0.0);
+            std::fflush(stdout);
+            results.emplace_back(&benchmark, result);
+        }
+
+        if (!options.out.empty()) {
+            std::ofstream out(options.out);
+            write_json(out, argv[0], results);
+            if (!out)
+                throw std::runtime_error("cannot write " + options.out);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
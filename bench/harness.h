@@ -0,0 +1,247 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Arnés y cargas de trabajo de bench/btree_bench.cpp, aparte para que los tests puedan revisar
+// los generadores y la forma en que se mide
+namespace bench {
+    using Clock = std::chrono::steady_clock;
+
+    // Evita que el compilador descarte un resultado que no se usa, como benchmark::DoNotOptimize
+    template<typename T>
+    void do_not_optimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // Cuenta el tiempo real y de CPU de las iteraciones de un benchmark, sin lo que pasa entre
+    // pause() y resume()
+    class State {
+        std::size_t max_iterations;
+        std::size_t items = 0;
+        Clock::duration real{};
+        std::clock_t cpu = 0;
+        Clock::time_point real_start;
+        std::clock_t cpu_start = 0;
+
+    public:
+        class Iterator {
+            State* state;
+            std::size_t left;
+
+        public:
+            Iterator(State* const state, const std::size_t left)
+                : state(state),
+                  left(left) {}
+
+            // Para que `for (auto _ : state)` no avise que _ no se usa
+            struct [[maybe_unused]] Value {};
+
+            Value operator*() const {
+                return {};
+            }
+
+            Iterator& operator++() {
+                --left;
+                return *this;
+            }
+
+            // Al terminar la última iteración se detiene el reloj
+            bool operator!=(const Iterator& /*end*/) const {
+                if (left != 0)
+                    return true;
+
+                state->pause();
+                return false;
+            }
+        };
+
+        explicit State(const std::size_t iterations)
+            : max_iterations(iterations) {}
+
+        Iterator begin() {
+            resume();
+            return {this, max_iterations};
+        }
+
+        Iterator end() {
+            return {this, 0};
+        }
+
+        void pause() {
+            real += Clock::now() - real_start;
+            cpu += std::clock() - cpu_start;
+        }
+
+        void resume() {
+            real_start = Clock::now();
+            cpu_start = std::clock();
+        }
+
+        void set_items_processed(const std::size_t count) {
+            items = count;
+        }
+
+        [[nodiscard]] std::size_t iterations() const {
+            return max_iterations;
+        }
+
+        [[nodiscard]] std::size_t items_processed() const {
+            return items;
+        }
+
+        [[nodiscard]] double real_seconds() const {
+            return std::chrono::duration<double>(real).count();
+        }
+
+        [[nodiscard]] double cpu_seconds() const {
+            return static_cast<double>(cpu) / CLOCKS_PER_SEC;
+        }
+    };
+
+    struct Benchmark {
+        std::string name;
+        std::string operation;
+        std::string workload;
+        std::string container;
+        std::string key_type;
+        std::size_t order;  // 0 en los contenedores de la biblioteca estándar
+        std::size_t size;
+        std::function<void(State&)> run;
+    };
+
+    struct Result {
+        std::size_t iterations;
+        double real_ns;  // Por iteración
+        double cpu_ns;
+        double items_per_second;
+    };
+
+    // Como Google Benchmark: se corre con cada vez más iteraciones, apuntando a 1.4 veces el
+    // mínimo y sin crecer más de 10 veces por vuelta, hasta que una corrida dure lo suficiente
+    inline Result measure(const Benchmark& benchmark, const double min_time) {
+        constexpr std::size_t max_iterations = 1'000'000'000;
+
+        std::size_t iterations = 1;
+        while (true) {
+            State state(iterations);
+            benchmark.run(state);
+
+            const double seconds = state.real_seconds();
+            if (seconds >= min_time || iterations >= max_iterations) {
+                const auto count = static_cast<double>(iterations);
+                return {iterations, seconds * 1e9 / count, state.cpu_seconds() * 1e9 / count,
+                        seconds > 0 ? static_cast<double>(state.items_processed()) / seconds : 0};
+            }
+
+            const double ratio = seconds > 0 ? std::min(10.0, 1.4 * min_time / seconds) : 10.0;
+            const double next = static_cast<double>(iterations) * ratio;
+            iterations = std::max(iterations + 1, static_cast<std::size_t>(next));
+        }
+    }
+
+    // Cargas de trabajo
+
+    enum class Workload { sequential, random, zipfian, lookups, misses };
+
+    // Los datos son los valores pares 0, 2, ..., 2(n - 1) (o parte de ellos en zipfian) y las
+    // búsquedas fallidas los impares, así que un rango [v, v + 2k] tiene k + 1 keys
+    template<typename TK>
+    TK make_key(const std::uint64_t value) {
+        if constexpr (std::is_same_v<TK, std::string>) {
+            // Con ceros a la izquierda el orden de los strings es el de los números, y con 16
+            // caracteres no entran en el buffer interno de std::string
+            std::string key = "user000000000000";
+            for (std::uint64_t v = value, i = key.size(); v != 0 && i > 4; v /= 10)
+                key[--i] = static_cast<char>('0' + v % 10);
+            return key;
+        } else {
+            return static_cast<TK>(value);
+        }
+    }
+
+    // Muestras de una distribución Zipf(theta) sobre [0, n), con el método de Gray et al. que usa
+    // YCSB, que también usa theta = 0.99 por defecto
+    class ZipfGenerator {
+        std::size_t n;
+        double theta;
+        double alpha;
+        double zetan;
+        double eta;
+
+        static double zeta(const std::size_t n, const double theta) {
+            double sum = 0;
+            for (std::size_t i = 1; i <= n; ++i)
+                sum += 1 / std::pow(static_cast<double>(i), theta);
+            return sum;
+        }
+
+    public:
+        explicit ZipfGenerator(const std::size_t n, const double theta = 0.99)
+            : n(n),
+              theta(theta),
+              alpha(1 / (1 - theta)),
+              zetan(zeta(n, theta)),
+              eta((1 - std::pow(2.0 / static_cast<double>(n), 1 - theta)) /
+                  (1 - zeta(2, theta) / zetan)) {}
+
+        template<typename Rng>
+        std::size_t operator()(Rng& rng) {
+            const double u = std::uniform_real_distribution<double>(0, 1)(rng);
+            const double uz = u * zetan;
+            if (uz < 1)
+                return 0;
+            if (uz < 1 + std::pow(0.5, theta))
+                return 1;
+
+            const auto rank = static_cast<std::size_t>(static_cast<double>(n) *
+                                                       std::pow(eta * u - eta + 1, alpha));
+            return std::min(rank, n - 1);
+        }
+    };
+
+    // Valores (antes de make_key) de una carga de n keys
+    inline std::vector<std::uint64_t> values_of(const Workload workload, const std::size_t n) {
+        std::mt19937_64 rng(static_cast<std::uint64_t>(workload) * 7919 + n);
+
+        std::vector<std::uint64_t> values(n);
+        for (std::size_t i = 0; i < n; ++i)
+            values[i] = 2 * i;
+
+        switch (workload) {
+        case Workload::sequential:
+            break;
+        case Workload::random:
+        case Workload::lookups:
+            std::shuffle(values.begin(), values.end(), rng);
+            break;
+        case Workload::misses:
+            for (std::uint64_t& value : values)
+                ++value;
+            std::shuffle(values.begin(), values.end(), rng);
+            break;
+        case Workload::zipfian: {
+            // Los rangos más frecuentes se reparten por todo el espacio de keys
+            std::vector<std::uint64_t> spread = values;
+            std::shuffle(spread.begin(), spread.end(), rng);
+            ZipfGenerator zipf(n);
+            for (std::uint64_t& value : values)
+                value = spread[zipf(rng)];
+            break;
+        }
+        }
+        return values;
+    }
+}  // namespace bench
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+// Política de filtro de BasicBTree que no guarda nada: toda búsqueda baja por el árbol
+struct NoKeyFilter {
+    static constexpr bool enabled = false;
+};
+
+// Filtro de Bloom por bloques para que BasicBTree descarte sin bajar las búsquedas de keys que no
+// están. Cada key cae en un solo bloque de 256 bits (media cache line) y marca un bit en cada una
+// de sus 8 palabras, así que consultarla lee una sola línea y nunca da falsos negativos. Los falsos
+// positivos rondan el 1% con BitsPerKey = 12.
+//
+// Un filtro de Bloom no puede olvidar keys: las que se borran siguen marcadas, y el árbol lo
+// vuelve a armar desde sus keys cuando se llena o cuando la mitad de lo que tiene ya se borró
+// (ver stale). Hash tiene que dar lo mismo para keys que Compare considera equivalentes; si es
+// transparente, las búsquedas con otros tipos de key también consultan el filtro.
+template<typename TK, typename Hash = std::hash<TK>, std::size_t BitsPerKey = 12>
+class BlockedBloomFilter {
+    static_assert(BitsPerKey >= 4, "fewer bits per key make the filter useless");
+
+    struct alignas(32) Block {
+        std::uint32_t words[8];
+    };
+
+    static constexpr std::size_t bits_per_block = 256;
+    static constexpr std::size_t min_capacity = 256;
+
+    // Multiplicadores impares que eligen el bit de cada palabra (los del split block Bloom filter
+    // de Parquet)
+    static constexpr std::uint32_t salts[8] = {0x47B6137BU, 0x44974D91U, 0x8824AD5BU,
+                                               0xA2B7289DU, 0x705495C7U, 0x2DF1424BU,
+                                               0x9EFC4947U, 0x5C6BFB31U};
+
+    std::vector<Block> blocks;
+    std::size_t capacity = 0;  // Keys que entran con BitsPerKey bits cada una
+    std::size_t added = 0;     // Keys marcadas desde el último rebuild (contando las borradas)
+    std::size_t removed = 0;   // De esas, cuántas ya no están en el árbol
+    bool valid = false;        // Si es false, may_contain acepta todo y stale pide rebuild
+    [[no_unique_address]] Hash hash;
+
+    // std::hash de enteros suele ser la identidad: se mezclan los bits antes de usarlos
+    template<typename K>
+    [[nodiscard]] std::uint64_t mixed(const K& key) const {
+        auto h = static_cast<std::uint64_t>(hash(key));
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    [[nodiscard]] std::size_t block_of(const std::uint64_t h) const {
+        return static_cast<std::size_t>(((h >> 32) * blocks.size()) >> 32);
+    }
+
+    static std::uint32_t mask(const std::uint64_t h, const std::size_t i) {
+        return std::uint32_t{1} << ((static_cast<std::uint32_t>(h) * salts[i]) >> 27);
+    }
+
+public:
+    static constexpr bool enabled = true;
+
+    // Si una búsqueda con una key de tipo K puede consultar el filtro
+    template<typename K>
+    static constexpr bool probes =
+        std::is_same_v<K, TK> ||
+        (requires { typename Hash::is_transparent; } && std::is_invocable_v<const Hash&, K>);
+
+    // false solo si key seguro no está
+    template<typename K>
+    [[nodiscard]] bool may_contain(const K& key) const {
+        if (!valid)
+            return true;
+
+        const std::uint64_t h = mixed(key);
+        const Block& block = blocks[block_of(h)];
+
+        bool found = true;
+        for (std::size_t i = 0; i < 8; ++i)
+            found &= (block.words[i] & mask(h, i)) != 0;
+        return found;
+    }
+
+    void add(const TK& key) {
+        if (!valid)
+            return;
+
+        const std::uint64_t h = mixed(key);
+        Block& block = blocks[block_of(h)];
+        for (std::size_t i = 0; i < 8; ++i)
+            block.words[i] |= mask(h, i);
+        ++added;
+    }
+
+    // Anota que una key marcada se borró del árbol. Su marca queda.
+    void remove() {
+        ++removed;
+    }
+
+    // El contenido del árbol cambió sin pasar por add (join, split): hasta el próximo rebuild
+    // el filtro no descarta nada
+    void invalidate() {
+        valid = false;
+    }
+
+    // Si hay que volver a armarlo: porque no es válido, porque tiene más keys de las que admite
+    // sin perder precisión, o porque más de la mitad de sus keys ya no están
+    [[nodiscard]] bool stale() const {
+        return !valid || added > capacity || removed * 2 > added;
+    }
+
+    // Vacía el filtro dejando lugar para el doble de count keys, para que un árbol que crece
+    // lo rearme cada vez que duplica su tamaño, y marca las keys que for_each_key le pasa a add
+    template<typename ForEachKey>
+    void rebuild(const std::size_t count, ForEachKey&& for_each_key) {
+        capacity = std::max(min_capacity, 2 * count);
+        const std::size_t count_blocks =
+            (capacity * BitsPerKey + bits_per_block - 1) / bits_per_block;
+
+        std::vector<Block>(count_blocks).swap(blocks);
+        added = removed = 0;
+        valid = true;
+        for_each_key([this](const TK& key) { add(key); });
+    }
+
+    [[nodiscard]] std::size_t memory_bytes() const {
+        return blocks.capacity() * sizeof(Block);
+    }
+};
+
+#endif
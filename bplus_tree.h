@@ -0,0 +1,969 @@
+#ifndef BPLUS_TREE_H
+#define BPLUS_TREE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "key_format.h"
+#include "node.h"
+#include "node_pool.h"
+#include "node_search.h"
+
+// Árbol B+: todas las keys viven en las hojas, los nodos internos solo guardan separadores y las
+// hojas forman una lista doblemente enlazada. Recorrer el árbol, un rango, o buscar el mínimo y el
+// máximo es caminar esa lista, sin volver a subir por el árbol.
+//
+// El separador keys[i] de un nodo interno cumple children[i] < keys[i] <= children[i + 1]: es una
+// copia de la primera key de su subárbol derecho al momento de crearse, y puede quedar aunque esa
+// key se borre después.
+//
+// Los nodos internos son el mismo Node que las hojas, con el mismo M y los enlaces sin usar: así
+// comparten el NodePool y el orden dinámico. Por eso el fan-out interno no es mayor que el de las
+// hojas, como sí lo sería con nodos internos propios.
+template<typename TK,
+         std::size_t Order = dynamic_order,
+         typename Compare = std::less<TK>,
+         typename Search = DefaultNodeSearch>
+class BPlusTree {
+    using BNode = Node<TK, Order, void, true>;
+
+    static constexpr std::size_t capacity = Order == dynamic_order ? 0 : Order - 1;
+
+    static constexpr bool transparent = requires { typename Compare::is_transparent; };
+
+    // Tipo con el que se compara una key de tipo K recibida en una búsqueda
+    template<typename K>
+    using LookupKey = std::conditional_t<transparent, K, TK>;
+
+    static constexpr std::size_t max_depth =
+        max_tree_depth(Order == dynamic_order ? 2 : (Order + 1) / 2);
+
+    // Nodo interno por el que se bajó y el índice del child que se tomó
+    struct Frame {
+        BNode* node;
+        std::size_t idx;
+    };
+
+    [[no_unique_address]] OrderValue<Order> M;
+    [[no_unique_address]] Compare comp;
+    NodePool<TK, Order, void, true> pool{M};
+    BNode* root = nullptr;
+    BNode* head = nullptr;  // Primera hoja
+    BNode* tail = nullptr;  // Última hoja
+    std::size_t n = 0;
+
+    std::size_t min_keys() const {
+        return (M - 1) / 2;
+    }
+
+    // Índice de la primera key >= key dentro del nodo
+    template<typename K>
+    std::size_t rank(const BNode* const node, const K& key) const {
+        return Search::template rank<capacity>(node->keys, node->count, key, comp);
+    }
+
+    template<typename K>
+    bool matches(const BNode* const node, const std::size_t idx, const K& key) const {
+        return idx < node->count && !comp(key, node->keys[idx]);
+    }
+
+    // Child de un nodo interno donde está key. Una key igual al separador está a su derecha.
+    template<typename K>
+    std::size_t child_index(const BNode* const node, const K& key) const {
+        const std::size_t idx = rank(node, key);
+        return matches(node, idx, key) ? idx + 1 : idx;
+    }
+
+    // Hoja donde está (o estaría) key. El árbol no debe estar vacío.
+    template<typename K>
+    BNode* find_leaf(const K& key) const {
+        BNode* cur = root;
+
+        while (!cur->leaf)
+            cur = cur->children[child_index(cur, key)];
+
+        return cur;
+    }
+
+    // Hoja llena: reparte sus M - 1 keys más new_key (que va en la posición i) entre node y una
+    // hoja nueva a su derecha, que se enlaza en la lista y se retorna.
+    BNode* split_leaf(BNode* const node, const std::size_t i, TK&& new_key) {
+        const std::size_t left = M / 2;
+
+        BNode* const right = pool.create();
+        right->count = M - left;
+
+        // Primero se llena right, que toma el final de la secuencia (con new_key ya insertada)
+        for (std::size_t j = left; j < M; ++j) {
+            if (j == i)
+                right->keys[j - left] = std::move(new_key);
+            else
+                right->keys[j - left] = std::move(node->keys[j > i ? j - 1 : j]);
+        }
+
+        if (i < left) {
+            for (std::size_t j = left - 1; j > i; --j)
+                node->keys[j] = std::move(node->keys[j - 1]);
+            node->keys[i] = std::move(new_key);
+        }
+
+        node->count = left;
+
+        right->links.prev = node;
+        right->links.next = node->links.next;
+        if (node->links.next != nullptr)
+            node->links.next->links.prev = right;
+        else
+            tail = right;
+        node->links.next = right;
+
+        return right;
+    }
+
+    // Nodo interno lleno: reparte sus keys más sep (en la posición i, con child a su derecha)
+    // entre node y un nodo nuevo a la derecha. Retorna la key del medio, que sube, y el nodo nuevo.
+    std::pair<TK, BNode*> split_internal(BNode* const node,
+                                         const std::size_t i,
+                                         TK&& sep,
+                                         BNode* const child) {
+        const std::size_t mid = M / 2;
+
+        const auto key_at = [&](const std::size_t j) -> TK& {
+            return j == i ? sep : node->keys[j > i ? j - 1 : j];
+        };
+        const auto child_at = [&](const std::size_t j) {
+            return j == i + 1 ? child : node->children[j > i + 1 ? j - 1 : j];
+        };
+
+        BNode* const right = pool.create();
+        right->leaf = false;
+        right->count = M - 1 - mid;
+
+        for (std::size_t j = mid + 1; j < M; ++j)
+            right->keys[j - mid - 1] = std::move(key_at(j));
+        for (std::size_t j = mid + 1; j <= M; ++j)
+            right->children[j - mid - 1] = child_at(j);
+
+        TK lifted = std::move(key_at(mid));
+
+        if (i < mid) {
+            for (std::size_t j = mid - 1; j > i; --j)
+                node->keys[j] = std::move(node->keys[j - 1]);
+            node->keys[i] = std::move(sep);
+
+            for (std::size_t j = mid; j > i + 1; --j)
+                node->children[j] = node->children[j - 1];
+            node->children[i + 1] = child;
+        }
+
+        for (std::size_t j = mid + 1; j <= M - 1; ++j)
+            node->children[j] = nullptr;
+
+        node->count = mid;
+
+        return {std::move(lifted), right};
+    }
+
+    template<typename K>
+    bool insert_key(K&& key) {
+        if constexpr (!transparent && !std::is_same_v<std::remove_cvref_t<K>, TK>) {
+            return insert_key(TK(std::forward<K>(key)));
+        } else {
+            if (root == nullptr)
+                root = head = tail = pool.create();
+
+            Frame path[max_depth];
+            std::size_t depth = 0;
+            BNode* leaf = root;
+
+            while (!leaf->leaf) {
+                const std::size_t idx = child_index(leaf, key);
+                path[depth++] = {leaf, idx};
+                leaf = leaf->children[idx];
+            }
+
+            const std::size_t i = rank(leaf, key);
+            if (matches(leaf, i, key))
+                return false;
+
+            TK new_key(std::forward<K>(key));
+            ++n;
+
+            if (leaf->count < M - 1) {
+                for (std::size_t j = leaf->count; j > i; --j)
+                    leaf->keys[j] = std::move(leaf->keys[j - 1]);
+                leaf->keys[i] = std::move(new_key);
+                ++leaf->count;
+                return true;
+            }
+
+            BNode* child = split_leaf(leaf, i, std::move(new_key));
+            TK sep = child->keys[0];  // Copia: la key sigue en la hoja
+
+            while (depth > 0) {
+                const auto [node, idx] = path[--depth];
+
+                if (node->count < M - 1) {
+                    for (std::size_t j = node->count; j > idx; --j) {
+                        node->keys[j] = std::move(node->keys[j - 1]);
+                        node->children[j + 1] = node->children[j];
+                    }
+
+                    node->keys[idx] = std::move(sep);
+                    node->children[idx + 1] = child;
+                    ++node->count;
+                    return true;
+                }
+
+                std::tie(sep, child) = split_internal(node, idx, std::move(sep), child);
+            }
+
+            BNode* const new_root = pool.create();
+            new_root->leaf = false;
+            new_root->count = 1;
+            new_root->keys[0] = std::move(sep);
+            new_root->children[0] = root;
+            new_root->children[1] = child;
+            root = new_root;
+
+            return true;
+        }
+    }
+
+    // Saca keys[i] y children[i + 1] de un nodo interno
+    static void erase_separator(BNode* const node, const std::size_t i) {
+        for (std::size_t j = i; j + 1 < node->count; ++j) {
+            node->keys[j] = std::move(node->keys[j + 1]);
+            node->children[j + 1] = node->children[j + 2];
+        }
+
+        node->children[node->count] = nullptr;
+        --node->count;
+    }
+
+    // Junta la hoja children[i + 1] de parent dentro de children[i]
+    void merge_leaves(BNode* const parent, const std::size_t i) {
+        BNode* const left = parent->children[i];
+        BNode* const right = parent->children[i + 1];
+
+        for (std::size_t j = 0; j < right->count; ++j)
+            left->keys[left->count + j] = std::move(right->keys[j]);
+        left->count += right->count;
+
+        left->links.next = right->links.next;
+        if (right->links.next != nullptr)
+            right->links.next->links.prev = left;
+        else
+            tail = left;
+
+        pool.destroy(right);
+        erase_separator(parent, i);
+    }
+
+    // Junta el nodo interno children[i + 1] de parent dentro de children[i], bajando el separador
+    void merge_internal(BNode* const parent, const std::size_t i) {
+        BNode* const left = parent->children[i];
+        BNode* const right = parent->children[i + 1];
+
+        left->keys[left->count] = std::move(parent->keys[i]);
+        for (std::size_t j = 0; j < right->count; ++j) {
+            left->keys[left->count + 1 + j] = std::move(right->keys[j]);
+            left->children[left->count + 1 + j] = right->children[j];
+        }
+        left->children[left->count + 1 + right->count] = right->children[right->count];
+        left->count += 1 + right->count;
+
+        pool.destroy(right);
+        erase_separator(parent, i);
+    }
+
+    // children[i] de parent, una hoja, quedó con menos keys que el mínimo. Pide una key a un
+    // hermano o se junta con él. Retorna si hubo merge (y parent perdió un separador).
+    bool fix_leaf(BNode* const parent, const std::size_t i) {
+        BNode* const leaf = parent->children[i];
+
+        if (i > 0 && parent->children[i - 1]->count > min_keys()) {
+            BNode* const left = parent->children[i - 1];
+
+            for (std::size_t j = leaf->count; j > 0; --j)
+                leaf->keys[j] = std::move(leaf->keys[j - 1]);
+            leaf->keys[0] = std::move(left->keys[left->count - 1]);
+            ++leaf->count;
+            --left->count;
+
+            parent->keys[i - 1] = leaf->keys[0];
+            return false;
+        }
+
+        if (i < parent->count && parent->children[i + 1]->count > min_keys()) {
+            BNode* const right = parent->children[i + 1];
+
+            leaf->keys[leaf->count] = std::move(right->keys[0]);
+            for (std::size_t j = 0; j + 1 < right->count; ++j)
+                right->keys[j] = std::move(right->keys[j + 1]);
+            ++leaf->count;
+            --right->count;
+
+            parent->keys[i] = right->keys[0];
+            return false;
+        }
+
+        merge_leaves(parent, i < parent->count ? i : i - 1);
+        return true;
+    }
+
+    // Igual que fix_leaf, para un nodo interno: los préstamos rotan a través del separador
+    bool fix_internal(BNode* const parent, const std::size_t i) {
+        BNode* const mid = parent->children[i];
+
+        if (i > 0 && parent->children[i - 1]->count > min_keys()) {
+            BNode* const left = parent->children[i - 1];
+
+            mid->children[mid->count + 1] = mid->children[mid->count];
+            for (std::size_t j = mid->count; j > 0; --j) {
+                mid->keys[j] = std::move(mid->keys[j - 1]);
+                mid->children[j] = mid->children[j - 1];
+            }
+
+            mid->keys[0] = std::move(parent->keys[i - 1]);
+            mid->children[0] = std::exchange(left->children[left->count], nullptr);
+            parent->keys[i - 1] = std::move(left->keys[left->count - 1]);
+            ++mid->count;
+            --left->count;
+            return false;
+        }
+
+        if (i < parent->count && parent->children[i + 1]->count > min_keys()) {
+            BNode* const right = parent->children[i + 1];
+
+            mid->keys[mid->count] = std::move(parent->keys[i]);
+            mid->children[mid->count + 1] = right->children[0];
+            parent->keys[i] = std::move(right->keys[0]);
+
+            for (std::size_t j = 0; j + 1 < right->count; ++j) {
+                right->keys[j] = std::move(right->keys[j + 1]);
+                right->children[j] = right->children[j + 1];
+            }
+            right->children[right->count - 1] = right->children[right->count];
+            right->children[right->count] = nullptr;
+
+            ++mid->count;
+            --right->count;
+            return false;
+        }
+
+        merge_internal(parent, i < parent->count ? i : i - 1);
+        return true;
+    }
+
+    template<typename K>
+    bool remove_key(const K& key) {
+        if (root == nullptr)
+            return false;
+
+        Frame path[max_depth];
+        std::size_t depth = 0;
+        BNode* leaf = root;
+
+        while (!leaf->leaf) {
+            const std::size_t idx = child_index(leaf, key);
+            path[depth++] = {leaf, idx};
+            leaf = leaf->children[idx];
+        }
+
+        const std::size_t i = rank(leaf, key);
+        if (!matches(leaf, i, key))
+            return false;
+
+        for (std::size_t j = i; j + 1 < leaf->count; ++j)
+            leaf->keys[j] = std::move(leaf->keys[j + 1]);
+        --leaf->count;
+        --n;
+
+        if (leaf == root) {
+            if (leaf->count == 0) {
+                pool.destroy(root);
+                root = head = tail = nullptr;
+            }
+            return true;
+        }
+
+        if (leaf->count >= min_keys())
+            return true;
+
+        bool merged = fix_leaf(path[depth - 1].node, path[depth - 1].idx);
+        --depth;
+
+        while (merged && depth > 0 && path[depth].node->count < min_keys()) {
+            merged = fix_internal(path[depth - 1].node, path[depth - 1].idx);
+            --depth;
+        }
+
+        if (!root->leaf && root->count == 0)
+            pool.destroy(std::exchange(root, root->children[0]));
+
+        return true;
+    }
+
+    // El retorno es (valid, height, min_key, max_key), como en BasicBTree. prev_leaf es la última
+    // hoja visitada, para comprobar la lista de hojas en el mismo recorrido.
+    std::tuple<bool, std::ptrdiff_t, const TK*, const TK*> check_properties(
+        const BNode* const node,
+        const BNode*& prev_leaf,
+        std::size_t& keys) const {
+        const std::size_t min = node == root ? 1 : min_keys();
+
+        if (node->count < min || node->count > M - 1)
+            return {false, -1, nullptr, nullptr};
+
+        for (std::size_t i = 0; i + 1 < node->count; ++i) {
+            if (!comp(node->keys[i], node->keys[i + 1]))
+                return {false, -1, nullptr, nullptr};
+        }
+
+        if (node->leaf) {
+            if (node->links.prev != prev_leaf)
+                return {false, -1, nullptr, nullptr};
+            if ((prev_leaf == nullptr ? head : prev_leaf->links.next) != node)
+                return {false, -1, nullptr, nullptr};
+
+            prev_leaf = node;
+            keys += node->count;
+            return {true, 0, &node->keys[0], &node->keys[node->count - 1]};
+        }
+
+        std::ptrdiff_t height = -1;
+        const TK* first = nullptr;
+        const TK* last = nullptr;
+
+        for (std::size_t i = 0; i < node->count + 1; ++i) {
+            if (node->children[i] == nullptr)
+                return {false, -1, nullptr, nullptr};
+
+            const auto [valid, sub_height, min_key, max_key] =
+                check_properties(node->children[i], prev_leaf, keys);
+            if (!valid || (i > 0 && sub_height != height))
+                return {false, -1, nullptr, nullptr};
+
+            // children[i - 1] < keys[i - 1] <= children[i]
+            if (i > 0 && (!comp(*last, node->keys[i - 1]) || comp(*min_key, node->keys[i - 1])))
+                return {false, -1, nullptr, nullptr};
+
+            height = sub_height;
+            if (i == 0)
+                first = min_key;
+            last = max_key;
+        }
+
+        return {true, height + 1, first, last};
+    }
+
+    // write_to junta lo que escribe en bloques de este tamaño
+    static constexpr std::size_t stream_block = 64 * 1024;
+
+    // Agrega a text las keys en orden separadas por sep, recorriendo la lista de hojas, y llama a
+    // flush(text) cada vez que pasa de stream_block. flush puede vaciarlo o dejarlo crecer.
+    template<typename Flush>
+    void write_text(const std::string_view sep, std::string& text, Flush&& flush) const {
+        for (const BNode* leaf = head; leaf != nullptr; leaf = leaf->links.next) {
+            for (std::size_t i = 0; i < leaf->count; ++i) {
+                if (leaf != head || i > 0)
+                    text.append(sep);
+                append_key(text, leaf->keys[i]);
+
+                if (text.size() >= stream_block)
+                    flush(text);
+            }
+        }
+    }
+
+    explicit BPlusTree(const OrderValue<Order> M, const Compare& comp = Compare())
+        : M(M),
+          comp(comp) {}
+
+    void swap(BPlusTree& other) noexcept {
+        std::swap(M, other.M);
+        std::swap(comp, other.comp);
+        pool.swap(other.pool);
+        std::swap(root, other.root);
+        std::swap(head, other.head);
+        std::swap(tail, other.tail);
+        std::swap(n, other.n);
+    }
+
+public:
+    // Iterador en orden: una hoja y una posición dentro de ella. Avanzar es pasar a la hoja
+    // siguiente de la lista. Cualquier insert o remove invalida los iteradores.
+    class const_iterator {
+        friend class BPlusTree;
+
+        const BPlusTree* tree = nullptr;  // Para poder retroceder desde end()
+        const BNode* leaf = nullptr;
+        std::size_t pos = 0;
+
+        const_iterator(const BPlusTree* const tree, const BNode* const leaf, const std::size_t pos)
+            : tree(tree),
+              leaf(leaf),
+              pos(pos) {}
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = TK;
+        using difference_type = std::ptrdiff_t;
+        using reference = const TK&;
+        using pointer = const TK*;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            return leaf->keys[pos];
+        }
+
+        pointer operator->() const {
+            return &leaf->keys[pos];
+        }
+
+        const_iterator& operator++() {
+            if (++pos == leaf->count) {
+                leaf = leaf->links.next;
+                pos = 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        const_iterator& operator--() {
+            if (leaf == nullptr) {
+                leaf = tree->tail;
+                pos = leaf->count - 1;
+            } else if (pos > 0) {
+                --pos;
+            } else {
+                leaf = leaf->links.prev;
+                pos = leaf->count - 1;
+            }
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) {
+            return a.leaf == b.leaf && a.pos == b.pos;
+        }
+    };
+
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator = const_reverse_iterator;
+
+    // Vista sobre un tramo de keys: solo guarda los iteradores de los extremos
+    class Range {
+        const_iterator first;
+        const_iterator last;
+
+    public:
+        Range(const_iterator first, const_iterator last)
+            : first(first),
+              last(last) {}
+
+        [[nodiscard]] const_iterator begin() const {
+            return first;
+        }
+
+        [[nodiscard]] const_iterator end() const {
+            return last;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return first == last;
+        }
+    };
+
+    explicit BPlusTree(const std::size_t M, const Compare& comp = Compare())
+        requires(Order == dynamic_order)
+        : M(M),
+          comp(comp) {}
+
+    BPlusTree()
+        requires(Order != dynamic_order)
+        : M(Order) {}
+
+    explicit BPlusTree(const Compare& comp)
+        requires(Order != dynamic_order)
+        : M(Order),
+          comp(comp) {}
+
+    BPlusTree(const BPlusTree& other) = delete;
+
+    BPlusTree(BPlusTree&& other) noexcept
+        : M(other.M),
+          comp(other.comp) {
+        swap(other);
+    }
+
+    BPlusTree& operator=(const BPlusTree& other) = delete;
+
+    BPlusTree& operator=(BPlusTree&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~BPlusTree() {
+        pool.clear(std::exchange(root, nullptr));
+        head = tail = nullptr;
+        n = 0;
+    }
+
+    template<typename K>
+    [[nodiscard]] bool search(const K& key) const {
+        if (root == nullptr)
+            return false;
+
+        const LookupKey<K>& k = key;
+        const BNode* const leaf = find_leaf(k);
+        return matches(leaf, rank(leaf, k), k);
+    }
+
+    // Construye la key desde key (copiando o moviendo) solo si no está
+    template<typename K = TK>
+    void insert(K&& key) {
+        insert_key(std::forward<K>(key));
+    }
+
+    template<typename K>
+    void remove(const K& key) {
+        remove_key(static_cast<const LookupKey<K>&>(key));
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        return const_iterator(this, head, 0);
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return const_iterator(this, nullptr, 0);
+    }
+
+    [[nodiscard]] const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    [[nodiscard]] const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    // Primera key >= key, o end() si no hay
+    template<typename K>
+    [[nodiscard]] const_iterator lower_bound(const K& key) const {
+        if (root == nullptr)
+            return end();
+
+        const LookupKey<K>& k = key;
+        const BNode* const leaf = find_leaf(k);
+        const std::size_t idx = rank(leaf, k);
+
+        if (idx == leaf->count)
+            return const_iterator(this, leaf->links.next, 0);
+        return const_iterator(this, leaf, idx);
+    }
+
+    // Primera key > key, o end() si no hay
+    template<typename K>
+    [[nodiscard]] const_iterator upper_bound(const K& key) const {
+        const LookupKey<K>& k = key;
+        const_iterator it = lower_bound(k);
+        if (it != end() && !comp(k, *it))
+            ++it;
+        return it;
+    }
+
+    template<typename K>
+    [[nodiscard]] const_iterator find(const K& key) const {
+        const LookupKey<K>& k = key;
+        const_iterator it = lower_bound(k);
+        if (it != end() && !comp(k, *it))
+            return it;
+        return end();
+    }
+
+    // Keys en [begin, end], en orden. Baja una vez hasta begin y de ahí recorre la lista de hojas.
+    template<typename K1, typename K2>
+    [[nodiscard]] Range range(const K1& begin, const K2& end) const {
+        const LookupKey<K1>& lo = begin;
+        const LookupKey<K2>& hi = end;
+
+        const const_iterator first = lower_bound(lo);
+        if (first == this->end() || comp(hi, *first))
+            return {first, first};
+
+        return {first, upper_bound(hi)};
+    }
+
+    template<typename K1, typename K2>
+    [[nodiscard]] Range rangeSearch(const K1& begin, const K2& end) const {
+        return range(begin, end);
+    }
+
+    [[nodiscard]] const TK& minKey() const {
+        if (head == nullptr)
+            throw std::runtime_error("BPlusTree is empty");
+
+        return head->keys[0];
+    }
+
+    [[nodiscard]] const TK& maxKey() const {
+        if (tail == nullptr)
+            throw std::runtime_error("BPlusTree is empty");
+
+        return tail->keys[tail->count - 1];
+    }
+
+    [[nodiscard]] std::ptrdiff_t height() const {
+        std::ptrdiff_t height = -1;
+
+        for (const BNode* cur = root; cur != nullptr; cur = cur->leaf ? nullptr : cur->children[0])
+            ++height;
+
+        return height;
+    }
+
+    // Las keys en orden (las de las hojas), separadas por sep. Igual que en BasicBTree, cada key
+    // se escribe con format_key, así que sirve para cualquier FormattableKey.
+    [[nodiscard]] std::string toString(const std::string& sep) const
+        requires FormattableKey<TK>
+    {
+        std::string result;
+        write_text(sep, result, [](std::string& /*text*/) {});
+        return result;
+    }
+
+    // Escribe las keys en orden en out, separadas por sep. Retorna el iterador que sigue a lo
+    // escrito.
+    template<std::output_iterator<char> Out>
+    Out write_to(Out out, const std::string_view sep = ",") const
+        requires FormattableKey<TK>
+    {
+        std::string buffer;
+        const auto flush = [&](std::string& text) {
+            out = std::copy(text.begin(), text.end(), std::move(out));
+            text.clear();
+        };
+        write_text(sep, buffer, flush);
+        flush(buffer);
+
+        return out;
+    }
+
+    void write_to(std::ostream& os, const std::string_view sep = ",") const
+        requires FormattableKey<TK>
+    {
+        std::string buffer;
+        const auto flush = [&](std::string& text) {
+            os.write(text.data(), static_cast<std::streamsize>(text.size()));
+            text.clear();
+        };
+        write_text(sep, buffer, flush);
+        flush(buffer);
+    }
+
+    void clear() {
+        BPlusTree(M, comp).swap(*this);
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return n;
+    }
+
+    [[nodiscard]] bool check_properties() const {
+        if (root == nullptr)
+            return head == nullptr && tail == nullptr && n == 0;
+
+        const BNode* last_leaf = nullptr;
+        std::size_t keys = 0;
+        const auto [valid, height, min, max] = check_properties(root, last_leaf, keys);
+
+        return valid && last_leaf == tail && tail->links.next == nullptr && keys == n;
+    }
+
+    // Construye el árbol de abajo hacia arriba en O(n): reparte las keys en hojas (enlazadas en
+    // orden) y luego arma cada nivel interno en una pasada. Cada hoja aporta una copia de su
+    // primera key como separador.
+    //
+    // `fill` es la fracción de M - 1 keys que se intenta poner en cada nodo (1.0 = nodos llenos).
+    // Los elementos deben estar ordenados de forma estrictamente creciente según Compare.
+    static BPlusTree* build_from_ordered_vector(const std::vector<TK>& elements,
+                                                const std::size_t M,
+                                                const double fill = 1.0)
+        requires(Order == dynamic_order)
+    {
+        return build_from_ordered_range(elements.begin(), elements.end(), M, fill);
+    }
+
+    static BPlusTree* build_from_ordered_vector(std::vector<TK>&& elements,
+                                                const std::size_t M,
+                                                const double fill = 1.0)
+        requires(Order == dynamic_order)
+    {
+        return build_from_ordered_range(std::make_move_iterator(elements.begin()),
+                                        std::make_move_iterator(elements.end()), M, fill);
+    }
+
+    template<std::input_iterator It>
+        requires std::forward_iterator<It> || std::sized_sentinel_for<It, It>
+    static BPlusTree* build_from_ordered_range(It first,
+                                               It last,
+                                               const std::size_t M,
+                                               const double fill = 1.0)
+        requires(Order == dynamic_order)
+    {
+        if (M < 3)
+            throw std::invalid_argument("order must be greater than 2");
+
+        return build(std::move(first), std::move(last), OrderValue<Order>(M), fill);
+    }
+
+    static BPlusTree* build_from_ordered_vector(const std::vector<TK>& elements,
+                                                const double fill = 1.0)
+        requires(Order != dynamic_order)
+    {
+        return build_from_ordered_range(elements.begin(), elements.end(), fill);
+    }
+
+    static BPlusTree* build_from_ordered_vector(std::vector<TK>&& elements,
+                                                const double fill = 1.0)
+        requires(Order != dynamic_order)
+    {
+        return build_from_ordered_range(std::make_move_iterator(elements.begin()),
+                                        std::make_move_iterator(elements.end()), fill);
+    }
+
+    template<std::input_iterator It>
+        requires std::forward_iterator<It> || std::sized_sentinel_for<It, It>
+    static BPlusTree* build_from_ordered_range(It first, It last, const double fill = 1.0)
+        requires(Order != dynamic_order)
+    {
+        return build(std::move(first), std::move(last), OrderValue<Order>(Order), fill);
+    }
+
+private:
+    // Cantidad de grupos en que se reparten `units` unidades (keys de las hojas, o children de un
+    // nivel interno) para que cada grupo tenga entre lo y hi, lo más cerca posible de target
+    static std::size_t group_count(const std::size_t units,
+                                   const std::size_t target,
+                                   const std::size_t lo,
+                                   const std::size_t hi) {
+        if (units <= hi)
+            return 1;
+
+        const std::size_t min_groups = (units + hi - 1) / hi;
+        const std::size_t max_groups = units / lo;
+        const std::size_t groups = (units + target / 2) / target;
+
+        return std::clamp(groups, min_groups, max_groups);
+    }
+
+    static std::size_t group_size(const std::size_t units,
+                                  const std::size_t groups,
+                                  const std::size_t j) {
+        return units / groups + static_cast<std::size_t>(j < units % groups);
+    }
+
+    template<typename It>
+    static BPlusTree* build(It first, const It last, const OrderValue<Order> M, const double fill) {
+        if (!(fill > 0.0 && fill <= 1.0))
+            throw std::invalid_argument("fill factor must be in (0, 1]");
+
+        const std::size_t min_keys = std::max<std::size_t>((M - 1) / 2, 1);
+        const std::size_t target = std::clamp(
+            static_cast<std::size_t>(std::lround(fill * static_cast<double>(M - 1))), min_keys,
+            M - 1);
+        const auto total = static_cast<std::size_t>(std::distance(first, last));
+
+        auto* tree = new BPlusTree(M);
+        if (total == 0)
+            return tree;
+
+        // level[i] son los nodos del nivel actual y seps[i] separa a level[i] de level[i + 1]
+        std::vector<BNode*> level;
+        std::vector<TK> seps;
+
+        const std::size_t leaves = group_count(total, target, min_keys, M - 1);
+        level.reserve(leaves);
+        seps.reserve(leaves - 1);
+
+        for (std::size_t j = 0; j < leaves; ++j) {
+            BNode* const leaf = tree->pool.create();
+            leaf->count = group_size(total, leaves, j);
+
+            for (std::size_t k = 0; k < leaf->count; ++k, ++first)
+                leaf->keys[k] = *first;
+
+            if (j > 0) {
+                seps.push_back(leaf->keys[0]);
+                leaf->links.prev = level.back();
+                level.back()->links.next = leaf;
+            }
+
+            level.push_back(leaf);
+        }
+
+        tree->head = level.front();
+        tree->tail = level.back();
+
+        while (level.size() > 1) {
+            const std::size_t units = level.size();
+            const std::size_t groups = group_count(units, target + 1, (M + 1) / 2, M);
+
+            std::vector<BNode*> next_level;
+            std::vector<TK> next_seps;
+            next_level.reserve(groups);
+            next_seps.reserve(groups - 1);
+
+            std::size_t c = 0;
+            for (std::size_t j = 0; j < groups; ++j) {
+                BNode* const node = tree->pool.create();
+                node->leaf = false;
+                node->count = group_size(units, groups, j) - 1;
+
+                for (std::size_t k = 0; k < node->count; ++k) {
+                    node->children[k] = level[c + k];
+                    node->keys[k] = std::move(seps[c + k]);
+                }
+
+                node->children[node->count] = level[c + node->count];
+                c += node->count + 1;
+
+                next_level.push_back(node);
+                if (j + 1 < groups)
+                    next_seps.push_back(std::move(seps[c - 1]));
+            }
+
+            level = std::move(next_level);
+            seps = std::move(next_seps);
+        }
+
+        tree->root = level.front();
+        tree->n = total;
+        return tree;
+    }
+};
+
+#endif
@@ -1,26 +1,384 @@
 #ifndef BTree_H
 #define BTree_H
 
+#include <algorithm>
 #include <cmath>
+#include <concepts>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 #include <utility>
-#include <variant>
 #include <vector>
+#include "bloom_filter.h"
+#include "btree_stats.h"
+#include "frozen_btree.h"
+#include "key_format.h"
+#include "mapped_btree.h"
 #include "node.h"
+#include "node_pool.h"
+#include "node_search.h"
+#include "work_stealing_pool.h"
+
+// Cómo se parte un nodo lleno al insertar (ver BasicBTree::set_split_policy)
+enum class SplitPolicy {
+    even,    // Mitad y mitad, como en un árbol B clásico
+    append,  // Al agregar al final del árbol, el nodo de la izquierda queda casi lleno
+};
+
+// En qué orden BasicBTree::parallel_reduce junta los resultados parciales
+enum class ReduceOrder {
+    ordered,    // En el orden de las keys; combine solo tiene que ser asociativo
+    unordered,  // En cualquier orden; combine tiene que ser además conmutativo
+};
 
-template<typename TK>
-class BTree {
-    using BNode = Node<TK>;
+// Cabecera de BasicBTree::dump. Le siguen las entradas en orden, cada una con los bytes de su key
+// (y de su valor, en BTreeMap) tal como están en memoria, con el endianness de quien la escribió.
+struct BTreeDumpHeader {
+    std::uint64_t magic;
+    std::uint32_t key_size;
+    std::uint32_t value_size;  // 0 si no hay valores
+    std::uint64_t count;
+};
 
-    std::size_t M;
+inline constexpr std::uint64_t btree_dump_magic = 0x31504D44'45525442;  // "BTREDMP1"
+
+// Implementación común de BTree (V = void, solo keys) y BTreeMap (cada key lleva un valor de tipo
+// V). Ambos usan los mismos nodos y los mismos algoritmos: donde se mueve una key, se mueve su
+// "entrada" completa (key y valor).
+//
+// Las keys se ordenan con Compare. Si Compare es transparente (tiene is_transparent, como
+// std::less<>), las búsquedas aceptan cualquier tipo comparable con TK sin construir un TK
+// temporal; si no, la key se convierte a TK una sola vez al entrar.
+//
+// Con Counted, cada nodo guarda además la cantidad de keys de su subárbol, que se mantiene en cada
+// insert, split, préstamo y merge. Con eso rank, select y count_range toman O(log n).
+//
+// Filter decide si hay un filtro de keys delante de las búsquedas por igualdad (search, find,
+// search_batch). Con NoKeyFilter no hay ninguno y no ocupa memoria; con BlockedBloomFilter una
+// búsqueda de una key que no está suele responderse mirando una sola cache line, sin bajar.
+template<typename TK,
+         typename V,
+         std::size_t Order,
+         typename Compare,
+         typename Search,
+         bool Counted = false,
+         typename Filter = NoKeyFilter>
+class BasicBTree {
+    using BNode = Node<TK, Order, V, false, Counted>;
+    using Pool = NodePool<TK, Order, V, false, Counted>;
+
+    static constexpr bool is_map = !std::is_void_v<V>;
+    static constexpr std::size_t capacity = Order == dynamic_order ? 0 : Order - 1;
+
+    // V, o un tipo cualquiera cuando V = void, para poder declarar la interfaz de BTreeMap (que
+    // queda deshabilitada) sin formar tipos como void&
+    using Mapped = std::conditional_t<is_map, V, char>;
+
+    // Lo que se guarda por cada key: la key sola, o el par (key, valor) en BTreeMap
+    using Entry = std::conditional_t<is_map, std::pair<TK, Mapped>, TK>;
+
+    static constexpr bool transparent = requires { typename Compare::is_transparent; };
+
+    // Nodo y posición de una entrada
+    using Position = std::pair<BNode*, std::size_t>;
+
+    // El fan-out mínimo sale del mínimo más bajo que acepta set_min_fill, y se suma un nivel por
+    // el borde derecho, que con SplitPolicy::append puede tener nodos de una sola key.
+    static constexpr std::size_t max_depth = max_tree_depth(
+        Order == dynamic_order ? 2 : std::max<std::size_t>(1, (Order - 1) / 4) + 1, 1);
+
+    static constexpr double lowest_min_fill = 0.25;
+
+    // Niveles que un iterador guarda sin reservar memoria. Con M = 16, 8 niveles ya son más de
+    // 2^28 keys.
+    static constexpr std::size_t iterator_frames = std::min<std::size_t>(max_depth, 8);
+
+    // Tipo con el que se compara una key de tipo K recibida en una búsqueda
+    template<typename K>
+    using LookupKey = std::conditional_t<transparent, K, TK>;
+
+    [[no_unique_address]] OrderValue<Order> M;
+    [[no_unique_address]] Compare comp;
+    Pool pool{M};
     BNode* root = nullptr;
-    std::size_t n = 0;
+
+    // Después de split() no se sabe cuántas keys quedaron en cada mitad sin recorrerlas: n queda
+    // en unknown_size y size() las cuenta la primera vez que se pide
+    static constexpr std::size_t unknown_size = static_cast<std::size_t>(-1);
+    mutable std::size_t n = 0;
+
+    // Ver set_split_policy y set_min_fill. swap los intercambia junto con los nodos, que pueden
+    // depender de ellos.
+    SplitPolicy split_mode = SplitPolicy::even;
+    double min_fraction = 0.5;
+    std::size_t min_count = (M - 1) / 2;
+
+    // Se actualiza en insert_at y erase_at, y se rearma cuando filter.stale() lo pide
+    [[no_unique_address]] Filter filter;
+
+#ifdef BTREE_STATS
+    // Son del objeto y no del contenido: swap (y por lo tanto clear) no los toca
+    mutable BTreeCounters counts;
+#endif
+
+    // Suma uno al contador, solo con BTREE_STATS
+    void count([[maybe_unused]] std::uint64_t BTreeCounters::* const counter) const {
+#ifdef BTREE_STATS
+        ++(counts.*counter);
+#endif
+    }
+
+    // Raíz y altura de un subárbol que todavía no es un árbol completo (join_nodes, split_node)
+    struct Subtree {
+        BNode* root = nullptr;
+        std::ptrdiff_t height = -1;
+    };
+
+    // Cantidad de keys del subárbol de node (0 para nullptr). Solo con Counted.
+    static std::size_t subtree_size(const BNode* const node) {
+        if constexpr (Counted)
+            return node == nullptr ? 0 : node->subtree.value;
+        else
+            return 0;
+    }
+
+    // Recalcula la cantidad de keys del subárbol de node a partir de la de sus children
+    static void recount(BNode* const node) {
+        if constexpr (Counted) {
+            std::size_t size = node->count;
+            if (!node->leaf)
+                for (std::size_t i = 0; i < node->count + 1; ++i)
+                    size += node->children[i]->subtree.value;
+
+            node->subtree.value = size;
+        }
+    }
+
+    // Suma delta (que puede ser negativo) a la cantidad de keys de node
+    static void add_size(BNode* const node, const std::ptrdiff_t delta) {
+        if constexpr (Counted)
+            node->subtree.value += static_cast<std::size_t>(delta);
+    }
+
+    // Suma delta a la cantidad de keys de cada nodo de path[0, depth)
+    static void add_size(const Position* const path,
+                         const std::size_t depth,
+                         const std::ptrdiff_t delta) {
+        if constexpr (Counted)
+            for (std::size_t i = 0; i < depth; ++i)
+                add_size(path[i].first, delta);
+    }
+
+    static const TK& key_of(const Entry& entry) {
+        if constexpr (is_map)
+            return entry.first;
+        else
+            return entry;
+    }
+
+    // Guarda una entrada (o algo convertible, como el par de un vector de entrada) en node[i]
+    template<typename E>
+    static void store(BNode* const node, const std::size_t i, E&& entry) {
+        if constexpr (is_map) {
+            node->keys[i] = std::forward<E>(entry).first;
+            node->values[i] = std::forward<E>(entry).second;
+        } else {
+            node->keys[i] = std::forward<E>(entry);
+        }
+    }
+
+    // Saca (moviendo) la entrada node[i]
+    static Entry take(BNode* const node, const std::size_t i) {
+        if constexpr (is_map)
+            return Entry(std::move(node->keys[i]), std::move(node->values[i]));
+        else
+            return std::move(node->keys[i]);
+    }
+
+    static void move_entry(BNode* const dst,
+                           const std::size_t j,
+                           BNode* const src,
+                           const std::size_t i) {
+        dst->keys[j] = std::move(src->keys[i]);
+        if constexpr (is_map)
+            dst->values[j] = std::move(src->values[i]);
+    }
+
+    // Índice de la primera key >= key dentro del nodo. Lo usan search, insert y remove.
+    template<typename K>
+    std::size_t rank(const BNode* const node, const K& key) const {
+#ifdef BTREE_STATS
+        if (node == root)
+            ++counts.searches;
+        ++counts.node_visits;
+
+        // Las comparaciones pasan por un comparador que las cuenta. Como ya no es std::less, la
+        // política usa su versión escalar en vez de los bloques SIMD.
+        const auto counting = [this](const auto& a, const auto& b) {
+            ++counts.comparisons;
+            return comp(a, b);
+        };
+        return Search::template rank<capacity>(node->keys, node->count, key, counting);
+#else
+        return Search::template rank<capacity>(node->keys, node->count, key, comp);
+#endif
+    }
+
+    // Si node->keys[idx], la primera key >= key, es equivalente a key
+    template<typename K>
+    bool matches(const BNode* const node, const std::size_t idx, const K& key) const {
+        if (idx >= node->count)
+            return false;
+
+        count(&BTreeCounters::comparisons);
+        return !comp(key, node->keys[idx]);
+    }
+
+    // Si el filtro asegura que key no está. Las keys de un tipo que el filtro no sabe hashear
+    // siempre bajan.
+    template<typename K>
+    [[nodiscard]] bool filtered_out(const K& key) const {
+        if constexpr (Filter::enabled) {
+            if constexpr (Filter::template probes<K>) {
+                if (!filter.may_contain(key)) {
+                    count(&BTreeCounters::filtered_misses);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Vuelve a armar el filtro si se llenó, si tiene demasiadas keys borradas o si no es válido
+    void refresh_filter() {
+        if constexpr (Filter::enabled) {
+            if (filter.stale())
+                rebuild_key_filter();
+        }
+    }
+
+    void rebuild_key_filter()
+        requires Filter::enabled
+    {
+        filter.rebuild(size(), [this](const auto& add) {
+            const auto visit = [&](const const_reference entry) { add(key_of(entry)); };
+            if (root != nullptr)
+                scan(root, visit);
+        });
+    }
+
+    // Búsquedas que search_batch avanza juntas, un nivel a la vez
+    static constexpr std::size_t batch_width = 16;
+    static constexpr std::size_t max_prefetch_lines = 8;
+
+    // Pide a la cache las líneas del nodo que usa rank() (cabecera y keys), sin esperar a que
+    // lleguen. En orden dinámico las keys están en el mismo bloque del pool, después del nodo.
+    void prefetch(const BNode* const node) const {
+#if defined(__GNUC__) || defined(__clang__)
+        std::size_t bytes = 0;
+        if constexpr (Order == dynamic_order)
+            bytes = sizeof(BNode) + (M - 1) * sizeof(TK);
+        else
+            bytes = offsetof(BNode, children);
+
+        const auto* const base = reinterpret_cast<const char*>(node);
+        const std::size_t lines =
+            std::min(max_prefetch_lines, (bytes + cache_line_size - 1) / cache_line_size);
+
+        for (std::size_t i = 0; i < lines; ++i)
+            __builtin_prefetch(base + i * cache_line_size, 0, 3);
+#else
+        (void)node;
+#endif
+    }
+
+    // Busca todas las keys de `keys` (en el orden dado por `order`) y llama a found(i, ptr) para
+    // cada una, con ptr = nullptr si keys[i] no está. Toma grupos de batch_width búsquedas y las
+    // baja juntas por el árbol: mientras se compara el nodo de una, ya se pidió el de las demás.
+    template<typename Found>
+    void lookup_batch(const std::span<const TK> keys,
+                      const std::span<const std::size_t> order,
+                      Found&& found) const {
+        const auto nth = [&](const std::size_t j) {
+            return order.empty() ? j : order[j];
+        };
+
+        if (root == nullptr) {
+            for (std::size_t j = 0; j < keys.size(); ++j)
+                found(nth(j), static_cast<const TK*>(nullptr));
+            return;
+        }
+
+        prefetch(root);
+
+        for (std::size_t first = 0; first < keys.size(); first += batch_width) {
+            const std::size_t width = std::min(batch_width, keys.size() - first);
+
+            const BNode* cur[batch_width];
+            std::size_t pending[batch_width];
+            std::size_t active = 0;
+
+            for (std::size_t j = 0; j < width; ++j) {
+                const std::size_t i = nth(first + j);
+                if (filtered_out(keys[i])) {
+                    found(i, static_cast<const TK*>(nullptr));
+                    continue;
+                }
+
+                cur[active] = root;
+                pending[active++] = i;
+            }
+
+            while (active > 0) {
+                for (std::size_t j = 0; j < active;) {
+                    const BNode* const node = cur[j];
+                    const TK& key = keys[pending[j]];
+                    const std::size_t idx = rank(node, key);
+
+                    const bool hit = matches(node, idx, key);
+                    if (hit || node->leaf) {
+                        found(pending[j], hit ? &node->keys[idx] : nullptr);
+
+                        // Esta búsqueda terminó: la reemplaza la última activa
+                        --active;
+                        cur[j] = cur[active];
+                        pending[j] = pending[active];
+                        continue;
+                    }
+
+                    cur[j] = node->children[idx];
+                    prefetch(cur[j]);
+                    ++j;
+                }
+            }
+        }
+    }
+
+    // Permutación de índices que recorre keys en orden, para que búsquedas vecinas compartan el
+    // camino cerca de la raíz
+    std::vector<std::size_t> sorted_order(const std::span<const TK> keys) const {
+        std::vector<std::size_t> order(keys.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+
+        std::sort(order.begin(), order.end(),
+                  [&](const std::size_t a, const std::size_t b) { return comp(keys[a], keys[b]); });
+        return order;
+    }
 
     static std::ptrdiff_t height(const BNode* const node) {
         std::ptrdiff_t height = -1;
@@ -37,20 +395,32 @@ class BTree {
     // El retorno es (valid, height, min_key, max_key)
     // Cuando valid = false, el resto de valores se ignoran, así que les asignamos -1s y nullptrs.
     std::tuple<bool, std::ptrdiff_t, const TK*, const TK*> check_properties(
-        const BNode* const node) const {
+        const BNode* const node,
+        const bool right_edge = true) const {
         if (node == nullptr)
             return {true, -1, nullptr, nullptr};
 
-        const std::size_t min_keys = node == root ? 1 : std::ceil(M / 2.0) - 1;
+        const std::size_t lowest = node == root ? 1 : min_keys(right_edge);
         const std::size_t max_keys = M - 1;
 
         // Check key count
-        if (node->count < min_keys || node->count > max_keys)
+        if (node->count < lowest || node->count > max_keys)
             return {false, -1, nullptr, nullptr};
 
+        // Subtree sizes must add up
+        if constexpr (Counted) {
+            std::size_t size = node->count;
+            if (!node->leaf)
+                for (std::size_t i = 0; i < node->count + 1; ++i)
+                    size += subtree_size(node->children[i]);
+
+            if (node->subtree.value != size)
+                return {false, -1, nullptr, nullptr};
+        }
+
         // Keys must be ordered
         for (std::size_t i = 0; i < node->count - 1; ++i) {
-            if (node->keys[i] >= node->keys[i + 1])
+            if (!comp(node->keys[i], node->keys[i + 1]))
                 return {false, -1, nullptr, nullptr};
         }
 
@@ -68,7 +438,7 @@ class BTree {
             // Check properties recursively
             for (std::size_t i = 0; i < node->count + 1; ++i) {
                 const auto [result, sub_height, min_key, max_key] =
-                    check_properties(node->children[i]);
+                    check_properties(node->children[i], right_edge && i == node->count);
                 if (!result)
                     return {false, -1, nullptr, nullptr};
 
@@ -85,7 +455,7 @@ class BTree {
 
             // Check that subtrees go inside the correct keys
             for (std::size_t i = 0; i < node->count; ++i) {
-                if (node->keys[i] < *maxs[i] || node->keys[i] >= *mins[i + 1])
+                if (!comp(*maxs[i], node->keys[i]) || !comp(node->keys[i], *mins[i + 1]))
                     return {false, -1, nullptr, nullptr};
             }
 
@@ -101,46 +471,25 @@ class BTree {
         return {true, 0, &node->keys[0], &node->keys[node->count - 1]};
     }
 
-    static std::string toString(BNode* node, const std::string& sep = ",") {
+    static std::size_t count_keys(const BNode* const node) {
         if (node == nullptr)
-            return "";
-
-        std::string result;
-
-        for (std::size_t i = 0; i < node->count; ++i) {
-            if (!node->leaf)
-                result += toString(node->children[i], sep) + sep;
-
-            result += std::to_string(node->keys[i]);
-
-            if (i < node->count - 1)
-                result += sep;
-        }
+            return 0;
 
+        std::size_t count = node->count;
         if (!node->leaf)
-            result += sep + toString(node->children[node->count], sep);
+            for (std::size_t i = 0; i < node->count + 1; ++i)
+                count += count_keys(node->children[i]);
 
-        return result;
+        return count;
     }
 
-    static void rangeSearch(BNode* const node,
-                            std::vector<const TK&>& out,
-                            const TK& begin,
-                            const TK& end) {
-        if (node == nullptr)
-            return;
-
-        for (std::size_t i = 0; i < node->count; ++i) {
-            const TK& key = node->keys[i];
-
-            if (begin < key)
-                rangeSearch(node->children[i], out, begin, end);
+    static BNode* minNode(BNode* const node) {
+        BNode* cur = node;
 
-            if (key >= begin && end >= key)
-                out.push(key);
-        }
+        while (!cur->leaf)
+            cur = cur->children[0];
 
-        rangeSearch(node->children[node->count], out, begin, end);
+        return cur;
     }
 
     static const TK& minKey(const BNode* const node) {
@@ -161,131 +510,111 @@ class BTree {
         return cur->keys[cur->count - 1];
     }
 
-    // Returns:
-    // - bool if the result didn't split. Indicates "inserted".
-    // - (TK, Node*) if there was a split (implies inserted = true)
-    std::variant<bool, std::pair<TK, BNode*>> insert(BNode* const node, TK key) {
-        // Los comentarios en esta función son prueba de mi travesía intentando insertar en un
-        // BTree...
-        //
-        // (programar pensando en inglés es peak)
-
-        if (node == nullptr)
-            return std::pair{key, nullptr};  // We went past a leaf. Gotta insert back up...
-
-        std::size_t i = 0;
-        while (i < node->count && node->keys[i] < key)
-            ++i;
-
-        if (i < node->count && node->keys[i] == key)
-            return false;  // Key already exists
-
-        // Insert between the correct keys
-        auto result = insert(node->children[i], std::move(key));
-
-        if (std::holds_alternative<bool>(result))
-            return result;  // Nothing to propagate, we're done here.
-
-        // Well, we got a split.
-        auto& [new_key, new_child] = std::get<std::pair<TK, BNode*>>(result);
-
-        // Got space left?
-        if (node->count < M - 1) {
-            // Got space left.
-            node->children[node->count + 1] = node->children[node->count];
+    // Construye la entrada de key en el lugar, con el valor hecho a partir de args en BTreeMap
+    template<typename K, typename... Args>
+    static Entry make_entry(K&& key, Args&&... args) {
+        if constexpr (is_map)
+            return Entry(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                         std::forward_as_tuple(std::forward<Args>(args)...));
+        else
+            return Entry(std::forward<K>(key));
+    }
 
-            for (std::size_t j = node->count; j > i; --j) {
-                node->keys[j] = std::move(node->keys[j - 1]);
-                node->children[j] = node->children[j - 1];
-            }
+    // node está lleno y le falta la entrada `entry` en la posición i, con `left` (el nodo que
+    // quedó a la izquierda de entry en el split de abajo) como children[i]. Reparte las M entradas
+    // moviendo cada una directo a su lugar final: las primeras `mid` van a un nodo nuevo a la
+    // izquierda, la siguiente queda en entry para subir y el resto se corre al inicio de node.
+    // Retorna el nodo nuevo. Si `where` aún está vacío, lo apunta a donde quedó entry.
+    BNode* split(BNode* const node,
+                 const std::size_t i,
+                 Entry& entry,
+                 BNode* const left,
+                 Position& where,
+                 const std::size_t mid) {
+#if defined(__GNUC__) || defined(__clang__)
+        // i va de 0 a M - 1 y mid deja al menos una key a la derecha. Sin decirlo, GCC no puede
+        // probar que node[j - 1] y node[mid] están dentro de keys y avisa con -Warray-bounds.
+        if (i >= M || mid >= M - 1)
+            __builtin_unreachable();
+#endif
 
-            node->keys[i] = std::move(new_key);
-            node->children[i] = new_child;
-            ++node->count;
+        // Entrada j y child j de la secuencia con entry ya insertada
+        const auto put = [&](BNode* const dst, const std::size_t k, const std::size_t j) {
+            if (j == i)
+                store(dst, k, std::move(entry));
+            else
+                move_entry(dst, k, node, j < i ? j : j - 1);
+        };
+        const auto child = [&](const std::size_t j) {
+            return j == i ? left : node->children[j < i ? j : j - 1];
+        };
+
+        const bool pending = where.first == nullptr;
+        count(&BTreeCounters::splits);
+
+        auto* const lsplit = pool.create();
+        lsplit->leaf = node->leaf;
+        lsplit->count = mid;
 
-            return true;
+        for (std::size_t j = 0; j < mid; ++j) {
+            put(lsplit, j, j);
+            lsplit->children[j] = child(j);
         }
+        lsplit->children[mid] = child(mid);
 
-        // Don't got space left.
+        Entry lifted = i == mid ? std::move(entry) : take(node, mid < i ? mid : mid - 1);
 
-        // Move keys to temporary "overflowed" list
-        TK keys_tmp[M];
-        BNode* children_tmp[M + 1];
-        std::size_t e = 0;
-        bool new_key_pending = true;
-
-        for (std::size_t j = 0; j < M; ++j) {
-            if (new_key_pending && (e >= node->count || new_key < node->keys[e])) {
-                keys_tmp[j] = std::move(new_key);
-                children_tmp[j] = new_child;
-                new_key_pending = false;
-            } else {
-                keys_tmp[j] = std::move(node->keys[e]);
-                children_tmp[j] = std::exchange(node->children[e], nullptr);
-                ++e;
-            }
+        // Lo que queda se corre hacia la izquierda: cada lectura está a la derecha de su escritura
+        const std::size_t right_count = M - 1 - mid;
+        for (std::size_t k = 0; k < right_count; ++k) {
+            put(node, k, mid + 1 + k);
+            node->children[k] = child(mid + 1 + k);
         }
+        node->children[right_count] = child(M);
 
-        children_tmp[M] = std::exchange(node->children[M - 1], nullptr);
-
-        const std::size_t mid = (M - 1) / 2;
-        const TK lifted = std::move(keys_tmp[mid]);
+        for (std::size_t k = right_count + 1; k < M; ++k)
+            node->children[k] = nullptr;
 
-        auto* const lsplit = new BNode(M);
-        lsplit->leaf = node->leaf;
-
-        // Split sizes (if split is uneven, left is 1 key smaller)
-        lsplit->count = mid;
-        node->count = M - 1 - mid;
-
-        for (std::size_t k = 0; k < lsplit->count; ++k) {
-            lsplit->keys[k] = std::move(keys_tmp[k]);
-            lsplit->children[k] = children_tmp[k];
-        }
-
-        lsplit->children[lsplit->count] = children_tmp[mid];
+        node->count = right_count;
+        entry = std::move(lifted);
 
-        for (std::size_t k = 0; k < node->count; ++k) {
-            node->keys[k] = std::move(keys_tmp[mid + 1 + k]);
-            node->children[k] = children_tmp[mid + 1 + k];
-        }
+        // node ya contaba todas las keys, incluida entry
+        recount(lsplit);
+        add_size(node, -static_cast<std::ptrdiff_t>(subtree_size(lsplit) + 1));
 
-        node->children[node->count] = children_tmp[M];
+        if (pending && i != mid)
+            where = i < mid ? Position{lsplit, i} : Position{node, i - mid - 1};
 
-        return std::pair{lifted, lsplit};
+        return lsplit;
     }
 
-    // static void prune_duplicates(BNode* node) {
-    //     if (node == nullptr || node->leaf)
-    //         return;
-    //
-    //     for (std::size_t i = 0; i <= node->count; ++i) {
-    //         prune_duplicates(node->children[i]);
-    //     }
-    //
-    //     for (std::size_t i = 0; i < node->count; ++i) {
-    //         BNode* child = node->children[i];
-    //         TK sep = node->keys[i];
-    //
-    //         if (child->count > 0 && child->keys[child->count - 1] == sep)
-    //             --child->count;
-    //     }
-    // }
-
-    void swap(BTree& other) noexcept {
+    void swap(BasicBTree& other) noexcept {
         std::swap(root, other.root);
         std::swap(n, other.n);
         std::swap(M, other.M);
+        std::swap(comp, other.comp);
+        std::swap(split_mode, other.split_mode);
+        std::swap(min_fraction, other.min_fraction);
+        std::swap(min_count, other.min_count);
+        std::swap(filter, other.filter);
+        pool.swap(other.pool);
+    }
+
+    void adopt_balance(const BasicBTree& other) {
+        split_mode = other.split_mode;
+        min_fraction = other.min_fraction;
+        min_count = other.min_count;
     }
 
-    static void merge_children(BNode* const node, const std::size_t i) {
+    void merge_children(BNode* const node, const std::size_t i) {
         BNode* const left = node->children[i];
         BNode* const right = node->children[i + 1];
+        count(&BTreeCounters::merges);
 
-        left->keys[left->count] = std::move(node->keys[i]);
+        move_entry(left, left->count, node, i);
 
         for (std::size_t k = 0; k < right->count; ++k) {
-            left->keys[left->count + 1 + k] = std::move(right->keys[k]);
+            move_entry(left, left->count + 1 + k, right, k);
             left->children[left->count + 1 + k] = std::exchange(right->children[k], nullptr);
         }
 
@@ -293,11 +622,12 @@ class BTree {
             std::exchange(right->children[right->count], nullptr);
 
         left->count += 1 + right->count;
+        add_size(left, static_cast<std::ptrdiff_t>(subtree_size(right) + 1));
 
-        delete std::exchange(node->children[i + 1], node->children[i]);
+        pool.destroy(std::exchange(node->children[i + 1], node->children[i]));
 
         for (std::size_t k = i; k < node->count - 1; ++k) {
-            node->keys[k] = std::move(node->keys[k + 1]);
+            move_entry(node, k, node, k + 1);
             node->children[k] = std::exchange(node->children[k + 1], nullptr);
         }
 
@@ -306,363 +636,2732 @@ class BTree {
         --node->count;
     }
 
-    enum class DeleteResult : std::uint8_t {
-        NotDeleted,
-        JustDeleted,
-        Deleted,
-    };
+    [[nodiscard]] std::size_t min_keys() const {
+        return min_count;
+    }
 
-    DeleteResult remove(BNode* node, const TK& key) {
-        if (node == nullptr)
-            return DeleteResult::NotDeleted;
+    // Mínimo de un nodo que no es la raíz. Con SplitPolicy::append, los del borde derecho (los que
+    // reciben las keys que se agregan al final) pueden quedar con una sola.
+    [[nodiscard]] std::size_t min_keys(const bool right_edge) const {
+        return right_edge && split_mode == SplitPolicy::append ? 1 : min_count;
+    }
 
-        std::size_t i = 0;
-        while (i < node->count && node->keys[i] < key)
-            ++i;
+    // Cuántos frames de path[0, depth), desde la raíz, bajan por el último child. El nodo de
+    // path[d] está en el borde derecho si d es a lo más ese valor.
+    static std::size_t right_edge_depth(const Position* const path, const std::size_t depth) {
+        std::size_t edge = 0;
+        while (edge < depth && path[edge].second == path[edge].first->count)
+            ++edge;
+        return edge;
+    }
 
-        const bool found_key = i < node->count && node->keys[i] == key;
+    // Deja los nodos del borde derecho con el mínimo de los demás, de abajo hacia arriba: cada uno
+    // toma keys de su hermano izquierdo o se funde con él, como en remove
+    void settle_right_edge() {
+        Position path[max_depth];
+        std::size_t depth = 0;
+        for (BNode* node = root; node != nullptr && !node->leaf;
+             node = node->children[node->count])
+            path[depth++] = {node, node->count};
+
+        while (depth > 0) {
+            BNode* const parent = path[--depth].first;
+            const std::size_t last = parent->count;
+
+            while (parent->children[last]->count < min_count &&
+                   parent->children[last - 1]->count > min_count)
+                borrow_left(parent, last);
+
+            if (parent->children[last]->count < min_count)
+                merge_children(parent, last - 1);
+        }
 
-        if (found_key && node->leaf) {
-            // Found the key!
-            for (std::size_t k = i; k < node->count - 1; ++k)
-                node->keys[k] = std::move(node->keys[k + 1]);
+        if (root->count == 0) {
+            BNode* const old_root = root;
+            root = root->children[0];
+            pool.destroy(old_root);
+            count(&BTreeCounters::height_decreases);
+        }
+    }
 
-            --node->count;
-            return DeleteResult::JustDeleted;
+    // Mueve todas las entradas del subárbol de node a out, en orden
+    static void take_all(BNode* const node, std::vector<Entry>& out) {
+        for (std::size_t i = 0; i < node->count; ++i) {
+            if (!node->leaf)
+                take_all(node->children[i], out);
+            out.push_back(take(node, i));
         }
 
-        DeleteResult result{};
+        if (!node->leaf)
+            take_all(node->children[node->count], out);
+    }
+
+    // children[i] de node tomó las últimas `taken` entradas de children[i - 1], rotando por el
+    // separador: el separador y las taken - 1 últimas de la izquierda pasan al comienzo, y la que
+    // queda antes de ellas es el separador nuevo. Cada nodo se corre una sola vez.
+    void borrow_left(BNode* const node, const std::size_t i, const std::size_t taken = 1) {
+        BNode* const mid = node->children[i];
+        BNode* const left = node->children[i - 1];
+        count(&BTreeCounters::borrows_left);
 
-        if (found_key) {
-            const TK& succ = minKey(node->children[i + 1]);
-            node->keys[i] = succ;
-            result = remove(node->children[i + 1], succ);
-        } else {
-            result = remove(node->children[i], key);
+        mid->children[mid->count + taken] = mid->children[mid->count];
+        for (std::size_t k = mid->count; k > 0; --k) {
+            move_entry(mid, k - 1 + taken, mid, k - 1);
+            mid->children[k - 1 + taken] = mid->children[k - 1];
         }
 
-        if (result != DeleteResult::JustDeleted)
-            return result;
+        const std::size_t from = left->count - taken + 1;
+        move_entry(mid, taken - 1, node, i - 1);
+        for (std::size_t k = 0; k + 1 < taken; ++k)
+            move_entry(mid, k, left, from + k);
+        for (std::size_t k = 0; k < taken; ++k)
+            mid->children[k] = std::exchange(left->children[from + k], nullptr);
+        move_entry(node, i - 1, left, from - 1);
+
+        mid->count += taken;
+        left->count -= taken;
+
+        if constexpr (Counted) {
+            std::ptrdiff_t moved = 0;
+            for (std::size_t k = 0; k < taken; ++k)
+                moved += static_cast<std::ptrdiff_t>(subtree_size(mid->children[k]) + 1);
+            add_size(mid, moved);
+            add_size(left, -moved);
+        }
+    }
+
+    // children[i] de node tomó las primeras `taken` entradas de children[i + 1], rotando por el
+    // separador, como borrow_left pero hacia el otro lado
+    void borrow_right(BNode* const node, const std::size_t i, const std::size_t taken = 1) {
+        BNode* const mid = node->children[i];
+        BNode* const right = node->children[i + 1];
+        count(&BTreeCounters::borrows_right);
+
+        const std::size_t at = mid->count + 1;
+        move_entry(mid, mid->count, node, i);
+        for (std::size_t k = 0; k + 1 < taken; ++k)
+            move_entry(mid, at + k, right, k);
+        for (std::size_t k = 0; k < taken; ++k)
+            mid->children[at + k] = right->children[k];
+        move_entry(node, i, right, taken - 1);
+
+        for (std::size_t k = 0; k + taken < right->count; ++k) {
+            move_entry(right, k, right, k + taken);
+            right->children[k] = right->children[k + taken];
+        }
 
-        // Only here we might need to fix properties.
-        // (This is the actually hard part)
+        right->children[right->count - taken] = right->children[right->count];
+        for (std::size_t k = right->count - taken + 1; k <= right->count; ++k)
+            right->children[k] = nullptr;
 
-        const std::size_t MIN_KEYS = std::ceil(M / 2.0) - 1;
+        mid->count += taken;
+        right->count -= taken;
 
-        BNode* const mid = node->children[i];
+        if constexpr (Counted) {
+            std::ptrdiff_t moved = 0;
+            for (std::size_t k = 0; k < taken; ++k)
+                moved += static_cast<std::ptrdiff_t>(subtree_size(mid->children[at + k]) + 1);
+            add_size(mid, moved);
+            add_size(right, -moved);
+        }
+    }
 
-        if (mid->count >= MIN_KEYS)
-            return result;
+    // Baja desde child por el borde derecho (o izquierdo, con rightmost = false) hasta una hoja,
+    // agregando el camino a path. Retorna la hoja.
+    BNode* push_edge(BNode* child, Position* const path, std::size_t& depth, const bool rightmost) {
+        while (!child->leaf) {
+            const std::size_t idx = rightmost ? child->count : 0;
+            path[depth++] = {child, idx};
+            child = child->children[idx];
+        }
 
-        // We gotta fix node->children[i]
+        return child;
+    }
 
-        if (i > 0 && node->children[i - 1]->count > MIN_KEYS) {
-            // Borrow from left
-            BNode* const left = node->children[i - 1];
+    // Borrado en una sola bajada: se guarda el camino hasta la key y erase_at sigue desde ahí
+    template<typename K>
+    bool remove_key(const K& key) {
+        if (filtered_out(key))
+            return false;
 
-            mid->children[mid->count + 1] = std::exchange(mid->children[mid->count], nullptr);
+        Position path[max_depth];
+        std::size_t depth = 0;
 
-            for (std::size_t k = mid->count; k > 0; ++k) {
-                mid->keys[k] = std::move(mid->keys[k - 1]);
-                mid->children[k] = std::exchange(mid->children[k - 1], nullptr);
+        for (BNode* node = root; node != nullptr; node = node->children[path[depth - 1].second]) {
+            const std::size_t idx = rank(node, key);
+            if (matches(node, idx, key)) {
+                erase_at(path, depth, node, idx);
+                return true;
             }
 
-            mid->keys[0] = std::move(node->keys[i - 1]);
-            mid->children[0] = std::exchange(left->children[left->count], nullptr);
-            node->keys[i - 1] = std::move(left->keys[left->count - 1]);
+            path[depth++] = {node, idx};
+        }
+
+        return false;
+    }
 
-            ++mid->count;
-            --left->count;
+    // Borra node->keys[idx], con path[0, depth) el camino desde la raíz hasta node. Si node es
+    // interno, se sigue hasta la hoja de su predecesor o sucesor, que sube moviéndose a su lugar.
+    // Después se recorre el camino hacia arriba arreglando los nodos que quedaron con menos del
+    // mínimo.
+    void erase_at(Position* const path,
+                  std::size_t depth,
+                  BNode* const node,
+                  const std::size_t idx) {
+        BNode* leaf = node;
+        std::size_t pos = idx;
 
-            return DeleteResult::Deleted;  // We're done.
+        if (!node->leaf) {
+            // Se prefiere el reemplazo cuya hoja puede prestar una key, así no hay que arreglar
+            // nada después. Si ninguna puede, se usa el predecesor.
+            const std::size_t base = depth;
+            path[depth++] = {node, idx};
+            leaf = push_edge(node->children[idx], path, depth, true);
+            pos = leaf->count - 1;
+
+            if (leaf->count <= min_keys() && minNode(node->children[idx + 1])->count > min_keys()) {
+                depth = base;
+                path[depth++] = {node, idx + 1};
+                leaf = push_edge(node->children[idx + 1], path, depth, false);
+                pos = 0;
+            }
+
+            move_entry(node, idx, leaf, pos);
         }
 
-        if (i < node->count && node->children[i + 1]->count > MIN_KEYS) {
-            // Borrow from right
-            BNode* const right = node->children[i + 1];
+        for (std::size_t k = pos; k + 1 < leaf->count; ++k)
+            move_entry(leaf, k, leaf, k + 1);
+        --leaf->count;
+        if (n != unknown_size)
+            --n;
+        if constexpr (Filter::enabled)
+            filter.remove();
 
-            mid->keys[mid->count] = std::move(node->keys[i]);
-            mid->children[mid->count + 1] = std::exchange(right->children[0], nullptr);
-            node->keys[i] = std::move(right->keys[0]);
+        add_size(path, depth, -1);
+        add_size(leaf, -1);
+        rebalance(path, depth, leaf);
+    }
 
-            for (std::size_t k = 0; k < right->count - 1; ++k) {
-                right->keys[k] = std::move(right->keys[k + 1]);
-                right->children[k] = std::exchange(right->children[k + 1], nullptr);
+    // child, al final del camino path[0, depth), perdió entradas y puede haber quedado bajo el
+    // mínimo. Sube arreglando mientras el nodo actual quede bajo el mínimo: si un hermano tiene
+    // todas las que le faltan sin quedar él bajo el suyo, se le piden de una vez y se termina; si
+    // no, los dos entran en un nodo y se juntan, lo que le quita una entrada al padre.
+    void rebalance(Position* const path, std::size_t depth, BNode* child) {
+        const std::size_t edge = right_edge_depth(path, depth);
+        while (depth > 0 && child->count < min_keys(depth <= edge)) {
+            const std::size_t missing = min_keys(depth <= edge) - child->count;
+            const auto [parent, i] = path[--depth];
+
+            if (i > 0 && parent->children[i - 1]->count >= min_keys() + missing) {
+                borrow_left(parent, i, missing);
+                break;
             }
 
-            right->children[right->count - 1] =
-                std::exchange(right->children[right->count], nullptr);
+            if (i < parent->count && parent->children[i + 1]->count >= min_keys() + missing) {
+                borrow_right(parent, i, missing);
+                break;
+            }
 
-            ++mid->count;
-            --right->count;
+            merge_children(parent, i < parent->count ? i : i - 1);
+            child = parent;
+        }
 
-            return DeleteResult::Deleted;  // We're done.
+        if (root->count == 0) {
+            BNode* const old_root = root;
+            root = root->leaf ? nullptr : root->children[0];
+            pool.destroy(old_root);
+            count(&BTreeCounters::height_decreases);
         }
 
-        // No borrow available! We have to merge.
-        if (i < node->count)
-            merge_children(node, i);  // Merge with right
-        else
-            merge_children(node, i - 1);  // Merge with left
+        refresh_filter();
+    }
+
+    // Saca la entrada con la key más grande. El árbol no debe estar vacío.
+    Entry pop_max() {
+        Position path[max_depth];
+        std::size_t depth = 0;
 
-        return DeleteResult::JustDeleted;
+        BNode* const leaf = push_edge(root, path, depth, true);
+        Entry entry = take(leaf, leaf->count - 1);
+        erase_at(path, depth, leaf, leaf->count - 1);
+        return entry;
     }
 
-public:
-    explicit BTree(const std::size_t M)
-        : M(M) {}
+    // Como borrow_left, pero con el separador sep fuera de los nodos: b toma sep como primera
+    // entrada (con el último child de a) y sep pasa a ser la última entrada de a
+    void rotate_right(BNode* const a, Entry& sep, BNode* const b) {
+        b->children[b->count + 1] = b->children[b->count];
+        for (std::size_t k = b->count; k > 0; --k) {
+            move_entry(b, k, b, k - 1);
+            b->children[k] = b->children[k - 1];
+        }
 
-    BTree(const BTree& other) = delete;
+        store(b, 0, std::move(sep));
+        b->children[0] = std::exchange(a->children[a->count], nullptr);
+        sep = take(a, a->count - 1);
 
-    BTree(BTree&& other) noexcept
-        : M(other.M) {
-        swap(other);
+        ++b->count;
+        --a->count;
+
+        const auto moved = static_cast<std::ptrdiff_t>(subtree_size(b->children[0]) + 1);
+        add_size(b, moved);
+        add_size(a, -moved);
     }
 
-    BTree& operator=(const BTree& other) = delete;
+    // Como borrow_right: a toma sep como última entrada (con el primer child de b) y sep pasa a ser
+    // la primera entrada de b
+    void rotate_left(BNode* const a, Entry& sep, BNode* const b) {
+        store(a, a->count, std::move(sep));
+        a->children[a->count + 1] = b->children[0];
+        sep = take(b, 0);
 
-    BTree& operator=(BTree&& other) noexcept {
-        swap(other);
-        return *this;
-    }
+        for (std::size_t k = 0; k + 1 < b->count; ++k) {
+            move_entry(b, k, b, k + 1);
+            b->children[k] = b->children[k + 1];
+        }
 
-    [[nodiscard]] bool search(TK key) const {
-        const BNode* cur = root;
+        b->children[b->count - 1] = b->children[b->count];
+        b->children[b->count] = nullptr;
 
-        while (cur != nullptr) {
-            std::size_t idx = 0;
-            while (idx < cur->count && key > cur->keys[idx])
-                idx++;
+        ++a->count;
+        --b->count;
 
-            if (idx < cur->count && key == cur->keys[idx])
-                return true;
+        const auto moved = static_cast<std::ptrdiff_t>(subtree_size(a->children[a->count]) + 1);
+        add_size(a, moved);
+        add_size(b, -moved);
+    }
 
-            cur = cur->children[idx];
+    // a se queda con sep y con todas las entradas y children de b, que se destruye
+    void concat(BNode* const a, Entry&& sep, BNode* const b) {
+        store(a, a->count, std::move(sep));
+
+        for (std::size_t k = 0; k < b->count; ++k) {
+            move_entry(a, a->count + 1 + k, b, k);
+            a->children[a->count + 1 + k] = std::exchange(b->children[k], nullptr);
         }
-        return false;
+
+        a->children[a->count + 1 + b->count] = std::exchange(b->children[b->count], nullptr);
+        a->count += 1 + b->count;
+        add_size(a, static_cast<std::ptrdiff_t>(subtree_size(b) + 1));
+
+        pool.destroy(b);
     }
 
-    ~BTree() {
-        if (root != nullptr) {
-            root->killSelf();
-            root = nullptr;
+    // Une l, pivot y r, con las keys de l < pivot < las keys de r, en O(|altura de l - altura de
+    // r| + 1). El más bajo se cuelga del borde del más alto a su misma altura, y si el padre ya
+    // estaba lleno se parte hacia arriba como en insert. Las raíces de l y r pueden estar bajo el
+    // mínimo: antes de colgar una se completa rotando keys desde su vecino, o se funde con él si
+    // ambos caben en un nodo.
+    Subtree join_nodes(const Subtree l, Entry&& pivot, const Subtree r) {
+        if (l.root == nullptr && r.root == nullptr) {
+            BNode* const leaf = pool.create();
+            store(leaf, 0, std::move(pivot));
+            leaf->count = 1;
+            recount(leaf);
+            return {leaf, 0};
         }
 
-        n = 0;
-    }
+        if (l.height == r.height) {
+            if (l.root->count + 1 + r.root->count <= M - 1) {
+                concat(l.root, std::move(pivot), r.root);
+                return l;
+            }
 
-    void insert(TK key) {
-        const auto result = insert(root, key);
+            BNode* const top = pool.create();
 
-        if (const bool* const inserted = std::get_if<bool>(&result)) {
-            if (*inserted)
-                ++n;
-            return;
+            while (l.root->count < min_keys())
+                rotate_left(l.root, pivot, r.root);
+            while (r.root->count < min_keys())
+                rotate_right(l.root, pivot, r.root);
+
+            top->leaf = false;
+            store(top, 0, std::move(pivot));
+            top->count = 1;
+            top->children[0] = l.root;
+            top->children[1] = r.root;
+            recount(top);
+            return {top, l.height + 1};
         }
 
-        auto [new_key, new_child] = std::get<std::pair<TK, BNode*>>(result);
+        Position path[max_depth];
+        std::size_t depth = 0;
+
+        if (l.height > r.height) {
+            // Baja por el borde derecho de l hasta el nodo de altura r.height + 1 (la hoja si r
+            // está vacío), donde pivot va al final con r a su derecha. Todos los nodos del camino
+            // ganan pivot y las keys de r.
+            BNode* node = l.root;
+            for (std::ptrdiff_t h = l.height; h > r.height + 1; --h) {
+                path[depth++] = {node, node->count};
+                node = node->children[node->count];
+            }
 
-        auto* const new_root = new BNode(M);
-        new_root->leaf = new_child == nullptr;
+            path[depth] = {node, node->count};
+            add_size(path, depth + 1, static_cast<std::ptrdiff_t>(subtree_size(r.root) + 1));
 
-        new_root->keys[0] = std::move(new_key);
-        new_root->count = 1;
+            BNode* left = nullptr;
+            if (r.root != nullptr) {
+                BNode* const last = node->children[node->count];
+                if (last->count + 1 + r.root->count <= M - 1) {
+                    concat(last, std::move(pivot), r.root);
+                    return l;
+                }
 
-        new_root->children[0] = new_child;
-        new_root->children[1] = root;
+                while (r.root->count < min_keys())
+                    rotate_right(last, pivot, r.root);
 
-        root = new_root;
-        ++n;
-    }
+                // insert_path deja a left a la izquierda de pivot y corre el child de ahí (r)
+                // a la derecha
+                node->children[node->count] = r.root;
+                left = last;
+            }
 
-    void remove(const TK& key) {
-        const DeleteResult result = remove(root, key);
+            path[depth++] = {node, node->count};
+            BNode* top = l.root;
+            insert_path(top, path, depth, std::move(pivot), left);
+            return {top, top == l.root ? l.height : l.height + 1};
+        }
 
-        if (result == DeleteResult::JustDeleted && root->count == 0)
-            delete std::exchange(root, root->children[0]);
+        // Simétrico: pivot va al inicio del nodo de altura l.height + 1 del borde izquierdo de r
+        BNode* node = r.root;
+        for (std::ptrdiff_t h = r.height; h > l.height + 1; --h) {
+            path[depth++] = {node, 0};
+            node = node->children[0];
+        }
 
-        const bool was_deleted =
-            result == DeleteResult::Deleted || result == DeleteResult::JustDeleted;
+        path[depth] = {node, 0};
+        add_size(path, depth + 1, static_cast<std::ptrdiff_t>(subtree_size(l.root) + 1));
 
-        if (was_deleted)
-            --n;
-    }
+        if (l.root != nullptr) {
+            BNode* const first = node->children[0];
+            if (l.root->count + 1 + first->count <= M - 1) {
+                concat(l.root, std::move(pivot), first);
+                node->children[0] = l.root;
+                return r;
+            }
 
-    [[nodiscard]] std::ptrdiff_t height() const {
-        return height(root);
-    }
+            while (l.root->count < min_keys())
+                rotate_left(l.root, pivot, first);
+        }
 
-    [[nodiscard]] std::string toString(const std::string& sep) const {
-        return toString(root, sep);
+        path[depth++] = {node, 0};
+        BNode* top = r.root;
+        insert_path(top, path, depth, std::move(pivot), l.root);
+        return {top, top == r.root ? r.height : r.height + 1};
     }
 
-    std::vector<const TK&> rangeSearch(const TK& begin, const TK& end) {
-        std::vector<const TK&> out;
-        rangeSearch(root, out, begin, end);
-        return out;
+    // Un pedazo de nodo sin keys no es un subárbol: se reemplaza por su único child
+    Subtree drop_empty_root(const Subtree tree) {
+        if (tree.root->count > 0)
+            return tree;
+
+        BNode* const child = tree.root->leaf ? nullptr : tree.root->children[0];
+        tree.root->children[0] = nullptr;
+        pool.destroy(tree.root);
+        return {child, tree.height - 1};
     }
 
-    [[nodiscard]] const TK& minKey() const {
-        if (root == nullptr)
-            throw std::runtime_error("BTree is empty");
+    // Parte el subárbol node, de altura h, en las keys < key y las >= key. Cada nodo del camino se
+    // corta en dos pedazos alrededor de key, y cada pedazo se une (join_nodes) con el resultado
+    // de su lado de más abajo. La suma de las diferencias de altura de esas uniones es O(h).
+    template<typename K>
+    std::pair<Subtree, Subtree> split_node(BNode* const node,
+                                           const std::ptrdiff_t h,
+                                           const K& key) {
+        const std::size_t idx = rank(node, key);
+
+        Subtree lsub;
+        Subtree rsub;
+        if (!node->leaf) {
+            if (matches(node, idx, key))
+                lsub = {node->children[idx], h - 1};
+            else
+                std::tie(lsub, rsub) = split_node(node->children[idx], h - 1, key);
 
-        return minKey(root);
-    }
+            node->children[idx] = nullptr;
+        }
 
-    [[nodiscard]] const TK& maxKey() const {
-        if (root == nullptr)
-            throw std::runtime_error("BTree is empty");
+        // Las entradas (idx, count) con sus children pasan a un nodo nuevo, y keys[idx] las une
+        // con rsub
+        Subtree right = rsub;
+        if (idx < node->count) {
+            BNode* const piece = pool.create();
+            piece->leaf = node->leaf;
+            piece->count = node->count - idx - 1;
+
+            for (std::size_t k = 0; k < piece->count; ++k) {
+                move_entry(piece, k, node, idx + 1 + k);
+                piece->children[k] = std::exchange(node->children[idx + 1 + k], nullptr);
+            }
+            piece->children[piece->count] = std::exchange(node->children[node->count], nullptr);
+            recount(piece);
 
-        return maxKey(root);
-    }
+            right = join_nodes(rsub, take(node, idx), drop_empty_root({piece, h}));
+        }
 
-    void clear() {
-        BTree(M).swap(*this);
-    }
+        // Lo que queda en node son las entradas [0, idx), y keys[idx - 1] lo une con lsub
+        if (idx == 0) {
+            pool.destroy(node);
+            return {lsub, right};
+        }
 
-    [[nodiscard]] std::size_t size() const {
-        return n;
+        Entry sep = take(node, idx - 1);
+        node->count = idx - 1;
+        recount(node);
+        return {join_nodes(drop_empty_root({node, h}), std::move(sep), lsub), right};
     }
 
-    static BTree* build_from_ordered_vector(const std::vector<TK>& elements, std::size_t M) {
-        if (M < 3)
-            throw std::invalid_argument("order must be greater than 2");
+    // join sin validar: left y right ya tienen el mismo orden y las keys en su lugar
+    static BasicBTree join_trees(BasicBTree&& left, Entry&& pivot, BasicBTree&& right) {
+        BasicBTree tree(std::move(left));
+
+        // El borde derecho de left queda adentro del resultado, donde rige el mínimo de siempre.
+        // El resultado usa la política más permisiva de las dos, que ambos contenidos cumplen.
+        if (tree.split_mode == SplitPolicy::append && tree.root != nullptr)
+            tree.settle_right_edge();
+        if (right.split_mode == SplitPolicy::append)
+            tree.split_mode = SplitPolicy::append;
+        if (right.min_count < tree.min_count) {
+            tree.min_count = right.min_count;
+            tree.min_fraction = right.min_fraction;
+        }
 
-        auto* tree = new BTree(M);
-        if (elements.empty())
-            return tree;
+        tree.pool.merge(right.pool);
+        if constexpr (Filter::enabled)
+            tree.filter.invalidate();
 
-        auto* root = new BNode(M);
-        tree->root = root;
+        const Subtree l{tree.root, height(tree.root)};
+        const Subtree r{right.root, height(right.root)};
+        tree.root = tree.join_nodes(l, std::move(pivot), r).root;
 
-        std::vector<BNode*> path{root};
-        for (TK elem : elements) {
-            while (!path.back()->leaf) {
-                BNode* cur = path.back();
-                BNode*& child = cur->children[cur->count];
-                if (child == nullptr)
-                    child = new BNode(M);
-                path.push_back(child);
-            }
+        if (tree.n != unknown_size && right.n != unknown_size)
+            tree.n += right.n + 1;
+        else
+            tree.n = unknown_size;
 
-            BNode* leaf = path.back();
-            leaf->keys[leaf->count++] = elem;
-            ++tree->n;
+        right.root = nullptr;
+        right.n = 0;
+        return tree;
+    }
 
-            for (int i = static_cast<int>(path.size()) - 1; i >= 0; --i) {
-                BNode* node = path[i];
-                if (node->count < M - 1)
-                    break;
+public:
+    // Iterador en orden sobre las keys. Guarda el camino desde la raíz hasta la key actual en un
+    // stack dentro del propio iterador, así que avanzar no reserva memoria y es O(1) amortizado.
+    // El stack tiene lugar para iterator_frames niveles; solo en un árbol más alto que eso se pasa
+    // a memoria reservada, del tamaño de la altura del árbol. Cualquier insert o remove invalida
+    // los iteradores.
+    //
+    // En BTreeMap, desreferenciar da un par (key, valor) de referencias; con Const = false el valor
+    // se puede modificar.
+    template<bool Const>
+    class basic_iterator {
+        friend class BasicBTree;
+        friend class basic_iterator<!Const>;
+
+        using MappedRef = std::conditional_t<Const, const Mapped, Mapped>&;
+
+        // En el frame de arriba, pos es el índice de la key actual. En los de abajo, pos es el
+        // índice del child por el que se bajó: al volver a ese nodo, la siguiente key es keys[pos].
+        struct Frame {
+            const BNode* node;
+            std::size_t pos;
+        };
+
+        // Sin inicializar: solo se leen los frames [0, depth)
+        Frame frames[iterator_frames];
+        std::unique_ptr<Frame[]> spilled;  // Si no es nullptr, el stack vive acá y no en frames
+        std::size_t depth = 0;
+        const BNode* root = nullptr;  // Para poder retroceder desde end()
+
+        explicit basic_iterator(const BNode* const root)
+            : root(root) {}
+
+        [[nodiscard]] const Frame* path() const {
+            return spilled ? spilled.get() : frames;
+        }
 
-                std::size_t mid = (M - 1) / 2;
-                TK promoted = node->keys[mid];
-
-                auto* right = new BNode(M);
-                right->leaf = node->leaf;
-                right->count = node->count - mid - 1;
-
-                std::copy(node->keys + mid + 1, node->keys + node->count, right->keys);
-                if (!node->leaf)
-                    std::copy(node->children + mid + 1, node->children + node->count + 1,
-                              right->children);
-
-                node->count = mid;
-
-                if (i == 0) {
-                    auto* newRoot = new BNode(M);
-                    newRoot->leaf = false;
-                    newRoot->count = 1;
-                    newRoot->keys[0] = promoted;
-                    newRoot->children[0] = node;
-                    newRoot->children[1] = right;
-                    tree->root = newRoot;
-                    path = {newRoot};
-                    break;
-                }
+        Frame* path() {
+            return spilled ? spilled.get() : frames;
+        }
 
-                BNode* parent = path[i - 1];
-                std::size_t pos = 0;
-                while (pos <= parent->count && parent->children[pos] != node)
-                    ++pos;
+        [[nodiscard]] const Frame& top() const {
+            return path()[depth - 1];
+        }
 
-                for (std::size_t i = parent->count - 1; i >= pos; --i) {
-                    parent->keys[i + 1] = std::move(parent->keys[i]);
-                }
-                for (std::size_t i = parent->count; i > pos; --i) {
-                    parent->children[i + 1] = std::move(parent->children[i]);
-                }
+        Frame& top() {
+            return path()[depth - 1];
+        }
 
-                parent->keys[pos] = promoted;
-                parent->children[pos + 1] = right;
-                ++parent->count;
-            }
+        // Pasa el stack a memoria reservada con lugar para todos los niveles del árbol
+        void spill() {
+            auto stack = std::make_unique_for_overwrite<Frame[]>(
+                static_cast<std::size_t>(BasicBTree::height(root)) + 1);
+            std::copy(frames, frames + depth, stack.get());
+            spilled = std::move(stack);
+        }
 
-            path.resize(1);
+        void push(const BNode* const node, const std::size_t pos) {
+            if (depth == iterator_frames && !spilled)
+                spill();
+            path()[depth++] = {node, pos};
         }
 
-        return tree;
+        // Copia los frames de other (sin leer los que no usa)
+        template<bool OtherConst>
+        void copy_path(const basic_iterator<OtherConst>& other) {
+            depth = other.depth;
+            root = other.root;
+            spilled.reset();
+            if (other.spilled) {
+                spilled = std::make_unique_for_overwrite<Frame[]>(
+                    static_cast<std::size_t>(BasicBTree::height(root)) + 1);
+            }
+
+            const auto* const from = other.path();
+            Frame* const to = path();
+            for (std::size_t i = 0; i < depth; ++i)
+                to[i] = {from[i].node, from[i].pos};
+        }
+
+        void push_leftmost(const BNode* node) {
+            while (true) {
+                push(node, 0);
+                if (node->leaf)
+                    return;
+                node = node->children[0];
+            }
+        }
+
+        void push_rightmost(const BNode* node) {
+            while (!node->leaf) {
+                push(node, node->count);
+                node = node->children[node->count];
+            }
+
+            push(node, node->count - 1);
+        }
+
+        // Sube mientras el frame de arriba ya no tenga keys por visitar
+        void pop_finished() {
+            while (depth > 0 && top().pos >= top().node->count)
+                --depth;
+        }
+
+        void advance() {
+            Frame& frame = top();
+
+            if (!frame.node->leaf) {
+                ++frame.pos;
+                push_leftmost(frame.node->children[frame.pos]);
+                return;
+            }
+
+            ++frame.pos;
+            pop_finished();
+        }
+
+        void retreat() {
+            if (depth == 0) {
+                push_rightmost(root);
+                return;
+            }
+
+            Frame& frame = top();
+
+            if (!frame.node->leaf) {
+                // El child a la izquierda de keys[pos] es children[pos]
+                push_rightmost(frame.node->children[frame.pos]);
+                return;
+            }
+
+            if (frame.pos > 0) {
+                --frame.pos;
+                return;
+            }
+
+            // Sube hasta un ancestro al que no se haya llegado por su primer child
+            do {
+                --depth;
+            } while (depth > 0 && top().pos == 0);
+
+            if (depth > 0)
+                --top().pos;
+        }
+
+        // Deja el iterador en la primera key >= key según el comparador de tree
+        template<typename K>
+        void seek(const BasicBTree& tree, const K& key) {
+            depth = 0;
+            const BNode* node = root;
+
+            while (node != nullptr) {
+                const std::size_t idx = tree.rank(node, key);
+                push(node, idx);
+
+                if (tree.matches(node, idx, key))
+                    return;
+
+                node = node->leaf ? nullptr : node->children[idx];
+            }
+
+            pop_finished();
+        }
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = Entry;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<is_map, std::pair<const TK&, MappedRef>, const TK&>;
+
+        // En BTreeMap la referencia es un valor temporal, así que operator-> devuelve un objeto que
+        // la guarda
+        struct ArrowProxy {
+            reference ref;
+
+            const reference* operator->() const {
+                return &ref;
+            }
+        };
+
+        using pointer = std::conditional_t<is_map, ArrowProxy, const TK*>;
+
+        basic_iterator() = default;
+
+        basic_iterator(const basic_iterator& other) {
+            copy_path(other);
+        }
+
+        basic_iterator(basic_iterator&& other) noexcept
+            : spilled(std::move(other.spilled)),
+              depth(other.depth),
+              root(other.root) {
+            if (!spilled)
+                std::copy(other.frames, other.frames + depth, frames);
+        }
+
+        // iterator -> const_iterator
+        template<bool OtherConst>
+            requires(Const && !OtherConst)
+        // NOLINTNEXTLINE(google-explicit-constructor)
+        basic_iterator(const basic_iterator<OtherConst>& other) {
+            copy_path(other);
+        }
+
+        basic_iterator& operator=(const basic_iterator& other) {
+            if (this != &other)
+                copy_path(other);
+            return *this;
+        }
+
+        basic_iterator& operator=(basic_iterator&& other) noexcept {
+            if (this == &other)
+                return *this;
+
+            spilled = std::move(other.spilled);
+            depth = other.depth;
+            root = other.root;
+            if (!spilled)
+                std::copy(other.frames, other.frames + depth, frames);
+            return *this;
+        }
+
+        ~basic_iterator() = default;
+
+        reference operator*() const {
+            const Frame& frame = top();
+
+            if constexpr (is_map) {
+                // El iterador mutable solo se crea desde un árbol no const
+                auto* const node = const_cast<BNode*>(frame.node);
+                return reference(node->keys[frame.pos], node->values[frame.pos]);
+            } else {
+                return frame.node->keys[frame.pos];
+            }
+        }
+
+        pointer operator->() const {
+            if constexpr (is_map)
+                return ArrowProxy{**this};
+            else
+                return &top().node->keys[top().pos];
+        }
+
+        // Key actual (también en BTreeMap, sin armar el par)
+        [[nodiscard]] const TK& key() const {
+            return top().node->keys[top().pos];
+        }
+
+        basic_iterator& operator++() {
+            advance();
+            return *this;
+        }
+
+        basic_iterator operator++(int) {
+            basic_iterator old = *this;
+            advance();
+            return old;
+        }
+
+        basic_iterator& operator--() {
+            retreat();
+            return *this;
+        }
+
+        basic_iterator operator--(int) {
+            basic_iterator old = *this;
+            retreat();
+            return old;
+        }
+
+        // Un mismo nodo solo se alcanza por un camino, así que basta comparar el frame de arriba
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) {
+            return a.depth == b.depth &&
+                   (a.depth == 0 || (a.top().node == b.top().node && a.top().pos == b.top().pos));
+        }
+    };
+
+    using const_iterator = basic_iterator<true>;
+    using iterator = std::conditional_t<is_map, basic_iterator<false>, const_iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+
+    // Vista sobre un tramo de keys del árbol. No guarda copias de las keys: solo los iteradores de
+    // los extremos.
+    class Range {
+        const_iterator first;
+        const_iterator last;
+
+    public:
+        Range(const_iterator first, const_iterator last)
+            : first(std::move(first)),
+              last(std::move(last)) {}
+
+        [[nodiscard]] const_iterator begin() const {
+            return first;
+        }
+
+        [[nodiscard]] const_iterator end() const {
+            return last;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return first == last;
+        }
+    };
+
+private:
+    explicit BasicBTree(const OrderValue<Order> M, const Compare& comp = Compare())
+        : M(M),
+          comp(comp) {}
+
+    // Nodo y posición de la key, o {nullptr, 0} si no está
+    template<typename K>
+    [[nodiscard]] Position locate(const K& key) const {
+        if (filtered_out(key))
+            return {nullptr, 0};
+
+        BNode* cur = root;
+
+        while (cur != nullptr) {
+            const std::size_t idx = rank(cur, key);
+
+            if (matches(cur, idx, key))
+                return {cur, idx};
+
+            cur = cur->children[idx];
+        }
+
+        return {nullptr, 0};
+    }
+
+    // Inserta la entrada (key, args...) si key no está. Retorna dónde quedó, o {nullptr, 0} si key
+    // ya estaba. Sin comparador transparente, una key de otro tipo se convierte a TK antes de
+    // bajar, para no convertirla en cada comparación.
+    template<typename K, typename... Args>
+    Position insert_entry(K&& key, Args&&... args) {
+        if constexpr (!transparent && !std::is_same_v<std::remove_cvref_t<K>, TK>) {
+            return insert_entry(TK(std::forward<K>(key)), std::forward<Args>(args)...);
+        } else {
+            // Baja una vez guardando el camino; la entrada solo se construye si key no está
+            Position path[max_depth];
+            std::size_t depth = 0;
+
+            for (BNode* cur = root; cur != nullptr; cur = cur->children[path[depth - 1].second]) {
+                const std::size_t idx = rank(cur, key);
+                if (matches(cur, idx, key))
+                    return {nullptr, 0};
+
+                path[depth++] = {cur, idx};
+            }
+
+            return insert_at(path, depth,
+                             make_entry(std::forward<K>(key), std::forward<Args>(args)...));
+        }
+    }
+
+    // Inserta entry en la hoja path[depth - 1], en la posición guardada en ese frame (o como raíz
+    // si el árbol está vacío), partiendo hacia arriba los nodos llenos del camino. Retorna dónde
+    // quedó entry.
+    Position insert_at(Position* const path, const std::size_t depth, Entry&& entry) {
+        if (n != unknown_size)
+            ++n;
+
+        if constexpr (Filter::enabled)
+            filter.add(key_of(entry));
+
+        add_size(path, depth, 1);
+        const Position pos = insert_path(root, path, depth, std::move(entry), nullptr);
+        refresh_filter();
+        return pos;
+    }
+
+    // insert_at sobre el subárbol con raíz top, que se actualiza si la raíz se parte. left queda
+    // como children[i] de entry en el nodo path[depth - 1] (el child que estaba ahí pasa a la
+    // derecha de entry), como si viniera del split de un nivel más abajo.
+    Position insert_path(BNode*& top,
+                         Position* const path,
+                         std::size_t depth,
+                         Entry&& entry,
+                         BNode* left) {
+        Position where{nullptr, 0};
+
+        // Con SplitPolicy::append, un nodo lleno del borde derecho que recibe la entrada al final
+        // deja M - 2 entradas a la izquierda y solo la nueva a la derecha, que seguirá llenándose
+        const std::size_t edge =
+            split_mode == SplitPolicy::append ? right_edge_depth(path, depth) : 0;
+
+        // Sube mientras los nodos estén llenos, partiéndolos
+        while (depth > 0) {
+            const auto [node, i] = path[--depth];
+
+            if (node->count < M - 1) {
+                node->children[node->count + 1] = node->children[node->count];
+
+                for (std::size_t j = node->count; j > i; --j) {
+                    move_entry(node, j, node, j - 1);
+                    node->children[j] = node->children[j - 1];
+                }
+
+                store(node, i, std::move(entry));
+                node->children[i] = left;
+                ++node->count;
+
+                if (where.first == nullptr)
+                    where = {node, i};
+                return where;
+            }
+
+            left = split(node, i, entry, left, where, depth < edge ? M - 2 : (M - 1) / 2);
+        }
+
+        auto* const new_root = pool.create();
+        new_root->leaf = left == nullptr;
+        count(&BTreeCounters::height_increases);
+
+        store(new_root, 0, std::move(entry));
+        new_root->count = 1;
+
+        new_root->children[0] = left;
+        new_root->children[1] = top;
+        recount(new_root);
+
+        if (where.first == nullptr)
+            where = {new_root, 0};
+
+        top = new_root;
+        return where;
+    }
+
+    // Camino desde la raíz hasta una hoja, que insert_sorted y erase_sorted reutilizan entre keys
+    // consecutivas. lo y hi son los separadores más cercanos que acotan la hoja (nullptr si no
+    // hay): mientras una key caiga estrictamente entre ellos, solo puede estar en esa hoja.
+    struct LeafCursor {
+        Position path[max_depth];
+        std::size_t depth = 0;  // 0 = hay que bajar desde la raíz
+        const TK* lo = nullptr;
+        const TK* hi = nullptr;
+    };
+
+    // Si key solo puede estar en la hoja en la que terminó el camino de cursor
+    template<typename K>
+    [[nodiscard]] bool in_leaf(const LeafCursor& cursor, const K& key) const {
+        return cursor.depth > 0 && cursor.path[cursor.depth - 1].first->leaf &&
+               (cursor.lo == nullptr || comp(*cursor.lo, key)) &&
+               (cursor.hi == nullptr || comp(key, *cursor.hi));
+    }
+
+    // Deja en cursor el camino hasta donde está (o iría) key, terminando en el nodo donde se
+    // encontró o en la hoja, con la posición de key en cada frame. Retorna si key está.
+    template<typename K>
+    bool seek(LeafCursor& cursor, const K& key) const {
+        if (in_leaf(cursor, key)) {
+            auto& [leaf, idx] = cursor.path[cursor.depth - 1];
+            idx = rank(leaf, key);
+            return matches(leaf, idx, key);
+        }
+
+        cursor.depth = 0;
+        cursor.lo = cursor.hi = nullptr;
+
+        for (BNode* node = root; node != nullptr;) {
+            const std::size_t idx = rank(node, key);
+            cursor.path[cursor.depth++] = {node, idx};
+
+            if (matches(node, idx, key))
+                return true;
+            if (node->leaf)
+                break;
+
+            if (idx > 0)
+                cursor.lo = &node->keys[idx - 1];
+            if (idx < node->count)
+                cursor.hi = &node->keys[idx];
+
+            node = node->children[idx];
+        }
+
+        return false;
+    }
+
+    // Memoria que insert_sorted reutiliza entre las tandas de insert_run
+    struct RunBuffers {
+        std::vector<Entry> run;
+        std::vector<Entry> all;
+        std::vector<std::pair<BNode*, std::size_t>> pieces;
+    };
+
+    // Inserta las entradas de run en la hoja llena en la que terminó cursor, donde caen todas, y
+    // la parte una sola vez: sus entradas y las nuevas se reparten en los nodos que hagan falta,
+    // parejos (o llenos, en el borde derecho con SplitPolicy::append), y los separadores entre
+    // ellos suben al padre. run puede venir desordenado o con keys repetidas o que ya están; se
+    // queda la primera de cada key, como con insert. Retorna cuántas se insertaron.
+    std::size_t insert_run(LeafCursor& cursor, RunBuffers& buffers) {
+        std::vector<Entry>& run = buffers.run;
+        std::vector<Entry>& all = buffers.all;
+        BNode* const leaf = cursor.path[cursor.depth - 1].first;
+        const std::size_t depth = cursor.depth - 1;
+        cursor.depth = 0;
+
+        std::stable_sort(run.begin(), run.end(), [&](const Entry& a, const Entry& b) {
+            return comp(key_of(a), key_of(b));
+        });
+        const auto fresh = [&](const Entry& entry) {
+            const std::size_t idx = rank(leaf, key_of(entry));
+            return !matches(leaf, idx, key_of(entry));
+        };
+
+        std::size_t added = 0;
+        for (std::size_t i = 0; i < run.size(); ++i) {
+            if ((added == 0 || comp(key_of(run[added - 1]), key_of(run[i]))) && fresh(run[i])) {
+                if (added != i)
+                    run[added] = std::move(run[i]);
+                ++added;
+            }
+        }
+        run.resize(added);
+        if constexpr (Filter::enabled)
+            for (const Entry& entry : run)
+                filter.add(key_of(entry));
+
+        all.clear();
+        std::size_t next = 0;
+        for (std::size_t i = 0; i < leaf->count; ++i) {
+            while (next < added && comp(key_of(run[next]), leaf->keys[i]))
+                all.push_back(std::move(run[next++]));
+            all.push_back(take(leaf, i));
+        }
+        while (next < added)
+            all.push_back(std::move(run[next++]));
+
+        // Con `pieces` nodos suben pieces - 1 separadores, y el resto tiene que entrar en los nodos
+        const std::size_t total = all.size();
+        const std::size_t pieces = (total + M) / M;
+        const std::size_t keys = total - (pieces - 1);
+        const bool pack =
+            split_mode == SplitPolicy::append && right_edge_depth(cursor.path, depth) == depth;
+        const std::size_t last_size =
+            pack ? std::max<std::size_t>(1, keys - std::min(keys, (pieces - 1) * (M - 1)))
+                 : keys / pieces;
+        const std::size_t rest = keys - last_size;
+        const auto piece_size = [&](const std::size_t p) {
+            if (p + 1 == pieces)
+                return last_size;
+            return rest / (pieces - 1) + (p < rest % (pieces - 1) ? 1 : 0);
+        };
+
+        // La hoja queda como el último pedazo; los demás son nodos nuevos a su izquierda. Cada
+        // separador queda en all, en el índice guardado junto al pedazo de su izquierda.
+        auto& nodes = buffers.pieces;
+        nodes.clear();
+        std::size_t at = 0;
+        for (std::size_t p = 0; p < pieces; ++p) {
+            BNode* const node = p + 1 < pieces ? pool.create() : leaf;
+            node->count = piece_size(p);
+            for (std::size_t k = 0; k < node->count; ++k)
+                store(node, k, std::move(all[at++]));
+            recount(node);
+            nodes.emplace_back(node, at++);
+        }
+
+        if (n != unknown_size)
+            n += added;
+        count(&BTreeCounters::splits);
+        add_size(cursor.path, depth, static_cast<std::ptrdiff_t>(leaf->count) -
+                                         static_cast<std::ptrdiff_t>(total - added));
+
+        // Los separadores suben de derecha a izquierda: cada uno entra en el padre del pedazo a
+        // su derecha, justo antes de él. Si un split anterior cambió ese padre, el camino se
+        // vuelve a buscar bajando con el separador, que termina en ese pedazo.
+        Position path[max_depth];
+        for (std::size_t p = pieces - 1; p-- > 0;) {
+            const auto [node, separator] = nodes[p];
+            std::size_t d = 0;
+            if (p + 2 == pieces) {
+                std::copy(cursor.path, cursor.path + depth, path);
+                d = depth;
+            } else {
+                for (BNode* node = root; !node->leaf; node = node->children[path[d - 1].second])
+                    path[d++] = {node, rank(node, key_of(all[separator]))};
+            }
+
+            add_size(path, d, static_cast<std::ptrdiff_t>(node->count + 1));
+            insert_path(root, path, d, std::move(all[separator]), node);
+        }
+
+        refresh_filter();
+        return added;
+    }
+
+    // Borra la key de cursor, que está en una hoja en el mínimo, y todas las siguientes de
+    // [first, last) que caen en esa hoja, compactándola una sola vez y arreglándola una sola vez
+    // después. Deja first en la primera key que cae fuera. Retorna cuántas se borraron.
+    template<typename Key, typename It, typename S>
+    std::size_t erase_run(LeafCursor& cursor, It& first, const S& last) {
+        const auto [leaf, idx] = cursor.path[cursor.depth - 1];
+        const std::size_t depth = cursor.depth - 1;
+
+        std::vector<bool> gone(leaf->count);
+        gone[idx] = true;
+        std::size_t erased = 1;
+
+        for (++first; first != last; ++first) {
+            const Key& key = *first;
+            if (!in_leaf(cursor, key))
+                break;
+
+            const std::size_t i = rank(leaf, key);
+            if (matches(leaf, i, key) && !gone[i]) {
+                gone[i] = true;
+                ++erased;
+            }
+        }
+        cursor.depth = 0;
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < leaf->count; ++i) {
+            if (gone[i])
+                continue;
+            if (kept != i)
+                move_entry(leaf, kept, leaf, i);
+            ++kept;
+        }
+        leaf->count = kept;
+
+        if (n != unknown_size)
+            n -= erased;
+        if constexpr (Filter::enabled)
+            for (std::size_t i = 0; i < erased; ++i)
+                filter.remove();
+
+        add_size(cursor.path, depth, -static_cast<std::ptrdiff_t>(erased));
+        add_size(leaf, -static_cast<std::ptrdiff_t>(erased));
+        rebalance(cursor.path, depth, leaf);
+        return erased;
+    }
+
+    // Pedazo de un recorrido paralelo: el subárbol completo de node (whole), o solo las keys
+    // [first, last) de node. Un subárbol con low o high todavía tiene keys fuera del rango por ese
+    // lado y hay que partirlo antes de recorrerlo.
+    struct ScanPiece {
+        const BNode* node;
+        std::size_t first = 0;
+        std::size_t last = 0;
+        bool whole = false;
+        bool low = false;
+        bool high = false;
+    };
+
+    // Pedazos en orden; la task t recorre pieces[tasks[t], tasks[t + 1])
+    struct ScanPlan {
+        std::vector<ScanPiece> pieces;
+        std::vector<std::size_t> tasks;
+    };
+
+    // Cada worker recibe varias tasks, para que el work stealing pueda emparejar subárboles de
+    // distinto tamaño
+    static constexpr std::size_t scan_tasks_per_worker = 8;
+
+    using const_reference = typename basic_iterator<true>::reference;
+
+    static const_reference entry_ref(const BNode* const node, const std::size_t i) {
+        if constexpr (is_map)
+            return const_reference(node->keys[i], node->values[i]);
+        else
+            return node->keys[i];
+    }
+
+    // En BTreeMap, key de una entrada vista desde un iterador const
+    static const TK& key_of(const const_reference entry)
+        requires is_map
+    {
+        return entry.first;
+    }
+
+    // write_to y dump juntan lo que escriben en bloques de este tamaño
+    static constexpr std::size_t stream_block = 64 * 1024;
+
+    // Agrega a text las keys en orden separadas por sep, llamando a flush(text) cada vez que pasa
+    // de stream_block. flush puede vaciarlo o dejarlo crecer.
+    template<typename Flush>
+    void write_text(const std::string_view sep, std::string& text, Flush&& flush) const {
+        if (root == nullptr)
+            return;
+
+        text.reserve(stream_block + 256);
+
+        bool first = true;
+        const auto write = [&](const const_reference entry) {
+            if (!first)
+                text.append(sep);
+            first = false;
+            append_key(text, key_of(entry));
+
+            if (text.size() >= stream_block)
+                flush(text);
+        };
+        scan(root, write);
+    }
+
+    template<typename Fn>
+    static void scan(const BNode* const node, Fn& fn) {
+        if (node->leaf) {
+            for (std::size_t i = 0; i < node->count; ++i)
+                fn(entry_ref(node, i));
+            return;
+        }
+
+        for (std::size_t i = 0; i < node->count; ++i) {
+            scan(node->children[i], fn);
+            fn(entry_ref(node, i));
+        }
+        scan(node->children[node->count], fn);
+    }
+
+    template<typename Fn>
+    static void scan(const ScanPiece& piece, Fn& fn) {
+        if (piece.whole) {
+            scan(piece.node, fn);
+            return;
+        }
+
+        for (std::size_t i = piece.first; i < piece.last; ++i)
+            fn(entry_ref(piece.node, i));
+    }
+
+    // Reemplaza el subárbol de piece por sus children y separadores que caen en [*lo, *hi]. El
+    // child i tiene las keys entre keys[i - 1] y keys[i], así que solo los de los extremos quedan
+    // acotados, y no lo quedan si la key del borde es justo lo o hi.
+    template<typename K1, typename K2>
+    void expand(const ScanPiece& piece,
+                const K1* const lo,
+                const K2* const hi,
+                std::vector<ScanPiece>& out) const {
+        const BNode* const node = piece.node;
+
+        const std::size_t a = piece.low ? rank(node, *lo) : 0;
+        const bool lo_match = piece.low && matches(node, a, *lo);
+        const std::size_t r = piece.high ? rank(node, *hi) : node->count;
+        const bool hi_match = piece.high && matches(node, r, *hi);
+        const std::size_t b = r + static_cast<std::size_t>(hi_match);
+
+        if (node->leaf) {
+            if (a < b)
+                out.push_back({node, a, b});
+            return;
+        }
+
+        for (std::size_t i = a; i <= r; ++i) {
+            if (i > a || !lo_match)
+                out.push_back({node->children[i], 0, 0, true, piece.low && i == a,
+                               piece.high && i == r && !hi_match});
+            if (i < b && i < node->count)
+                out.push_back({node, i, i + 1});
+        }
+    }
+
+    // Parte las keys en [*lo, *hi] (nullptr = sin cota) en subárboles completos, bajando hasta que
+    // haya al menos `target` o no se puedan partir más. Cada task empieza en un subárbol y se lleva
+    // los separadores que lo siguen.
+    template<typename K1, typename K2>
+    ScanPlan plan_scan(const K1* const lo, const K2* const hi, const std::size_t target) const {
+        ScanPlan plan;
+        if (root != nullptr)
+            plan.pieces.push_back({root, 0, 0, true, lo != nullptr, hi != nullptr});
+
+        std::vector<ScanPiece> next;
+        while (true) {
+            std::size_t subtrees = 0;
+            bool bounded = false;
+            bool splittable = false;
+            for (const ScanPiece& piece : plan.pieces) {
+                if (!piece.whole)
+                    continue;
+                ++subtrees;
+                bounded = bounded || piece.low || piece.high;
+                splittable = splittable || !piece.node->leaf;
+            }
+
+            const bool more = subtrees < target && splittable;
+            if (!bounded && !more)
+                break;
+
+            next.clear();
+            for (const ScanPiece& piece : plan.pieces) {
+                if (piece.whole && (piece.low || piece.high || (more && !piece.node->leaf)))
+                    expand(piece, lo, hi, next);
+                else
+                    next.push_back(piece);
+            }
+            plan.pieces.swap(next);
+        }
+
+        for (std::size_t i = 0; i < plan.pieces.size(); ++i)
+            if (plan.tasks.empty() || (plan.pieces[i].whole && i > 0))
+                plan.tasks.push_back(i);
+        plan.tasks.push_back(plan.pieces.size());
+
+        return plan;
+    }
+
+    template<typename K1, typename K2, typename Fn, typename Executor>
+    void parallel_scan(const K1* const lo, const K2* const hi, Fn& fn, Executor& executor) const {
+        const ScanPlan plan =
+            plan_scan(lo, hi, std::max<std::size_t>(1, executor.concurrency()) *
+                                  scan_tasks_per_worker);
+
+        executor.run(plan.tasks.size() - 1, [&](const std::size_t t, std::size_t /*worker*/) {
+            for (std::size_t i = plan.tasks[t]; i < plan.tasks[t + 1]; ++i)
+                scan(plan.pieces[i], fn);
+        });
+    }
+
+    // Ver parallel_reduce. Con ReduceOrder::ordered hay un resultado parcial por task, que se
+    // combinan en orden; si no, uno por worker, que acumula todas las tasks que le tocan.
+    template<typename K1,
+             typename K2,
+             typename T,
+             typename Accumulate,
+             typename Combine,
+             typename Executor>
+    T parallel_fold(const K1* const lo,
+                    const K2* const hi,
+                    const T& identity,
+                    Accumulate& accumulate,
+                    Combine& combine,
+                    const ReduceOrder order,
+                    Executor& executor) const {
+        const std::size_t workers = std::max<std::size_t>(1, executor.concurrency());
+        const ScanPlan plan = plan_scan(lo, hi, workers * scan_tasks_per_worker);
+        const std::size_t tasks = plan.tasks.size() - 1;
+
+        std::vector<std::optional<T>> partials(order == ReduceOrder::ordered ? tasks : workers);
+
+        executor.run(tasks, [&](const std::size_t t, const std::size_t worker) {
+            std::optional<T>& slot = partials[order == ReduceOrder::ordered ? t : worker];
+            T acc = slot ? std::move(*slot) : identity;
+
+            const auto add = [&](const const_reference entry) {
+                acc = accumulate(std::move(acc), entry);
+            };
+            for (std::size_t i = plan.tasks[t]; i < plan.tasks[t + 1]; ++i)
+                scan(plan.pieces[i], add);
+
+            slot = std::move(acc);
+        });
+
+        T result = identity;
+        for (std::optional<T>& partial : partials)
+            if (partial)
+                result = combine(std::move(result), std::move(*partial));
+        return result;
+    }
+
+public:
+    explicit BasicBTree(const std::size_t M, const Compare& comp = Compare())
+        requires(Order == dynamic_order)
+        : M(M),
+          comp(comp) {}
+
+    BasicBTree()
+        requires(Order != dynamic_order)
+        : M(Order) {}
+
+    explicit BasicBTree(const Compare& comp)
+        requires(Order != dynamic_order)
+        : M(Order),
+          comp(comp) {}
+
+    BasicBTree(const BasicBTree& other) = delete;
+
+    BasicBTree(BasicBTree&& other) noexcept
+        : M(other.M),
+          comp(other.comp) {
+        swap(other);
+    }
+
+    BasicBTree& operator=(const BasicBTree& other) = delete;
+
+    BasicBTree& operator=(BasicBTree&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    template<typename K>
+    [[nodiscard]] bool search(const K& key) const {
+        const LookupKey<K>& k = key;
+        if (filtered_out(k))
+            return false;
+
+        const BNode* cur = root;
+
+        while (cur != nullptr) {
+            const std::size_t idx = rank(cur, k);
+
+            if (matches(cur, idx, k))
+                return true;
+
+            cur = cur->children[idx];
+        }
+        return false;
+    }
+
+    // Versión de search para muchas keys a la vez: out[i] = search(keys[i]). Las búsquedas se
+    // intercalan nivel por nivel y se hace prefetch del siguiente nodo de cada una. Con
+    // sort = true, se ordenan primero las keys para que búsquedas vecinas reutilicen los nodos.
+    void search_batch(const std::span<const TK> keys,
+                      const std::span<bool> out,
+                      const bool sort = false) const {
+        if (out.size() < keys.size())
+            throw std::invalid_argument("output span is smaller than keys");
+
+        const std::vector<std::size_t> order =
+            sort ? sorted_order(keys) : std::vector<std::size_t>();
+        lookup_batch(keys, order,
+                     [&](const std::size_t i, const TK* const key) { out[i] = key != nullptr; });
+    }
+
+    // Como search_batch, pero out[i] apunta a la key guardada en el árbol (o es nullptr si no está)
+    void find_batch(const std::span<const TK> keys,
+                    const std::span<const TK*> out,
+                    const bool sort = false) const {
+        if (out.size() < keys.size())
+            throw std::invalid_argument("output span is smaller than keys");
+
+        const std::vector<std::size_t> order =
+            sort ? sorted_order(keys) : std::vector<std::size_t>();
+        lookup_batch(keys, order, [&](const std::size_t i, const TK* const key) { out[i] = key; });
+    }
+
+    ~BasicBTree() {
+        pool.clear(std::exchange(root, nullptr));
+        n = 0;
+    }
+
+    // Construye la key desde key (copiando o moviendo, según lo que se pase) solo si no está
+    template<typename K = TK>
+    void insert(K&& key)
+        requires(!is_map)
+    {
+        insert_entry(std::forward<K>(key));
+    }
+
+    // Inserta (key, value) si key no está. Retorna si se insertó.
+    template<typename K = TK>
+    bool insert(K&& key, Mapped value)
+        requires is_map
+    {
+        return insert_entry(std::forward<K>(key), std::move(value)).first != nullptr;
+    }
+
+    // Inserta (key, value), o reemplaza el valor si key ya está. Retorna si se insertó.
+    template<typename K = TK>
+    bool insert_or_assign(K&& key, Mapped value)
+        requires is_map
+    {
+        if constexpr (!transparent && !std::is_same_v<std::remove_cvref_t<K>, TK>) {
+            return insert_or_assign(TK(std::forward<K>(key)), std::move(value));
+        } else {
+            if (const auto [node, idx] = locate(key); node != nullptr) {
+                node->values[idx] = std::move(value);
+                return false;
+            }
+
+            return insert_entry(std::forward<K>(key), std::move(value)).first != nullptr;
+        }
+    }
+
+    // Si key no está, inserta un valor construido con args. Retorna el valor de key y si se
+    // insertó. Si key ya está, no se construye ni la key ni el valor.
+    template<typename K = TK, typename... Args>
+    std::pair<Mapped*, bool> try_emplace(K&& key, Args&&... args)
+        requires is_map
+    {
+        if constexpr (!transparent && !std::is_same_v<std::remove_cvref_t<K>, TK>) {
+            return try_emplace(TK(std::forward<K>(key)), std::forward<Args>(args)...);
+        } else {
+            if (const auto [node, idx] = locate(key); node != nullptr)
+                return {&node->values[idx], false};
+
+            const auto [node, idx] =
+                insert_entry(std::forward<K>(key), std::forward<Args>(args)...);
+            return {&node->values[idx], true};
+        }
+    }
+
+    template<typename K = TK>
+    Mapped& operator[](K&& key)
+        requires is_map
+    {
+        return *try_emplace(std::forward<K>(key)).first;
+    }
+
+    // Puntero al valor de key, o nullptr si no está
+    template<typename K>
+    [[nodiscard]] Mapped* find(const K& key)
+        requires is_map
+    {
+        const auto [node, idx] = locate(static_cast<const LookupKey<K>&>(key));
+        return node == nullptr ? nullptr : &node->values[idx];
+    }
+
+    template<typename K>
+    [[nodiscard]] const Mapped* find(const K& key) const
+        requires is_map
+    {
+        const auto [node, idx] = locate(static_cast<const LookupKey<K>&>(key));
+        return node == nullptr ? nullptr : &node->values[idx];
+    }
+
+    template<typename K>
+    void remove(const K& key) {
+        remove_key(static_cast<const LookupKey<K>&>(key));
+    }
+
+    // Inserta los elementos de [first, last) (keys, o pares (key, valor) en BTreeMap) que no estén.
+    // Pensado para tandas ordenadas según Compare: se reutiliza el camino a la hoja de la key
+    // anterior, y solo se vuelve a bajar desde la raíz cuando la key cae fuera de esa hoja. Cuando
+    // la hoja se llena, todos los elementos siguientes que caen en ella se juntan y la hoja se
+    // parte una sola vez en los nodos que hagan falta (insert_run). Con elementos desordenados el
+    // resultado es el mismo, solo más lento. Retorna cuántos se insertaron.
+    template<std::input_iterator It, std::sentinel_for<It> S>
+    std::size_t insert_sorted(It first, const S last) {
+        LeafCursor cursor;
+        std::size_t inserted = 0;
+        std::optional<Entry> pending;  // El primero que cayó fuera de la última tanda
+        RunBuffers buffers;
+        std::vector<Entry>& run = buffers.run;
+        const auto read = [&] {
+            Entry entry(*first);
+            ++first;
+            return entry;
+        };
+
+        while (pending || first != last) {
+            Entry entry = pending ? *std::exchange(pending, std::nullopt) : read();
+            if (seek(cursor, key_of(entry)))
+                continue;
+
+            if (cursor.depth == 0 || cursor.path[cursor.depth - 1].first->count < M - 1) {
+                insert_at(cursor.path, cursor.depth, std::move(entry));
+                ++inserted;
+                continue;
+            }
+
+            run.clear();
+            run.push_back(std::move(entry));
+            while (first != last) {
+                Entry next = read();
+                if (!in_leaf(cursor, key_of(next))) {
+                    pending.emplace(std::move(next));
+                    break;
+                }
+                run.push_back(std::move(next));
+            }
+
+            inserted += insert_run(cursor, buffers);
+        }
+
+        return inserted;
+    }
+
+    // Borra las keys de [first, last) que estén, reutilizando el camino entre keys consecutivas
+    // como insert_sorted. Si una key está en una hoja que ya tiene el mínimo, esa key y todas las
+    // siguientes que caen en la hoja se borran juntas y la hoja se arregla una sola vez
+    // (erase_run). Retorna cuántas se borraron.
+    template<std::input_iterator It, std::sentinel_for<It> S>
+    std::size_t erase_sorted(It first, const S last) {
+        using Key = LookupKey<std::remove_cvref_t<std::iter_reference_t<It>>>;
+        LeafCursor cursor;
+        std::size_t erased = 0;
+
+        while (first != last) {
+            const Key& key = *first;
+            if (!seek(cursor, key)) {
+                ++first;
+                continue;
+            }
+
+            const auto [node, idx] = cursor.path[cursor.depth - 1];
+            if (node->leaf && node->count <= min_keys()) {
+                erased += erase_run<Key>(cursor, first, last);
+                continue;
+            }
+
+            // Si no se borra de una hoja, el árbol cambia de forma
+            erase_at(cursor.path, cursor.depth - 1, node, idx);
+            if (!node->leaf)
+                cursor.depth = 0;
+
+            ++first;
+            ++erased;
+        }
+
+        return erased;
+    }
+
+    // Une left, pivot y right en un solo árbol y lo retorna; left y right quedan vacíos. Las keys
+    // de left deben ser menores que pivot y pivot menor que las de right. Toma O(log n): el árbol
+    // más bajo se cuelga del borde del más alto, a su misma altura.
+    static BasicBTree join(BasicBTree&& left, Entry pivot, BasicBTree&& right) {
+        if (left.M != right.M)
+            throw std::invalid_argument("trees must have the same order");
+
+        if ((left.root != nullptr && !left.comp(maxKey(left.root), key_of(pivot))) ||
+            (right.root != nullptr && !left.comp(key_of(pivot), minKey(right.root))))
+            throw std::invalid_argument("keys must be left < pivot < right");
+
+        return join_trees(std::move(left), std::move(pivot), std::move(right));
+    }
+
+    // Como join, pero sin pivot: se usa la key más grande de left
+    static BasicBTree join(BasicBTree&& left, BasicBTree&& right) {
+        if (left.M != right.M)
+            throw std::invalid_argument("trees must have the same order");
+
+        if (left.root != nullptr && right.root != nullptr &&
+            !left.comp(maxKey(left.root), minKey(right.root)))
+            throw std::invalid_argument("keys must be left < right");
+
+        if (left.root == nullptr)
+            return BasicBTree(std::move(right));
+
+        Entry pivot = left.pop_max();
+        return join_trees(std::move(left), std::move(pivot), std::move(right));
+    }
+
+    // Parte el árbol en dos, las keys < key y las >= key, en O(log n); este árbol queda vacío. Los
+    // dos árboles comparten los chunks de memoria del original. Sin Counted, el tamaño de cada uno
+    // no se conoce sin recorrerlo, así que se cuenta la primera vez que se pide size().
+    template<typename K>
+    [[nodiscard]] std::pair<BasicBTree, BasicBTree> split(const K& key) {
+        const LookupKey<K>& k = key;
+        BasicBTree left(M, comp);
+        BasicBTree right(M, comp);
+        left.adopt_balance(*this);
+        right.adopt_balance(*this);
+
+        if (root != nullptr) {
+            const std::ptrdiff_t h = height(root);
+            const auto [lo, hi] = split_node(std::exchange(root, nullptr), h, k);
+            n = 0;
+            filter = Filter();
+
+            left.pool.swap(pool);
+            if (hi.root != nullptr)
+                right.pool.share(left.pool);
+
+            left.root = lo.root;
+            right.root = hi.root;
+
+            if constexpr (Counted) {
+                left.n = subtree_size(lo.root);
+                right.n = subtree_size(hi.root);
+            } else {
+                left.n = lo.root == nullptr ? 0 : unknown_size;
+                right.n = hi.root == nullptr ? 0 : unknown_size;
+            }
+        }
+
+        return {std::move(left), std::move(right)};
+    }
+
+    // Unión, intersección y diferencia de a y b en O(|a| + |b|): se recorren ambos en orden a la
+    // vez y el resultado se arma de abajo hacia arriba, como build_from_ordered_vector. Usan el
+    // orden, el comparador, la SplitPolicy y el llenado mínimo de a. En BTreeMap, con una key en
+    // ambos se queda el valor de a.
+    static BasicBTree merge_union(const BasicBTree& a, const BasicBTree& b) {
+        return merge_sets(a, b, a.size() + b.size(), true, true, true);
+    }
+
+    static BasicBTree intersection(const BasicBTree& a, const BasicBTree& b) {
+        return merge_sets(a, b, std::min(a.size(), b.size()), false, true, false);
+    }
+
+    static BasicBTree difference(const BasicBTree& a, const BasicBTree& b) {
+        return merge_sets(a, b, a.size(), true, false, false);
+    }
+
+    [[nodiscard]] std::ptrdiff_t height() const {
+        return height(root);
+    }
+
+    [[nodiscard]] std::string toString(const std::string& sep) const {
+        std::string result;
+        write_text(sep, result, [](std::string& /*text*/) {});
+        return result;
+    }
+
+    // Escribe las keys en orden en out, separadas por sep, en una sola pasada y sin armar strings
+    // por subárbol (ver format_key). Retorna el iterador que sigue a lo escrito.
+    template<std::output_iterator<char> Out>
+    Out write_to(Out out, const std::string_view sep = ",") const
+        requires FormattableKey<TK>
+    {
+        std::string buffer;
+        const auto flush = [&](std::string& text) {
+            out = std::copy(text.begin(), text.end(), std::move(out));
+            text.clear();
+        };
+        write_text(sep, buffer, flush);
+        flush(buffer);
+
+        return out;
     }
 
-    // RIP :c
-    // se intentó implementar el algoritmo <<bulk loading>> mencionado en la página de wikipedia del
-    // b-tree https://en.wikipedia.org/wiki/B-tree#Initial_construction pero los resultados no
-    // fueron satisfactorios, este algoritmo es propio de los b+tree
-    //
-    // static BTree* build_from_ordered_vector(const std::vector<TK>& elements, const std::size_t M)
-    // {
-    //     if (M < 3)
-    //         throw std::invalid_argument("order must be greater than 2");
-    //     if (elements.empty())
-    //         return new BTree(M);
-    //
-    //     auto* tree = new BTree(M);
-    //     std::size_t B = M - 1;
-    //
-    //     std::vector<BNode*> nodes;
-    //     for (std::size_t i = 0; i < elements.size(); i += B) {
-    //         auto* node = new BNode(M);
-    //
-    //         std::size_t idx = 0;
-    //         std::size_t end = std::min(i + B, elements.size());
-    //         for (std::size_t j = i; j < end; ++j) {
-    //             node->keys[idx++] = elements[j];
-    //             ++node->count;
-    //         }
-    //         nodes.push_back(std::move(node));
-    //     }
-    //
-    //     while (nodes.size() > 1) {
-    //         std::vector<BNode*> next;
-    //         for (std::size_t i = 0; i < nodes.size(); i += M) {
-    //             auto* parent = new BNode(M);
-    //             parent->leaf = false;
-    //
-    //             const std::size_t end = std::min(i + M, nodes.size());
-    //             const std::size_t childCount = end - i;
-    //
-    //             for (std::size_t j = 0; j < childCount; ++j)
-    //                 parent->children[j] = nodes[i + j];
-    //
-    //             parent->count = childCount - 1;
-    //             for (std::size_t j = 0; j < parent->count; ++j) {
-    //                 parent->keys[j] = nodes[i + j]->keys[nodes[i + j]->count - 1];
-    //             }
-    //
-    //             next.push_back(std::move(parent));
-    //         }
-    //
-    //         nodes = std::move(next);
-    //     }
+    void write_to(std::ostream& os, const std::string_view sep = ",") const
+        requires FormattableKey<TK>
+    {
+        std::string buffer;
+        const auto flush = [&](std::string& text) {
+            os.write(text.data(), static_cast<std::streamsize>(text.size()));
+            text.clear();
+        };
+        write_text(sep, buffer, flush);
+        flush(buffer);
+    }
+
+    // Copia las keys a un FrozenBTree: inmutable, sin punteros y con todos los nodos en un solo
+    // array, para índices que se arman una vez y después solo se consultan
+    [[nodiscard]] FrozenBTree<TK, Compare> freeze() const
+        requires(!is_map)
+    {
+        return FrozenBTree<TK, Compare>(begin(), end(), comp);
+    }
+
+    // Escribe en path una imagen del árbol sin punteros (ver MappedBTree) que open_mapped puede
+    // servir directamente desde el archivo. Los nodos se recorren por niveles y solo se guardan
+    // sus keys ocupadas, así que la imagen no depende de Order ni del fill factor.
+    void save(const std::string& path) const
+        requires(!is_map)
+    {
+        static_assert(std::is_trivially_copyable_v<TK>,
+                      "saved keys are read back from the file, so they must be trivially copyable");
+
+        std::vector<const BNode*> nodes;
+        std::vector<MappedImageNode> table;
+        if (root != nullptr)
+            nodes.push_back(root);
+
+        std::uint64_t keys = 0;
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            const BNode* node = nodes[i];
+            if (nodes.size() + node->count + 1 > UINT32_MAX)
+                throw std::length_error("BTree has too many nodes for a mapped image");
+
+            const auto first_child = static_cast<std::uint32_t>(node->leaf ? 0 : nodes.size());
+            table.push_back({static_cast<std::uint32_t>(node->count), first_child, keys});
+            keys += node->count;
+            if (!node->leaf)
+                for (std::size_t c = 0; c <= node->count; ++c)
+                    nodes.push_back(node->children[c]);
+        }
+
+        const std::size_t table_end =
+            sizeof(MappedImageHeader) + sizeof(MappedImageNode) * table.size();
+        const std::size_t keys_offset = (table_end + mapped_image_alignment - 1) /
+                                        mapped_image_alignment * mapped_image_alignment;
+        const MappedImageHeader header{mapped_image_magic, sizeof(TK), keys,
+                                       table.size(),       height(),   keys_offset};
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof header);
+        out.write(reinterpret_cast<const char*>(table.data()),
+                  static_cast<std::streamsize>(sizeof(MappedImageNode) * table.size()));
+        const char padding[mapped_image_alignment]{};
+        out.write(padding, static_cast<std::streamsize>(keys_offset - table_end));
+        for (const BNode* node : nodes)
+            out.write(reinterpret_cast<const char*>(node->keys),
+                      static_cast<std::streamsize>(sizeof(TK) * node->count));
+
+        out.flush();
+        if (!out)
+            throw std::runtime_error("cannot write " + path);
+    }
+
+    // Escribe todas las entradas en orden en un formato binario simple (ver BTreeDumpHeader), que
+    // load vuelve a cargar con el bulk loader. A diferencia de save, sirve también para BTreeMap y
+    // no depende de la forma del árbol.
+    void dump(std::ostream& out) const {
+        static_assert(std::is_trivially_copyable_v<TK> &&
+                          (!is_map || std::is_trivially_copyable_v<Mapped>),
+                      "dumped entries are copied byte by byte, so they must be trivially copyable");
+
+        const BTreeDumpHeader header{btree_dump_magic, sizeof(TK), is_map ? sizeof(Mapped) : 0,
+                                     size()};
+        out.write(reinterpret_cast<const char*>(&header), sizeof header);
+
+        std::vector<char> buffer;
+        buffer.reserve(stream_block + dump_entry_bytes);
+
+        const auto append = [&](const auto& object) {
+            const auto* const bytes = reinterpret_cast<const char*>(&object);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof object);
+        };
+        const auto write = [&](const const_reference entry) {
+            append(key_of(entry));
+            if constexpr (is_map)
+                append(entry.second);
+
+            if (buffer.size() >= stream_block) {
+                out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        };
+        if (root != nullptr)
+            scan(root, write);
+
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (!out)
+            throw std::runtime_error("cannot write BTree dump");
+    }
+
+    // Abre de solo lectura una imagen escrita con save, sin copiarla a memoria
+    static MappedBTree<TK, Compare, Search> open_mapped(const std::string& path,
+                                                        const Compare& comp = Compare())
+        requires(!is_map)
+    {
+        return MappedBTree<TK, Compare, Search>::open(path, comp);
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        const_iterator it(root);
+        if (root != nullptr)
+            it.push_leftmost(root);
+        return it;
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return const_iterator(root);
+    }
+
+    [[nodiscard]] iterator begin()
+        requires is_map
+    {
+        iterator it(root);
+        if (root != nullptr)
+            it.push_leftmost(root);
+        return it;
+    }
+
+    [[nodiscard]] iterator end()
+        requires is_map
+    {
+        return iterator(root);
+    }
+
+    [[nodiscard]] const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    [[nodiscard]] const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    // Primera key >= key, o end() si no hay
+    template<typename K>
+    [[nodiscard]] const_iterator lower_bound(const K& key) const {
+        const_iterator it(root);
+        it.seek(*this, static_cast<const LookupKey<K>&>(key));
+        return it;
+    }
+
+    // Primera key > key, o end() si no hay
+    template<typename K>
+    [[nodiscard]] const_iterator upper_bound(const K& key) const {
+        const LookupKey<K>& k = key;
+        const_iterator it = lower_bound(k);
+        if (it.depth > 0 && !comp(k, it.key()))
+            ++it;
+        return it;
+    }
+
+    template<typename K>
+    [[nodiscard]] const_iterator find(const K& key) const
+        requires(!is_map)
+    {
+        const LookupKey<K>& k = key;
+        if (filtered_out(k))
+            return end();
+
+        const_iterator it = lower_bound(k);
+        if (it.depth > 0 && !comp(k, it.key()))
+            return it;
+        return end();
+    }
+
+    // Keys en [begin, end], en orden. Se calcula de forma perezosa: baja una vez hasta begin y de
+    // ahí avanza en orden, en O(log n + k) para k keys visitadas. Se puede dejar de iterar en
+    // cualquier momento.
+    template<typename K1, typename K2>
+    [[nodiscard]] Range range(const K1& begin, const K2& end) const {
+        const LookupKey<K1>& lo = begin;
+        const LookupKey<K2>& hi = end;
+
+        // Se compara end contra keys del árbol y no contra begin, que puede no ser comparable
+        const_iterator first = lower_bound(lo);
+        if (first.depth == 0 || comp(hi, first.key()))
+            return {first, first};
+
+        return {std::move(first), upper_bound(hi)};
+    }
+
+    template<typename K1, typename K2>
+    [[nodiscard]] Range rangeSearch(const K1& begin, const K2& end) const {
+        return range(begin, end);
+    }
+
+    // Llama a fn con cada key (en BTreeMap, cada par key/valor) en [begin, end], repartiendo el
+    // trabajo en executor. El rango se parte en los separadores de los nodos internos, y cada task
+    // recorre en orden subárboles completos, sin comparar keys. fn se llama desde varios hilos a
+    // la vez y sin orden entre tasks; el árbol no se puede modificar mientras tanto.
+    template<typename K1, typename K2, typename Fn, TaskExecutor Executor = WorkStealingPool>
+    void parallel_for_each_in_range(const K1& begin,
+                                    const K2& end,
+                                    Fn&& fn,
+                                    Executor& executor = WorkStealingPool::shared()) const {
+        const LookupKey<K1>& lo = begin;
+        const LookupKey<K2>& hi = end;
+        parallel_scan(&lo, &hi, fn, executor);
+    }
+
+    // parallel_for_each_in_range sobre todo el árbol
+    template<typename Fn, TaskExecutor Executor = WorkStealingPool>
+    void parallel_for_each(Fn&& fn, Executor& executor = WorkStealingPool::shared()) const {
+        parallel_scan(static_cast<const TK*>(nullptr), static_cast<const TK*>(nullptr), fn,
+                      executor);
+    }
+
+    // Reduce las keys (o pares key/valor) de [begin, end] en paralelo: cada task arranca de una
+    // copia de identity y hace acc = accumulate(std::move(acc), entry) con sus entradas en orden,
+    // y después los resultados se juntan con combine(std::move(a), std::move(b)). combine tiene que
+    // ser asociativo. Con ReduceOrder::ordered los resultados se combinan en el orden de las keys,
+    // así que sirve para operaciones no conmutativas; con unordered cada worker acumula todas sus
+    // tasks en un solo resultado, lo que necesita combine conmutativo pero hace menos copias.
+    template<typename K1,
+             typename K2,
+             typename T,
+             typename Accumulate,
+             typename Combine,
+             TaskExecutor Executor = WorkStealingPool>
+        requires std::invocable<Accumulate&, T, const_reference>
+    [[nodiscard]] T parallel_reduce(const K1& begin,
+                                    const K2& end,
+                                    const T& identity,
+                                    Accumulate accumulate,
+                                    Combine combine,
+                                    const ReduceOrder order = ReduceOrder::ordered,
+                                    Executor& executor = WorkStealingPool::shared()) const {
+        const LookupKey<K1>& lo = begin;
+        const LookupKey<K2>& hi = end;
+        return parallel_fold(&lo, &hi, identity, accumulate, combine, order, executor);
+    }
+
+    // parallel_reduce sobre todo el árbol
+    template<typename T,
+             typename Accumulate,
+             typename Combine,
+             TaskExecutor Executor = WorkStealingPool>
+        requires std::invocable<Accumulate&, T, const_reference>
+    [[nodiscard]] T parallel_reduce(const T& identity,
+                                    Accumulate accumulate,
+                                    Combine combine,
+                                    const ReduceOrder order = ReduceOrder::ordered,
+                                    Executor& executor = WorkStealingPool::shared()) const {
+        return parallel_fold(static_cast<const TK*>(nullptr), static_cast<const TK*>(nullptr),
+                             identity, accumulate, combine, order, executor);
+    }
+
+    // Cantidad de keys menores que key
+    template<typename K>
+    [[nodiscard]] std::size_t rank(const K& key) const
+        requires Counted
+    {
+        return count_below(static_cast<const LookupKey<K>&>(key), false);
+    }
+
+    // Cantidad de keys en [begin, end], sin recorrerlas
+    template<typename K1, typename K2>
+    [[nodiscard]] std::size_t count_range(const K1& begin, const K2& end) const
+        requires Counted
+    {
+        const LookupKey<K1>& lo = begin;
+        const LookupKey<K2>& hi = end;
+
+        const std::size_t below_end = count_below(hi, true);
+        const std::size_t below_begin = count_below(lo, false);
+        return below_end > below_begin ? below_end - below_begin : 0;
+    }
+
+    // Iterador a la k-ésima key en orden (desde 0), o end() si k >= size(). De ahí se puede
+    // seguir avanzando, por ejemplo para leer una página de resultados.
+    [[nodiscard]] const_iterator select(const std::size_t k) const
+        requires Counted
+    {
+        return select_at<const_iterator>(k);
+    }
+
+    [[nodiscard]] iterator select(const std::size_t k)
+        requires Counted && is_map
+    {
+        return select_at<iterator>(k);
+    }
+
+    [[nodiscard]] const TK& minKey() const {
+        if (root == nullptr)
+            throw std::runtime_error("BTree is empty");
+
+        return minKey(root);
+    }
+
+    [[nodiscard]] const TK& maxKey() const {
+        if (root == nullptr)
+            throw std::runtime_error("BTree is empty");
+
+        return maxKey(root);
+    }
+
+    void clear() {
+        BasicBTree empty(M, comp);
+        empty.adopt_balance(*this);
+        empty.swap(*this);
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        if (n == unknown_size)
+            n = count_keys(root);
+        return n;
+    }
+
+    // Con SplitPolicy::append, un nodo lleno que recibe una key más grande que todas las del árbol
+    // se parte dejando M - 2 keys a la izquierda y la nueva sola a la derecha, en vez de mitad y
+    // mitad. Con keys crecientes (logs, ids secuenciales) los nodos quedan casi llenos en vez de a
+    // la mitad. Los nodos del borde derecho pueden quedar bajo el mínimo, porque son los que
+    // reciben las próximas keys. Volver a SplitPolicy::even los completa desde sus vecinos.
+    void set_split_policy(const SplitPolicy policy) {
+        if (split_mode == SplitPolicy::append && policy != SplitPolicy::append && root != nullptr)
+            settle_right_edge();
+        split_mode = policy;
+    }
+
+    [[nodiscard]] SplitPolicy split_policy() const {
+        return split_mode;
+    }
+
+    // Fracción de M - 1 keys bajo la que remove rebalancea un nodo, entre 0.25 y 0.5 (el mínimo de
+    // un árbol B, por defecto). Con un mínimo más bajo los merges se postergan: un nodo recién
+    // partido tolera muchos borrados antes de fundirse, así que insertar y borrar alternadamente
+    // cerca del límite no parte y junta el mismo nodo una y otra vez. compact() recupera la
+    // densidad cuando convenga. Subir el mínimo de un árbol con keys lo compacta para cumplirlo.
+    void set_min_fill(const double fill) {
+        if (!(fill >= lowest_min_fill && fill <= 0.5))
+            throw std::invalid_argument("minimum fill must be in [0.25, 0.5]");
+
+        const std::size_t count =
+            std::max<std::size_t>(1, static_cast<std::size_t>(fill * static_cast<double>(M - 1)));
+        const bool raised = count > min_count;
+
+        min_fraction = fill;
+        min_count = count;
+        if (raised && root != nullptr)
+            compact();
+    }
+
+    [[nodiscard]] double min_fill() const {
+        return min_fraction;
+    }
+
+    // Reconstruye el árbol de abajo hacia arriba en O(n), como build_from_ordered_vector con el
+    // mismo `fill`, para juntar las keys de los nodos que quedaron medio vacíos. Usa memoria para
+    // una copia de las entradas; si falta, el árbol puede quedar vacío.
+    void compact(const double fill = 1.0) {
+        fill_target(fill, M);
+
+        std::vector<Entry> entries;
+        entries.reserve(size());
+        if (root != nullptr)
+            take_all(root, entries);
+        pool.clear(std::exchange(root, nullptr));
+        n = 0;
+
+        const std::unique_ptr<BasicBTree> tree(build(std::make_move_iterator(entries.begin()),
+                                                     std::make_move_iterator(entries.end()), M,
+                                                     fill));
+        root = std::exchange(tree->root, nullptr);
+        n = std::exchange(tree->n, 0);
+        std::swap(filter, tree->filter);
+        pool.merge(tree->pool);
+    }
+
+    // Vuelve a armar el filtro de keys con las que hay ahora. Se hace solo cuando hace falta, pero
+    // después de join o split (que lo dejan sin efecto) se puede pedir antes del próximo insert o
+    // remove, que si no lo rearman ellos.
+    void rebuild_filter()
+        requires Filter::enabled
+    {
+        rebuild_key_filter();
+    }
+
+    // Construye el árbol de abajo hacia arriba en O(n): primero todas las hojas, luego cada nivel
+    // interno en una sola pasada, hasta que quede un solo nodo.
     //
-    //     tree->root = nodes.front();
-    //     prune_duplicates(tree->root);
-    //     return tree;
-    // }
+    // `fill` es la fracción de M - 1 keys que se intenta poner en cada nodo (1.0 = nodos llenos).
+    // Los elementos deben estar ordenados de forma estrictamente creciente. Las versiones con
+    // rvalue y con rango (por ejemplo con std::move_iterator) mueven las keys en vez de copiarlas.
+    static BasicBTree* build_from_ordered_vector(const std::vector<Entry>& elements,
+                                                 const std::size_t M,
+                                                 const double fill = 1.0)
+        requires(Order == dynamic_order)
+    {
+        return build_from_ordered_range(elements.begin(), elements.end(), M, fill);
+    }
+
+    static BasicBTree* build_from_ordered_vector(std::vector<Entry>&& elements,
+                                                 const std::size_t M,
+                                                 const double fill = 1.0)
+        requires(Order == dynamic_order)
+    {
+        return build_from_ordered_range(std::make_move_iterator(elements.begin()),
+                                        std::make_move_iterator(elements.end()), M, fill);
+    }
+
+    template<std::input_iterator It>
+        requires std::forward_iterator<It> || std::sized_sentinel_for<It, It>
+    static BasicBTree* build_from_ordered_range(It first,
+                                                It last,
+                                                const std::size_t M,
+                                                const double fill = 1.0)
+        requires(Order == dynamic_order)
+    {
+        if (M < 3)
+            throw std::invalid_argument("order must be greater than 2");
+
+        return build(std::move(first), std::move(last), OrderValue<Order>(M), fill);
+    }
+
+    static BasicBTree* build_from_ordered_vector(const std::vector<Entry>& elements,
+                                                 const double fill = 1.0)
+        requires(Order != dynamic_order)
+    {
+        return build_from_ordered_range(elements.begin(), elements.end(), fill);
+    }
+
+    static BasicBTree* build_from_ordered_vector(std::vector<Entry>&& elements,
+                                                 const double fill = 1.0)
+        requires(Order != dynamic_order)
+    {
+        return build_from_ordered_range(std::make_move_iterator(elements.begin()),
+                                        std::make_move_iterator(elements.end()), fill);
+    }
+
+    template<std::input_iterator It>
+        requires std::forward_iterator<It> || std::sized_sentinel_for<It, It>
+    static BasicBTree* build_from_ordered_range(It first, It last, const double fill = 1.0)
+        requires(Order != dynamic_order)
+    {
+        return build(std::move(first), std::move(last), OrderValue<Order>(Order), fill);
+    }
+
+    // Lee un árbol escrito con dump y lo arma con el bulk loader. Falla si el stream no es un dump
+    // de este tipo de entradas, si está cortado o si las keys no están en orden.
+    static BasicBTree* load(std::istream& in, const std::size_t M, const double fill = 1.0)
+        requires(Order == dynamic_order)
+    {
+        if (M < 3)
+            throw std::invalid_argument("order must be greater than 2");
+
+        return load_dump(in, OrderValue<Order>(M), fill);
+    }
+
+    static BasicBTree* load(std::istream& in, const double fill = 1.0)
+        requires(Order != dynamic_order)
+    {
+        return load_dump(in, OrderValue<Order>(Order), fill);
+    }
+
+    // Igual que build_from_ordered_vector (el árbol resultante es idéntico), pero cada nivel se
+    // reparte en tramos contiguos de nodos entre `threads` hilos. Los niveles de arriba, que tienen
+    // pocos nodos, se construyen en el hilo que llama. threads = 0 usa todos los cores.
+    static BasicBTree* parallel_build_from_ordered_vector(const std::vector<Entry>& elements,
+                                                          const std::size_t M,
+                                                          const std::size_t threads = 0,
+                                                          const double fill = 1.0)
+        requires(Order == dynamic_order)
+    {
+        if (M < 3)
+            throw std::invalid_argument("order must be greater than 2");
+
+        return build_parallel(elements.begin(), elements.end(), OrderValue<Order>(M), fill,
+                              threads);
+    }
+
+    static BasicBTree* parallel_build_from_ordered_vector(std::vector<Entry>&& elements,
+                                                          const std::size_t M,
+                                                          const std::size_t threads = 0,
+                                                          const double fill = 1.0)
+        requires(Order == dynamic_order)
+    {
+        if (M < 3)
+            throw std::invalid_argument("order must be greater than 2");
+
+        return build_parallel(std::make_move_iterator(elements.begin()),
+                              std::make_move_iterator(elements.end()), OrderValue<Order>(M), fill,
+                              threads);
+    }
+
+    static BasicBTree* parallel_build_from_ordered_vector(const std::vector<Entry>& elements,
+                                                          const std::size_t threads = 0,
+                                                          const double fill = 1.0)
+        requires(Order != dynamic_order)
+    {
+        return build_parallel(elements.begin(), elements.end(), OrderValue<Order>(Order), fill,
+                              threads);
+    }
+
+    static BasicBTree* parallel_build_from_ordered_vector(std::vector<Entry>&& elements,
+                                                          const std::size_t threads = 0,
+                                                          const double fill = 1.0)
+        requires(Order != dynamic_order)
+    {
+        return build_parallel(std::make_move_iterator(elements.begin()),
+                              std::make_move_iterator(elements.end()), OrderValue<Order>(Order),
+                              fill, threads);
+    }
+
+private:
+    // Cantidad de keys menores que key, o menores o iguales con inclusive = true. En cada nodo
+    // del camino se suman sus keys y los subárboles que quedan a la izquierda de key.
+    template<typename K>
+    std::size_t count_below(const K& key, const bool inclusive) const {
+        std::size_t below = 0;
+
+        for (const BNode* node = root; node != nullptr;) {
+            const std::size_t idx = rank(node, key);
+            const bool hit = matches(node, idx, key);
+
+            below += idx;
+            if (!node->leaf)
+                for (std::size_t j = 0; j < idx + static_cast<std::size_t>(hit); ++j)
+                    below += node->children[j]->subtree.value;
+
+            if (hit)
+                return below + static_cast<std::size_t>(inclusive);
+
+            node = node->children[idx];
+        }
+
+        return below;
+    }
+
+    // Baja hacia la k-ésima key restando los subárboles que quedan a su izquierda, armando el
+    // camino del iterador
+    template<typename It>
+    It select_at(std::size_t k) const {
+        It it(root);
+        if (k >= subtree_size(root))
+            return it;
+
+        for (const BNode* node = root;;) {
+            if (node->leaf) {
+                it.push(node, k);
+                return it;
+            }
+
+            std::size_t j = 0;
+            for (; k >= node->children[j]->subtree.value; ++j) {
+                if (k == node->children[j]->subtree.value) {
+                    it.push(node, j);
+                    return it;
+                }
+
+                k -= node->children[j]->subtree.value + 1;
+            }
+
+            it.push(node, j);
+            node = node->children[j];
+        }
+    }
+
+    // Niveles con menos nodos que esto se construyen en un solo hilo
+    static constexpr std::size_t parallel_grain = 1024;
+    // Reparte `units` unidades (hijos de un nivel, o keys + 1 en las hojas) en grupos de entre
+    // ceil(M / 2) y M unidades, lo más cerca posible de `target` por grupo. Si todas caben en un
+    // solo nodo, ese nodo será la raíz, que no tiene mínimo.
+    static std::size_t group_count(const std::size_t units,
+                                   const std::size_t target,
+                                   const OrderValue<Order> M) {
+        if (units <= M)
+            return 1;
+
+        const std::size_t lo = (M + 1) / 2;
+        const std::size_t min_groups = (units + M - 1) / M;
+        const std::size_t max_groups = units / lo;
+        const std::size_t groups = (units + target / 2) / target;
+
+        return std::clamp(groups, min_groups, max_groups);
+    }
+
+    // Tamaño del grupo j cuando `units` se reparte de forma pareja en `groups` grupos
+    static std::size_t group_size(const std::size_t units,
+                                  const std::size_t groups,
+                                  const std::size_t j) {
+        return units / groups + static_cast<std::size_t>(j < units % groups);
+    }
+
+    // Primera unidad del grupo j (suma de los tamaños de los grupos anteriores)
+    static std::size_t group_start(const std::size_t units,
+                                   const std::size_t groups,
+                                   const std::size_t j) {
+        return j * (units / groups) + std::min(j, units % groups);
+    }
+
+    // Reparte [0, count) en tramos contiguos y ejecuta fn(worker, begin, end) por tramo, uno por
+    // hilo. El tramo 0 corre en el hilo que llama. Si algún tramo lanza, se relanza al terminar.
+    template<typename Fn>
+    static void for_each_chunk(const std::size_t count, const std::size_t workers, Fn&& fn) {
+        const std::size_t chunks =
+            std::min(workers, std::max<std::size_t>(1, count / parallel_grain));
+
+        if (chunks <= 1) {
+            fn(std::size_t{0}, std::size_t{0}, count);
+            return;
+        }
+
+        std::vector<std::exception_ptr> errors(chunks);
+        std::vector<std::thread> threads;
+        threads.reserve(chunks - 1);
+
+        const auto run = [&](const std::size_t w) {
+            try {
+                fn(w, group_start(count, chunks, w),
+                   group_start(count, chunks, w) + group_size(count, chunks, w));
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        };
+
+        for (std::size_t w = 1; w < chunks; ++w)
+            threads.emplace_back(run, w);
+
+        run(0);
+
+        for (std::thread& thread : threads)
+            thread.join();
+
+        for (const std::exception_ptr& error : errors)
+            if (error)
+                std::rethrow_exception(error);
+    }
+
+    static std::size_t fill_target(const double fill, const OrderValue<Order> M) {
+        if (!(fill > 0.0 && fill <= 1.0))
+            throw std::invalid_argument("fill factor must be in (0, 1]");
+
+        const std::size_t min_keys = std::ceil(M / 2.0) - 1;
+        const auto keys = static_cast<std::size_t>(std::lround(fill * static_cast<double>(M - 1)));
+
+        return std::clamp(keys, min_keys, M - 1) + 1;
+    }
+
+    // Mezcla las secuencias en orden de a y b, quedándose con las entradas que están solo en a,
+    // en ambos o solo en b según keep_a, keep_both y keep_b. expected es una cota del resultado.
+    static BasicBTree merge_sets(const BasicBTree& a,
+                                 const BasicBTree& b,
+                                 const std::size_t expected,
+                                 const bool keep_a,
+                                 const bool keep_both,
+                                 const bool keep_b) {
+        std::vector<Entry> merged;
+        merged.reserve(expected);
+
+        const const_iterator a_end = a.end();
+        const const_iterator b_end = b.end();
+        const_iterator i = a.begin();
+        const_iterator j = b.begin();
+
+        while (i != a_end && j != b_end) {
+            if (a.comp(i.key(), j.key())) {
+                if (keep_a)
+                    merged.emplace_back(*i);
+                ++i;
+            } else if (a.comp(j.key(), i.key())) {
+                if (keep_b)
+                    merged.emplace_back(*j);
+                ++j;
+            } else {
+                if (keep_both)
+                    merged.emplace_back(*i);
+                ++i;
+                ++j;
+            }
+        }
+
+        for (; keep_a && i != a_end; ++i)
+            merged.emplace_back(*i);
+        for (; keep_b && j != b_end; ++j)
+            merged.emplace_back(*j);
+
+        const std::unique_ptr<BasicBTree> tree(build(std::make_move_iterator(merged.begin()),
+                                                     std::make_move_iterator(merged.end()), a.M,
+                                                     1.0));
+        tree->comp = a.comp;
+        tree->adopt_balance(a);
+        return std::move(*tree);
+    }
+
+    static constexpr std::size_t dump_entry_bytes = sizeof(TK) + (is_map ? sizeof(Mapped) : 0);
+
+    static BasicBTree* load_dump(std::istream& in, const OrderValue<Order> M, const double fill) {
+        static_assert(std::is_trivially_copyable_v<TK> &&
+                          (!is_map || std::is_trivially_copyable_v<Mapped>),
+                      "dumped entries are copied byte by byte, so they must be trivially copyable");
+
+        BTreeDumpHeader header{};
+        in.read(reinterpret_cast<char*>(&header), sizeof header);
+        if (!in || header.magic != btree_dump_magic || header.key_size != sizeof(TK) ||
+            header.value_size != (is_map ? sizeof(Mapped) : 0))
+            throw std::runtime_error("stream is not a valid BTree dump");
+
+        // count viene del stream: se reserva de a poco y no todo de una vez
+        const std::size_t batch = std::max<std::size_t>(1, stream_block / dump_entry_bytes);
+        std::vector<char> buffer(batch * dump_entry_bytes);
+        std::vector<Entry> entries;
+        entries.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(header.count, batch)));
+
+        const Compare comp;
+        for (std::uint64_t left = header.count; left > 0;) {
+            const auto k = static_cast<std::size_t>(std::min<std::uint64_t>(left, batch));
+            in.read(buffer.data(), static_cast<std::streamsize>(k * dump_entry_bytes));
+            if (!in)
+                throw std::runtime_error("truncated BTree dump");
+
+            for (std::size_t i = 0; i < k; ++i) {
+                const char* const bytes = buffer.data() + i * dump_entry_bytes;
+                TK key;
+                std::memcpy(&key, bytes, sizeof(TK));
+
+                if (!entries.empty() && !comp(key_of(entries.back()), key))
+                    throw std::runtime_error("BTree dump keys are not in order");
+
+                if constexpr (is_map) {
+                    Mapped value;
+                    std::memcpy(&value, bytes + sizeof(TK), sizeof(Mapped));
+                    entries.emplace_back(key, value);
+                } else {
+                    entries.push_back(key);
+                }
+            }
+
+            left -= k;
+        }
+
+        return build(std::make_move_iterator(entries.begin()),
+                     std::make_move_iterator(entries.end()), M, fill);
+    }
+
+    template<typename It>
+    static BasicBTree* build(It first,
+                             const It last,
+                             const OrderValue<Order> M,
+                             const double fill) {
+        const std::size_t target = fill_target(fill, M);
+        const auto total = static_cast<std::size_t>(std::distance(first, last));
+
+        auto* tree = new BasicBTree(M);
+        if (total == 0)
+            return tree;
+
+        // level[i] son los nodos del nivel actual y seps[i] es la key que separa a level[i] de
+        // level[i + 1]; al subir de nivel esas keys se reparten entre los nuevos nodos.
+        std::vector<BNode*> level;
+        std::vector<Entry> seps;
+
+        const std::size_t leaves = group_count(total + 1, target, M);
+        level.reserve(leaves);
+        seps.reserve(leaves - 1);
+
+        for (std::size_t j = 0; j < leaves; ++j) {
+            BNode* const leaf = tree->pool.create();
+            leaf->count = group_size(total + 1, leaves, j) - 1;
+
+            for (std::size_t k = 0; k < leaf->count; ++k, ++first)
+                store(leaf, k, *first);
+            recount(leaf);
+
+            level.push_back(leaf);
+
+            if (j + 1 < leaves) {
+                seps.emplace_back(*first);
+                ++first;
+            }
+        }
+
+        while (level.size() > 1) {
+            const std::size_t units = level.size();
+            const std::size_t groups = group_count(units, target, M);
+
+            std::vector<BNode*> next_level;
+            std::vector<Entry> next_seps;
+            next_level.reserve(groups);
+            next_seps.reserve(groups - 1);
+
+            std::size_t c = 0;
+            for (std::size_t j = 0; j < groups; ++j) {
+                BNode* const node = tree->pool.create();
+                node->leaf = false;
+                node->count = group_size(units, groups, j) - 1;
+
+                for (std::size_t k = 0; k < node->count; ++k) {
+                    node->children[k] = level[c + k];
+                    store(node, k, std::move(seps[c + k]));
+                }
+
+                node->children[node->count] = level[c + node->count];
+                recount(node);
+                c += node->count + 1;
+
+                next_level.push_back(node);
+                if (j + 1 < groups)
+                    next_seps.push_back(std::move(seps[c - 1]));
+            }
+
+            level = std::move(next_level);
+            seps = std::move(next_seps);
+        }
+
+        tree->root = level.front();
+        tree->n = total;
+        tree->refresh_filter();
+        return tree;
+    }
+
+    // Misma distribución que build(), pero calculando la posición de cada nodo a partir de su
+    // índice para que cada hilo pueda construir su tramo del nivel por separado. Cada hilo crea
+    // nodos en su propio pool y al final los chunks pasan al pool del árbol.
+    // It debe tener acceso aleatorio (también vale std::move_iterator sobre uno que lo tenga)
+    template<typename It>
+    static BasicBTree* build_parallel(const It first,
+                                      const It last,
+                                      const OrderValue<Order> M,
+                                      const double fill,
+                                      std::size_t workers) {
+        const std::size_t target = fill_target(fill, M);
+        const auto total = static_cast<std::size_t>(last - first);
+
+        std::unique_ptr<BasicBTree> tree(new BasicBTree(M));
+        if (total == 0)
+            return tree.release();
+
+        if (workers == 0)
+            workers = std::max(1U, std::thread::hardware_concurrency());
+
+        std::vector<Pool> pools;
+        pools.reserve(workers);
+        for (std::size_t w = 0; w < workers; ++w)
+            pools.emplace_back(M);
+
+        const std::size_t leaves = group_count(total + 1, target, M);
+        std::vector<BNode*> level(leaves);
+        std::vector<Entry> seps(leaves - 1);
+
+        const auto build_leaves = [&](const std::size_t w, std::size_t j, const std::size_t end) {
+            for (; j < end; ++j) {
+                const std::size_t start = group_start(total + 1, leaves, j);
+
+                BNode* const leaf = pools[w].create();
+                leaf->count = group_size(total + 1, leaves, j) - 1;
+
+                for (std::size_t k = 0; k < leaf->count; ++k)
+                    store(leaf, k, first[start + k]);
+                recount(leaf);
+
+                level[j] = leaf;
+                if (j + 1 < leaves)
+                    seps[j] = Entry(first[start + leaf->count]);
+            }
+        };
+
+        for_each_chunk(leaves, workers, build_leaves);
+
+        while (level.size() > 1) {
+            const std::size_t units = level.size();
+            const std::size_t groups = group_count(units, target, M);
+
+            std::vector<BNode*> next_level(groups);
+            std::vector<Entry> next_seps(groups - 1);
+
+            const auto build_level = [&](const std::size_t w, std::size_t j,
+                                         const std::size_t end) {
+                for (; j < end; ++j) {
+                    const std::size_t c = group_start(units, groups, j);
+
+                    BNode* const node = pools[w].create();
+                    node->leaf = false;
+                    node->count = group_size(units, groups, j) - 1;
+
+                    for (std::size_t k = 0; k < node->count; ++k) {
+                        node->children[k] = level[c + k];
+                        store(node, k, std::move(seps[c + k]));
+                    }
+
+                    node->children[node->count] = level[c + node->count];
+                    recount(node);
+
+                    next_level[j] = node;
+                    if (j + 1 < groups)
+                        next_seps[j] = std::move(seps[c + node->count]);
+                }
+            };
+
+            for_each_chunk(groups, workers, build_level);
+
+            level = std::move(next_level);
+            seps = std::move(next_seps);
+        }
+
+        for (Pool& pool : pools)
+            tree->pool.merge(pool);
+
+        tree->root = level.front();
+        tree->n = total;
+        tree->refresh_filter();
+        return tree.release();
+    }
+
+    // Suma node y su subárbol a los niveles de result, desde el nivel depth
+    static void analyze(const BNode* const node, const std::size_t depth, BTreeStats& result) {
+        if (result.levels.size() <= depth)
+            result.levels.resize(depth + 1);
+
+        ++result.levels[depth].nodes;
+        result.levels[depth].keys += node->count;
+
+        if (node->leaf) {
+            ++result.leaves;
+            return;
+        }
+
+        for (std::size_t i = 0; i <= node->count; ++i)
+            analyze(node->children[i], depth + 1, result);
+    }
+
+public:
 
     [[nodiscard]] bool check_properties() const {
         const auto [result, height, min, max] = check_properties(root);
         return result;
     }
+
+    // Recorre el árbol como check_properties y retorna su forma: nodos, keys y fill factor de
+    // cada nivel, altura y memoria. Sirve para elegir M y el fill de build_from_ordered_vector
+    // con datos reales.
+    [[nodiscard]] BTreeStats analyze() const {
+        BTreeStats result;
+        if (root != nullptr)
+            analyze(root, 0, result);
+
+        const auto fill = [&](const std::size_t keys, const std::size_t nodes) {
+            return static_cast<double>(keys) / (static_cast<double>(nodes) * (M - 1));
+        };
+
+        for (BTreeLevelStats& level : result.levels) {
+            level.fill = fill(level.keys, level.nodes);
+            result.nodes += level.nodes;
+            result.keys += level.keys;
+        }
+
+        result.height = static_cast<std::ptrdiff_t>(result.levels.size()) - 1;
+        if (result.nodes > 0)
+            result.fill = fill(result.keys, result.nodes);
+        result.memory_bytes = sizeof(*this) + result.nodes * pool.block_bytes();
+        if constexpr (Filter::enabled)
+            result.memory_bytes += filter.memory_bytes();
+        return result;
+    }
+
+    // analyze() junto con los contadores, si se compiló con BTREE_STATS
+    [[nodiscard]] BTreeStats stats() const {
+        BTreeStats result = analyze();
+#ifdef BTREE_STATS
+        result.counters = counters();
+#endif
+        return result;
+    }
+
+#ifdef BTREE_STATS
+    [[nodiscard]] BTreeCounters counters() const {
+        BTreeCounters result = counts;
+        pool.add_counters(result);
+        return result;
+    }
+
+    void reset_counters() {
+        counts = {};
+        pool.reset_counters();
+    }
+#endif
 };
 
+template<typename TK,
+         std::size_t Order = dynamic_order,
+         typename Compare = std::less<TK>,
+         typename Search = DefaultNodeSearch>
+using BTree = BasicBTree<TK, void, Order, Compare, Search>;
+
+// BTree con estadísticas de orden (rank, select y count_range en O(log n))
+template<typename TK,
+         std::size_t Order = dynamic_order,
+         typename Compare = std::less<TK>,
+         typename Search = DefaultNodeSearch>
+using CountedBTree = BasicBTree<TK, void, Order, Compare, Search, true>;
+
+// BTree con un filtro de Bloom delante de search, para cargas donde la mayoría de las búsquedas
+// son de keys que no están. Usa unos 12 bits más por key.
+template<typename TK,
+         std::size_t Order = dynamic_order,
+         typename Compare = std::less<TK>,
+         typename Search = DefaultNodeSearch,
+         typename Hash = std::hash<TK>>
+using FilteredBTree =
+    BasicBTree<TK, void, Order, Compare, Search, false, BlockedBloomFilter<TK, Hash>>;
+
 #endif
@@ -0,0 +1,33 @@
+#ifndef BTREE_MAP_H
+#define BTREE_MAP_H
+
+#include "btree.h"
+
+// Mapa ordenado K -> V sobre el mismo árbol B que BTree. Los valores van en un array paralelo a las
+// keys dentro de cada nodo, y se mueven (nunca se copian) junto con sus keys en splits y merges.
+template<typename K,
+         typename V,
+         std::size_t Order = dynamic_order,
+         typename Compare = std::less<K>,
+         typename Search = DefaultNodeSearch>
+using BTreeMap = BasicBTree<K, V, Order, Compare, Search>;
+
+// BTreeMap con estadísticas de orden (rank, select y count_range en O(log n))
+template<typename K,
+         typename V,
+         std::size_t Order = dynamic_order,
+         typename Compare = std::less<K>,
+         typename Search = DefaultNodeSearch>
+using CountedBTreeMap = BasicBTree<K, V, Order, Compare, Search, true>;
+
+// BTreeMap con un filtro de Bloom delante de find (ver FilteredBTree)
+template<typename K,
+         typename V,
+         std::size_t Order = dynamic_order,
+         typename Compare = std::less<K>,
+         typename Search = DefaultNodeSearch,
+         typename Hash = std::hash<K>>
+using FilteredBTreeMap =
+    BasicBTree<K, V, Order, Compare, Search, false, BlockedBloomFilter<K, Hash>>;
+
+#endif
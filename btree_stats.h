@@ -0,0 +1,61 @@
+#ifndef BTREE_STATS_H
+#define BTREE_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Contadores de lo que hace BasicBTree en sus caminos calientes. Solo se actualizan si se compila
+// con BTREE_STATS definido; sin eso no cuestan nada y BasicBTree::counters() no existe.
+//
+// Con BTREE_STATS hasta las búsquedas const escriben los contadores, así que leer el mismo árbol
+// desde varios hilos deja de ser seguro sin sincronización externa.
+struct BTreeCounters {
+    std::uint64_t searches = 0;     // Bajadas desde la raíz buscando una key
+    std::uint64_t node_visits = 0;  // Nodos en los que se buscó una key
+    std::uint64_t comparisons = 0;  // Llamadas al comparador dentro de esos nodos
+    std::uint64_t splits = 0;
+    std::uint64_t merges = 0;
+    std::uint64_t borrows_left = 0;
+    std::uint64_t borrows_right = 0;
+    std::uint64_t node_allocations = 0;  // Nodos pedidos al pool
+    std::uint64_t node_frees = 0;        // Nodos devueltos uno a uno (sin contar clear())
+    std::uint64_t chunk_allocations = 0;  // Chunks que el pool pidió a operator new
+    std::uint64_t height_increases = 0;   // Veces que el árbol ganó un nivel (split de la raíz)
+    std::uint64_t height_decreases = 0;   // Veces que perdió uno (la raíz quedó vacía)
+    std::uint64_t filtered_misses = 0;    // Búsquedas que el filtro de keys cortó sin bajar
+
+    [[nodiscard]] double visits_per_search() const {
+        return searches == 0 ? 0 : static_cast<double>(node_visits) / static_cast<double>(searches);
+    }
+
+    [[nodiscard]] double comparisons_per_visit() const {
+        return node_visits == 0
+                   ? 0
+                   : static_cast<double>(comparisons) / static_cast<double>(node_visits);
+    }
+};
+
+struct BTreeLevelStats {
+    std::size_t nodes = 0;
+    std::size_t keys = 0;
+    double fill = 0;  // keys / (nodes * (M - 1))
+};
+
+// Forma del árbol, calculada recorriéndolo (ver BasicBTree::analyze)
+struct BTreeStats {
+    std::ptrdiff_t height = -1;
+    std::size_t nodes = 0;
+    std::size_t leaves = 0;
+    std::size_t keys = 0;
+    double fill = 0;  // Promedio de todos los nodos, ponderado por su capacidad
+    std::vector<BTreeLevelStats> levels;  // Desde la raíz
+
+    // Bloques de los nodos en uso más el objeto árbol. No cuenta lo que las keys reservan aparte
+    // (como el buffer de un std::string largo) ni los bloques libres del pool.
+    std::size_t memory_bytes = 0;
+
+    BTreeCounters counters;  // En cero si no se compiló con BTREE_STATS
+};
+
+#endif
@@ -0,0 +1,270 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "node.h"
+
+using PageId = std::uint32_t;
+
+// Archivo dividido en páginas de page_size bytes, leídas y escritas enteras
+class PageFile {
+    int fd = -1;
+    std::size_t page_size;
+
+    static std::system_error error(const std::string& what) {
+        return {errno, std::generic_category(), what};
+    }
+
+public:
+    PageFile(const std::string& path, const std::size_t page_size)
+        : page_size(page_size) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            throw error("cannot open " + path);
+    }
+
+    PageFile(const PageFile&) = delete;
+
+    PageFile& operator=(const PageFile&) = delete;
+
+    ~PageFile() {
+        ::close(fd);
+    }
+
+    // Cantidad de páginas completas en el archivo
+    [[nodiscard]] std::size_t page_count() const {
+        struct stat info {};
+        if (::fstat(fd, &info) != 0)
+            throw error("cannot stat page file");
+        return static_cast<std::size_t>(info.st_size) / page_size;
+    }
+
+    void read(const PageId id, std::byte* const page) const {
+        std::size_t done = 0;
+        while (done < page_size) {
+            const ::ssize_t got = ::pread(fd, page + done, page_size - done,
+                                          static_cast<::off_t>(id * page_size + done));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+                throw error("cannot read page " + std::to_string(id));
+
+            // Más allá del final del archivo la página se lee como ceros
+            if (got == 0) {
+                std::memset(page + done, 0, page_size - done);
+                return;
+            }
+            done += static_cast<std::size_t>(got);
+        }
+    }
+
+    void write(const PageId id, const std::byte* const page) {
+        std::size_t done = 0;
+        while (done < page_size) {
+            const ::ssize_t put = ::pwrite(fd, page + done, page_size - done,
+                                           static_cast<::off_t>(id * page_size + done));
+            if (put < 0 && errno == EINTR)
+                continue;
+            if (put < 0)
+                throw error("cannot write page " + std::to_string(id));
+            done += static_cast<std::size_t>(put);
+        }
+    }
+
+    void sync() {
+        if (::fsync(fd) != 0)
+            throw error("cannot sync page file");
+    }
+
+    // Deja el archivo con sus primeras pages páginas
+    void truncate(const std::size_t pages) {
+        if (::ftruncate(fd, static_cast<::off_t>(pages * page_size)) != 0)
+            throw error("cannot truncate page file");
+    }
+};
+
+// Caché de páginas de un PageFile con reemplazo CLOCK. Cada página en memoria ocupa un frame;
+// mientras alguien la tenga fijada (pin) no se desaloja. Las páginas modificadas se escriben al
+// archivo recién cuando se desalojan o en flush(). Sin steal, las modificadas tampoco se desalojan:
+// el archivo solo cambia en flush(), lo que necesita quien escribe un log antes que las páginas.
+class BufferPool {
+    struct Frame {
+        PageId id = 0;
+        std::size_t pins = 0;
+        bool used = false;
+        bool dirty = false;
+        bool referenced = false;
+    };
+
+    struct PageDeleter {
+        void operator()(std::byte* const pages) const {
+            ::operator delete[](pages, std::align_val_t{cache_line_size});
+        }
+    };
+
+    PageFile& file;
+    std::size_t page_size;
+    std::vector<Frame> frames;
+    std::unique_ptr<std::byte[], PageDeleter> pages;
+    std::unordered_map<PageId, std::size_t> table;
+    std::size_t hand = 0;
+    std::size_t dirty_frames = 0;
+    bool steal;
+
+    // Frame libre, desalojando con CLOCK: se salta los fijados y les da una segunda vuelta a los
+    // referenciados desde la última pasada
+    std::size_t victim() {
+        for (std::size_t step = 0; step < 2 * frames.size(); ++step) {
+            const std::size_t i = std::exchange(hand, (hand + 1) % frames.size());
+            Frame& frame = frames[i];
+
+            if (!frame.used)
+                return i;
+            if (frame.pins > 0 || (frame.dirty && !steal))
+                continue;
+            if (frame.referenced) {
+                frame.referenced = false;
+                continue;
+            }
+
+            if (frame.dirty) {
+                file.write(frame.id, data(i));
+                --dirty_frames;
+            }
+            table.erase(frame.id);
+            frame = Frame{};
+            return i;
+        }
+
+        throw std::runtime_error(steal ? "all buffer pool frames are pinned"
+                                       : "all buffer pool frames are pinned or dirty");
+    }
+
+    std::size_t install(const PageId id) {
+        const std::size_t i = victim();
+        frames[i] = {id, 1, true, false, true};
+        table.emplace(id, i);
+        return i;
+    }
+
+public:
+    BufferPool(PageFile& file,
+               const std::size_t page_size,
+               const std::size_t capacity,
+               const bool steal = true)
+        : file(file),
+          page_size(page_size),
+          frames(capacity),
+          pages(static_cast<std::byte*>(
+              ::operator new[](capacity * page_size, std::align_val_t{cache_line_size}))),
+          steal(steal) {
+        if (capacity == 0)
+            throw std::invalid_argument("buffer pool needs at least one frame");
+    }
+
+    BufferPool(const BufferPool&) = delete;
+
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    ~BufferPool() = default;
+
+    // Fija la página id, leyéndola del archivo si no está en memoria. Retorna su frame.
+    std::size_t pin(const PageId id) {
+        if (const auto it = table.find(id); it != table.end()) {
+            Frame& frame = frames[it->second];
+            ++frame.pins;
+            frame.referenced = true;
+            return it->second;
+        }
+
+        const std::size_t i = install(id);
+        try {
+            file.read(id, data(i));
+        } catch (...) {
+            table.erase(id);
+            frames[i] = Frame{};
+            throw;
+        }
+        return i;
+    }
+
+    // Fija la página id sin leerla: su contenido empieza en ceros y ya cuenta como modificada
+    std::size_t pin_new(const PageId id) {
+        std::size_t i = 0;
+        if (const auto it = table.find(id); it != table.end()) {
+            i = it->second;
+            ++frames[i].pins;
+        } else {
+            i = install(id);
+        }
+
+        std::memset(data(i), 0, page_size);
+        mark_dirty(i);
+        return i;
+    }
+
+    void unpin(const std::size_t frame) {
+        --frames[frame].pins;
+    }
+
+    void mark_dirty(const std::size_t frame) {
+        if (!std::exchange(frames[frame].dirty, true))
+            ++dirty_frames;
+    }
+
+    [[nodiscard]] std::byte* data(const std::size_t frame) const {
+        return pages.get() + frame * page_size;
+    }
+
+    // Escribe al archivo todas las páginas modificadas
+    void flush() {
+        for (std::size_t i = 0; i < frames.size(); ++i) {
+            if (frames[i].used && frames[i].dirty) {
+                file.write(frames[i].id, data(i));
+                frames[i].dirty = false;
+                --dirty_frames;
+            }
+        }
+    }
+
+    // Llama a fn(id, página) por cada página modificada en memoria
+    template<typename Fn>
+    void for_each_dirty(Fn&& fn) const {
+        for (std::size_t i = 0; i < frames.size(); ++i)
+            if (frames[i].used && frames[i].dirty)
+                fn(frames[i].id, static_cast<const std::byte*>(data(i)));
+    }
+
+    // Olvida todas las páginas en memoria sin escribirlas. Ninguna debe estar fijada.
+    void discard() {
+        std::fill(frames.begin(), frames.end(), Frame{});
+        table.clear();
+        hand = 0;
+        dirty_frames = 0;
+    }
+
+    [[nodiscard]] std::size_t capacity() const {
+        return frames.size();
+    }
+
+    [[nodiscard]] std::size_t dirty_count() const {
+        return dirty_frames;
+    }
+};
+
+#endif
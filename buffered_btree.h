@@ -0,0 +1,713 @@
+#ifndef BUFFERED_BTREE_H
+#define BUFFERED_BTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "node.h"
+#include "node_ops.h"
+#include "node_search.h"
+
+// Operación pendiente sobre key: después de aplicarla, key está en el árbol si y solo si present
+template<typename TK>
+struct PendingMessage {
+    TK key;
+    bool present;
+};
+
+// Árbol B (solo keys) optimizado para escrituras, al estilo de un árbol B^ε: insert y remove no
+// bajan hasta una hoja, sino que dejan un mensaje en el buffer de la raíz. Cuando un buffer pasa
+// de buffer_capacity mensajes, los que van hacia el child con más trabajo pendiente bajan juntos
+// a ese child. Los que llegan al último nivel interno se aplican en la hoja, o con el insert y
+// remove de siempre cuando hay que partirla o rebalancear. Así, muchas escrituras al mismo
+// subárbol comparten una sola bajada.
+//
+// Un mensaje con key k está siempre en algún nodo interno del camino hacia k, y uno más arriba es
+// más nuevo que uno más abajo. search revisa los buffers mientras baja, así que cuesta un poco más
+// que en BasicBTree.
+//
+// Los nodos son Node de orden fijo con un buffer de mensajes, que solo usan los internos y está
+// ordenado por key sin repetir keys. Split, borrow y merge son los de node_ops.h, más el reparto
+// de los mensajes entre los nodos que cambian.
+//
+// Como insert y remove no miran el árbol, no saben si la key ya estaba: la cantidad de keys solo
+// se sabe aplicando todos los mensajes pendientes, con flush_and_size(). for_each() también los
+// aplica antes (lo mismo que flush()).
+//
+// Por omisión los nodos son de orden 32 con buffers de 2048 mensajes: con 10^7 inserts de keys
+// aleatorias de tipo int fue la combinación más rápida, alrededor del doble que BTree.
+template<typename TK,
+         std::size_t Order = 32,
+         typename Compare = std::less<TK>,
+         typename Search = DefaultNodeSearch>
+class BufferedBTree {
+    static_assert(Order != dynamic_order, "BufferedBTree needs a fixed order");
+
+    using Message = PendingMessage<TK>;
+    using Buffer = std::vector<Message>;
+    using BNode = Node<TK, Order, void, false, false, Buffer>;
+
+    static constexpr std::size_t M = Order;
+    static constexpr std::size_t min_keys = (M - 1) / 2;
+
+    static constexpr bool transparent = requires { typename Compare::is_transparent; };
+
+    template<typename K>
+    using LookupKey = std::conditional_t<transparent, K, TK>;
+
+    static constexpr std::size_t max_depth = max_tree_depth((Order + 1) / 2);
+
+    struct Frame {
+        BNode* node;
+        std::size_t idx;
+    };
+
+    static constexpr std::size_t default_buffer_capacity = 2048;
+
+    [[no_unique_address]] Compare comp;
+    std::size_t buffer_capacity = default_buffer_capacity;
+
+    BNode* root = nullptr;
+    std::size_t n = 0;        // Keys en los nodos, sin contar los mensajes pendientes
+    std::size_t pending = 0;  // Mensajes en los buffers
+
+    // Mensajes del buffer de una raíz que quedó reemplazada por una hoja, a aplicar después de
+    // la operación en curso
+    Buffer orphans;
+
+    // Índice de la primera key >= key. Un mensaje con esa key baja por children[idx].
+    template<typename K>
+    std::size_t rank(const BNode* const node, const K& key) const {
+        return Search::template rank<M - 1>(node->keys, node->count, key, comp);
+    }
+
+    template<typename K>
+    bool matches(const BNode* const node, const std::size_t idx, const K& key) const {
+        return idx < node->count && !comp(key, node->keys[idx]);
+    }
+
+    // Primer mensaje con key mayor que bound. Los de antes bajan a la izquierda de un separador
+    // bound.
+    typename Buffer::iterator split_point(Buffer& buffer, const TK& bound) const {
+        return std::partition_point(buffer.begin(), buffer.end(), [&](const Message& msg) {
+            return !comp(bound, msg.key);
+        });
+    }
+
+    template<typename K>
+    const Message* find_message(const BNode* const node, const K& key) const {
+        const auto it = std::partition_point(
+            node->buffer.messages.begin(), node->buffer.messages.end(),
+            [&](const Message& msg) { return comp(msg.key, key); });
+        return it != node->buffer.messages.end() && !comp(key, it->key) ? &*it : nullptr;
+    }
+
+    // Agrega msg, más nuevo que los que ya están en buffer
+    void add_message(Buffer& buffer, Message&& msg) {
+        const auto it = std::partition_point(buffer.begin(), buffer.end(), [&](const Message& m) {
+            return comp(m.key, msg.key);
+        });
+
+        if (it != buffer.end() && !comp(msg.key, it->key)) {
+            *it = std::move(msg);
+        } else {
+            buffer.insert(it, std::move(msg));
+            ++pending;
+        }
+    }
+
+    // Mezcla en buffer los mensajes de newer, ordenados y más nuevos que los de buffer. Se mezcla
+    // desde atrás dentro del mismo buffer; los huecos que dejan las keys repetidas se cierran al
+    // final.
+    void merge_messages(Buffer& buffer, Buffer&& newer) {
+        if (buffer.empty()) {
+            buffer = std::move(newer);
+            return;
+        }
+
+        const auto old_size = static_cast<std::ptrdiff_t>(buffer.size());
+        buffer.resize(buffer.size() + newer.size());
+
+        auto out = buffer.end();
+        auto old_it = buffer.begin() + old_size;
+        auto new_it = newer.end();
+        while (new_it != newer.begin()) {
+            const bool has_old = old_it != buffer.begin();
+            if (has_old && comp(std::prev(new_it)->key, std::prev(old_it)->key)) {
+                *--out = std::move(*--old_it);
+            } else {
+                if (has_old && !comp(std::prev(old_it)->key, std::prev(new_it)->key)) {
+                    --old_it;
+                    --pending;
+                }
+                *--out = std::move(*--new_it);
+            }
+        }
+
+        buffer.erase(old_it, out);
+    }
+
+    static void destroy_subtree(BNode* const node) {
+        if (node == nullptr)
+            return;
+
+        if (!node->leaf)
+            for (std::size_t i = 0; i < node->count + 1; ++i)
+                destroy_subtree(node->children[i]);
+
+        delete node;
+    }
+
+    void push(Message&& msg) {
+        if (root == nullptr || root->leaf) {
+            apply(std::move(msg));
+            return;
+        }
+
+        add_message(root->buffer.messages, std::move(msg));
+        if (root->buffer.messages.size() > buffer_capacity)
+            flush_path();
+    }
+
+    // Baja desde la raíz llevando los mensajes que van hacia el child con más mensajes, mientras
+    // el child también se llene. Los que llegan a una hoja se aplican.
+    void flush_path() {
+        Frame path[max_depth];
+        std::size_t depth = 0;
+        BNode* node = root;
+
+        while (true) {
+            Buffer& buffer = node->buffer.messages;
+
+            // Como el buffer está ordenado, los mensajes de cada child forman un tramo contiguo y
+            // basta recorrer los mensajes junto con los separadores
+            std::size_t best = 0;
+            std::size_t best_from = 0;
+            std::size_t best_to = 0;
+            const auto consider = [&](const std::size_t child, const std::size_t from,
+                                      const std::size_t to) {
+                if (to - from > best_to - best_from)
+                    std::tie(best, best_from, best_to) = std::make_tuple(child, from, to);
+            };
+
+            std::size_t run = 0;
+            std::size_t from = 0;
+            for (std::size_t i = 0; i < buffer.size(); ++i) {
+                if (run < node->count && comp(node->keys[run], buffer[i].key)) {
+                    consider(run, from, i);
+                    do
+                        ++run;
+                    while (run < node->count && comp(node->keys[run], buffer[i].key));
+                    from = i;
+                }
+            }
+            consider(run, from, buffer.size());
+
+            const auto first = buffer.begin() + static_cast<std::ptrdiff_t>(best_from);
+            const auto last = buffer.begin() + static_cast<std::ptrdiff_t>(best_to);
+            Buffer batch(std::make_move_iterator(first), std::make_move_iterator(last));
+            buffer.erase(first, last);
+
+            path[depth++] = {node, best};
+
+            BNode* const child = node->children[best];
+            if (child->leaf) {
+                apply_to_leaf(path, depth, child, batch);
+                return;
+            }
+
+            merge_messages(child->buffer.messages, std::move(batch));
+            if (child->buffer.messages.size() <= buffer_capacity)
+                return;
+            node = child;
+        }
+    }
+
+    // Aplica batch a leaf, a la que se llegó por path[0, depth). Mientras leaf no tenga que
+    // partirse ni quede bajo el mínimo, y la key no sea un separador del camino (que es el único
+    // lugar fuera de leaf donde puede estar), se aplica ahí mismo sin bajar desde la raíz. Desde
+    // el primer mensaje que cambia la forma del árbol, el resto va por apply.
+    void apply_to_leaf(const Frame* const path,
+                       const std::size_t depth,
+                       BNode* const leaf,
+                       Buffer& batch) {
+        pending -= batch.size();
+
+        std::size_t i = 0;
+        for (; i < batch.size(); ++i) {
+            Message& msg = batch[i];
+
+            bool separator = false;
+            for (std::size_t d = 0; d < depth && !separator; ++d) {
+                const auto [node, idx] = path[d];
+                separator = matches(node, idx, msg.key);
+            }
+
+            const std::size_t pos = rank(leaf, msg.key);
+            const bool hit = matches(leaf, pos, msg.key);
+
+            if (msg.present) {
+                if (separator || hit)
+                    continue;
+                if (leaf->count == M - 1)
+                    break;
+
+                std::move_backward(leaf->keys + pos, leaf->keys + leaf->count,
+                                   leaf->keys + leaf->count + 1);
+                leaf->keys[pos] = std::move(msg.key);
+                ++leaf->count;
+                ++n;
+            } else {
+                if (!separator && !hit)
+                    continue;
+                if (separator || leaf->count == min_keys)
+                    break;
+
+                std::move(leaf->keys + pos + 1, leaf->keys + leaf->count, leaf->keys + pos);
+                --leaf->count;
+                --n;
+            }
+        }
+
+        for (; i < batch.size(); ++i)
+            apply(std::move(batch[i]));
+    }
+
+    void apply(Message&& msg) {
+        if (msg.present)
+            insert_key(std::move(msg.key));
+        else
+            remove_key(msg.key);
+
+        while (!orphans.empty()) {
+            Message orphan = std::move(orphans.back());
+            orphans.pop_back();
+            --pending;
+
+            if (orphan.present)
+                insert_key(std::move(orphan.key));
+            else
+                remove_key(orphan.key);
+        }
+    }
+
+    // node está lleno y le falta entry en la posición i, con left como children[i]. Los mensajes
+    // de node van al lado por el que bajarían.
+    BNode* split(BNode* const node, const std::size_t i, TK& entry, BNode* const left) {
+        auto* const lsplit = new BNode();
+        node_ops::split<M>(*node, *lsplit, i, entry, left);
+
+        if (!node->leaf) {
+            Buffer& buffer = node->buffer.messages;
+            const auto boundary = split_point(buffer, entry);
+            lsplit->buffer.messages.assign(std::make_move_iterator(buffer.begin()),
+                                           std::make_move_iterator(boundary));
+            buffer.erase(buffer.begin(), boundary);
+        }
+
+        return lsplit;
+    }
+
+    // children[i] de node tomó la última key de children[i - 1], rotando por el separador. Los
+    // mensajes de children[i - 1] que quedan a la derecha del separador nuevo se van con él.
+    void borrow_left(BNode* const node, const std::size_t i) {
+        BNode* const mid = node->children[i];
+        BNode* const left = node->children[i - 1];
+        node_ops::borrow_left(*node, i, *mid, *left);
+
+        if (!mid->leaf) {
+            Buffer& from = left->buffer.messages;
+            const auto boundary = split_point(from, node->keys[i - 1]);
+            mid->buffer.messages.insert(mid->buffer.messages.begin(),
+                                        std::make_move_iterator(boundary),
+                                        std::make_move_iterator(from.end()));
+            from.erase(boundary, from.end());
+        }
+    }
+
+    // children[i] de node tomó la primera key de children[i + 1], rotando por el separador. Los
+    // mensajes de children[i + 1] que quedan a la izquierda del separador nuevo se van con él.
+    void borrow_right(BNode* const node, const std::size_t i) {
+        BNode* const mid = node->children[i];
+        BNode* const right = node->children[i + 1];
+        node_ops::borrow_right(*node, i, *mid, *right);
+
+        if (!mid->leaf) {
+            Buffer& from = right->buffer.messages;
+            const auto boundary = split_point(from, node->keys[i]);
+            mid->buffer.messages.insert(mid->buffer.messages.end(),
+                                        std::make_move_iterator(from.begin()),
+                                        std::make_move_iterator(boundary));
+            from.erase(from.begin(), boundary);
+        }
+    }
+
+    // children[i] absorbe el separador, children[i + 1] y sus mensajes, y children[i + 1] se
+    // libera
+    static void merge_children(BNode* const node, const std::size_t i) {
+        BNode* const left = node->children[i];
+        BNode* const right = node->children[i + 1];
+        node_ops::merge(*node, i, *left, *right);
+
+        left->buffer.messages.insert(left->buffer.messages.end(),
+                                     std::make_move_iterator(right->buffer.messages.begin()),
+                                     std::make_move_iterator(right->buffer.messages.end()));
+        delete right;
+    }
+
+    // Insert de BasicBTree sobre las keys de los nodos, sin mirar los mensajes
+    void insert_key(TK&& key) {
+        if (root == nullptr) {
+            root = new BNode();
+            root->keys[0] = std::move(key);
+            root->count = 1;
+            ++n;
+            return;
+        }
+
+        Frame path[max_depth];
+        std::size_t depth = 0;
+
+        for (BNode* node = root;;) {
+            const std::size_t idx = rank(node, key);
+            if (matches(node, idx, key))
+                return;
+
+            path[depth++] = {node, idx};
+            if (node->leaf)
+                break;
+            node = node->children[idx];
+        }
+
+        ++n;
+
+        TK entry = std::move(key);
+        BNode* left = nullptr;
+
+        for (std::size_t d = depth; d-- > 0;) {
+            const auto [cur, i] = path[d];
+
+            if (cur->count < M - 1) {
+                cur->children[cur->count + 1] = cur->children[cur->count];
+                for (std::size_t j = cur->count; j > i; --j) {
+                    cur->keys[j] = std::move(cur->keys[j - 1]);
+                    cur->children[j] = cur->children[j - 1];
+                }
+
+                cur->keys[i] = std::move(entry);
+                cur->children[i] = left;
+                ++cur->count;
+                return;
+            }
+
+            left = split(cur, i, entry, left);
+        }
+
+        auto* const new_root = new BNode();
+        new_root->leaf = false;
+        new_root->keys[0] = std::move(entry);
+        new_root->count = 1;
+        new_root->children[0] = left;
+        new_root->children[1] = root;
+        root = new_root;
+    }
+
+    // Remove de BasicBTree sobre las keys de los nodos, sin mirar los mensajes (salvo para
+    // mantenerlos en el camino de su key)
+    void remove_key(const TK& key) {
+        if (root == nullptr)
+            return;
+
+        // Si key está en un nodo interno (anchor) se reemplaza por su predecesor, que está al
+        // final del borde derecho del child de la izquierda
+        Frame path[max_depth];
+        std::size_t depth = 0;
+        std::size_t anchor = max_depth;
+
+        for (BNode* node = root;;) {
+            std::size_t idx = 0;
+            bool hit = false;
+            if (anchor != max_depth) {
+                idx = node->leaf ? node->count - 1 : node->count;
+            } else {
+                idx = rank(node, key);
+                hit = matches(node, idx, key);
+                if (hit && !node->leaf)
+                    anchor = depth;
+            }
+
+            path[depth++] = {node, idx};
+
+            if (node->leaf) {
+                if (anchor == max_depth && !hit)
+                    return;
+                break;
+            }
+            node = node->children[idx];
+        }
+
+        BNode* const leaf = path[depth - 1].node;
+        const std::size_t pos = path[depth - 1].idx;
+
+        if (anchor != max_depth) {
+            // El separador baja de key al predecesor, así que los mensajes entre los dos que
+            // esperaban en el borde derecho del subárbol izquierdo ahora van por el subárbol
+            // derecho: pasan al nodo de su borde izquierdo que está a la misma altura
+            const auto [node, idx] = path[anchor];
+            BNode* right = node->children[idx + 1];
+
+            for (std::size_t d = anchor + 1; d + 1 < depth; ++d, right = right->children[0]) {
+                Buffer& buffer = path[d].node->buffer.messages;
+                const auto boundary = split_point(buffer, leaf->keys[pos]);
+                right->buffer.messages.insert(right->buffer.messages.begin(),
+                                              std::make_move_iterator(boundary),
+                                              std::make_move_iterator(buffer.end()));
+                buffer.erase(boundary, buffer.end());
+            }
+
+            node->keys[idx] = std::move(leaf->keys[pos]);
+        }
+
+        for (std::size_t j = pos; j + 1 < leaf->count; ++j)
+            leaf->keys[j] = std::move(leaf->keys[j + 1]);
+        --leaf->count;
+        --n;
+
+        for (std::size_t d = depth - 1; d > 0; --d) {
+            if (path[d].node->count >= min_keys)
+                break;
+
+            const auto [parent, i] = path[d - 1];
+
+            if (i > 0) {
+                if (parent->children[i - 1]->count > min_keys) {
+                    borrow_left(parent, i);
+                    break;
+                }
+
+                merge_children(parent, i - 1);
+            } else {
+                if (parent->children[i + 1]->count > min_keys) {
+                    borrow_right(parent, i);
+                    break;
+                }
+
+                merge_children(parent, i);
+            }
+        }
+
+        // Una raíz vacía se reemplaza por su único child (o por nada, si era hoja). Sus mensajes
+        // son más nuevos que los del child; si el child es una hoja, se aplican.
+        if (root->count == 0) {
+            BNode* const old_root = root;
+
+            if (old_root->leaf) {
+                root = nullptr;
+            } else {
+                root = old_root->children[0];
+                if (root->leaf)
+                    orphans = std::move(old_root->buffer.messages);
+                else
+                    merge_messages(root->buffer.messages, std::move(old_root->buffer.messages));
+            }
+
+            delete old_root;
+        }
+    }
+
+    template<typename Fn>
+    static void for_each(const BNode* const node, Fn& fn) {
+        for (std::size_t i = 0; i < node->count; ++i) {
+            if (!node->leaf)
+                for_each(node->children[i], fn);
+            fn(static_cast<const TK&>(node->keys[i]));
+        }
+
+        if (!node->leaf)
+            for_each(node->children[node->count], fn);
+    }
+
+    // Saca los mensajes de todos los buffers, junto con la profundidad de su nodo
+    static void collect_messages(BNode* const node,
+                                 const std::size_t depth,
+                                 std::vector<std::pair<std::size_t, Message>>& messages) {
+        if (node->leaf)
+            return;
+
+        for (Message& msg : node->buffer.messages)
+            messages.emplace_back(depth, std::move(msg));
+        node->buffer.messages.clear();
+
+        for (std::size_t i = 0; i < node->count + 1; ++i)
+            collect_messages(node->children[i], depth + 1, messages);
+    }
+
+    // Que los mensajes de cada nodo estén ordenados, sin repetir y dentro de (lo, hi], el tramo
+    // que baja hasta el nodo. Retorna cuántos hay en el subárbol, o nullopt si alguno está mal.
+    std::optional<std::size_t> check_messages(const BNode* const node,
+                                              const TK* const lo,
+                                              const TK* const hi) const {
+        const Buffer& buffer = node->buffer.messages;
+        if (node->leaf)
+            return buffer.empty() ? std::optional<std::size_t>(0) : std::nullopt;
+
+        for (std::size_t i = 0; i < buffer.size(); ++i) {
+            const TK& key = buffer[i].key;
+            if ((i > 0 && !comp(buffer[i - 1].key, key)) || (lo != nullptr && !comp(*lo, key)) ||
+                (hi != nullptr && comp(*hi, key)))
+                return std::nullopt;
+        }
+
+        std::size_t total = buffer.size();
+        for (std::size_t i = 0; i < node->count + 1; ++i) {
+            const std::optional<std::size_t> sub =
+                check_messages(node->children[i], i > 0 ? &node->keys[i - 1] : lo,
+                               i < node->count ? &node->keys[i] : hi);
+            if (!sub)
+                return std::nullopt;
+            total += *sub;
+        }
+
+        return total;
+    }
+
+public:
+    BufferedBTree() = default;
+
+    // buffer_capacity: cuántos mensajes junta un nodo interno antes de pasarlos a un child
+    explicit BufferedBTree(const std::size_t buffer_capacity, const Compare& comp = Compare())
+        : comp(comp),
+          buffer_capacity(buffer_capacity) {}
+
+    BufferedBTree(const BufferedBTree&) = delete;
+
+    BufferedBTree(BufferedBTree&& other) noexcept
+        : comp(other.comp),
+          buffer_capacity(other.buffer_capacity),
+          root(std::exchange(other.root, nullptr)),
+          n(std::exchange(other.n, 0)),
+          pending(std::exchange(other.pending, 0)) {}
+
+    BufferedBTree& operator=(const BufferedBTree&) = delete;
+
+    BufferedBTree& operator=(BufferedBTree&& other) noexcept {
+        std::swap(comp, other.comp);
+        std::swap(buffer_capacity, other.buffer_capacity);
+        std::swap(root, other.root);
+        std::swap(n, other.n);
+        std::swap(pending, other.pending);
+        return *this;
+    }
+
+    ~BufferedBTree() {
+        destroy_subtree(root);
+    }
+
+    template<typename K>
+    [[nodiscard]] bool search(const K& key) const {
+        const LookupKey<K>& k = key;
+
+        // El primer mensaje con key en el camino es el más nuevo y decide. Si no hay ninguno,
+        // decide si key está en algún nodo, aunque esté en uno interno hay que seguir bajando
+        // porque puede haber mensajes más abajo.
+        bool found = false;
+        for (const BNode* node = root; node != nullptr;) {
+            const std::size_t idx = rank(node, k);
+            if (!node->leaf)
+                if (const Message* const msg = find_message(node, k))
+                    return msg->present;
+
+            found = found || matches(node, idx, k);
+            node = node->leaf ? nullptr : node->children[idx];
+        }
+
+        return found;
+    }
+
+    void insert(TK key) {
+        push({std::move(key), true});
+    }
+
+    void remove(TK key) {
+        push({std::move(key), false});
+    }
+
+    // Aplica todos los mensajes pendientes. Después de esto el árbol es un árbol B normal.
+    void flush() {
+        if (root == nullptr || root->leaf)
+            return;
+
+        std::vector<std::pair<std::size_t, Message>> messages;
+        collect_messages(root, 0, messages);
+        pending = 0;
+
+        // Por key, y ante la misma key primero el del nodo menos profundo, que es el más nuevo
+        std::sort(messages.begin(), messages.end(), [&](const auto& a, const auto& b) {
+            if (comp(a.second.key, b.second.key))
+                return true;
+            if (comp(b.second.key, a.second.key))
+                return false;
+            return a.first < b.first;
+        });
+
+        for (std::size_t i = 0, j = 0; i < messages.size(); i = j) {
+            for (j = i + 1; j < messages.size() &&
+                            !comp(messages[i].second.key, messages[j].second.key);)
+                ++j;
+
+            apply(std::move(messages[i].second));
+        }
+    }
+
+    // Llama a fn(key) para cada key, en orden. Aplica antes los mensajes pendientes.
+    template<typename Fn>
+    void for_each(Fn&& fn) {
+        flush();
+        if (root != nullptr)
+            for_each(root, fn);
+    }
+
+    // Cantidad de keys. Como los mensajes pendientes pueden repetir keys que ya están (o borrar
+    // keys que no están), para saberla hay que aplicarlos antes.
+    [[nodiscard]] std::size_t flush_and_size() {
+        flush();
+        return n;
+    }
+
+    // Inserts y removes que todavía esperan en algún buffer
+    [[nodiscard]] std::size_t pending_messages() const {
+        return pending;
+    }
+
+    void clear() {
+        destroy_subtree(root);
+        root = nullptr;
+        n = 0;
+        pending = 0;
+    }
+
+    [[nodiscard]] std::ptrdiff_t height() const {
+        std::ptrdiff_t height = -1;
+        for (const BNode* cur = root; cur != nullptr; cur = cur->leaf ? nullptr : cur->children[0])
+            ++height;
+        return height;
+    }
+
+    // Propiedades de árbol B de los nodos, más que cada mensaje esté en el camino de su key
+    [[nodiscard]] bool check_properties() const {
+        if (root == nullptr)
+            return pending == 0;
+
+        auto fetch = [](const BNode* const child) { return child; };
+        return node_ops::check<M>(*root, true, min_keys, nullptr, nullptr, comp, fetch) >= 0 &&
+               check_messages(root, nullptr, nullptr) == pending;
+    }
+};
+
+#endif
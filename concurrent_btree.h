@@ -0,0 +1,714 @@
+#ifndef CONCURRENT_BTREE_H
+#define CONCURRENT_BTREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "node.h"
+#include "node_ops.h"
+#include "node_search.h"
+
+// Latch de un nodo para optimistic lock coupling. version cuenta las escrituras en sus bits
+// altos; el bit 1 indica que un escritor tiene el nodo tomado y el bit 0 que el nodo ya salió del
+// árbol. Un lector no escribe nada: anota la versión antes de leer el nodo y la vuelve a comparar
+// después. Si cambió, lo que leyó pudo estar a medio escribir y tiene que empezar de nuevo.
+class OptimisticLatch {
+    static constexpr std::uint64_t obsolete_bit = 1;
+    static constexpr std::uint64_t locked_bit = 2;
+    static constexpr unsigned spins_before_yield = 64;
+
+    std::atomic<std::uint64_t> version{0};
+
+public:
+    // Anota en v la versión actual. Falla si hay un escritor o si el nodo es obsoleto.
+    bool read_lock(std::uint64_t& v) const {
+        v = version.load(std::memory_order_acquire);
+        return (v & (locked_bit | obsolete_bit)) == 0;
+    }
+
+    // Si nadie escribió el nodo desde read_lock. El fence evita que las lecturas del nodo se
+    // muevan después de esta comparación.
+    [[nodiscard]] bool validate(const std::uint64_t v) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version.load(std::memory_order_relaxed) == v;
+    }
+
+    void write_lock() {
+        for (unsigned spins = 0;; ++spins) {
+            std::uint64_t v = version.load(std::memory_order_relaxed);
+            if ((v & locked_bit) == 0 &&
+                version.compare_exchange_weak(v, v | locked_bit, std::memory_order_acquire))
+                return;
+
+            if (spins >= spins_before_yield)
+                std::this_thread::yield();
+        }
+    }
+
+    // Suelta el latch: sumar locked_bit lo limpia y lleva el acarreo al contador
+    void write_unlock() {
+        version.fetch_add(locked_bit, std::memory_order_release);
+    }
+
+    // Suelta el latch de un nodo que salió del árbol; los lectores que lleguen a él reintentan
+    void write_unlock_obsolete() {
+        version.fetch_add(locked_bit | obsolete_bit, std::memory_order_release);
+    }
+};
+
+// Libera con epochs los objetos que salieron de una estructura mientras algún lector sin latch
+// puede estar leyéndolos. Cada lector anuncia la epoch global en un slot mientras lee (Guard);
+// cada objeto retirado queda anotado con la epoch en que salió. La epoch solo avanza cuando todos
+// los lectores activos ya anunciaron la actual, así que cuando avanzó dos veces desde que un
+// objeto salió, ya no queda ningún lector que lo haya alcanzado y se puede borrar. Nunca hace
+// falta un momento sin lectores: alcanza con que cada lectura termine.
+template<typename T>
+class EpochReclaimer {
+    struct alignas(cache_line_size) Slot {
+        std::atomic<std::uint64_t> epoch{0};  // 0 = libre
+    };
+
+    // Cada cuántos retiros se intenta avanzar la epoch y liberar
+    static constexpr std::size_t reclaim_batch = 64;
+
+    std::atomic<std::uint64_t> epoch{1};
+    std::size_t slot_count;
+    std::unique_ptr<Slot[]> slots;
+
+    std::mutex retired_mutex;
+    std::vector<std::pair<std::uint64_t, T*>> retired;
+    std::size_t since_reclaim = 0;
+
+    // Slot en el que el hilo entró la última vez, para volver al mismo sin competir con otros
+    static inline thread_local std::size_t slot_hint =
+        std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    // Toma un slot libre anunciando la epoch actual. El CAS es seq_cst: el anuncio queda visible
+    // antes de que el lector lea cualquier puntero de la estructura.
+    std::size_t enter() {
+        for (std::size_t i = slot_hint % slot_count;; i = (i + 1) % slot_count) {
+            std::uint64_t free = 0;
+            if (slots[i].epoch.compare_exchange_strong(free, epoch.load())) {
+                slot_hint = i;
+                return i;
+            }
+            if (i + 1 == slot_count)
+                std::this_thread::yield();
+        }
+    }
+
+    // Avanza la epoch si todos los lectores activos ya están en la actual, y borra lo que salió
+    // hace al menos dos epochs. Con retired_mutex tomado.
+    void reclaim() {
+        since_reclaim = 0;
+
+        std::uint64_t current = epoch.load();
+        bool behind = false;
+        for (std::size_t i = 0; i < slot_count && !behind; ++i) {
+            const std::uint64_t announced = slots[i].epoch.load();
+            behind = announced != 0 && announced != current;
+        }
+        if (!behind && epoch.compare_exchange_strong(current, current + 1))
+            ++current;
+
+        const auto safe = std::partition(retired.begin(), retired.end(), [&](const auto& entry) {
+            return entry.first + 2 > current;
+        });
+        for (auto it = safe; it != retired.end(); ++it)
+            delete it->second;
+        retired.erase(safe, retired.end());
+    }
+
+public:
+    // Mientras exista, los objetos que el hilo alcance no se liberan
+    class Guard {
+        EpochReclaimer* reclaimer;
+        std::size_t slot;
+
+    public:
+        explicit Guard(EpochReclaimer& reclaimer)
+            : reclaimer(&reclaimer),
+              slot(reclaimer.enter()) {}
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            reclaimer->slots[slot].epoch.store(0, std::memory_order_release);
+        }
+    };
+
+    // Con un slot por lector simultáneo; más lectores que slots esperan a que se libere uno
+    explicit EpochReclaimer(const std::size_t readers = 0)
+        : slot_count(readers != 0 ? readers
+                                  : 4 * std::max<std::size_t>(1, std::thread::hardware_concurrency())),
+          slots(new Slot[slot_count]) {}
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    // Sin lectores ya no hay nada que esperar
+    ~EpochReclaimer() {
+        for (const auto& [retired_at, object] : retired)
+            delete object;
+    }
+
+    // object ya no es alcanzable desde la estructura; se borra cuando ningún lector lo pueda tener
+    void retire(T* const object) {
+        const std::lock_guard lock(retired_mutex);
+        retired.emplace_back(epoch.load(), object);
+        if (++since_reclaim >= reclaim_batch)
+            reclaim();
+    }
+
+    // Libera lo que ya se puede sin esperar al próximo lote de retiros
+    void collect() {
+        const std::lock_guard lock(retired_mutex);
+        reclaim();
+    }
+
+    // Objetos retirados que todavía esperan a que terminen los lectores que pueden tenerlos
+    [[nodiscard]] std::size_t pending() {
+        const std::lock_guard lock(retired_mutex);
+        return retired.size();
+    }
+};
+
+template<typename TK, std::size_t Order>
+struct alignas(cache_line_size) LatchedNode {
+    static_assert(Order >= 3, "order must be greater than 2");
+
+    OptimisticLatch latch;
+    std::size_t count = 0;
+    bool leaf = true;
+    TK keys[Order - 1]{};
+    LatchedNode* children[Order]{};
+};
+
+// Árbol B (solo keys) que se puede usar desde varios hilos a la vez.
+//
+// Los lectores (search, for_each_in_range) bajan con optimistic lock coupling: leen cada nodo sin
+// tomarlo y validan su versión antes de pasar al siguiente, así que no escriben memoria compartida
+// y no se frenan entre ellos. Los escritores (insert, remove) toman los latches de arriba hacia
+// abajo y sueltan los ancestros apenas el nodo actual no puede partirse (o quedar bajo el
+// mínimo), porque entonces el cambio no sube de ahí.
+//
+// Como un lector puede estar leyendo un nodo mientras se escribe, las keys deben ser trivialmente
+// copiables, y el orden es fijo para que los nodos tengan tamaño fijo. Los nodos que salen del
+// árbol (por un merge o porque la raíz se vació) se liberan con un EpochReclaimer: cada bajada
+// optimista anuncia su epoch, y un nodo se borra cuando ya terminaron todas las que empezaron
+// antes de que saliera. Los escritores no anuncian nada: solo llegan a nodos cuyo padre tienen
+// tomado, y un nodo solo sale del árbol con su padre tomado.
+template<typename TK,
+         std::size_t Order = 64,
+         typename Compare = std::less<TK>,
+         typename Search = DefaultNodeSearch>
+class ConcurrentBTree {
+    static_assert(std::is_trivially_copyable_v<TK>,
+                  "keys are read while being written, so they must be trivially copyable");
+
+    using BNode = LatchedNode<TK, Order>;
+
+    static constexpr std::size_t M = Order;
+    static constexpr std::size_t min_keys = (M - 1) / 2;
+
+    static constexpr bool transparent = requires { typename Compare::is_transparent; };
+
+    template<typename K>
+    using LookupKey = std::conditional_t<transparent, K, TK>;
+
+    static constexpr std::size_t max_depth = max_tree_depth((Order + 1) / 2);
+
+    // Nodo tomado por un escritor y el índice por el que bajó (o de la key, en la hoja)
+    struct Frame {
+        BNode* node;
+        std::size_t idx;
+    };
+
+    [[no_unique_address]] Compare comp;
+
+    // root_latch protege al puntero root como si fuera un nodo más por encima de la raíz
+    OptimisticLatch root_latch;
+    std::atomic<BNode*> root{nullptr};
+    std::atomic<std::size_t> n{0};
+
+    mutable EpochReclaimer<BNode> reclaimer;
+
+    // Índice de la primera key >= key entre las primeras count. Los lectores pasan count ya
+    // acotado a M - 1, porque pueden leerlo a medio escribir (y entonces descartan el resultado).
+    template<typename K>
+    std::size_t rank(const BNode* const node, const std::size_t count, const K& key) const {
+        return Search::template rank<M - 1>(node->keys, count, key, comp);
+    }
+
+    template<typename K>
+    bool matches(const BNode* const node,
+                 const std::size_t count,
+                 const std::size_t idx,
+                 const K& key) const {
+        return idx < count && !comp(key, node->keys[idx]);
+    }
+
+    // Saca node del árbol. Sigue siendo memoria válida para los lectores que lo estén leyendo,
+    // que al validar ven que es obsoleto y reintentan, hasta que todos terminan.
+    void retire(BNode* const node) {
+        node->latch.write_unlock_obsolete();
+        reclaimer.retire(node);
+    }
+
+    static void destroy_subtree(BNode* const node) {
+        if (node == nullptr)
+            return;
+
+        if (!node->leaf)
+            for (std::size_t i = 0; i < node->count + 1; ++i)
+                destroy_subtree(node->children[i]);
+
+        delete node;
+    }
+
+    // Búsqueda optimista. Retorna nullopt si algún nodo cambió durante la lectura.
+    template<typename K>
+    std::optional<bool> try_search(const K& key) const {
+        const typename EpochReclaimer<BNode>::Guard guard(reclaimer);
+        std::uint64_t version = 0;
+        if (!root_latch.read_lock(version))
+            return std::nullopt;
+
+        const BNode* node = root.load(std::memory_order_acquire);
+        if (node == nullptr)
+            return root_latch.validate(version) ? std::optional<bool>(false) : std::nullopt;
+
+        const OptimisticLatch* parent = &root_latch;
+        std::uint64_t parent_version = version;
+
+        while (true) {
+            // Se anota la versión del nodo antes de validar al padre: si el padre no cambió,
+            // el nodo sigue siendo el que corresponde a key
+            if (!node->latch.read_lock(version) || !parent->validate(parent_version))
+                return std::nullopt;
+
+            const std::size_t count = std::min(node->count, M - 1);
+            const std::size_t idx = rank(node, count, key);
+            const bool hit = matches(node, count, idx, key);
+            const bool leaf = node->leaf;
+            const BNode* const child = node->children[idx];
+
+            if (!node->latch.validate(version))
+                return std::nullopt;
+            if (hit || leaf)
+                return hit;
+
+            parent = &node->latch;
+            parent_version = version;
+            node = child;
+        }
+    }
+
+    // Un tramo de keys en orden a partir de bound (incluido si inclusive), leído en una sola
+    // bajada: las keys de la hoja donde cae bound y, detrás, el separador más cercano que sigue a
+    // esa hoja. Retorna nullopt si algún nodo cambió durante la lectura.
+    struct Batch {
+        TK keys[Order];
+        std::size_t count = 0;
+        bool last = true;  // No hay keys después de las del tramo
+    };
+
+    template<typename K>
+    std::optional<Batch> try_batch(const K& bound, const bool inclusive) const {
+        Batch batch;
+        std::optional<TK> successor;
+
+        const typename EpochReclaimer<BNode>::Guard guard(reclaimer);
+        std::uint64_t version = 0;
+        if (!root_latch.read_lock(version))
+            return std::nullopt;
+
+        const BNode* node = root.load(std::memory_order_acquire);
+        if (node == nullptr)
+            return root_latch.validate(version) ? std::optional<Batch>(batch) : std::nullopt;
+
+        const OptimisticLatch* parent = &root_latch;
+        std::uint64_t parent_version = version;
+
+        while (true) {
+            if (!node->latch.read_lock(version) || !parent->validate(parent_version))
+                return std::nullopt;
+
+            const std::size_t count = std::min(node->count, M - 1);
+            std::size_t idx = rank(node, count, bound);
+            if (!inclusive && matches(node, count, idx, bound))
+                ++idx;
+
+            const bool leaf = node->leaf;
+            if (leaf) {
+                for (std::size_t k = idx; k < count; ++k)
+                    batch.keys[batch.count++] = node->keys[k];
+            } else if (idx < count) {
+                successor = node->keys[idx];
+            }
+
+            const BNode* const child = node->children[idx];
+            if (!node->latch.validate(version))
+                return std::nullopt;
+
+            if (leaf)
+                break;
+
+            parent = &node->latch;
+            parent_version = version;
+            node = child;
+        }
+
+        if (successor) {
+            batch.keys[batch.count++] = *successor;
+            batch.last = false;
+        }
+
+        return batch;
+    }
+
+    // node está lleno y le falta entry en la posición i, con left como children[i]. Retorna el
+    // nodo nuevo de la izquierda, que todavía no es alcanzable.
+    BNode* split(BNode* const node, const std::size_t i, TK& entry, BNode* const left) {
+        auto* const lsplit = new BNode();
+        node_ops::split<M>(*node, *lsplit, i, entry, left);
+        return lsplit;
+    }
+
+    // Nodos que un escritor tiene tomados: path[first, depth), más root_latch si root_held. Al
+    // bajar a un nodo "seguro" se sueltan todos los de arriba.
+    struct WritePath {
+        Frame path[max_depth];
+        std::size_t first = 0;
+        std::size_t depth = 0;
+        bool root_held = true;
+    };
+
+    void release_above(WritePath& held, const std::size_t keep = max_depth) {
+        if (held.root_held) {
+            root_latch.write_unlock();
+            held.root_held = false;
+        }
+
+        for (std::size_t d = held.first; d < held.depth; ++d)
+            if (d != keep)
+                held.path[d].node->latch.write_unlock();
+
+        held.first = held.depth;
+    }
+
+    void release_all(WritePath& held) {
+        for (std::size_t d = held.first; d < held.depth; ++d)
+            if (held.path[d].node != nullptr)
+                held.path[d].node->latch.write_unlock();
+
+        held.first = held.depth;
+        if (held.root_held) {
+            root_latch.write_unlock();
+            held.root_held = false;
+        }
+    }
+
+public:
+    ConcurrentBTree() = default;
+
+    // readers: cuántos hilos pueden estar leyendo a la vez sin esperarse (0 = 4 por core)
+    explicit ConcurrentBTree(const Compare& comp, const std::size_t readers = 0)
+        : comp(comp),
+          reclaimer(readers) {}
+
+    ConcurrentBTree(const ConcurrentBTree&) = delete;
+
+    ConcurrentBTree& operator=(const ConcurrentBTree&) = delete;
+
+    ~ConcurrentBTree() {
+        destroy_subtree(root.load(std::memory_order_relaxed));
+    }
+
+    template<typename K>
+    [[nodiscard]] bool search(const K& key) const {
+        const LookupKey<K>& k = key;
+
+        while (true)
+            if (const std::optional<bool> found = try_search(k))
+                return *found;
+    }
+
+    // Inserta key si no está. Retorna si se insertó.
+    bool insert(const TK& key) {
+        WritePath held;
+        root_latch.write_lock();
+
+        BNode* node = root.load(std::memory_order_relaxed);
+        if (node == nullptr) {
+            auto* const leaf = new BNode();
+            leaf->keys[0] = key;
+            leaf->count = 1;
+
+            root.store(leaf, std::memory_order_release);
+            root_latch.write_unlock();
+            n.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        node->latch.write_lock();
+
+        // Baja tomando cada nodo. Uno que no está lleno absorbe un split de abajo sin partirse,
+        // así que ya no hace falta nada por encima de él.
+        while (true) {
+            if (node->count < M - 1)
+                release_above(held);
+
+            const std::size_t idx = rank(node, node->count, key);
+            held.path[held.depth++] = {node, idx};
+
+            if (matches(node, node->count, idx, key)) {
+                release_all(held);
+                return false;
+            }
+
+            if (node->leaf)
+                break;
+
+            node = node->children[idx];
+            node->latch.write_lock();
+        }
+
+        TK entry = key;
+        BNode* left = nullptr;
+
+        for (std::size_t d = held.depth; d-- > held.first;) {
+            const auto [cur, i] = held.path[d];
+
+            if (cur->count < M - 1) {
+                cur->children[cur->count + 1] = cur->children[cur->count];
+                for (std::size_t j = cur->count; j > i; --j) {
+                    cur->keys[j] = cur->keys[j - 1];
+                    cur->children[j] = cur->children[j - 1];
+                }
+
+                cur->keys[i] = entry;
+                cur->children[i] = left;
+                ++cur->count;
+
+                release_all(held);
+                n.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            left = split(cur, i, entry, left);
+        }
+
+        // Se partió también la raíz, así que root_latch sigue tomado
+        auto* const new_root = new BNode();
+        new_root->leaf = false;
+        new_root->keys[0] = entry;
+        new_root->count = 1;
+        new_root->children[0] = left;
+        new_root->children[1] = held.path[held.first].node;
+
+        root.store(new_root, std::memory_order_release);
+        release_all(held);
+        n.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Borra key si está. Retorna si se borró.
+    template<typename K>
+    bool remove(const K& key) {
+        const LookupKey<K>& k = key;
+
+        WritePath held;
+        root_latch.write_lock();
+
+        BNode* node = root.load(std::memory_order_relaxed);
+        if (node == nullptr) {
+            root_latch.write_unlock();
+            return false;
+        }
+
+        node->latch.write_lock();
+
+        // Si key está en un nodo interno, ese nodo (anchor) queda tomado aunque se suelte lo de
+        // arriba, porque al final su key se reemplaza por el predecesor; para llegar a él se sigue
+        // por el borde derecho del child de la izquierda hasta una hoja
+        std::size_t anchor = max_depth;
+        bool anchor_apart = false;  // anchor quedó tomado fuera de path[first, depth)
+
+        while (true) {
+            // Un nodo con más del mínimo (más de una key, si es la raíz) no queda bajo el mínimo
+            // aunque absorba un merge de abajo
+            if (node->count > (held.depth == 0 ? 1 : min_keys)) {
+                if (anchor != max_depth && anchor >= held.first)
+                    anchor_apart = true;
+                release_above(held, anchor);
+            }
+
+            std::size_t idx = 0;
+            bool hit = false;
+            if (anchor != max_depth) {
+                idx = node->leaf ? node->count - 1 : node->count;
+            } else {
+                idx = rank(node, node->count, k);
+                hit = matches(node, node->count, idx, k);
+                if (hit && !node->leaf)
+                    anchor = held.depth;
+            }
+
+            held.path[held.depth++] = {node, idx};
+
+            if (node->leaf) {
+                if (anchor == max_depth && !hit) {
+                    release_all(held);
+                    return false;
+                }
+                break;
+            }
+
+            node = node->children[idx];
+            node->latch.write_lock();
+        }
+
+        // La key a borrar (o su predecesor) está en la hoja path[depth - 1]
+        BNode* const leaf = held.path[held.depth - 1].node;
+        const std::size_t pos = held.path[held.depth - 1].idx;
+
+        if (anchor != max_depth)
+            held.path[anchor].node->keys[held.path[anchor].idx] = leaf->keys[pos];
+
+        for (std::size_t j = pos; j + 1 < leaf->count; ++j)
+            leaf->keys[j] = leaf->keys[j + 1];
+        --leaf->count;
+
+        // Sube arreglando los nodos tomados que quedaron bajo el mínimo. Los hermanos se toman
+        // recién aquí; su padre está tomado, así que ningún otro escritor puede estar bajando
+        // hacia ellos desde arriba.
+        for (std::size_t d = held.depth - 1; d > held.first; --d) {
+            BNode* const cur = held.path[d].node;
+            if (cur->count >= min_keys)
+                break;
+
+            const auto [parent, i] = held.path[d - 1];
+
+            if (i > 0) {
+                BNode* const left = parent->children[i - 1];
+                left->latch.write_lock();
+
+                if (left->count > min_keys) {
+                    node_ops::borrow_left(*parent, i, *cur, *left);
+                    left->latch.write_unlock();
+                    break;
+                }
+
+                node_ops::merge(*parent, i - 1, *left, *cur);
+                left->latch.write_unlock();
+                retire(cur);
+                held.path[d].node = nullptr;
+            } else {
+                BNode* const right = parent->children[i + 1];
+                right->latch.write_lock();
+
+                if (right->count > min_keys) {
+                    node_ops::borrow_right(*parent, i, *cur, *right);
+                    right->latch.write_unlock();
+                    break;
+                }
+
+                node_ops::merge(*parent, i, *cur, *right);
+                retire(right);
+            }
+        }
+
+        // Una raíz vacía se reemplaza por su único child (o por nada, si era hoja). Solo puede
+        // pasar si root_latch sigue tomado.
+        if (held.root_held) {
+            BNode* const old_root = held.path[0].node;
+
+            if (old_root != nullptr && old_root->count == 0) {
+                root.store(old_root->leaf ? nullptr : old_root->children[0],
+                           std::memory_order_release);
+                retire(old_root);
+                held.path[0].node = nullptr;
+            }
+        }
+
+        if (anchor_apart)
+            held.path[anchor].node->latch.write_unlock();
+
+        release_all(held);
+        n.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Llama a fn(key) para cada key en [begin, end], en orden. Se lee una hoja por vez con el
+    // mismo protocolo optimista que search y fn se llama sin tener nada tomado. Cada key que se
+    // entrega estaba en el árbol al leerse su hoja, pero el recorrido completo no es una foto del
+    // árbol: puede ver o no las keys que otros hilos insertan o borran mientras tanto.
+    template<typename K1, typename K2, typename Fn>
+    void for_each_in_range(const K1& begin, const K2& end, Fn&& fn) const {
+        const LookupKey<K1>& lo = begin;
+        const LookupKey<K2>& hi = end;
+
+        std::optional<Batch> batch;
+        while (!(batch = try_batch(lo, true))) {}
+
+        while (true) {
+            for (std::size_t i = 0; i < batch->count; ++i) {
+                if (comp(hi, batch->keys[i]))
+                    return;
+                fn(static_cast<const TK&>(batch->keys[i]));
+            }
+
+            if (batch->last || batch->count == 0)
+                return;
+
+            const TK from = batch->keys[batch->count - 1];
+            while (!(batch = try_batch(from, false))) {}
+        }
+    }
+
+    // Cantidad de keys. Con escritores en curso es solo aproximada.
+    [[nodiscard]] std::size_t size() const {
+        return n.load(std::memory_order_relaxed);
+    }
+
+    // Libera ya los nodos retirados que ningún lector puede estar leyendo. Se hace solo cada
+    // tantos retiros; esto sirve para no esperar al próximo lote. Se puede llamar en cualquier
+    // momento, con otros hilos usando el árbol.
+    void collect_garbage() {
+        reclaimer.collect();
+    }
+
+    // Nodos retirados que todavía no se liberaron
+    [[nodiscard]] std::size_t pending_garbage() const {
+        return reclaimer.pending();
+    }
+
+    // Solo tiene sentido sin escritores en curso
+    [[nodiscard]] bool check_properties() const {
+        const BNode* const node = root.load(std::memory_order_acquire);
+        auto fetch = [](const BNode* const child) { return child; };
+        return node == nullptr ||
+               node_ops::check<M>(*node, true, min_keys, nullptr, nullptr, comp, fetch) >= 0;
+    }
+
+    [[nodiscard]] std::ptrdiff_t height() const {
+        std::ptrdiff_t height = -1;
+        for (const BNode* cur = root.load(std::memory_order_acquire); cur != nullptr;
+             cur = cur->leaf ? nullptr : cur->children[0])
+            ++height;
+        return height;
+    }
+};
+
+#endif
@@ -0,0 +1,257 @@
+#ifndef FROZEN_BTREE_H
+#define FROZEN_BTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "node.h"
+#include "node_search.h"
+
+// Allocator que alinea los bloques a cache line, para que cada nodo de FrozenBTree ocupe líneas
+// enteras
+template<typename T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+
+    CacheAlignedAllocator() = default;
+
+    template<typename U>
+    constexpr explicit CacheAlignedAllocator(const CacheAlignedAllocator<U>& /*other*/) {}
+
+    T* allocate(const std::size_t count) {
+        return static_cast<T*>(
+            ::operator new(count * sizeof(T), std::align_val_t{cache_line_size}));
+    }
+
+    void deallocate(T* const block, const std::size_t /*count*/) {
+        ::operator delete(block, std::align_val_t{cache_line_size});
+    }
+
+    friend bool operator==(const CacheAlignedAllocator&, const CacheAlignedAllocator&) = default;
+};
+
+// Árbol B estático sin punteros, armado una sola vez desde keys ordenadas (por ejemplo con
+// BasicBTree::freeze) y después solo de lectura.
+//
+// Todos los nodos viven en un solo array, nivel por nivel desde la raíz, con B keys cada uno (una
+// cache line cuando las keys son chicas). El child i del nodo k de un nivel es el nodo
+// k * (B + 1) + i del siguiente, así que no se guardan punteros ni cantidades. Como en un árbol
+// B+, el último nivel son todas las keys ordenadas y contiguas, y los niveles de arriba guardan
+// como separador la menor key de cada subárbol derecho. Los slots que sobran se rellenan con la
+// key máxima.
+//
+// Buscar baja siempre la misma cantidad de niveles y en cada nodo cuenta cuántas de sus B keys son
+// menores, sin salir antes del loop ni bifurcar según las keys. Ese conteo es directamente el
+// child por el que seguir, y en la hoja es la posición de la respuesta en el array ordenado.
+template<typename TK,
+         typename Compare = std::less<TK>,
+         std::size_t B = std::clamp<std::size_t>(cache_line_size / sizeof(TK), 2, 32)>
+class FrozenBTree {
+    static_assert(B >= 2, "nodes need at least two keys");
+
+    static constexpr bool transparent = requires { typename Compare::is_transparent; };
+
+    template<typename K>
+    using LookupKey = std::conditional_t<transparent, K, TK>;
+
+    // Con a lo más 2^48 keys y fan-out B + 1 >= 3 no hay más de 32 niveles
+    static constexpr std::size_t max_levels = 32;
+
+    std::vector<TK, CacheAlignedAllocator<TK>> nodes;
+    std::size_t first[max_levels]{};  // Primer nodo de cada nivel; el último nivel son las hojas
+    std::size_t levels = 0;
+    std::size_t n = 0;
+    [[no_unique_address]] Compare comp;
+
+    [[nodiscard]] const TK* leaves() const {
+        return nodes.data() + first[levels - 1] * B;
+    }
+
+    // Cuántas de las B keys del nodo son menores que key (o no mayores, con Upper)
+    template<bool Upper, typename K>
+    std::size_t count_below(const TK* const node, const K& key) const {
+        if constexpr (Upper) {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < B; ++i)
+                count += static_cast<std::size_t>(!comp(key, node[i]));
+            return count;
+        } else {
+            return LinearNodeSearch::rank<B>(node, B, key, comp);
+        }
+    }
+
+    // Posición en el orden de la primera key >= key (o > key, con Upper), o n si no hay
+    template<bool Upper, typename K>
+    std::size_t position(const K& key) const {
+        const TK* const data = nodes.data();
+        const TK& max = leaves()[n - 1];
+
+        // Desde acá los slots de relleno (que valen max) nunca cuentan como menores, así que
+        // ningún conteo lleva a un child que no existe
+        if (Upper ? !comp(key, max) : comp(max, key))
+            return n;
+
+        std::size_t k = 0;
+        for (std::size_t level = 0; level + 1 < levels; ++level)
+            k = k * (B + 1) + count_below<Upper>(data + (first[level] + k) * B, key);
+
+        return k * B + count_below<Upper>(data + (first[levels - 1] + k) * B, key);
+    }
+
+    // Arma los niveles internos sobre las hojas, que ya están en su lugar
+    void build(const std::size_t leaf_nodes) {
+        std::size_t counts[max_levels]{};
+        counts[0] = leaf_nodes;
+        levels = 1;
+        while (counts[levels - 1] > 1) {
+            counts[levels] = (counts[levels - 1] + B) / (B + 1);
+            ++levels;
+        }
+        std::reverse(counts, counts + levels);
+
+        std::size_t total = 0;
+        for (std::size_t level = 0; level < levels; ++level) {
+            first[level] = total;
+            total += counts[level];
+        }
+
+        // Las hojas se movieron al final del array, donde les toca
+        const TK max = nodes[n - 1];
+        nodes.resize(total * B, max);
+        std::move_backward(nodes.begin(),
+                           nodes.begin() + static_cast<std::ptrdiff_t>(leaf_nodes * B),
+                           nodes.end());
+
+        // Cada separador es la primera key de la hoja de más a la izquierda de su subárbol
+        std::size_t span = 1;  // Hojas por subárbol de un nodo del nivel de abajo
+        for (std::size_t level = levels - 1; level-- > 0;) {
+            for (std::size_t k = 0; k < counts[level]; ++k) {
+                for (std::size_t i = 0; i < B; ++i) {
+                    const std::size_t leaf = (k * (B + 1) + i + 1) * span;
+                    nodes[(first[level] + k) * B + i] =
+                        leaf < leaf_nodes ? leaves()[leaf * B] : max;
+                }
+            }
+            span *= B + 1;
+        }
+    }
+
+public:
+    using const_iterator = const TK*;
+    using iterator = const_iterator;
+
+    FrozenBTree() = default;
+
+    explicit FrozenBTree(const Compare& comp)
+        : comp(comp) {}
+
+    // Las keys de [begin, end) deben estar ordenadas de forma estrictamente creciente
+    template<std::forward_iterator It>
+    FrozenBTree(const It begin, const It end, const Compare& comp = Compare())
+        : comp(comp) {
+        n = static_cast<std::size_t>(std::distance(begin, end));
+        if (n == 0)
+            return;
+        if (n > std::size_t{1} << 48)
+            throw std::length_error("too many keys for a FrozenBTree");
+
+        const std::size_t leaf_nodes = (n + B - 1) / B;
+        nodes.reserve(leaf_nodes * B);
+        nodes.assign(begin, end);
+        build(leaf_nodes);
+    }
+
+    template<typename K>
+    [[nodiscard]] bool search(const K& key) const {
+        const LookupKey<K>& k = key;
+        if (n == 0)
+            return false;
+
+        const std::size_t pos = position<false>(k);
+        return pos < n && !comp(k, leaves()[pos]);
+    }
+
+    // Primera key >= key, o end() si no hay
+    template<typename K>
+    [[nodiscard]] const_iterator lower_bound(const K& key) const {
+        const LookupKey<K>& k = key;
+        return n == 0 ? end() : begin() + position<false>(k);
+    }
+
+    // Primera key > key, o end() si no hay
+    template<typename K>
+    [[nodiscard]] const_iterator upper_bound(const K& key) const {
+        const LookupKey<K>& k = key;
+        return n == 0 ? end() : begin() + position<true>(k);
+    }
+
+    template<typename K>
+    [[nodiscard]] const_iterator find(const K& key) const {
+        const LookupKey<K>& k = key;
+        const const_iterator it = lower_bound(k);
+        return it != end() && !comp(k, *it) ? it : end();
+    }
+
+    // Keys en [begin, end], en orden, contiguas en memoria
+    template<typename K1, typename K2>
+    [[nodiscard]] std::span<const TK> range(const K1& begin, const K2& end) const {
+        const LookupKey<K1>& lo = begin;
+        const LookupKey<K2>& hi = end;
+        if (comp(hi, lo))
+            return {};
+
+        return {lower_bound(lo), upper_bound(hi)};
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        return n == 0 ? nullptr : leaves();
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return n == 0 ? nullptr : leaves() + n;
+    }
+
+    // La key en la posición i del orden
+    [[nodiscard]] const TK& operator[](const std::size_t i) const {
+        return leaves()[i];
+    }
+
+    [[nodiscard]] const TK& minKey() const {
+        if (n == 0)
+            throw std::runtime_error("BTree is empty");
+
+        return leaves()[0];
+    }
+
+    [[nodiscard]] const TK& maxKey() const {
+        if (n == 0)
+            throw std::runtime_error("BTree is empty");
+
+        return leaves()[n - 1];
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return n;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return n == 0;
+    }
+
+    [[nodiscard]] std::ptrdiff_t height() const {
+        return static_cast<std::ptrdiff_t>(levels) - 1;
+    }
+
+    // Bytes del array de nodos
+    [[nodiscard]] std::size_t memory_usage() const {
+        return nodes.size() * sizeof(TK);
+    }
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef KEY_FORMAT_H
+#define KEY_FORMAT_H
+
+#include <algorithm>
+#include <charconv>
+#include <concepts>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Keys que format_key sabe escribir como texto
+template<typename T>
+concept FormattableKey = std::is_arithmetic_v<T> ||
+                         std::convertible_to<const T&, std::string_view> ||
+                         requires(std::ostream& out, const T& key) { out << key; };
+
+// Escribe key como texto en out y retorna el iterador que sigue. Los tipos aritméticos pasan por
+// std::to_chars, sin reservar memoria: los floats salen en su forma más corta que vuelve al mismo
+// valor, y bool y los caracteres como números, igual que con std::to_string. Los strings se
+// copian tal cual, y cualquier otro tipo usa su operator<<.
+template<FormattableKey T, std::output_iterator<char> Out>
+Out format_key(const T& key, Out out) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        // Alcanza para el long double más largo en notación científica
+        char buffer[128];
+        const auto print = [&](const auto value) {
+            return std::to_chars(buffer, buffer + sizeof buffer, value).ptr;
+        };
+
+        char* end = nullptr;
+        if constexpr (std::is_floating_point_v<T>)
+            end = print(key);
+        else if constexpr (std::is_signed_v<T>)
+            end = print(static_cast<long long>(key));
+        else
+            end = print(static_cast<unsigned long long>(key));
+        return std::copy(buffer, end, out);
+    } else if constexpr (std::convertible_to<const T&, std::string_view>) {
+        const std::string_view text = key;
+        return std::copy(text.begin(), text.end(), out);
+    } else {
+        std::ostringstream text;
+        text << key;
+        const std::string_view view = text.view();
+        return std::copy(view.begin(), view.end(), out);
+    }
+}
+
+// Como format_key, pero agrega el texto al final de out de una sola vez en vez de a un char por
+// vez
+template<FormattableKey T>
+void append_key(std::string& out, const T& key) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        char buffer[128];
+        out.append(buffer, format_key(key, buffer));
+    } else if constexpr (std::convertible_to<const T&, std::string_view>) {
+        out.append(std::string_view(key));
+    } else {
+        format_key(key, std::back_inserter(out));
+    }
+}
+
+#endif
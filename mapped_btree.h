@@ -0,0 +1,407 @@
+#ifndef MAPPED_BTREE_H
+#define MAPPED_BTREE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "node.h"
+#include "node_search.h"
+
+// Imagen de un árbol B sin punteros, en el formato que escribe BasicBTree::save. Los nodos están en
+// orden BFS, así que los children de cada nodo son consecutivos y basta guardar el índice del
+// primero. Las keys de todos los nodos van juntas, nodo tras nodo y sin slots vacíos, en un solo
+// array alineado a 64 bytes. Todo se guarda con el endianness y el layout de la máquina que lo
+// escribió.
+struct MappedImageHeader {
+    std::uint64_t magic;
+    std::uint64_t key_size;
+    std::uint64_t size;
+    std::uint64_t node_count;
+    std::int64_t height;
+    std::uint64_t keys_offset;
+};
+
+struct MappedImageNode {
+    std::uint32_t count;
+    std::uint32_t first_child;  // 0 en las hojas: la raíz es el nodo 0 y no es child de nadie
+    std::uint64_t first_key;
+};
+
+inline constexpr std::uint64_t mapped_image_magic = 0x31474D49'45455242;  // "BREEIMG1"
+inline constexpr std::size_t mapped_image_alignment = 64;
+
+// Vista de solo lectura sobre una imagen guardada con BasicBTree::save. El archivo se mapea con
+// mmap y las búsquedas leen directamente de él, sin deserializar nada, así que abrirlo cuesta lo
+// mismo sin importar su tamaño y varios procesos comparten las mismas páginas del page cache.
+template<typename TK, typename Compare = std::less<TK>, typename Search = DefaultNodeSearch>
+class MappedBTree {
+    static_assert(std::is_trivially_copyable_v<TK>,
+                  "keys are read straight from the file, so they must be trivially copyable");
+
+    static constexpr bool transparent = requires { typename Compare::is_transparent; };
+
+    template<typename K>
+    using LookupKey = std::conditional_t<transparent, K, TK>;
+
+    // El archivo puede venir de un árbol de cualquier orden, así que solo se cuenta con fan-out 2
+    static constexpr std::size_t max_depth = max_tree_depth(2);
+
+    void* base = nullptr;
+    std::size_t length = 0;
+    const MappedImageNode* nodes = nullptr;
+    const TK* keys = nullptr;
+    std::uint64_t n = 0;
+    std::ptrdiff_t tree_height = -1;
+    [[no_unique_address]] Compare comp;
+
+    MappedBTree(void* const base, const std::size_t length, const Compare& comp)
+        : base(base),
+          length(length),
+          comp(comp) {}
+
+    [[nodiscard]] const TK* keys_of(const MappedImageNode& node) const {
+        return keys + node.first_key;
+    }
+
+    template<typename K>
+    std::size_t rank(const MappedImageNode& node, const K& key) const {
+        return Search::template rank<0>(keys_of(node), node.count, key, comp);
+    }
+
+    template<typename K>
+    bool matches(const MappedImageNode& node, const std::size_t idx, const K& key) const {
+        return idx < node.count && !comp(key, keys_of(node)[idx]);
+    }
+
+    // Revisa que los índices de la imagen no apunten fuera del archivo
+    void validate(const MappedImageHeader& header) const {
+        const auto fail = [] { throw std::runtime_error("file is not a valid BTree image"); };
+
+        if (header.magic != mapped_image_magic || header.key_size != sizeof(TK))
+            fail();
+
+        const std::size_t table_end =
+            sizeof(MappedImageHeader) + header.node_count * sizeof(MappedImageNode);
+        if (header.node_count > length / sizeof(MappedImageNode) || table_end > length ||
+            header.keys_offset < table_end || header.keys_offset % alignof(TK) != 0 ||
+            header.keys_offset > length ||
+            header.size > (length - header.keys_offset) / sizeof(TK) ||
+            header.height >= static_cast<std::int64_t>(max_depth) ||
+            (header.node_count == 0) != (header.size == 0))
+            fail();
+
+        // Los children van después de su padre, así que el nivel de cada nodo ya se conoce al
+        // llegar a él; con eso ningún camino puede pasar de max_depth nodos
+        std::vector<std::uint8_t> level(header.node_count, 0);
+
+        for (std::uint64_t i = 0; i < header.node_count; ++i) {
+            const MappedImageNode& node = nodes[i];
+            if (node.count == 0 || node.first_key > header.size ||
+                node.count > header.size - node.first_key)
+                fail();
+
+            if (node.first_child == 0)
+                continue;
+            if (node.first_child <= i ||
+                std::uint64_t{node.first_child} + node.count >= header.node_count ||
+                level[i] + 1U >= max_depth)
+                fail();
+
+            for (std::uint64_t c = node.first_child; c <= node.first_child + node.count; ++c)
+                level[c] = std::max(level[c], static_cast<std::uint8_t>(level[i] + 1));
+        }
+    }
+
+public:
+    // Iterador en orden (hacia adelante) sobre las keys de la imagen, con el camino desde la raíz
+    // en un stack dentro del iterador, como el de BasicBTree
+    class const_iterator {
+        friend class MappedBTree;
+
+        // En el frame de arriba, pos es el índice de la key actual. En los de abajo, pos es el
+        // índice del child por el que se bajó.
+        struct Frame {
+            std::uint32_t node;
+            std::uint32_t pos;
+        };
+
+        const MappedBTree* tree = nullptr;
+        Frame path[max_depth]{};
+        std::size_t depth = 0;
+
+        explicit const_iterator(const MappedBTree* const tree)
+            : tree(tree) {}
+
+        [[nodiscard]] const MappedImageNode& node(const Frame& frame) const {
+            return tree->nodes[frame.node];
+        }
+
+        void push_leftmost(std::uint32_t idx) {
+            while (true) {
+                path[depth++] = {idx, 0};
+                const std::uint32_t child = tree->nodes[idx].first_child;
+                if (child == 0)
+                    return;
+                idx = child;
+            }
+        }
+
+        void pop_finished() {
+            while (depth > 0 && path[depth - 1].pos >= node(path[depth - 1]).count)
+                --depth;
+        }
+
+        template<typename K>
+        void seek(const K& key) {
+            depth = 0;
+            if (tree->n == 0)
+                return;
+
+            for (std::uint32_t idx = 0;;) {
+                const MappedImageNode& cur = tree->nodes[idx];
+                const auto pos = static_cast<std::uint32_t>(tree->rank(cur, key));
+                path[depth++] = {idx, pos};
+
+                if (tree->matches(cur, pos, key) || cur.first_child == 0)
+                    break;
+                idx = cur.first_child + pos;
+            }
+
+            pop_finished();
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TK;
+        using difference_type = std::ptrdiff_t;
+        using reference = const TK&;
+        using pointer = const TK*;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            const Frame& frame = path[depth - 1];
+            return tree->keys_of(node(frame))[frame.pos];
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        const_iterator& operator++() {
+            Frame& frame = path[depth - 1];
+            const std::uint32_t child = node(frame).first_child;
+
+            ++frame.pos;
+            if (child != 0)
+                push_leftmost(child + frame.pos);
+            else
+                pop_finished();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) {
+            return a.depth == b.depth &&
+                   (a.depth == 0 || (a.path[a.depth - 1].node == b.path[b.depth - 1].node &&
+                                     a.path[a.depth - 1].pos == b.path[b.depth - 1].pos));
+        }
+    };
+
+    // Tramo [first, last) de keys, como BasicBTree::Range
+    class Range {
+        const_iterator first;
+        const_iterator last;
+
+    public:
+        Range(const_iterator first, const_iterator last)
+            : first(std::move(first)),
+              last(std::move(last)) {}
+
+        [[nodiscard]] const_iterator begin() const {
+            return first;
+        }
+
+        [[nodiscard]] const_iterator end() const {
+            return last;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return first == last;
+        }
+    };
+
+    // Mapea la imagen de path. Lanza std::system_error si no se puede abrir y std::runtime_error
+    // si no es una imagen válida para TK.
+    static MappedBTree open(const std::string& path, const Compare& comp = Compare()) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+
+        struct stat info {};
+        if (::fstat(fd, &info) != 0) {
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "cannot stat " + path);
+        }
+
+        const auto length = static_cast<std::size_t>(info.st_size);
+        if (length < sizeof(MappedImageHeader)) {
+            ::close(fd);
+            throw std::runtime_error("file is not a valid BTree image");
+        }
+
+        void* const base = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        const int error = errno;
+        ::close(fd);
+        if (base == MAP_FAILED)
+            throw std::system_error(error, std::generic_category(), "cannot map " + path);
+
+        MappedBTree tree(base, length, comp);
+        const auto* const bytes = static_cast<const std::byte*>(base);
+        const auto* const header = reinterpret_cast<const MappedImageHeader*>(bytes);
+
+        tree.nodes = reinterpret_cast<const MappedImageNode*>(bytes + sizeof(MappedImageHeader));
+        tree.validate(*header);
+        tree.keys = reinterpret_cast<const TK*>(bytes + header->keys_offset);
+        tree.n = header->size;
+        tree.tree_height = static_cast<std::ptrdiff_t>(header->height);
+        return tree;
+    }
+
+    MappedBTree(const MappedBTree&) = delete;
+
+    MappedBTree(MappedBTree&& other) noexcept
+        : base(std::exchange(other.base, nullptr)),
+          length(std::exchange(other.length, 0)),
+          nodes(other.nodes),
+          keys(other.keys),
+          n(std::exchange(other.n, 0)),
+          tree_height(std::exchange(other.tree_height, -1)),
+          comp(other.comp) {}
+
+    MappedBTree& operator=(const MappedBTree&) = delete;
+
+    MappedBTree& operator=(MappedBTree&& other) noexcept {
+        std::swap(base, other.base);
+        std::swap(length, other.length);
+        std::swap(nodes, other.nodes);
+        std::swap(keys, other.keys);
+        std::swap(n, other.n);
+        std::swap(tree_height, other.tree_height);
+        std::swap(comp, other.comp);
+        return *this;
+    }
+
+    ~MappedBTree() {
+        if (base != nullptr)
+            ::munmap(base, length);
+    }
+
+    template<typename K>
+    [[nodiscard]] bool search(const K& key) const {
+        const LookupKey<K>& k = key;
+        if (n == 0)
+            return false;
+
+        for (std::uint32_t idx = 0;;) {
+            const MappedImageNode& node = nodes[idx];
+            const std::size_t pos = rank(node, k);
+            if (matches(node, pos, k))
+                return true;
+            if (node.first_child == 0)
+                return false;
+            idx = node.first_child + static_cast<std::uint32_t>(pos);
+        }
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        const_iterator it(this);
+        if (n != 0)
+            it.push_leftmost(0);
+        return it;
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return const_iterator(this);
+    }
+
+    // Primera key >= key, o end() si no hay
+    template<typename K>
+    [[nodiscard]] const_iterator lower_bound(const K& key) const {
+        const_iterator it(this);
+        it.seek(static_cast<const LookupKey<K>&>(key));
+        return it;
+    }
+
+    // Primera key > key, o end() si no hay
+    template<typename K>
+    [[nodiscard]] const_iterator upper_bound(const K& key) const {
+        const LookupKey<K>& k = key;
+        const_iterator it = lower_bound(k);
+        if (it != end() && !comp(k, *it))
+            ++it;
+        return it;
+    }
+
+    // Keys en [begin, end], en orden
+    template<typename K1, typename K2>
+    [[nodiscard]] Range range(const K1& begin, const K2& end) const {
+        const LookupKey<K1>& lo = begin;
+        const LookupKey<K2>& hi = end;
+
+        const_iterator first = lower_bound(lo);
+        if (first == this->end() || comp(hi, *first))
+            return {first, first};
+
+        return {std::move(first), upper_bound(hi)};
+    }
+
+    [[nodiscard]] const TK& minKey() const {
+        if (n == 0)
+            throw std::runtime_error("BTree is empty");
+        return *begin();
+    }
+
+    [[nodiscard]] const TK& maxKey() const {
+        if (n == 0)
+            throw std::runtime_error("BTree is empty");
+
+        std::uint32_t idx = 0;
+        while (nodes[idx].first_child != 0)
+            idx = nodes[idx].first_child + nodes[idx].count;
+        return keys_of(nodes[idx])[nodes[idx].count - 1];
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return n;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return n == 0;
+    }
+
+    [[nodiscard]] std::ptrdiff_t height() const {
+        return tree_height;
+    }
+};
+
+#endif
@@ -2,14 +2,159 @@
 #define NODE_H
 
 #include <cstddef>
-#include <utility>
 
-template<typename TK>
-struct Node {
+// Orden "0" indica que el orden del árbol se decide en tiempo de ejecución
+inline constexpr std::size_t dynamic_order = 0;
+
+inline constexpr std::size_t cache_line_size = 64;
+
+// Cota de la altura de un árbol con a lo más 2^48 keys (más no caben en memoria) en el que todo
+// nodo que no es la raíz tiene al menos min_fanout children: con d niveles hay al menos
+// 2 * min_fanout^(d - 2) keys. slack suma niveles para árboles que pueden dejar nodos más vacíos
+// que eso, y sirve para dimensionar los caminos que se guardan en el stack.
+constexpr std::size_t max_tree_depth(const std::size_t min_fanout, const std::size_t slack = 0) {
+    constexpr std::size_t max_keys = std::size_t{1} << 48;
+
+    std::size_t depth = 1;
+    for (std::size_t power = 1; power <= max_keys / min_fanout / 2; power *= min_fanout)
+        ++depth;
+
+    return depth + 1 + slack;
+}
+
+// Guarda el orden M de un árbol. Cuando el orden es conocido en compilación, no ocupa espacio y
+// siempre se convierte a la constante, así que los loops que dependen de M tienen trip count fijo.
+template<std::size_t Order>
+struct OrderValue {
+    constexpr explicit OrderValue(const std::size_t /*M*/) {}
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    constexpr operator std::size_t() const {
+        return Order;
+    }
+};
+
+template<>
+struct OrderValue<dynamic_order> {
+    std::size_t value;
+
+    constexpr explicit OrderValue(const std::size_t M)
+        : value(M) {}
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    constexpr operator std::size_t() const {
+        return value;
+    }
+};
+
+// Valores de los nodos de BTreeMap. Van en un array paralelo a keys (y no junto a cada key) para
+// que la búsqueda dentro del nodo siga recorriendo keys contiguas. Con V = void no ocupan espacio.
+template<typename V, std::size_t Order>
+struct NodeValues {
+    V data[Order - 1]{};
+
+    V& operator[](const std::size_t i) {
+        return data[i];
+    }
+
+    const V& operator[](const std::size_t i) const {
+        return data[i];
+    }
+};
+
+template<typename V>
+struct NodeValues<V, dynamic_order> {
+    V* data = nullptr;
+
+    V& operator[](const std::size_t i) {
+        return data[i];
+    }
+
+    const V& operator[](const std::size_t i) const {
+        return data[i];
+    }
+};
+
+template<std::size_t Order>
+struct NodeValues<void, Order> {};
+
+template<>
+struct NodeValues<void, dynamic_order> {};
+
+// Punteros a las hojas vecinas, para enlazar las hojas de BPlusTree. Sin Linked no ocupan espacio.
+template<typename N, bool Linked>
+struct LeafLinks {
+    N* prev = nullptr;
+    N* next = nullptr;
+};
+
+template<typename N>
+struct LeafLinks<N, false> {};
+
+// Cantidad de keys del subárbol del nodo (el nodo y todos sus descendientes), para las
+// estadísticas de orden de los árboles con Counted. Sin Counted no ocupa espacio.
+template<bool Counted>
+struct SubtreeSize {
+    std::size_t value = 0;
+};
+
+template<>
+struct SubtreeSize<false> {};
+
+// Mensajes pendientes del nodo, para los buffers de BufferedBTree. Con B = void no ocupa espacio.
+template<typename B>
+struct NodeBuffer {
+    B messages;
+};
+
+template<>
+struct NodeBuffer<void> {};
+
+// Nodo con orden fijo: keys y children viven dentro del mismo bloque alineado a cache line, así que
+// visitar un nodo no persigue punteros extra.
+template<typename TK,
+         std::size_t Order = dynamic_order,
+         typename V = void,
+         bool Linked = false,
+         bool Counted = false,
+         typename Buffer = void>
+struct alignas(cache_line_size) Node {
+    static_assert(Order >= 3, "order must be greater than 2");
+
+    std::size_t count = 0;
+    bool leaf = true;
+    TK keys[Order - 1]{};
+    Node* children[Order]{};
+    [[no_unique_address]] NodeValues<V, Order> values;
+    [[no_unique_address]] LeafLinks<Node, Linked> links;
+    [[no_unique_address]] SubtreeSize<Counted> subtree;
+    [[no_unique_address]] NodeBuffer<Buffer> buffer;
+
+    Node() = default;
+
+    Node(const Node&) = delete;
+
+    Node(Node&& other) = delete;
+
+    Node& operator=(const Node&) = delete;
+
+    Node& operator=(Node&& other) = delete;
+
+    ~Node() = default;
+};
+
+// Nodo con orden dinámico. keys, children (y values, en BTreeMap) apuntan a memoria del mismo
+// bloque en el que vive el nodo; NodePool se encarga de construir y destruir esos arrays.
+template<typename TK, typename V, bool Linked, bool Counted, typename Buffer>
+struct Node<TK, dynamic_order, V, Linked, Counted, Buffer> {
     TK* keys;
     Node** children;
     std::size_t count = 0;
     bool leaf = true;
+    [[no_unique_address]] NodeValues<V, dynamic_order> values;
+    [[no_unique_address]] LeafLinks<Node, Linked> links;
+    [[no_unique_address]] SubtreeSize<Counted> subtree;
+    [[no_unique_address]] NodeBuffer<Buffer> buffer;
 
     Node() = delete;
 
@@ -17,35 +162,15 @@ struct Node {
 
     Node(Node&& other) = delete;
 
-    explicit Node(const std::size_t M)
-        : keys(new TK[M - 1]()),
-          children(new Node*[M]()) {}
+    Node(TK* const keys, Node** const children)
+        : keys(keys),
+          children(children) {}
 
     Node& operator=(const Node&) = delete;
 
-    Node& operator=(Node&& other) noexcept {
-        std::swap(keys, other.keys);
-        std::swap(children, other.children);
-        std::swap(count, other.count);
-        std::swap(leaf, other.leaf);
-        return *this;
-    }
+    Node& operator=(Node&& other) = delete;
 
-    // Este destructor ejecuta cuando se elimina un nodo. Por conveniencia, solo limpia sus propios
-    // recursos y no a sus children
-    ~Node() {
-        delete[] keys;
-        delete[] children;
-    }
-
-    // Este método es como el destructor pero también limpia a los children recursivamente
-    void killSelf() {
-        for (std::size_t i = 0; i < count + 1; ++i)
-            if (children[i] != nullptr)
-                children[i]->killSelf();
-
-        delete this;
-    }
+    ~Node() = default;
 };
 
 #endif
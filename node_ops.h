@@ -0,0 +1,167 @@
+#ifndef NODE_OPS_H
+#define NODE_OPS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Split, borrow, merge y validación de los árboles cuyos nodos son arrays de orden fijo M:
+// count, leaf, keys[M - 1] y children[M]. Los children pueden ser punteros o ids de página, así
+// que las funciones reciben cada nodo ya resuelto y dejan al llamador lo que cambia entre
+// árboles: de dónde sale un nodo nuevo, cómo se fija o se comparte, y qué pasa con el que sobra.
+// Reparten igual que BasicBTree con SplitPolicy::even y sin subárboles contados.
+namespace node_ops {
+    template<typename N>
+    using KeyOf = std::remove_cvref_t<decltype(std::declval<N&>().keys[0])>;
+
+    template<typename N>
+    using ChildOf = std::remove_cvref_t<decltype(std::declval<N&>().children[0])>;
+
+    // node está lleno y le falta entry en la posición i, con left como children[i]. Las primeras
+    // (M - 1) / 2 keys van a lsplit, que es un nodo nuevo a la izquierda; la del medio queda en
+    // entry para subir y el resto se queda en node. Como en el split de BasicBTree, cada key se
+    // mueve una sola vez directo a su lugar, sin armar la secuencia completa en el stack.
+    template<std::size_t M, typename N>
+    void split(N& node, N& lsplit, const std::size_t i, KeyOf<N>& entry, const ChildOf<N> left) {
+        constexpr std::size_t mid = (M - 1) / 2;
+        constexpr std::size_t right_count = M - 1 - mid;
+
+        // Key j y child j de la secuencia con entry ya insertada
+        const auto key = [&](const std::size_t j) -> KeyOf<N>& {
+            return j == i ? entry : node.keys[j < i ? j : j - 1];
+        };
+        const auto child = [&](const std::size_t j) {
+            return j == i ? left : node.children[j < i ? j : j - 1];
+        };
+
+        lsplit.leaf = node.leaf;
+        lsplit.count = mid;
+        for (std::size_t j = 0; j < mid; ++j) {
+            lsplit.keys[j] = std::move(key(j));
+            lsplit.children[j] = child(j);
+        }
+        lsplit.children[mid] = child(mid);
+
+        KeyOf<N> lifted = std::move(key(mid));
+
+        // Lo que queda se corre hacia la izquierda: cada lectura está a la derecha de su escritura
+        for (std::size_t k = 0; k < right_count; ++k) {
+            node.keys[k] = std::move(key(mid + 1 + k));
+            node.children[k] = child(mid + 1 + k);
+        }
+        node.children[right_count] = child(M);
+        std::fill(node.children + right_count + 1, node.children + M, ChildOf<N>{});
+
+        node.count = right_count;
+        entry = std::move(lifted);
+    }
+
+    // mid (children[i] de node) toma la última key de left (children[i - 1]), rotando por el
+    // separador
+    template<typename N>
+    void borrow_left(N& node, const std::size_t i, N& mid, N& left) {
+        mid.children[mid.count + 1] = mid.children[mid.count];
+        for (std::size_t k = mid.count; k > 0; --k) {
+            mid.keys[k] = std::move(mid.keys[k - 1]);
+            mid.children[k] = mid.children[k - 1];
+        }
+
+        mid.keys[0] = std::move(node.keys[i - 1]);
+        mid.children[0] = std::exchange(left.children[left.count], ChildOf<N>{});
+        node.keys[i - 1] = std::move(left.keys[left.count - 1]);
+
+        ++mid.count;
+        --left.count;
+    }
+
+    // mid (children[i] de node) toma la primera key de right (children[i + 1]), rotando por el
+    // separador
+    template<typename N>
+    void borrow_right(N& node, const std::size_t i, N& mid, N& right) {
+        mid.keys[mid.count] = std::move(node.keys[i]);
+        mid.children[mid.count + 1] = right.children[0];
+        node.keys[i] = std::move(right.keys[0]);
+
+        for (std::size_t k = 0; k + 1 < right.count; ++k) {
+            right.keys[k] = std::move(right.keys[k + 1]);
+            right.children[k] = right.children[k + 1];
+        }
+
+        right.children[right.count - 1] = right.children[right.count];
+        right.children[right.count] = ChildOf<N>{};
+
+        ++mid.count;
+        --right.count;
+    }
+
+    // left (children[i] de node) absorbe el separador y right (children[i + 1]), que node deja
+    // de apuntar; qué hacer con right queda para el llamador. Si right es const (porque lo siguen
+    // compartiendo otros), sus keys se copian en vez de moverse.
+    template<typename N, typename R>
+    void merge(N& node, const std::size_t i, N& left, R& right) {
+        left.keys[left.count] = std::move(node.keys[i]);
+        for (std::size_t k = 0; k < right.count; ++k) {
+            if constexpr (std::is_const_v<R>)
+                left.keys[left.count + 1 + k] = right.keys[k];
+            else
+                left.keys[left.count + 1 + k] = std::move(right.keys[k]);
+        }
+
+        if (!right.leaf)
+            std::copy(right.children, right.children + right.count + 1,
+                      left.children + left.count + 1);
+        left.count += 1 + right.count;
+
+        for (std::size_t k = i; k + 1 < node.count; ++k) {
+            node.keys[k] = std::move(node.keys[k + 1]);
+            node.children[k + 1] = node.children[k + 2];
+        }
+        node.children[node.count] = ChildOf<N>{};
+        --node.count;
+    }
+
+    // Valida el subárbol de node: cada nodo tiene entre min_keys (1 en la raíz) y M - 1 keys
+    // ordenadas, todas mayores que *lo y menores que *hi cuando no son nulos, y las hojas están a
+    // la misma profundidad. fetch(child) da algo que se usa como puntero al child (un puntero o
+    // una página fijada) y que sigue válido mientras se valida su subárbol. Retorna la altura del
+    // subárbol, o -1 si no es válido.
+    template<std::size_t M, typename N, typename Compare, typename Fetch>
+    std::ptrdiff_t check(const N& node,
+                         const bool is_root,
+                         const std::size_t min_keys,
+                         const KeyOf<N>* const lo,
+                         const KeyOf<N>* const hi,
+                         const Compare& comp,
+                         Fetch& fetch) {
+        if (node.count < (is_root ? 1 : min_keys) || node.count > M - 1)
+            return -1;
+
+        for (std::size_t i = 0; i + 1 < node.count; ++i)
+            if (!comp(node.keys[i], node.keys[i + 1]))
+                return -1;
+
+        if ((lo != nullptr && !comp(*lo, node.keys[0])) ||
+            (hi != nullptr && !comp(node.keys[node.count - 1], *hi)))
+            return -1;
+
+        if (node.leaf)
+            return 0;
+
+        std::ptrdiff_t height = -1;
+        for (std::size_t i = 0; i < node.count + 1; ++i) {
+            const auto child = fetch(node.children[i]);
+            const std::ptrdiff_t sub_height =
+                check<M>(*child, false, min_keys, i > 0 ? &node.keys[i - 1] : lo,
+                         i < node.count ? &node.keys[i] : hi, comp, fetch);
+            if (sub_height < 0 || (i > 0 && sub_height != height))
+                return -1;
+
+            height = sub_height;
+        }
+
+        return height + 1;
+    }
+}  // namespace node_ops
+
+#endif
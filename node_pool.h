@@ -0,0 +1,305 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "btree_stats.h"
+#include "node.h"
+
+// Arena de nodos. Reparte bloques de tamaño fijo desde chunks grandes, reutiliza los bloques de los
+// nodos liberados (por ejemplo en merges) mediante una free list, y al destruirse suelta chunks
+// completos en vez de nodo por nodo.
+//
+// Para el orden dinámico, cada bloque contiene el nodo seguido de sus arrays de keys, values (si
+// V no es void) y children, así que crear un nodo ya no hace tres allocations sino ninguna (salvo
+// cuando se acaba el chunk).
+//
+// Los chunks se liberan cuando ya ningún pool los usa: después de BasicBTree::split, los nodos de
+// los dos árboles resultantes pueden vivir en los mismos chunks.
+template<typename TK,
+         std::size_t Order,
+         typename V = void,
+         bool Linked = false,
+         bool Counted = false>
+class NodePool {
+    using BNode = Node<TK, Order, V, Linked, Counted>;
+
+    static constexpr bool has_values = !std::is_void_v<V>;
+    static constexpr bool trivial_nodes =
+        std::is_trivially_destructible_v<TK> &&
+        (!has_values || std::is_trivially_destructible_v<std::conditional_t<has_values, V, int>>);
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct ChunkDeleter {
+        void operator()(std::byte* const chunk) const {
+            ::operator delete(chunk, std::align_val_t{cache_line_size});
+        }
+    };
+
+    static constexpr std::size_t first_chunk_blocks = 8;
+    static constexpr std::size_t max_chunk_bytes = std::size_t{1} << 20;
+
+    [[no_unique_address]] OrderValue<Order> M;
+    std::size_t keys_offset = 0;
+    std::size_t values_offset = 0;
+    std::size_t children_offset = 0;
+    std::size_t block_size = 0;
+
+    std::vector<std::shared_ptr<std::byte>> chunks;
+    std::size_t next_chunk_blocks = first_chunk_blocks;
+    std::byte* bump = nullptr;
+    std::byte* bump_end = nullptr;
+    FreeBlock* free_list = nullptr;
+
+#ifdef BTREE_STATS
+    // Son del pool y no de los nodos, así que swap no los intercambia
+    std::uint64_t created = 0;
+    std::uint64_t destroyed = 0;
+    std::uint64_t chunks_allocated = 0;
+#endif
+
+    static constexpr std::size_t align_up(const std::size_t size, const std::size_t alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    std::byte* allocate_block() {
+        if (free_list != nullptr) {
+            auto* const block = reinterpret_cast<std::byte*>(free_list);
+            free_list = free_list->next;
+            return block;
+        }
+
+        if (bump == bump_end) {
+            const std::size_t blocks = next_chunk_blocks;
+            auto* const chunk = static_cast<std::byte*>(
+                ::operator new(blocks * block_size, std::align_val_t{cache_line_size}));
+            std::shared_ptr<std::byte> owner(chunk, ChunkDeleter{});
+            chunks.push_back(std::move(owner));
+#ifdef BTREE_STATS
+            ++chunks_allocated;
+#endif
+
+            bump = chunk;
+            bump_end = chunk + blocks * block_size;
+            next_chunk_blocks = std::max(next_chunk_blocks,
+                                         std::min(blocks * 2, max_chunk_bytes / block_size));
+        }
+
+        return std::exchange(bump, bump + block_size);
+    }
+
+    void free_block(std::byte* const block) {
+        free_list = new (block) FreeBlock{free_list};
+    }
+
+    void release(BNode* const node) {
+        if constexpr (Order == dynamic_order) {
+            std::destroy_n(node->keys, M - 1);
+            if constexpr (has_values)
+                std::destroy_n(node->values.data, M - 1);
+        }
+
+        node->~BNode();
+        free_block(reinterpret_cast<std::byte*>(node));
+    }
+
+    void destroy_subtree(BNode* const node) {
+        if (!node->leaf)
+            for (std::size_t i = 0; i < node->count + 1; ++i)
+                destroy_subtree(node->children[i]);
+
+        release(node);
+    }
+
+    void release_chunks() {
+        chunks.clear();
+        next_chunk_blocks = first_chunk_blocks;
+        bump = bump_end = nullptr;
+        free_list = nullptr;
+    }
+
+public:
+    explicit NodePool(const OrderValue<Order> M)
+        : M(M) {
+        if constexpr (Order == dynamic_order) {
+            keys_offset = align_up(sizeof(BNode), alignof(TK));
+            values_offset = keys_offset + (M - 1) * sizeof(TK);
+            if constexpr (has_values) {
+                values_offset = align_up(values_offset, alignof(V));
+                children_offset = values_offset + (M - 1) * sizeof(V);
+            } else {
+                children_offset = values_offset;
+            }
+            children_offset = align_up(children_offset, alignof(BNode*));
+            block_size = align_up(children_offset + M * sizeof(BNode*), cache_line_size);
+        } else {
+            block_size = sizeof(BNode);
+        }
+    }
+
+    NodePool(const NodePool&) = delete;
+
+    NodePool(NodePool&& other) noexcept
+        : NodePool(other.M) {
+        swap(other);
+    }
+
+    NodePool& operator=(const NodePool&) = delete;
+
+    NodePool& operator=(NodePool&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    // Solo libera la memoria: los nodos que sigan vivos deben haberse soltado con clear() si sus
+    // keys necesitan destructor.
+    ~NodePool() {
+        release_chunks();
+    }
+
+    void swap(NodePool& other) noexcept {
+        std::swap(M, other.M);
+        std::swap(keys_offset, other.keys_offset);
+        std::swap(values_offset, other.values_offset);
+        std::swap(children_offset, other.children_offset);
+        std::swap(block_size, other.block_size);
+        std::swap(chunks, other.chunks);
+        std::swap(next_chunk_blocks, other.next_chunk_blocks);
+        std::swap(bump, other.bump);
+        std::swap(bump_end, other.bump_end);
+        std::swap(free_list, other.free_list);
+    }
+
+    // Se queda con toda la memoria de other, incluyendo los nodos que ya estén vivos en ella. Ambos
+    // pools deben ser del mismo orden M. El espacio sin usar del chunk actual de other pasa a la
+    // free list.
+    void merge(NodePool& other) {
+        chunks.insert(chunks.end(), std::make_move_iterator(other.chunks.begin()),
+                      std::make_move_iterator(other.chunks.end()));
+
+        // Después de split los dos pools comparten chunks: al volver a juntarlos (join) cada chunk
+        // quedaría dos veces, y la lista se duplicaría en cada split seguido de join
+        std::sort(chunks.begin(), chunks.end(),
+                  [](const auto& a, const auto& b) { return a.get() < b.get(); });
+        chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+
+        for (; other.bump != other.bump_end; other.bump += block_size)
+            free_block(other.bump);
+
+        while (other.free_list != nullptr) {
+            FreeBlock* const block = std::exchange(other.free_list, other.free_list->next);
+            free_block(reinterpret_cast<std::byte*>(block));
+        }
+
+        other.chunks.clear();
+        other.next_chunk_blocks = first_chunk_blocks;
+        other.bump = other.bump_end = nullptr;
+
+#ifdef BTREE_STATS
+        created += std::exchange(other.created, 0);
+        destroyed += std::exchange(other.destroyed, 0);
+        chunks_allocated += std::exchange(other.chunks_allocated, 0);
+#endif
+    }
+
+    // Pasa a usar también los chunks de other, sin quitárselos: los nodos que viven en ellos siguen
+    // siendo válidos mientras exista cualquiera de los dos pools. Cada nodo sigue perteneciendo a
+    // un solo árbol, que es el único que lo destruye.
+    void share(const NodePool& other) {
+        chunks.insert(chunks.end(), other.chunks.begin(), other.chunks.end());
+    }
+
+    // Crea un nodo hoja vacío con todas sus keys construidas por defecto y sus children en nullptr
+    BNode* create() {
+        std::byte* const block = allocate_block();
+#ifdef BTREE_STATS
+        ++created;
+#endif
+
+        if constexpr (Order == dynamic_order) {
+            auto* const keys = reinterpret_cast<TK*>(block + keys_offset);
+            auto* const children = reinterpret_cast<BNode**>(block + children_offset);
+
+            try {
+                std::uninitialized_value_construct_n(keys, M - 1);
+            } catch (...) {
+                free_block(block);
+                throw;
+            }
+
+            std::uninitialized_value_construct_n(children, static_cast<std::size_t>(M));
+            auto* const node = new (block) BNode(keys, children);
+
+            if constexpr (has_values) {
+                auto* const values = reinterpret_cast<V*>(block + values_offset);
+
+                try {
+                    std::uninitialized_value_construct_n(values, M - 1);
+                } catch (...) {
+                    std::destroy_n(keys, M - 1);
+                    free_block(block);
+                    throw;
+                }
+
+                node->values.data = values;
+            }
+
+            return node;
+        } else {
+            try {
+                return new (block) BNode();
+            } catch (...) {
+                free_block(block);
+                throw;
+            }
+        }
+    }
+
+    // Destruye un nodo (no a sus children) y deja su bloque en la free list
+    void destroy(BNode* const node) {
+#ifdef BTREE_STATS
+        ++destroyed;
+#endif
+        release(node);
+    }
+
+    // Suelta todos los nodos del árbol con raíz root. Si las keys (y values) no necesitan
+    // destructor, no se visita ningún nodo: se liberan los chunks directamente.
+    void clear(BNode* const root) {
+        if constexpr (!trivial_nodes) {
+            if (root != nullptr)
+                destroy_subtree(root);
+        }
+
+        release_chunks();
+    }
+
+    // Bytes de cada bloque de nodo
+    [[nodiscard]] std::size_t block_bytes() const {
+        return block_size;
+    }
+
+#ifdef BTREE_STATS
+    void add_counters(BTreeCounters& counters) const {
+        counters.node_allocations += created;
+        counters.node_frees += destroyed;
+        counters.chunk_allocations += chunks_allocated;
+    }
+
+    void reset_counters() {
+        created = destroyed = chunks_allocated = 0;
+    }
+#endif
+};
+
+#endif
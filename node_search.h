@@ -0,0 +1,237 @@
+#ifndef NODE_SEARCH_H
+#define NODE_SEARCH_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Políticas de búsqueda dentro de un nodo. Todas exponen
+//
+//     template<std::size_t Capacity, typename TK, typename K, typename Compare>
+//     static std::size_t rank(const TK* keys, std::size_t count, const K& key, const Compare&);
+//
+// que retorna el índice de la primera key de keys[0, count) para la que comp(keys[i], key) es
+// falso, es decir, la primera key >= key. K puede ser distinto de TK cuando el comparador es
+// transparente (por ejemplo std::string_view contra std::string). Capacity es la cantidad de
+// slots del nodo (M - 1) cuando el orden es fijo, o 0 cuando el orden se decide en runtime. Los
+// slots en [count, Capacity) siempre contienen keys construidas, así que se pueden leer.
+
+// Búsqueda lineal escalar. Con orden fijo y pequeño recorre todos los slots sin salir antes, para
+// que el loop tenga trip count constante.
+struct LinearNodeSearch {
+    static constexpr std::size_t unrolled_limit = 32;
+
+    template<std::size_t Capacity, typename TK, typename K, typename Compare>
+    static std::size_t rank(const TK* const keys,
+                            const std::size_t count,
+                            const K& key,
+                            const Compare& comp) {
+        std::size_t idx = 0;
+
+        if constexpr (Capacity != 0 && Capacity <= unrolled_limit) {
+            for (std::size_t i = 0; i < Capacity; ++i)
+                idx += static_cast<std::size_t>(i < count && comp(keys[i], key));
+        } else {
+            while (idx < count && comp(keys[idx], key))
+                ++idx;
+        }
+
+        return idx;
+    }
+};
+
+namespace node_search_detail {
+    template<typename T>
+    concept SimdKey = (std::is_integral_v<T> && std::is_signed_v<T> &&
+                       (sizeof(T) == 4 || sizeof(T) == 8)) ||
+                      (std::is_floating_point_v<T> && (sizeof(T) == 4 || sizeof(T) == 8));
+
+    // Los bloques vectoriales comparan con "<" nativo, así que solo sirven si el comparador es ese
+    // mismo orden y la key buscada es del tipo de las keys guardadas
+    template<typename TK, typename K, typename Compare>
+    concept SimdSearchable =
+        SimdKey<TK> && std::is_same_v<K, TK> &&
+        (std::is_same_v<Compare, std::less<TK>> || std::is_same_v<Compare, std::less<>>);
+
+    // Como las keys están ordenadas, la máscara de "keys[j] < key" es un prefijo de unos: su
+    // popcount es la cantidad de keys menores dentro del bloque. Si el bloque no está lleno de
+    // unos, el rank está dentro de él y podemos terminar.
+    template<typename TK>
+    std::size_t vector_rank(const TK* const keys, const std::size_t count, const TK key) {
+        std::size_t i = 0;
+
+#if defined(__AVX512F__)
+        if constexpr (std::is_integral_v<TK> && sizeof(TK) == 4) {
+            const __m512i k = _mm512_set1_epi32(static_cast<std::int32_t>(key));
+            for (; i + 16 <= count; i += 16) {
+                const __m512i v = _mm512_loadu_si512(keys + i);
+                const unsigned mask = _mm512_cmplt_epi32_mask(v, k);
+                if (mask != 0xFFFFU)
+                    return i + std::popcount(mask);
+            }
+        } else if constexpr (std::is_integral_v<TK> && sizeof(TK) == 8) {
+            const __m512i k = _mm512_set1_epi64(static_cast<std::int64_t>(key));
+            for (; i + 8 <= count; i += 8) {
+                const __m512i v = _mm512_loadu_si512(keys + i);
+                const unsigned mask = _mm512_cmplt_epi64_mask(v, k);
+                if (mask != 0xFFU)
+                    return i + std::popcount(mask);
+            }
+        } else if constexpr (sizeof(TK) == 4) {
+            const __m512 k = _mm512_set1_ps(key);
+            for (; i + 16 <= count; i += 16) {
+                const __m512 v = _mm512_loadu_ps(keys + i);
+                const unsigned mask = _mm512_cmp_ps_mask(v, k, _CMP_LT_OQ);
+                if (mask != 0xFFFFU)
+                    return i + std::popcount(mask);
+            }
+        } else {
+            const __m512d k = _mm512_set1_pd(key);
+            for (; i + 8 <= count; i += 8) {
+                const __m512d v = _mm512_loadu_pd(keys + i);
+                const unsigned mask = _mm512_cmp_pd_mask(v, k, _CMP_LT_OQ);
+                if (mask != 0xFFU)
+                    return i + std::popcount(mask);
+            }
+        }
+#elif defined(__AVX2__)
+        if constexpr (std::is_integral_v<TK> && sizeof(TK) == 4) {
+            const __m256i k = _mm256_set1_epi32(static_cast<std::int32_t>(key));
+            for (; i + 8 <= count; i += 8) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+                const auto mask = static_cast<unsigned>(
+                    _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v))));
+                if (mask != 0xFFU)
+                    return i + std::popcount(mask);
+            }
+        } else if constexpr (std::is_integral_v<TK> && sizeof(TK) == 8) {
+            const __m256i k = _mm256_set1_epi64x(static_cast<std::int64_t>(key));
+            for (; i + 4 <= count; i += 4) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+                const auto mask = static_cast<unsigned>(
+                    _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, v))));
+                if (mask != 0xFU)
+                    return i + std::popcount(mask);
+            }
+        } else if constexpr (sizeof(TK) == 4) {
+            const __m256 k = _mm256_set1_ps(key);
+            for (; i + 8 <= count; i += 8) {
+                const __m256 v = _mm256_loadu_ps(keys + i);
+                const auto mask =
+                    static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(v, k, _CMP_LT_OQ)));
+                if (mask != 0xFFU)
+                    return i + std::popcount(mask);
+            }
+        } else {
+            const __m256d k = _mm256_set1_pd(key);
+            for (; i + 4 <= count; i += 4) {
+                const __m256d v = _mm256_loadu_pd(keys + i);
+                const auto mask =
+                    static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(v, k, _CMP_LT_OQ)));
+                if (mask != 0xFU)
+                    return i + std::popcount(mask);
+            }
+        }
+#elif defined(__SSE2__)
+        if constexpr (std::is_integral_v<TK> && sizeof(TK) == 4) {
+            const __m128i k = _mm_set1_epi32(static_cast<std::int32_t>(key));
+            for (; i + 4 <= count; i += 4) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+                const auto mask = static_cast<unsigned>(
+                    _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, k))));
+                if (mask != 0xFU)
+                    return i + std::popcount(mask);
+            }
+        } else if constexpr (std::is_integral_v<TK> && sizeof(TK) == 8) {
+            // SSE2 no compara enteros de 64 bits; se usa el loop escalar de abajo.
+        } else if constexpr (sizeof(TK) == 4) {
+            const __m128 k = _mm_set1_ps(key);
+            for (; i + 4 <= count; i += 4) {
+                const auto mask =
+                    static_cast<unsigned>(_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(keys + i), k)));
+                if (mask != 0xFU)
+                    return i + std::popcount(mask);
+            }
+        } else {
+            const __m128d k = _mm_set1_pd(key);
+            for (; i + 2 <= count; i += 2) {
+                const auto mask =
+                    static_cast<unsigned>(_mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(keys + i), k)));
+                if (mask != 0x3U)
+                    return i + std::popcount(mask);
+            }
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        // vclt deja todos los bits en 1 para cada lane menor; el shift lo convierte en 1 por lane.
+        if constexpr (std::is_integral_v<TK> && sizeof(TK) == 4) {
+            const int32x4_t k = vdupq_n_s32(static_cast<std::int32_t>(key));
+            for (; i + 4 <= count; i += 4) {
+                const int32x4_t v = vld1q_s32(reinterpret_cast<const std::int32_t*>(keys + i));
+                const std::uint32_t lanes = vaddvq_u32(vshrq_n_u32(vcltq_s32(v, k), 31));
+                if (lanes != 4)
+                    return i + lanes;
+            }
+        } else if constexpr (std::is_integral_v<TK> && sizeof(TK) == 8) {
+            const int64x2_t k = vdupq_n_s64(static_cast<std::int64_t>(key));
+            for (; i + 2 <= count; i += 2) {
+                const int64x2_t v = vld1q_s64(reinterpret_cast<const std::int64_t*>(keys + i));
+                const std::uint64_t lanes = vaddvq_u64(vshrq_n_u64(vcltq_s64(v, k), 63));
+                if (lanes != 2)
+                    return i + lanes;
+            }
+        } else if constexpr (sizeof(TK) == 4) {
+            const float32x4_t k = vdupq_n_f32(key);
+            for (; i + 4 <= count; i += 4) {
+                const std::uint32_t lanes =
+                    vaddvq_u32(vshrq_n_u32(vcltq_f32(vld1q_f32(keys + i), k), 31));
+                if (lanes != 4)
+                    return i + lanes;
+            }
+        } else {
+            const float64x2_t k = vdupq_n_f64(key);
+            for (; i + 2 <= count; i += 2) {
+                const std::uint64_t lanes =
+                    vaddvq_u64(vshrq_n_u64(vcltq_f64(vld1q_f64(keys + i), k), 63));
+                if (lanes != 2)
+                    return i + lanes;
+            }
+        }
+#endif
+
+        // Cola (o fallback completo cuando no hay SIMD disponible)
+        while (i < count && keys[i] < key)
+            ++i;
+
+        return i;
+    }
+}
+
+// Compara bloques enteros de keys con instrucciones vectoriales (AVX-512, AVX2, SSE2 o NEON, según
+// el target de compilación) para keys aritméticas ordenadas con std::less. Para cualquier otro tipo
+// o comparador cae a LinearNodeSearch.
+struct SimdNodeSearch {
+    template<std::size_t Capacity, typename TK, typename K, typename Compare>
+    static std::size_t rank(const TK* const keys,
+                            const std::size_t count,
+                            const K& key,
+                            const Compare& comp) {
+        if constexpr (node_search_detail::SimdSearchable<TK, K, Compare>)
+            return node_search_detail::vector_rank(keys, count, key);
+        else
+            return LinearNodeSearch::rank<Capacity>(keys, count, key, comp);
+    }
+};
+
+using DefaultNodeSearch = SimdNodeSearch;
+
+#endif
@@ -0,0 +1,756 @@
+#ifndef PAGED_BTREE_H
+#define PAGED_BTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "buffer_pool.h"
+#include "node.h"
+#include "node_ops.h"
+#include "node_search.h"
+#include "write_ahead_log.h"
+
+// Nodo de PagedBTree: ocupa el comienzo de una página y sus children son ids de página. El
+// orden es el mayor que entra en PageSize bytes.
+template<typename TK, std::size_t PageSize>
+struct PagedNode {
+    static constexpr std::size_t order =
+        (PageSize - 2 * sizeof(std::uint64_t) + sizeof(TK)) / (sizeof(TK) + sizeof(PageId));
+
+    static_assert(order >= 3, "page too small for three children");
+
+    std::uint32_t count;
+    std::uint32_t leaf;
+    PageId children[order];
+    TK keys[order - 1];
+};
+
+// Página 0 del archivo. Las páginas libres forman una lista: cada una guarda al comienzo el id
+// de la siguiente (0 es el final, porque la página 0 nunca es un nodo).
+struct PagedHeader {
+    std::uint64_t magic;
+    std::uint64_t page_size;
+    std::uint64_t key_size;
+    std::uint64_t order;
+    std::uint64_t size;
+    PageId root;
+    PageId page_count;
+    PageId free_head;
+    std::uint64_t clean;  // Sin log, 0 mientras hay páginas escritas después del último flush()
+};
+
+// Página fijada en el BufferPool mientras exista el PageRef. write() la marca como modificada.
+template<typename T>
+class PageRef {
+    BufferPool* pool = nullptr;
+    std::size_t frame = 0;
+    PageId page = 0;
+
+public:
+    PageRef() = default;
+
+    PageRef(BufferPool& pool, const std::size_t frame, const PageId page)
+        : pool(&pool),
+          frame(frame),
+          page(page) {}
+
+    PageRef(const PageRef&) = delete;
+
+    PageRef(PageRef&& other) noexcept
+        : pool(std::exchange(other.pool, nullptr)),
+          frame(other.frame),
+          page(other.page) {}
+
+    PageRef& operator=(const PageRef&) = delete;
+
+    PageRef& operator=(PageRef&& other) noexcept {
+        if (this != &other) {
+            reset();
+            pool = std::exchange(other.pool, nullptr);
+            frame = other.frame;
+            page = other.page;
+        }
+        return *this;
+    }
+
+    ~PageRef() {
+        reset();
+    }
+
+    void reset() {
+        if (pool != nullptr)
+            std::exchange(pool, nullptr)->unpin(frame);
+    }
+
+    [[nodiscard]] PageId id() const {
+        return page;
+    }
+
+    const T* operator->() const {
+        return reinterpret_cast<const T*>(pool->data(frame));
+    }
+
+    const T& operator*() const {
+        return *operator->();
+    }
+
+    T* write() {
+        pool->mark_dirty(frame);
+        return reinterpret_cast<T*>(pool->data(frame));
+    }
+};
+
+// Árbol B (solo keys) guardado en un archivo, una página por nodo. Los nodos se leen a través de
+// un BufferPool de pool_pages páginas, así que el árbol puede ser mucho más grande que la
+// memoria.
+//
+// Sin log, las páginas modificadas se escriben en su lugar al desalojarse y en flush(), así que
+// el archivo solo es consistente después de un flush() o de cerrar el árbol normalmente: un crash
+// entre dos flush() puede dejar una mezcla de páginas viejas y nuevas. Para no abrir un árbol
+// roto, la primera modificación después de un flush() marca la página 0 como sucia en el disco, y
+// abrir un archivo marcado así lanza. Para sobrevivir a un crash hay que usar un log.
+//
+// Con un log (WriteAheadLog), insert, remove y clear agregan un registro lógico (la key) antes de
+// retornar y esperan según la SyncPolicy; las páginas modificadas quedan en memoria hasta el
+// próximo checkpoint. Un checkpoint copia esas páginas al log, hace fsync, recién entonces las
+// escribe en su lugar y vacía el log, así que un crash a medio camino se repara volviendo a
+// copiarlas. Al abrir, se rehace el último checkpoint completo y se repiten los registros que le
+// siguen: los splits y merges se rehacen solos al repetir los insert y remove que los causaron.
+//
+// search, insert y remove son los mismos algoritmos que en BasicBTree (split al insertar, y
+// borrow o merge al borrar) con ids de página en vez de punteros. Las keys se guardan tal cual
+// en la página, así que deben ser trivialmente copiables. Cada operación toma un mutex: varios
+// hilos pueden usar el árbol, de a uno, y con un log sus fsync se agrupan.
+template<typename TK,
+         std::size_t PageSize = 4096,
+         typename Compare = std::less<TK>,
+         typename Search = DefaultNodeSearch>
+class PagedBTree {
+    static_assert(std::is_trivially_copyable_v<TK>,
+                  "keys are stored as raw bytes, so they must be trivially copyable");
+
+    using PNode = PagedNode<TK, PageSize>;
+    using NodeRef = PageRef<PNode>;
+
+    static_assert(sizeof(PNode) <= PageSize && sizeof(PagedHeader) <= PageSize);
+
+public:
+    static constexpr std::size_t order = PNode::order;
+    static constexpr std::size_t default_pool_pages = 1024;
+
+    // Con un log, pasado este tamaño se hace un checkpoint para acotar la recuperación
+    static constexpr std::uint64_t checkpoint_bytes = std::uint64_t{64} << 20;
+
+private:
+    static constexpr std::size_t M = order;
+    static constexpr std::size_t min_keys = (M - 1) / 2;
+    static constexpr std::uint64_t magic = 0x45455254'42474150;  // "PAGBTREE"
+
+    static constexpr bool transparent = requires { typename Compare::is_transparent; };
+
+    template<typename K>
+    using LookupKey = std::conditional_t<transparent, K, TK>;
+
+    static constexpr std::size_t max_depth = max_tree_depth((M + 1) / 2);
+
+    // Frames que puede ensuciar una operación: el camino, un nodo nuevo o un hermano por nivel, la
+    // raíz nueva y la página 0
+    static constexpr std::size_t op_frames = 2 * max_depth + 2;
+
+    // Tipos de registro del log
+    static constexpr std::uint8_t log_insert = 1;
+    static constexpr std::uint8_t log_remove = 2;
+    static constexpr std::uint8_t log_clear = 3;
+    static constexpr std::uint8_t log_page = 4;        // id y contenido de una página
+    static constexpr std::uint8_t log_checkpoint = 5;  // offsets de sus páginas y del replay
+
+    [[no_unique_address]] Compare comp;
+    PageFile file;
+    BufferPool pool;
+    std::unique_ptr<WriteAheadLog> log;
+    PagedHeader header{};
+    mutable std::mutex latch;
+
+    template<typename K>
+    std::size_t rank(const PNode* const node, const K& key) const {
+        return Search::template rank<M - 1>(node->keys, node->count, key, comp);
+    }
+
+    template<typename K>
+    bool matches(const PNode* const node, const std::size_t idx, const K& key) const {
+        return idx < node->count && !comp(key, node->keys[idx]);
+    }
+
+    NodeRef fetch(const PageId id) {
+        return {pool, pool.pin(id), id};
+    }
+
+    // Página para un nodo nuevo, tomada de la lista de libres o del final del archivo
+    NodeRef allocate() {
+        PageId id = header.free_head;
+
+        if (id != 0) {
+            const std::size_t frame = pool.pin(id);
+            std::memcpy(&header.free_head, pool.data(frame), sizeof(PageId));
+            pool.unpin(frame);
+        } else {
+            id = header.page_count++;
+        }
+
+        return {pool, pool.pin_new(id), id};
+    }
+
+    // Devuelve la página id a la lista de libres. Nadie debe tenerla fijada.
+    void free_page(const PageId id) {
+        const std::size_t frame = pool.pin_new(id);
+        std::memcpy(pool.data(frame), &header.free_head, sizeof(PageId));
+        pool.unpin(frame);
+        header.free_head = id;
+    }
+
+    void write_header() {
+        const std::size_t frame = pool.pin_new(0);
+        std::memcpy(pool.data(frame), &header, sizeof(header));
+        pool.unpin(frame);
+    }
+
+    // node está lleno y le falta entry en la posición i, con left como children[i]. Retorna la
+    // página del nodo nuevo de la izquierda.
+    PageId split(PNode* const node, const std::size_t i, TK& entry, const PageId left) {
+        NodeRef lsplit = allocate();
+        node_ops::split<M>(*node, *lsplit.write(), i, entry, left);
+        return lsplit.id();
+    }
+
+    // Recorre en orden las keys de la página id que no son menores que *lo, mientras no pasen de
+    // *hi. Retorna false si ya pasó de hi. Solo quedan fijadas las páginas del camino actual.
+    template<typename K1, typename K2, typename Fn>
+    bool walk(const PageId id, const K1* const lo, const K2* const hi, Fn& fn) {
+        const NodeRef node = fetch(id);
+        const std::size_t first = lo != nullptr ? rank(node.operator->(), *lo) : 0;
+
+        for (std::size_t i = first; i <= node->count; ++i) {
+            if (!node->leaf && !walk(node->children[i], i == first ? lo : nullptr, hi, fn))
+                return false;
+
+            if (i < node->count) {
+                if (hi != nullptr && comp(*hi, node->keys[i]))
+                    return false;
+                fn(static_cast<const TK&>(node->keys[i]));
+            }
+        }
+
+        return true;
+    }
+
+    // Retorna false si key ya estaba
+    bool insert_key(const TK& key) {
+        if (header.root == 0) {
+            NodeRef leaf_ref = allocate();
+            PNode* const leaf = leaf_ref.write();
+            leaf->leaf = 1;
+            leaf->count = 1;
+            leaf->keys[0] = key;
+
+            header.root = leaf_ref.id();
+            header.size = 1;
+            return true;
+        }
+
+        NodeRef path[max_depth];
+        std::size_t idx[max_depth];
+        std::size_t depth = 0;
+
+        for (PageId id = header.root;;) {
+            NodeRef node = fetch(id);
+            const std::size_t i = rank(node.operator->(), key);
+            if (matches(node.operator->(), i, key))
+                return false;
+
+            const bool leaf = node->leaf != 0;
+            id = node->children[i];
+            idx[depth] = i;
+            path[depth++] = std::move(node);
+
+            if (leaf)
+                break;
+        }
+
+        ++header.size;
+
+        TK entry = key;
+        PageId left = 0;
+
+        for (std::size_t d = depth; d-- > 0;) {
+            PNode* const cur = path[d].write();
+            const std::size_t i = idx[d];
+
+            if (cur->count < M - 1) {
+                cur->children[cur->count + 1] = cur->children[cur->count];
+                for (std::size_t j = cur->count; j > i; --j) {
+                    cur->keys[j] = cur->keys[j - 1];
+                    cur->children[j] = cur->children[j - 1];
+                }
+
+                cur->keys[i] = entry;
+                cur->children[i] = left;
+                ++cur->count;
+                return true;
+            }
+
+            left = split(cur, i, entry, left);
+        }
+
+        NodeRef root_ref = allocate();
+        PNode* const new_root = root_ref.write();
+        new_root->leaf = 0;
+        new_root->count = 1;
+        new_root->keys[0] = entry;
+        new_root->children[0] = left;
+        new_root->children[1] = path[0].id();
+        header.root = root_ref.id();
+        return true;
+    }
+
+    // Retorna la key que se borró, o nada si no había una equivalente a k
+    template<typename K>
+    std::optional<TK> remove_key(const K& k) {
+        if (header.root == 0)
+            return std::nullopt;
+
+        // Si key está en un nodo interno (anchor) se reemplaza por su predecesor, que está al
+        // final del borde derecho del child de la izquierda
+        NodeRef path[max_depth];
+        std::size_t idx[max_depth];
+        std::size_t depth = 0;
+        std::size_t anchor = max_depth;
+
+        for (PageId id = header.root;;) {
+            NodeRef node = fetch(id);
+            std::size_t i = 0;
+            bool hit = false;
+            if (anchor != max_depth) {
+                i = node->leaf ? node->count - 1 : node->count;
+            } else {
+                i = rank(node.operator->(), k);
+                hit = matches(node.operator->(), i, k);
+                if (hit && !node->leaf)
+                    anchor = depth;
+            }
+
+            const bool leaf = node->leaf != 0;
+            id = node->children[i];
+            idx[depth] = i;
+            path[depth++] = std::move(node);
+
+            if (leaf) {
+                if (anchor == max_depth && !hit)
+                    return std::nullopt;
+                break;
+            }
+        }
+
+        PNode* const leaf = path[depth - 1].write();
+        const std::size_t pos = idx[depth - 1];
+        const TK removed = anchor != max_depth ? path[anchor]->keys[idx[anchor]] : leaf->keys[pos];
+
+        if (anchor != max_depth)
+            path[anchor].write()->keys[idx[anchor]] = leaf->keys[pos];
+
+        for (std::size_t j = pos; j + 1 < leaf->count; ++j)
+            leaf->keys[j] = leaf->keys[j + 1];
+        --leaf->count;
+        --header.size;
+
+        for (std::size_t d = depth - 1; d > 0; --d) {
+            if (path[d]->count >= min_keys)
+                break;
+
+            PNode* const parent = path[d - 1].write();
+            PNode* const cur = path[d].write();
+            const std::size_t i = idx[d - 1];
+
+            if (i > 0) {
+                NodeRef left = fetch(parent->children[i - 1]);
+                if (left->count > min_keys) {
+                    node_ops::borrow_left(*parent, i, *cur, *left.write());
+                    break;
+                }
+
+                node_ops::merge(*parent, i - 1, *left.write(), std::as_const(*cur));
+                const PageId freed = path[d].id();
+                path[d].reset();
+                free_page(freed);
+            } else {
+                NodeRef right = fetch(parent->children[i + 1]);
+                if (right->count > min_keys) {
+                    node_ops::borrow_right(*parent, i, *cur, *right.write());
+                    break;
+                }
+
+                node_ops::merge(*parent, i, *cur, *right);
+                const PageId freed = right.id();
+                right.reset();
+                free_page(freed);
+            }
+        }
+
+        // Una raíz vacía se reemplaza por su único child (o por nada, si era hoja)
+        if (path[0]->count == 0) {
+            const PageId old_root = path[0].id();
+            header.root = path[0]->leaf ? 0 : path[0]->children[0];
+            path[0].reset();
+            free_page(old_root);
+        }
+
+        return removed;
+    }
+
+    // Vacía el árbol. Con log el archivo se acorta recién en el checkpoint, para que hasta
+    // entonces siga valiendo el anterior.
+    void clear_pages() {
+        pool.discard();
+        header.root = 0;
+        header.page_count = 1;
+        header.free_head = 0;
+        header.size = 0;
+
+        if (log == nullptr) {
+            file.truncate(1);
+            write_header();
+        }
+    }
+
+    template<typename T>
+    static std::span<const std::byte> bytes_of(const T& value) {
+        return std::as_bytes(std::span(&value, 1));
+    }
+
+    // Copia al log las páginas modificadas y la página 0, después un registro de checkpoint con
+    // el offset de la primera y replay_from, y recién con eso en el disco las escribe en su lugar.
+    // Al recuperar se repiten los registros lógicos desde el offset replay_from del log.
+    void write_checkpoint(const std::uint64_t replay_from) {
+        write_header();
+        const std::uint64_t offsets[2] = {log->bytes(), replay_from};
+
+        std::vector<std::byte> record(sizeof(PageId) + PageSize);
+        pool.for_each_dirty([&](const PageId id, const std::byte* const page) {
+            std::memcpy(record.data(), &id, sizeof id);
+            std::memcpy(record.data() + sizeof id, page, PageSize);
+            log->append(log_page, record);
+        });
+        log->append(log_checkpoint, std::as_bytes(std::span(offsets)));
+        log->sync();
+
+        pool.flush();
+        if (file.page_count() > header.page_count)
+            file.truncate(header.page_count);
+        file.sync();
+    }
+
+    void checkpoint() {
+        write_checkpoint(log->bytes());
+        log->reset();
+    }
+
+    // Sin steal las páginas modificadas no se pueden desalojar: antes de una operación tiene que
+    // haber lugar para todas las que puede modificar
+    void make_room() {
+        if (pool.dirty_count() + op_frames > pool.capacity() || log->bytes() > checkpoint_bytes)
+            checkpoint();
+    }
+
+    // Agrega el registro (si la operación cambió algo) y espera según la política. Con lock
+    // suelto, así que otros hilos pueden operar mientras este espera el fsync.
+    void commit(std::unique_lock<std::mutex>& lock,
+                const bool changed,
+                const std::uint8_t type,
+                const std::span<const std::byte> data) {
+        const WriteAheadLog::Lsn lsn = changed ? log->append(type, data) : log->end();
+        lock.unlock();
+        log->commit(lsn);
+    }
+
+    // Rehace el último checkpoint completo del log y repite los registros lógicos que siguen
+    void recover() {
+        const auto corrupt = [] {
+            throw std::runtime_error("log does not match the page file layout");
+        };
+
+        // Las páginas de un checkpoint al que le falta su registro final no se usan
+        std::uint64_t offsets[2] = {0, 0};
+        std::uint64_t images_to = 0;
+        log->replay([&](const std::uint64_t offset, const std::uint8_t type, const auto data) {
+            if (type != log_checkpoint)
+                return;
+            if (data.size() != sizeof offsets)
+                corrupt();
+
+            std::memcpy(offsets, data.data(), sizeof offsets);
+            images_to = offset;
+        });
+        const auto [images_from, replay_from] = offsets;
+
+        std::vector<std::pair<std::uint64_t, std::uint8_t>> ops;
+        std::vector<TK> keys;
+        log->replay([&](const std::uint64_t offset, const std::uint8_t type, const auto data) {
+            if (type == log_page) {
+                if (data.size() != sizeof(PageId) + PageSize)
+                    corrupt();
+                if (offset >= images_from && offset < images_to) {
+                    PageId id = 0;
+                    std::memcpy(&id, data.data(), sizeof id);
+                    file.write(id, data.data() + sizeof id);
+                }
+            } else if (type != log_checkpoint && offset >= replay_from) {
+                if (type != log_clear && (type > log_remove || data.size() != sizeof(TK)))
+                    corrupt();
+                ops.emplace_back(offset, type);
+                if (type != log_clear)
+                    std::memcpy(&keys.emplace_back(), data.data(), sizeof(TK));
+            }
+        });
+        file.sync();
+        open_header();
+
+        // Un checkpoint en medio de la recuperación no vacía el log: anota desde dónde seguir
+        std::size_t next_key = 0;
+        for (const auto& [offset, type] : ops) {
+            if (pool.dirty_count() + op_frames > pool.capacity())
+                write_checkpoint(offset);
+
+            if (type == log_insert)
+                insert_key(keys[next_key++]);
+            else if (type == log_remove)
+                remove_key(keys[next_key++]);
+            else
+                clear_pages();
+        }
+
+        checkpoint();
+    }
+
+    void open_header() {
+        if (file.page_count() == 0) {
+            header = {magic, PageSize, sizeof(TK), M, 0, 0, 1, 0, 1};
+            write_header();
+            return;
+        }
+
+        const std::size_t frame = pool.pin(0);
+        std::memcpy(&header, pool.data(frame), sizeof(header));
+        pool.unpin(frame);
+
+        if (header.magic != magic || header.page_size != PageSize ||
+            header.key_size != sizeof(TK) || header.order != M)
+            throw std::runtime_error("page file was written with a different layout");
+        if (header.clean == 0)
+            throw std::runtime_error("page file was not flushed before it was last closed");
+    }
+
+    // Sin log, antes de la primera modificación después de un flush() la página 0 se marca en el
+    // disco como no consistente. En ese momento es la única página modificada.
+    void begin_write() {
+        if (header.clean == 0)
+            return;
+
+        header.clean = 0;
+        write_header();
+        pool.flush();
+        file.sync();
+    }
+
+    // Sin log: todas las páginas primero, y recién cuando están en el disco la página 0 marcada
+    // como consistente
+    void flush_pages() {
+        write_header();
+        pool.flush();
+        file.sync();
+
+        header.clean = 1;
+        write_header();
+        pool.flush();
+        file.sync();
+    }
+
+    PagedBTree(const std::string& path,
+               const std::string* const log_path,
+               const SyncPolicy policy,
+               const std::size_t pool_pages,
+               const Compare& comp)
+        : comp(comp),
+          file(path, PageSize),
+          pool(file, PageSize, pool_pages, log_path == nullptr) {
+        // insert fija todo el camino, el nodo nuevo de un split y la página 0
+        if (pool_pages < max_depth + 2)
+            throw std::invalid_argument("buffer pool too small for a root-to-leaf path");
+
+        if (log_path == nullptr) {
+            open_header();
+            return;
+        }
+
+        if (pool_pages < op_frames)
+            throw std::invalid_argument("buffer pool too small to hold an operation's pages");
+        log = std::make_unique<WriteAheadLog>(*log_path, policy);
+        recover();
+    }
+
+public:
+    // Abre el árbol guardado en path, o crea uno vacío si el archivo no existe o está vacío
+    explicit PagedBTree(const std::string& path,
+                        const std::size_t pool_pages = default_pool_pages,
+                        const Compare& comp = Compare())
+        : PagedBTree(path, nullptr, SyncPolicy::none(), pool_pages, comp) {}
+
+    // Igual, pero registrando los cambios en el log log_path. Si el proceso terminó sin un
+    // flush(), al abrir se recupera lo que alcanzó a quedar durable según policy.
+    PagedBTree(const std::string& path,
+               const std::string& log_path,
+               const SyncPolicy policy = SyncPolicy::every_op(),
+               const std::size_t pool_pages = default_pool_pages,
+               const Compare& comp = Compare())
+        : PagedBTree(path, &log_path, policy, pool_pages, comp) {}
+
+    PagedBTree(const PagedBTree&) = delete;
+
+    PagedBTree& operator=(const PagedBTree&) = delete;
+
+    // Escribe lo pendiente. Para enterarse de un error de escritura hay que llamar antes a
+    // flush(): un destructor no puede lanzarlo.
+    ~PagedBTree() {
+        try {
+            if (log != nullptr) {
+                checkpoint();
+            } else {
+                flush_pages();
+            }
+        } catch (...) {  // NOLINT(bugprone-empty-catch)
+        }
+    }
+
+    template<typename K>
+    [[nodiscard]] bool search(const K& key) {
+        const LookupKey<K>& k = key;
+        const std::scoped_lock lock(latch);
+
+        for (PageId id = header.root; id != 0;) {
+            const NodeRef node = fetch(id);
+            const std::size_t idx = rank(node.operator->(), k);
+            if (matches(node.operator->(), idx, k))
+                return true;
+
+            id = node->leaf ? 0 : node->children[idx];
+        }
+
+        return false;
+    }
+
+    void insert(const TK& key) {
+        std::unique_lock lock(latch);
+        if (log == nullptr) {
+            begin_write();
+            insert_key(key);
+            return;
+        }
+
+        make_room();
+        commit(lock, insert_key(key), log_insert, bytes_of(key));
+    }
+
+    template<typename K>
+    void remove(const K& key) {
+        const LookupKey<K>& k = key;
+        std::unique_lock lock(latch);
+        if (log == nullptr) {
+            begin_write();
+            remove_key(k);
+            return;
+        }
+
+        make_room();
+        const std::optional<TK> removed = remove_key(k);
+        commit(lock, removed.has_value(), log_remove,
+               removed ? bytes_of(*removed) : std::span<const std::byte>());
+    }
+
+    // Llama a fn(key) para cada key, en orden. fn no debe usar el árbol.
+    template<typename Fn>
+    void for_each(Fn&& fn) {
+        const std::scoped_lock lock(latch);
+        if (header.root != 0)
+            walk<TK, TK>(header.root, nullptr, nullptr, fn);
+    }
+
+    // Llama a fn(key) para cada key en [begin, end], en orden. fn no debe usar el árbol.
+    template<typename K1, typename K2, typename Fn>
+    void for_each_in_range(const K1& begin, const K2& end, Fn&& fn) {
+        const LookupKey<K1>& lo = begin;
+        const LookupKey<K2>& hi = end;
+        const std::scoped_lock lock(latch);
+
+        if (header.root != 0)
+            walk(header.root, &lo, &hi, fn);
+    }
+
+    void clear() {
+        std::unique_lock lock(latch);
+        if (log == nullptr)
+            begin_write();
+        clear_pages();
+        if (log != nullptr)
+            commit(lock, true, log_clear, {});
+    }
+
+    // Escribe al archivo todas las páginas modificadas y la página 0, y espera a que lleguen al
+    // disco. Con log es un checkpoint, y el log queda vacío.
+    void flush() {
+        const std::scoped_lock lock(latch);
+        if (log != nullptr)
+            checkpoint();
+        else
+            flush_pages();
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        const std::scoped_lock lock(latch);
+        return header.size;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size() == 0;
+    }
+
+    [[nodiscard]] std::ptrdiff_t height() {
+        const std::scoped_lock lock(latch);
+        std::ptrdiff_t height = -1;
+        for (PageId id = header.root; id != 0;) {
+            const NodeRef node = fetch(id);
+            ++height;
+            id = node->leaf ? 0 : node->children[0];
+        }
+        return height;
+    }
+
+    [[nodiscard]] bool check_properties() {
+        const std::scoped_lock lock(latch);
+        if (header.root == 0)
+            return true;
+
+        auto fetch_child = [this](const PageId id) { return fetch(id); };
+        const NodeRef root = fetch(header.root);
+        return node_ops::check<M>(*root, true, min_keys, nullptr, nullptr, comp, fetch_child) >= 0;
+    }
+};
+
+#endif
@@ -0,0 +1,520 @@
+#ifndef PERSISTENT_BTREE_H
+#define PERSISTENT_BTREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "node.h"
+#include "node_ops.h"
+#include "node_search.h"
+
+// Nodo compartido entre versiones de PersistentBTree. Una vez publicado no cambia nunca; refs
+// cuenta cuántos padres (o versiones, si es raíz) lo apuntan.
+template<typename TK, std::size_t Order>
+struct alignas(cache_line_size) SharedNode {
+    static_assert(Order >= 3, "order must be greater than 2");
+
+    std::atomic<std::size_t> refs{1};
+    std::size_t count = 0;
+    bool leaf = true;
+    TK keys[Order - 1]{};
+    SharedNode* children[Order]{};
+};
+
+// Árbol B (solo keys) persistente: insert y remove no modifican ningún nodo publicado, sino que
+// copian el camino desde la raíz hasta la hoja que cambian (y los hermanos que usen para
+// rebalancear), comparten todos los demás nodos con la versión anterior y publican la raíz nueva
+// de forma atómica.
+//
+// snapshot() retorna una foto del árbol en ese momento, que se puede leer desde cualquier hilo
+// por todo el tiempo que haga falta sin frenar a los escritores. Los escritores solo se esperan
+// entre ellos. Cada nodo lleva la cuenta de cuántos padres lo apuntan y se libera cuando ninguna
+// versión viva (la actual o la de algún snapshot) puede llegar a él.
+template<typename TK,
+         std::size_t Order = 64,
+         typename Compare = std::less<TK>,
+         typename Search = DefaultNodeSearch>
+class PersistentBTree {
+    using BNode = SharedNode<TK, Order>;
+
+    static constexpr std::size_t M = Order;
+    static constexpr std::size_t min_keys = (M - 1) / 2;
+
+    static constexpr bool transparent = requires { typename Compare::is_transparent; };
+
+    template<typename K>
+    using LookupKey = std::conditional_t<transparent, K, TK>;
+
+    static constexpr std::size_t max_depth = max_tree_depth((Order + 1) / 2);
+
+    struct Frame {
+        BNode* node;
+        std::size_t idx;
+    };
+
+    static void acquire(BNode* const node) {
+        if (node != nullptr)
+            node->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Suelta una referencia a node. El que suelta la última lo libera, junto con su referencia a
+    // cada child.
+    static void release(BNode* const node) {
+        if (node == nullptr || node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+
+        if (!node->leaf)
+            for (std::size_t i = 0; i < node->count + 1; ++i)
+                release(node->children[i]);
+
+        delete node;
+    }
+
+    // Copia privada de node, todavía sin publicar. Sus children quedan apuntados también por la
+    // copia.
+    static BNode* clone(const BNode* const node) {
+        auto* const copy = new BNode();
+        copy->leaf = node->leaf;
+        copy->count = node->count;
+        std::copy(node->keys, node->keys + node->count, copy->keys);
+
+        if (!node->leaf) {
+            std::copy(node->children, node->children + node->count + 1, copy->children);
+            for (std::size_t i = 0; i < node->count + 1; ++i)
+                acquire(copy->children[i]);
+        }
+
+        return copy;
+    }
+
+    // Deja en children[i] de node (que ya es privado) un nodo que se puede modificar. Un child
+    // con una sola referencia solo lo apunta node, así que nadie más lo ve: es una copia hecha
+    // por esta misma escritura.
+    static BNode* own_child(BNode* const node, const std::size_t i) {
+        BNode* const child = node->children[i];
+        if (child->refs.load(std::memory_order_acquire) == 1)
+            return child;
+
+        BNode* const copy = clone(child);
+        release(child);
+        node->children[i] = copy;
+        return copy;
+    }
+
+    // Raíz y cantidad de keys de una versión publicada. Al destruirse suelta su referencia a la
+    // raíz.
+    struct Version {
+        BNode* root;
+        std::size_t size;
+
+        Version(BNode* const root, const std::size_t size)
+            : root(root),
+              size(size) {}
+
+        Version(const Version&) = delete;
+
+        Version& operator=(const Version&) = delete;
+
+        ~Version() {
+            release(root);
+        }
+    };
+
+    using VersionPtr = std::shared_ptr<const Version>;
+
+    template<typename K>
+    static std::size_t rank(const BNode* const node, const K& key, const Compare& comp) {
+        return Search::template rank<M - 1>(node->keys, node->count, key, comp);
+    }
+
+    template<typename K>
+    static bool matches(const BNode* const node,
+                        const std::size_t idx,
+                        const K& key,
+                        const Compare& comp) {
+        return idx < node->count && !comp(key, node->keys[idx]);
+    }
+
+    template<typename K>
+    static bool contains(const BNode* node, const K& key, const Compare& comp) {
+        while (node != nullptr) {
+            const std::size_t idx = rank(node, key, comp);
+            if (matches(node, idx, key, comp))
+                return true;
+
+            node = node->leaf ? nullptr : node->children[idx];
+        }
+
+        return false;
+    }
+
+    // Llama a fn(key) para cada key desde lo (o desde la primera, si no hay lo) hasta hi (o hasta
+    // la última), en orden. Cada frame guarda la próxima key a entregar de su nodo; las de
+    // children[idx] ya se entregaron o quedan antes de lo.
+    template<typename K1, typename K2, typename Fn>
+    static void walk(const BNode* const root,
+                     const Compare& comp,
+                     const K1* const lo,
+                     const K2* const hi,
+                     Fn& fn) {
+        struct WalkFrame {
+            const BNode* node;
+            std::size_t idx;
+        };
+
+        WalkFrame stack[max_depth];
+        std::size_t depth = 0;
+
+        for (const BNode* node = root; node != nullptr;) {
+            const std::size_t idx = lo != nullptr ? rank(node, *lo, comp) : 0;
+            stack[depth++] = {node, idx};
+
+            if ((lo != nullptr && matches(node, idx, *lo, comp)) || node->leaf)
+                break;
+            node = node->children[idx];
+        }
+
+        while (depth > 0) {
+            auto& [node, idx] = stack[depth - 1];
+            if (idx == node->count) {
+                --depth;
+                continue;
+            }
+
+            const TK& key = node->keys[idx];
+            if (hi != nullptr && comp(*hi, key))
+                return;
+            fn(key);
+
+            ++idx;
+            if (!node->leaf)
+                for (const BNode* child = node->children[idx]; child != nullptr;
+                     child = child->leaf ? nullptr : child->children[0])
+                    stack[depth++] = {child, 0};
+        }
+    }
+
+    static bool check_properties(const BNode* const root, const Compare& comp) {
+        auto fetch = [](const BNode* const child) { return child; };
+        return root == nullptr ||
+               node_ops::check<M>(*root, true, min_keys, nullptr, nullptr, comp, fetch) >= 0;
+    }
+
+    static std::ptrdiff_t height(const BNode* node) {
+        std::ptrdiff_t height = -1;
+        for (; node != nullptr; node = node->leaf ? nullptr : node->children[0])
+            ++height;
+        return height;
+    }
+
+    // node (privado) está lleno y le falta entry en la posición i, con left como children[i].
+    // Retorna el nodo nuevo de la izquierda.
+    static BNode* split(BNode* const node, const std::size_t i, TK& entry, BNode* const left) {
+        auto* const lsplit = new BNode();
+        node_ops::split<M>(*node, *lsplit, i, entry, left);
+        return lsplit;
+    }
+
+    // children[i] (privado) absorbe el separador y una copia de children[i + 1], que puede seguir
+    // compartido con otras versiones; node suelta su referencia a él
+    static void merge_children(BNode* const node, const std::size_t i) {
+        BNode* const right = node->children[i + 1];
+        node_ops::merge(*node, i, *node->children[i], std::as_const(*right));
+
+        if (!right->leaf)
+            for (std::size_t k = 0; k < right->count + 1; ++k)
+                acquire(right->children[k]);
+
+        release(right);
+    }
+
+    [[no_unique_address]] Compare comp;
+
+    std::atomic<VersionPtr> current;
+    std::mutex write_mutex;
+
+    VersionPtr load() const {
+        return current.load(std::memory_order_acquire);
+    }
+
+    void publish(BNode* const root, const std::size_t size) {
+        current.store(std::make_shared<const Version>(root, size), std::memory_order_release);
+    }
+
+public:
+    // Foto de solo lectura del árbol. Comparte sus nodos con el árbol y con los otros snapshots,
+    // y sigue siendo válida (incluso si el árbol ya se destruyó) hasta que se destruye.
+    class Snapshot {
+        friend class PersistentBTree;
+
+        VersionPtr version;
+        [[no_unique_address]] Compare comp;
+
+        Snapshot(VersionPtr version, const Compare& comp)
+            : version(std::move(version)),
+              comp(comp) {}
+
+    public:
+        template<typename K>
+        [[nodiscard]] bool search(const K& key) const {
+            const LookupKey<K>& k = key;
+            return contains(version->root, k, comp);
+        }
+
+        // Llama a fn(key) para cada key, en orden
+        template<typename Fn>
+        void for_each(Fn&& fn) const {
+            walk<TK, TK>(version->root, comp, nullptr, nullptr, fn);
+        }
+
+        // Llama a fn(key) para cada key en [begin, end], en orden
+        template<typename K1, typename K2, typename Fn>
+        void for_each_in_range(const K1& begin, const K2& end, Fn&& fn) const {
+            const LookupKey<K1>& lo = begin;
+            const LookupKey<K2>& hi = end;
+            walk(version->root, comp, &lo, &hi, fn);
+        }
+
+        [[nodiscard]] const TK& minKey() const {
+            const BNode* node = version->root;
+            if (node == nullptr)
+                throw std::runtime_error("BTree is empty");
+
+            while (!node->leaf)
+                node = node->children[0];
+            return node->keys[0];
+        }
+
+        [[nodiscard]] const TK& maxKey() const {
+            const BNode* node = version->root;
+            if (node == nullptr)
+                throw std::runtime_error("BTree is empty");
+
+            while (!node->leaf)
+                node = node->children[node->count];
+            return node->keys[node->count - 1];
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return version->size;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return version->size == 0;
+        }
+
+        [[nodiscard]] std::ptrdiff_t height() const {
+            return PersistentBTree::height(version->root);
+        }
+
+        [[nodiscard]] bool check_properties() const {
+            return PersistentBTree::check_properties(version->root, comp);
+        }
+    };
+
+    PersistentBTree()
+        : current(std::make_shared<const Version>(nullptr, 0)) {}
+
+    explicit PersistentBTree(const Compare& comp)
+        : comp(comp),
+          current(std::make_shared<const Version>(nullptr, 0)) {}
+
+    PersistentBTree(const PersistentBTree&) = delete;
+
+    PersistentBTree& operator=(const PersistentBTree&) = delete;
+
+    ~PersistentBTree() = default;
+
+    // Foto de la última versión publicada. Cuesta lo mismo que copiar un shared_ptr.
+    [[nodiscard]] Snapshot snapshot() const {
+        return Snapshot(load(), comp);
+    }
+
+    template<typename K>
+    [[nodiscard]] bool search(const K& key) const {
+        const LookupKey<K>& k = key;
+        return contains(load()->root, k, comp);
+    }
+
+    // Inserta key si no está. Retorna si se insertó.
+    bool insert(TK key) {
+        const std::lock_guard<std::mutex> lock(write_mutex);
+
+        const VersionPtr base = load();
+        if (contains(base->root, key, comp))
+            return false;
+
+        if (base->root == nullptr) {
+            auto* const leaf = new BNode();
+            leaf->keys[0] = std::move(key);
+            leaf->count = 1;
+
+            publish(leaf, 1);
+            return true;
+        }
+
+        // Copia el camino hasta la hoja donde va key
+        BNode* root = clone(base->root);
+        Frame path[max_depth];
+        std::size_t depth = 0;
+
+        for (BNode* node = root;;) {
+            const std::size_t idx = rank(node, key, comp);
+            path[depth++] = {node, idx};
+
+            if (node->leaf)
+                break;
+            node = own_child(node, idx);
+        }
+
+        TK entry = std::move(key);
+        BNode* left = nullptr;
+        bool grown = true;
+
+        for (std::size_t d = depth; d-- > 0;) {
+            const auto [cur, i] = path[d];
+
+            if (cur->count < M - 1) {
+                cur->children[cur->count + 1] = cur->children[cur->count];
+                for (std::size_t j = cur->count; j > i; --j) {
+                    cur->keys[j] = std::move(cur->keys[j - 1]);
+                    cur->children[j] = cur->children[j - 1];
+                }
+
+                cur->keys[i] = std::move(entry);
+                cur->children[i] = left;
+                ++cur->count;
+
+                grown = false;
+                break;
+            }
+
+            left = split(cur, i, entry, left);
+        }
+
+        if (grown) {
+            auto* const new_root = new BNode();
+            new_root->leaf = false;
+            new_root->keys[0] = std::move(entry);
+            new_root->count = 1;
+            new_root->children[0] = left;
+            new_root->children[1] = root;
+            root = new_root;
+        }
+
+        publish(root, base->size + 1);
+        return true;
+    }
+
+    // Borra key si está. Retorna si se borró.
+    template<typename K>
+    bool remove(const K& key) {
+        const LookupKey<K>& k = key;
+
+        const std::lock_guard<std::mutex> lock(write_mutex);
+
+        const VersionPtr base = load();
+        if (!contains(base->root, k, comp))
+            return false;
+
+        // Copia el camino hasta key y, si key está en un nodo interno, sigue por el borde derecho
+        // del child de la izquierda hasta la hoja con su predecesor
+        BNode* root = clone(base->root);
+        Frame path[max_depth];
+        std::size_t depth = 0;
+        std::size_t anchor = max_depth;
+
+        for (BNode* node = root;;) {
+            std::size_t idx = 0;
+            if (anchor != max_depth) {
+                idx = node->leaf ? node->count - 1 : node->count;
+            } else {
+                idx = rank(node, k, comp);
+                if (matches(node, idx, k, comp) && !node->leaf)
+                    anchor = depth;
+            }
+
+            path[depth++] = {node, idx};
+
+            if (node->leaf)
+                break;
+            node = own_child(node, idx);
+        }
+
+        BNode* const leaf = path[depth - 1].node;
+        const std::size_t pos = path[depth - 1].idx;
+
+        if (anchor != max_depth)
+            path[anchor].node->keys[path[anchor].idx] = std::move(leaf->keys[pos]);
+
+        for (std::size_t j = pos; j + 1 < leaf->count; ++j)
+            leaf->keys[j] = std::move(leaf->keys[j + 1]);
+        --leaf->count;
+
+        // Sube arreglando los nodos que quedaron bajo el mínimo. El hermano que presta keys se
+        // copia antes de tocarlo; el que se absorbe en un merge solo se lee.
+        for (std::size_t d = depth - 1; d > 0; --d) {
+            if (path[d].node->count >= min_keys)
+                break;
+
+            const auto [parent, i] = path[d - 1];
+
+            if (i > 0) {
+                if (parent->children[i - 1]->count > min_keys) {
+                    node_ops::borrow_left(*parent, i, *path[d].node, *own_child(parent, i - 1));
+                    break;
+                }
+
+                own_child(parent, i - 1);
+                merge_children(parent, i - 1);
+            } else {
+                if (parent->children[i + 1]->count > min_keys) {
+                    node_ops::borrow_right(*parent, i, *path[d].node, *own_child(parent, i + 1));
+                    break;
+                }
+
+                merge_children(parent, i);
+            }
+        }
+
+        // Una raíz vacía se reemplaza por su único child (o por nada, si era hoja)
+        if (root->count == 0) {
+            BNode* const old_root = root;
+            root = old_root->leaf ? nullptr : old_root->children[0];
+            acquire(root);
+            release(old_root);
+        }
+
+        publish(root, base->size - 1);
+        return true;
+    }
+
+    void clear() {
+        const std::lock_guard<std::mutex> lock(write_mutex);
+        publish(nullptr, 0);
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return load()->size;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size() == 0;
+    }
+
+    [[nodiscard]] std::ptrdiff_t height() const {
+        return height(load()->root);
+    }
+
+    [[nodiscard]] bool check_properties() const {
+        return check_properties(load()->root, comp);
+    }
+};
+
+#endif
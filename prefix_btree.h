@@ -0,0 +1,863 @@
+#ifndef PREFIX_BTREE_H
+#define PREFIX_BTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "node.h"
+
+// Nodo de PrefixBTree: un bloque de NodeBytes bytes. data empieza con los children (solo en nodos
+// internos), sigue la tabla de offsets (count + 1 entradas) y después el prefijo común de todas las
+// keys del nodo, guardado una sola vez, y los sufijos pegados uno tras otro. El sufijo i ocupa
+// [offsets[i], offsets[i + 1]) contando desde el final del prefijo.
+template<std::size_t NodeBytes>
+struct alignas(cache_line_size) PrefixNode {
+    static constexpr std::size_t header_bytes = 16;
+    static constexpr std::size_t data_bytes = NodeBytes - header_bytes;
+
+    static_assert(NodeBytes % cache_line_size == 0 && NodeBytes <= 65536,
+                  "node size must be a multiple of the cache line and fit 16-bit offsets");
+
+    std::uint16_t count = 0;  // Keys de una hoja, o separadores de un nodo interno
+    std::uint16_t prefix = 0;
+    bool leaf = true;
+    PrefixNode* next = nullptr;  // Hoja siguiente en orden
+    std::byte data[data_bytes];
+
+    PrefixNode** children() {
+        return reinterpret_cast<PrefixNode**>(data);
+    }
+
+    PrefixNode* const* children() const {
+        return reinterpret_cast<PrefixNode* const*>(data);
+    }
+
+    std::uint16_t* offsets() {
+        const std::size_t table = leaf ? 0 : sizeof(PrefixNode*) * (count + 1);
+        return reinterpret_cast<std::uint16_t*>(data + table);
+    }
+
+    const std::uint16_t* offsets() const {
+        return const_cast<PrefixNode*>(this)->offsets();
+    }
+
+    char* prefix_data() {
+        return reinterpret_cast<char*>(offsets() + count + 1);
+    }
+
+    const char* prefix_data() const {
+        return reinterpret_cast<const char*>(offsets() + count + 1);
+    }
+
+    [[nodiscard]] std::string_view prefix_view() const {
+        return {prefix_data(), prefix};
+    }
+
+    [[nodiscard]] std::string_view suffix(const std::size_t i) const {
+        const std::uint16_t* const off = offsets();
+        return {prefix_data() + prefix + off[i], static_cast<std::size_t>(off[i + 1] - off[i])};
+    }
+
+    // Bytes de data en uso
+    [[nodiscard]] std::size_t used() const {
+        return reinterpret_cast<const std::byte*>(prefix_data()) - data + prefix + offsets()[count];
+    }
+};
+
+// Árbol B+ de strings con los nodos comprimidos. Cada nodo guarda una sola vez el prefijo común de
+// sus keys y los sufijos en un área contigua con una tabla de offsets, así que keys como URLs o
+// paths, que comparten prefijos largos, ocupan una fracción de lo que ocupa un std::string cada
+// una, y caben muchas más por nodo. Buscar dentro de un nodo compara primero con el prefijo y
+// después solo los sufijos.
+//
+// Como en BPlusTree, las keys viven en las hojas (enlazadas en orden) y los nodos internos guardan
+// separadores: children[i] < keys[i] <= children[i + 1]. Con TruncateSeparators, el separador
+// entre dos hojas es el prefijo más corto que las distingue, no una key completa.
+//
+// Los nodos se llenan por bytes y no por cantidad de keys: uno se parte cuando no le entra una key
+// más, y se junta con (o le pide keys a) un hermano cuando usa menos de un cuarto de su espacio.
+// Las keys se ordenan byte a byte, igual que std::string, así que no hay comparador.
+template<std::size_t NodeBytes = 1024, bool TruncateSeparators = true>
+class PrefixBTree {
+    using PNode = PrefixNode<NodeBytes>;
+
+    static constexpr std::size_t capacity = PNode::data_bytes;
+    static constexpr std::size_t min_bytes = capacity / 4;
+
+    // Los nodos son de tamaño variable en bytes, así que solo se cuenta con que cada nodo interno
+    // tiene al menos dos children
+    static constexpr std::size_t max_depth = max_tree_depth(2);
+
+public:
+    // Con keys de este largo o menos, un nodo interno siempre tiene lugar para tres separadores
+    static constexpr std::size_t max_key_size =
+        (capacity - 4 * sizeof(PNode*) - 4 * sizeof(std::uint16_t)) / 3;
+
+private:
+    // Nodo interno por el que se bajó y el índice del child que se tomó
+    struct Frame {
+        PNode* node;
+        std::size_t idx;
+    };
+
+    // Contenido de un nodo con las keys completas, para rearmarlo (o repartirlo entre varios)
+    // cuando cambia más que una key de una hoja
+    struct Draft {
+        bool leaf = true;
+        std::string bytes;
+        std::vector<std::size_t> ends;
+        std::vector<PNode*> children;
+
+        [[nodiscard]] std::size_t count() const {
+            return ends.size();
+        }
+
+        [[nodiscard]] std::size_t start(const std::size_t i) const {
+            return i == 0 ? 0 : ends[i - 1];
+        }
+
+        [[nodiscard]] std::string_view key(const std::size_t i) const {
+            return std::string_view(bytes).substr(start(i), ends[i] - start(i));
+        }
+
+        void insert(const std::size_t i, const std::string_view key) {
+            bytes.insert(start(i), key);
+            ends.insert(ends.begin() + static_cast<std::ptrdiff_t>(i), start(i));
+            for (std::size_t j = i; j < ends.size(); ++j)
+                ends[j] += key.size();
+        }
+
+        void erase(const std::size_t i, const std::size_t keys = 1) {
+            const std::size_t from = start(i);
+            const std::size_t len = start(i + keys) - from;
+            bytes.erase(from, len);
+            ends.erase(ends.begin() + static_cast<std::ptrdiff_t>(i),
+                       ends.begin() + static_cast<std::ptrdiff_t>(i + keys));
+            for (std::size_t j = i; j < ends.size(); ++j)
+                ends[j] -= len;
+        }
+
+        void append(const std::string_view key) {
+            bytes += key;
+            ends.push_back(bytes.size());
+        }
+
+        void append(const PNode* const node) {
+            for (std::size_t i = 0; i < node->count; ++i) {
+                bytes += node->prefix_view();
+                bytes += node->suffix(i);
+                ends.push_back(bytes.size());
+            }
+            if (!node->leaf)
+                children.insert(children.end(), node->children(),
+                                node->children() + node->count + 1);
+        }
+    };
+
+    PNode* root = nullptr;
+    std::size_t n = 0;
+    std::size_t nodes = 0;
+
+    static std::size_t common_prefix(const std::string_view a, const std::string_view b) {
+        const std::size_t len = std::min(a.size(), b.size());
+        const auto end = a.begin() + static_cast<std::ptrdiff_t>(len);
+        return static_cast<std::size_t>(std::mismatch(a.begin(), end, b.begin()).first - a.begin());
+    }
+
+    // Posición de key respecto del prefijo del nodo: < 0 si es menor que todas sus keys, > 0 si es
+    // mayor que todas, y 0 si empieza con el prefijo
+    static int against_prefix(const PNode* const node, const std::string_view key) {
+        const std::string_view prefix = node->prefix_view();
+        const std::size_t len = std::min(prefix.size(), key.size());
+        if (const int c = key.substr(0, len).compare(prefix.substr(0, len)); c != 0)
+            return c;
+        return key.size() < prefix.size() ? -1 : 0;
+    }
+
+    // Índice de la primera key >= key (o > key, con Upper)
+    template<bool Upper>
+    static std::size_t bound(const PNode* const node, const std::string_view key) {
+        if (const int c = against_prefix(node, key); c != 0)
+            return c < 0 ? 0 : node->count;
+
+        const std::string_view rest = key.substr(node->prefix);
+        std::size_t lo = 0;
+        std::size_t hi = node->count;
+        while (lo < hi) {
+            const std::size_t mid = lo + (hi - lo) / 2;
+            const int c = node->suffix(mid).compare(rest);
+            if (Upper ? c <= 0 : c < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    static bool matches(const PNode* const node, const std::size_t i, const std::string_view key) {
+        return i < node->count && key.size() >= node->prefix &&
+               key.substr(node->prefix) == node->suffix(i) &&
+               key.substr(0, node->prefix) == node->prefix_view();
+    }
+
+    static std::string key_at(const PNode* const node, const std::size_t i) {
+        std::string key(node->prefix_view());
+        key += node->suffix(i);
+        return key;
+    }
+
+    PNode* allocate(const bool leaf) {
+        auto* const node = new PNode;
+        node->leaf = leaf;
+        ++nodes;
+        return node;
+    }
+
+    void release(PNode* const node) {
+        delete node;
+        --nodes;
+    }
+
+    void free_tree(PNode* const node) {
+        if (!node->leaf)
+            for (std::size_t i = 0; i <= node->count; ++i)
+                free_tree(node->children()[i]);
+        release(node);
+    }
+
+    // Bytes que ocupan las keys [a, b) de d (y sus children) escritas en un nodo
+    static std::size_t encoded_size(const Draft& d, const std::size_t a, const std::size_t b) {
+        const std::size_t keys = b - a;
+        const std::size_t table =
+            (d.leaf ? 0 : sizeof(PNode*) * (keys + 1)) + sizeof(std::uint16_t) * (keys + 1);
+        if (keys == 0)
+            return table;
+
+        const std::size_t prefix = common_prefix(d.key(a), d.key(b - 1));
+        return table + prefix + (d.start(b) - d.start(a)) - keys * prefix;
+    }
+
+    // Escribe en node las keys [a, b) de d y, en un nodo interno, los children [a, b]
+    static void encode(PNode* const node,
+                       const Draft& d,
+                       const std::size_t a,
+                       const std::size_t b) {
+        const std::size_t keys = b - a;
+        const std::size_t prefix = keys == 0 ? 0 : common_prefix(d.key(a), d.key(b - 1));
+
+        node->leaf = d.leaf;
+        node->count = static_cast<std::uint16_t>(keys);
+        node->prefix = static_cast<std::uint16_t>(prefix);
+        if (!d.leaf)
+            std::copy(d.children.begin() + static_cast<std::ptrdiff_t>(a),
+                      d.children.begin() + static_cast<std::ptrdiff_t>(b + 1), node->children());
+
+        std::uint16_t* const off = node->offsets();
+        char* const out = node->prefix_data();
+        if (keys > 0)
+            std::memcpy(out, d.key(a).data(), prefix);
+
+        std::size_t at = 0;
+        for (std::size_t i = a; i < b; ++i) {
+            const std::string_view key = d.key(i);
+            off[i - a] = static_cast<std::uint16_t>(at);
+            std::memcpy(out + prefix + at, key.data() + prefix, key.size() - prefix);
+            at += key.size() - prefix;
+        }
+        off[keys] = static_cast<std::uint16_t>(at);
+    }
+
+    // Rangos [first, last) de keys en que se reparte d para que cada uno entre en un nodo. En un
+    // nodo interno, la key entre un rango y el siguiente es el separador que sube al padre.
+    static std::vector<std::pair<std::size_t, std::size_t>> partition(const Draft& d) {
+        const std::size_t count = d.count();
+        const std::size_t gap = d.leaf ? 0 : 1;
+        if (encoded_size(d, 0, count) <= capacity)
+            return {{0, count}};
+
+        // Dos mitades lo más parejas posible
+        std::size_t best = 0;
+        std::size_t best_size = ~std::size_t{0};
+        for (std::size_t s = d.leaf ? 1 : 0; s < count; ++s) {
+            const std::size_t size =
+                std::max(encoded_size(d, 0, s), encoded_size(d, s + gap, count));
+            if (size < best_size) {
+                best = s;
+                best_size = size;
+            }
+        }
+        if (best_size <= capacity)
+            return {{0, best}, {best + gap, count}};
+
+        // Si no alcanza con dos, se llenan nodos de izquierda a derecha
+        std::vector<std::pair<std::size_t, std::size_t>> parts;
+        for (std::size_t a = 0;;) {
+            std::size_t b = a + 1;
+            while (b < count && encoded_size(d, a, b + 1) <= capacity)
+                ++b;
+            parts.emplace_back(a, std::min(b, count));
+            if (b + gap > count || (d.leaf && b == count))
+                return parts;
+            a = b + gap;
+        }
+    }
+
+    // Separador entre dos hojas vecinas: la primera key de la derecha, o con TruncateSeparators
+    // su prefijo más corto que es mayor que la última key de la izquierda
+    static std::string_view separator(const std::string_view left, const std::string_view right) {
+        if constexpr (TruncateSeparators)
+            return right.substr(0, common_prefix(left, right) + 1);
+        else
+            return right;
+    }
+
+    // d es el nuevo contenido de node, que está en la profundidad depth del camino path. Lo
+    // escribe, partiéndolo si no entra en un nodo o juntándolo con un hermano si quedó muy vacío,
+    // y sigue hacia arriba mientras los padres cambien.
+    void settle(Frame* const path, const std::size_t depth, PNode* const node, const Draft& d) {
+        const auto parts = partition(d);
+
+        if (parts.size() == 1) {
+            if (depth > 0 && encoded_size(d, 0, d.count()) < min_bytes) {
+                rebalance(path, depth, d);
+                return;
+            }
+
+            encode(node, d, 0, d.count());
+            if (depth == 0 && node->count == 0) {
+                root = node->leaf ? nullptr : node->children()[0];
+                release(node);
+            }
+            return;
+        }
+
+        std::vector<PNode*> out{node};
+        std::vector<std::string_view> seps;
+        for (std::size_t j = 0; j < parts.size(); ++j) {
+            if (j > 0) {
+                PNode* const next = allocate(d.leaf);
+                next->next = std::exchange(out.back()->next, d.leaf ? next : nullptr);
+                out.push_back(next);
+                seps.push_back(d.leaf ? separator(d.key(parts[j - 1].second - 1),
+                                                  d.key(parts[j].first))
+                                      : d.key(parts[j - 1].second));
+            }
+            encode(out[j], d, parts[j].first, parts[j].second);
+        }
+
+        if (depth == 0) {
+            root = allocate(false);
+            Draft top;
+            top.leaf = false;
+            for (const std::string_view sep : seps)
+                top.append(sep);
+            top.children = std::move(out);
+            settle(path, 0, root, top);
+            return;
+        }
+
+        replace(path, depth - 1, path[depth - 1].idx, 1, out, seps);
+    }
+
+    // En el nodo path[level], cambia los children [first, first + removed) (y los separadores
+    // entre ellos) por nodes, con seps entre uno y otro
+    void replace(Frame* const path,
+                 const std::size_t level,
+                 const std::size_t first,
+                 const std::size_t removed,
+                 const std::vector<PNode*>& nodes,
+                 const std::vector<std::string_view>& seps) {
+        PNode* const parent = path[level].node;
+        Draft d;
+        d.leaf = false;
+        d.append(parent);
+
+        d.erase(first, removed - 1);
+        d.children.erase(d.children.begin() + static_cast<std::ptrdiff_t>(first),
+                         d.children.begin() + static_cast<std::ptrdiff_t>(first + removed));
+        for (std::size_t j = 0; j < seps.size(); ++j)
+            d.insert(first + j, seps[j]);
+        d.children.insert(d.children.begin() + static_cast<std::ptrdiff_t>(first), nodes.begin(),
+                          nodes.end());
+
+        settle(path, level, parent, d);
+    }
+
+    // El nodo en la profundidad depth quedó con contenido d, que usa menos de min_bytes. Se junta
+    // con un hermano si entran los dos en un nodo; si no, se reparten entre ambos.
+    void rebalance(Frame* const path, const std::size_t depth, const Draft& d) {
+        PNode* const parent = path[depth - 1].node;
+        const std::size_t i = path[depth - 1].idx;
+        const std::size_t first = i > 0 ? i - 1 : i;
+        PNode* const left = parent->children()[first];
+        PNode* const right = parent->children()[first + 1];
+        const std::string sep = key_at(parent, first);
+
+        Draft both;
+        both.leaf = d.leaf;
+        const auto add_draft = [&] {
+            for (std::size_t k = 0; k < d.count(); ++k)
+                both.append(d.key(k));
+            both.children.insert(both.children.end(), d.children.begin(), d.children.end());
+        };
+
+        if (i > 0)
+            both.append(left);
+        else
+            add_draft();
+        if (!d.leaf)
+            both.append(sep);
+        if (i > 0)
+            add_draft();
+        else
+            both.append(right);
+
+        if (encoded_size(both, 0, both.count()) <= capacity) {
+            encode(left, both, 0, both.count());
+            if (both.leaf)
+                left->next = right->next;
+            release(right);
+            replace(path, depth - 1, first, 2, {left}, {});
+            return;
+        }
+
+        const auto parts = partition(both);
+        std::vector<PNode*> out{left, right};
+        std::vector<std::string_view> seps;
+        for (std::size_t j = 0; j < parts.size(); ++j) {
+            if (j > 1) {
+                PNode* const next = allocate(both.leaf);
+                next->next = std::exchange(out.back()->next, both.leaf ? next : nullptr);
+                out.push_back(next);
+            }
+            if (j > 0)
+                seps.push_back(both.leaf ? separator(both.key(parts[j - 1].second - 1),
+                                                     both.key(parts[j].first))
+                                         : both.key(parts[j - 1].second));
+            encode(out[j], both, parts[j].first, parts[j].second);
+        }
+
+        replace(path, depth - 1, first, 2, out, seps);
+    }
+
+    // Inserta key en la posición i de la hoja sin rearmarla. Retorna false si key no empieza con
+    // el prefijo de la hoja o no hay lugar.
+    static bool insert_in_place(PNode* const node,
+                                const std::size_t i,
+                                const std::string_view key) {
+        const std::size_t prefix = node->prefix;
+        if (key.substr(0, prefix) != node->prefix_view() ||
+            node->used() + sizeof(std::uint16_t) + key.size() - prefix > capacity)
+            return false;
+
+        const std::size_t len = key.size() - prefix;
+        std::uint16_t* const off = node->offsets();
+        const std::size_t count = node->count;
+        const std::size_t at = off[i];
+        const std::size_t total = off[count];
+
+        // La tabla crece una entrada: todo lo que sigue se corre dos bytes, y los sufijos desde el
+        // i además dejan lugar al nuevo. Se mueve de atrás hacia adelante.
+        char* const base = node->prefix_data();
+        char* const suffixes = base + prefix;
+        char* const moved = suffixes + sizeof(std::uint16_t);
+        std::memmove(moved + at + len, suffixes + at, total - at);
+        std::memmove(moved, suffixes, at);
+        std::memmove(base + sizeof(std::uint16_t), base, prefix);
+        std::memcpy(moved + at, key.data() + prefix, len);
+
+        for (std::size_t j = count + 1; j > i + 1; --j)
+            off[j] = static_cast<std::uint16_t>(off[j - 1] + len);
+        off[i + 1] = static_cast<std::uint16_t>(at + len);
+        ++node->count;
+        return true;
+    }
+
+    // Saca la key i de la hoja sin rearmarla. El prefijo sigue siendo común a las que quedan.
+    static void erase_in_place(PNode* const node, const std::size_t i) {
+        std::uint16_t* const off = node->offsets();
+        const std::size_t count = node->count;
+        const std::size_t at = off[i];
+        const std::size_t len = off[i + 1] - at;
+        const std::size_t total = off[count];
+        char* const base = node->prefix_data();
+        char* const suffixes = base + node->prefix;
+
+        for (std::size_t j = i + 1; j < count; ++j)
+            off[j] = static_cast<std::uint16_t>(off[j + 1] - len);
+
+        // Al revés que en insert_in_place: se mueve de adelante hacia atrás
+        std::memmove(base - sizeof(std::uint16_t), base, node->prefix);
+        std::memmove(suffixes - sizeof(std::uint16_t), suffixes, at);
+        std::memmove(suffixes - sizeof(std::uint16_t) + at, suffixes + at + len, total - at - len);
+        --node->count;
+    }
+
+    // Baja hasta la hoja donde está (o estaría) key, anotando el camino
+    PNode* descend(const std::string_view key, Frame* const path, std::size_t& depth) const {
+        PNode* node = root;
+        depth = 0;
+        while (!node->leaf) {
+            const std::size_t i = bound<true>(node, key);
+            path[depth++] = {node, i};
+            node = node->children()[i];
+        }
+        return node;
+    }
+
+    const PNode* leftmost() const {
+        const PNode* node = root;
+        while (!node->leaf)
+            node = node->children()[0];
+        return node;
+    }
+
+    // Revisa el subárbol de node con sus keys en [lo, hi) (sin cota si es nullptr). Retorna su
+    // altura, o -1 si algo no se cumple. prev_leaf es la última hoja visitada.
+    std::ptrdiff_t check_properties(const PNode* const node,
+                                    const bool is_root,
+                                    const std::string* const lo,
+                                    const std::string* const hi,
+                                    const PNode*& prev_leaf,
+                                    std::size_t& keys) const {
+        if (node->used() > capacity || (!is_root && node->leaf && node->count == 0))
+            return -1;
+
+        std::vector<std::string> all;
+        for (std::size_t i = 0; i < node->count; ++i) {
+            all.push_back(key_at(node, i));
+            if ((i > 0 && all[i - 1] >= all[i]) || (lo != nullptr && all[i] < *lo) ||
+                (hi != nullptr && all[i] >= *hi))
+                return -1;
+        }
+
+        if (node->leaf) {
+            if (prev_leaf != nullptr && prev_leaf->next != node)
+                return -1;
+            prev_leaf = node;
+            keys += node->count;
+            return 0;
+        }
+
+        std::ptrdiff_t height = -1;
+        for (std::size_t i = 0; i <= node->count; ++i) {
+            const std::ptrdiff_t sub = check_properties(
+                node->children()[i], false, i == 0 ? lo : &all[i - 1],
+                i == node->count ? hi : &all[i], prev_leaf, keys);
+            if (sub < 0 || (i > 0 && sub != height))
+                return -1;
+            height = sub;
+        }
+        return height + 1;
+    }
+
+public:
+    // Iterador en orden por la lista de hojas. Cada key se arma (prefijo y sufijo) al llegar a
+    // ella y queda dentro del iterador, así que la referencia vale mientras el iterador no avance.
+    // Cualquier insert o remove invalida los iteradores.
+    class const_iterator {
+        friend class PrefixBTree;
+
+        const PNode* leaf = nullptr;
+        std::size_t pos = 0;
+        std::string key;
+
+        const_iterator(const PNode* const leaf, const std::size_t pos)
+            : leaf(leaf),
+              pos(pos) {
+            if (this->leaf != nullptr && this->pos == this->leaf->count) {
+                this->leaf = this->leaf->next;
+                this->pos = 0;
+            }
+            load();
+        }
+
+        void load() {
+            if (leaf != nullptr) {
+                key.assign(leaf->prefix_view());
+                key += leaf->suffix(pos);
+            }
+        }
+
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string;
+        using difference_type = std::ptrdiff_t;
+        using reference = const std::string&;
+        using pointer = const std::string*;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            return key;
+        }
+
+        pointer operator->() const {
+            return &key;
+        }
+
+        const_iterator& operator++() {
+            if (++pos == leaf->count) {
+                leaf = leaf->next;
+                pos = 0;
+            }
+            load();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) {
+            return a.leaf == b.leaf && a.pos == b.pos;
+        }
+    };
+
+    using iterator = const_iterator;
+
+    // Vista sobre un tramo de keys: solo guarda los iteradores de los extremos
+    class Range {
+        const_iterator first;
+        const_iterator last;
+
+    public:
+        Range(const_iterator first, const_iterator last)
+            : first(std::move(first)),
+              last(std::move(last)) {}
+
+        [[nodiscard]] const_iterator begin() const {
+            return first;
+        }
+
+        [[nodiscard]] const_iterator end() const {
+            return last;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return first == last;
+        }
+    };
+
+    PrefixBTree() = default;
+
+    PrefixBTree(const PrefixBTree&) = delete;
+
+    PrefixBTree(PrefixBTree&& other) noexcept
+        : root(std::exchange(other.root, nullptr)),
+          n(std::exchange(other.n, 0)),
+          nodes(std::exchange(other.nodes, 0)) {}
+
+    PrefixBTree& operator=(const PrefixBTree&) = delete;
+
+    PrefixBTree& operator=(PrefixBTree&& other) noexcept {
+        std::swap(root, other.root);
+        std::swap(n, other.n);
+        std::swap(nodes, other.nodes);
+        return *this;
+    }
+
+    ~PrefixBTree() {
+        clear();
+    }
+
+    [[nodiscard]] bool search(const std::string_view key) const {
+        if (root == nullptr)
+            return false;
+
+        const PNode* node = root;
+        while (!node->leaf)
+            node = node->children()[bound<true>(node, key)];
+        return matches(node, bound<false>(node, key), key);
+    }
+
+    // Lanza std::length_error si key tiene más de max_key_size bytes
+    void insert(const std::string_view key) {
+        if (key.size() > max_key_size)
+            throw std::length_error("key too long for PrefixBTree");
+
+        if (root == nullptr) {
+            root = allocate(true);
+            Draft d;
+            d.append(key);
+            encode(root, d, 0, 1);
+            n = 1;
+            return;
+        }
+
+        Frame path[max_depth];
+        std::size_t depth = 0;
+        PNode* const leaf = descend(key, path, depth);
+        const std::size_t i = bound<false>(leaf, key);
+        if (matches(leaf, i, key))
+            return;
+
+        ++n;
+        if (insert_in_place(leaf, i, key))
+            return;
+
+        Draft d;
+        d.append(leaf);
+        d.insert(i, key);
+        settle(path, depth, leaf, d);
+    }
+
+    void remove(const std::string_view key) {
+        if (root == nullptr)
+            return;
+
+        Frame path[max_depth];
+        std::size_t depth = 0;
+        PNode* const leaf = descend(key, path, depth);
+        const std::size_t i = bound<false>(leaf, key);
+        if (!matches(leaf, i, key))
+            return;
+
+        --n;
+        const std::size_t freed = sizeof(std::uint16_t) + leaf->suffix(i).size();
+        if (depth == 0 || (leaf->count > 1 && leaf->used() - freed >= min_bytes)) {
+            erase_in_place(leaf, i);
+            if (leaf->count == 0) {
+                release(leaf);
+                root = nullptr;
+            }
+            return;
+        }
+
+        Draft d;
+        d.append(leaf);
+        d.erase(i);
+        settle(path, depth, leaf, d);
+    }
+
+    [[nodiscard]] const_iterator begin() const {
+        return root == nullptr ? const_iterator() : const_iterator(leftmost(), 0);
+    }
+
+    [[nodiscard]] const_iterator end() const {
+        return {};
+    }
+
+    // Primera key >= key, o end() si no hay
+    [[nodiscard]] const_iterator lower_bound(const std::string_view key) const {
+        if (root == nullptr)
+            return end();
+
+        Frame path[max_depth];
+        std::size_t depth = 0;
+        const PNode* const leaf = descend(key, path, depth);
+        return const_iterator(leaf, bound<false>(leaf, key));
+    }
+
+    // Primera key > key, o end() si no hay
+    [[nodiscard]] const_iterator upper_bound(const std::string_view key) const {
+        if (root == nullptr)
+            return end();
+
+        Frame path[max_depth];
+        std::size_t depth = 0;
+        const PNode* const leaf = descend(key, path, depth);
+        return const_iterator(leaf, bound<true>(leaf, key));
+    }
+
+    // Keys en [begin, end], en orden
+    [[nodiscard]] Range range(const std::string_view begin, const std::string_view end) const {
+        if (end < begin)
+            return {this->end(), this->end()};
+        return {lower_bound(begin), upper_bound(end)};
+    }
+
+    // Llama a fn(key) para cada key, en orden, con un std::string_view que solo vale durante la
+    // llamada. Evita armar un std::string por key.
+    template<typename Fn>
+    void for_each(Fn&& fn) const {
+        if (root == nullptr)
+            return;
+
+        std::string key;
+        for (const PNode* leaf = leftmost(); leaf != nullptr; leaf = leaf->next) {
+            key.assign(leaf->prefix_view());
+            for (std::size_t i = 0; i < leaf->count; ++i) {
+                key.resize(leaf->prefix);
+                key += leaf->suffix(i);
+                fn(std::string_view(key));
+            }
+        }
+    }
+
+    [[nodiscard]] std::string minKey() const {
+        if (root == nullptr)
+            throw std::runtime_error("PrefixBTree is empty");
+
+        return key_at(leftmost(), 0);
+    }
+
+    [[nodiscard]] std::string maxKey() const {
+        if (root == nullptr)
+            throw std::runtime_error("PrefixBTree is empty");
+
+        const PNode* node = root;
+        while (!node->leaf)
+            node = node->children()[node->count];
+        return key_at(node, node->count - 1);
+    }
+
+    [[nodiscard]] std::ptrdiff_t height() const {
+        std::ptrdiff_t height = -1;
+        for (const PNode* node = root; node != nullptr;
+             node = node->leaf ? nullptr : node->children()[0])
+            ++height;
+        return height;
+    }
+
+    [[nodiscard]] std::string toString(const std::string& sep) const {
+        std::string result;
+        for_each([&](const std::string_view key) {
+            if (!result.empty())
+                result += sep;
+            result += key;
+        });
+        return result;
+    }
+
+    void clear() {
+        if (root != nullptr)
+            free_tree(std::exchange(root, nullptr));
+        n = 0;
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return n;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return n == 0;
+    }
+
+    // Bytes ocupados por los nodos
+    [[nodiscard]] std::size_t memory_usage() const {
+        return nodes * sizeof(PNode);
+    }
+
+    [[nodiscard]] bool check_properties() const {
+        if (root == nullptr)
+            return n == 0 && nodes == 0;
+
+        const PNode* last_leaf = nullptr;
+        std::size_t keys = 0;
+        return check_properties(root, true, nullptr, nullptr, last_leaf, keys) >= 0 &&
+               last_leaf->next == nullptr && keys == n;
+    }
+};
+
+#endif
@@ -0,0 +1,1956 @@
+// Tests de los árboles, aparte de main.cpp (que no se modifica). Cada test compara contra
+// std::set, std::map o un vector ordenado y usa el ASSERT de tester.h.
+//
+// No hay sistema de build: se compila a mano desde la raíz del repo, por ejemplo con
+//
+//     g++ -std=c++20 -O1 -fsanitize=address,undefined -pthread tests/btree_tests.cpp -o btree_tests
+//
+// Con -DBTREE_STATS se revisan además los contadores de BTreeCounters. Sin argumentos corre todos
+// los tests; con argumentos, solo los que se nombran. Termina con código 1 si falló algún ASSERT.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../bench/harness.h"
+#include "../bplus_tree.h"
+#include "../btree.h"
+#include "../btree_map.h"
+#include "../buffered_btree.h"
+#include "../concurrent_btree.h"
+#include "../frozen_btree.h"
+#include "../mapped_btree.h"
+#include "../paged_btree.h"
+#include "../persistent_btree.h"
+#include "../prefix_btree.h"
+#include "../tester.h"
+
+namespace tests {
+    namespace fs = std::filesystem;
+
+    // Si tree tiene exactamente las keys de expected, en el mismo orden
+    template<typename Tree, typename Expected>
+    bool same_keys(const Tree& tree, const Expected& expected) {
+        return tree.size() == expected.size() &&
+               std::equal(tree.begin(), tree.end(), expected.begin(), expected.end());
+    }
+
+    // Inserta y borra keys al azar en tree y en expected a la vez
+    template<typename Tree>
+    void random_ops(Tree& tree,
+                    std::set<int>& expected,
+                    const int ops,
+                    const int max_key,
+                    const unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> keys(0, max_key - 1);
+        for (int i = 0; i < ops; i++) {
+            const int key = keys(rng);
+            if (rng() % 5 < 3) {
+                tree.insert(key);
+                expected.insert(key);
+            } else {
+                tree.remove(key);
+                expected.erase(key);
+            }
+        }
+    }
+
+    // Directorio temporal propio de un test, que se borra al terminar
+    class TempDir {
+        fs::path dir;
+
+    public:
+        explicit TempDir(const std::string& name)
+            : dir(fs::temp_directory_path() / ("btree_tests_" + name)) {
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+        }
+
+        TempDir(const TempDir&) = delete;
+        TempDir& operator=(const TempDir&) = delete;
+
+        ~TempDir() {
+            std::error_code ignored;
+            fs::remove_all(dir, ignored);
+        }
+
+        [[nodiscard]] std::string path(const std::string& name) const {
+            return (dir / name).string();
+        }
+
+        // Copia name mientras el árbol sigue abierto, como lo dejaría un proceso que termina en
+        // ese momento
+        [[nodiscard]] std::string crash_copy(const std::string& name) const {
+            fs::copy_file(dir / name, dir / ("crashed_" + name));
+            return path("crashed_" + name);
+        }
+    };
+
+    template<std::size_t M>
+    void fixed_order_with() {
+        BTree<int, M> tree;
+        std::set<int> expected;
+        random_ops(tree, expected, 30000, 5000, M);
+
+        ASSERT(tree.check_properties() && same_keys(tree, expected),
+               "BTree<int, " + std::to_string(M) + "> does not match std::set");
+    }
+
+    // El orden fijo da los mismos resultados que el dinámico, con M chico, par e impar
+    void fixed_order() {
+        fixed_order_with<3>();
+        fixed_order_with<8>();
+        fixed_order_with<33>();
+
+        BTree<int> dynamic(8);
+        BTree<int, 8> fixed;
+        std::set<int> expected_dynamic, expected_fixed;
+        random_ops(dynamic, expected_dynamic, 30000, 5000, 1);
+        random_ops(fixed, expected_fixed, 30000, 5000, 1);
+        ASSERT(dynamic.toString(",") == fixed.toString(",") && dynamic.height() == fixed.height(),
+               "BTree<int, 8> and BTree<int>(8) differ after the same operations");
+    }
+
+    // Arrays ordenados de todos los largos hasta algo más de dos bloques de AVX-512, con los
+    // extremos del tipo. Cada array tiene justo count elementos, así que ASan marca cualquier
+    // lectura más allá.
+    template<typename T>
+    bool simd_rank_matches(std::mt19937& rng) {
+        const T low = std::numeric_limits<T>::lowest();
+        const T high = std::numeric_limits<T>::max();
+        std::uniform_int_distribution<int> values(-1000, 1000);
+
+        for (std::size_t count = 0; count <= 40; ++count) {
+            std::set<T> distinct;
+            if (count > 0)
+                distinct.insert(low);
+            if (count > 1)
+                distinct.insert(high);
+            while (distinct.size() < count)
+                distinct.insert(static_cast<T>(values(rng)));
+            const std::vector<T> keys(distinct.begin(), distinct.end());
+
+            std::vector<T> queries = {low, high, T{0}, static_cast<T>(-1), static_cast<T>(1)};
+            for (const T key : keys) {
+                queries.push_back(key);
+                if (key != low)
+                    queries.push_back(key - 1);
+                if (key != high)
+                    queries.push_back(key + 1);
+            }
+
+            for (const T key : queries) {
+                const auto expected = static_cast<std::size_t>(
+                    std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+                if (SimdNodeSearch::rank<0>(keys.data(), count, key, std::less<T>()) != expected)
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    // El rank vectorial coincide con lower_bound para cada tipo que tiene kernel, y un árbol con
+    // SimdNodeSearch queda igual que uno con LinearNodeSearch
+    void simd_search() {
+        std::mt19937 rng(2);
+        ASSERT(simd_rank_matches<std::int32_t>(rng), "SimdNodeSearch rank is wrong for int32_t");
+        ASSERT(simd_rank_matches<std::int64_t>(rng), "SimdNodeSearch rank is wrong for int64_t");
+        ASSERT(simd_rank_matches<float>(rng), "SimdNodeSearch rank is wrong for float");
+        ASSERT(simd_rank_matches<double>(rng), "SimdNodeSearch rank is wrong for double");
+
+        BTree<int, 24, std::less<int>, SimdNodeSearch> simd;
+        BTree<int, 24, std::less<int>, LinearNodeSearch> linear;
+        std::set<int> expected_simd, expected_linear;
+        random_ops(simd, expected_simd, 30000, 5000, 2);
+        random_ops(linear, expected_linear, 30000, 5000, 2);
+        ASSERT(simd.check_properties() && same_keys(simd, expected_simd) &&
+                   simd.toString(",") == linear.toString(","),
+               "BTree with SimdNodeSearch differs from LinearNodeSearch");
+    }
+
+    // Key que lleva la cuenta de cuántas hay vivas, para ver que el pool destruye todas
+    struct TrackedKey {
+        static inline int live = 0;
+        static inline int constructed = 0;
+        int value = 0;
+
+        TrackedKey() {
+            ++live;
+            ++constructed;
+        }
+
+        TrackedKey(const int value)  // NOLINT(google-explicit-constructor)
+            : value(value) {
+            ++live;
+            ++constructed;
+        }
+
+        TrackedKey(const TrackedKey& other)
+            : value(other.value) {
+            ++live;
+            ++constructed;
+        }
+
+        TrackedKey& operator=(const TrackedKey& other) = default;
+
+        ~TrackedKey() {
+            --live;
+        }
+
+        bool operator<(const TrackedKey& other) const {
+            return value < other.value;
+        }
+    };
+
+    // Los bloques están alineados a cache line y un nodo destruido se reutiliza. Con keys que
+    // necesitan destructor, clear() y el destructor del árbol las destruyen todas; con keys
+    // triviales, los chunks se sueltan sin visitar nodos (ASan avisaría si quedara alguno).
+    void pool() {
+        NodePool<int, dynamic_order> nodes(OrderValue<dynamic_order>{7});
+        bool fresh = nodes.block_bytes() % cache_line_size == 0;
+        std::vector<Node<int, dynamic_order>*> created;
+        for (int i = 0; i < 100; i++) {
+            auto* const node = nodes.create();
+            fresh = fresh && reinterpret_cast<std::uintptr_t>(node) % cache_line_size == 0 &&
+                    node->count == 0 && node->leaf &&
+                    std::all_of(node->keys, node->keys + 6, [](int key) { return key == 0; }) &&
+                    std::all_of(node->children, node->children + 7,
+                                [](auto* child) { return child == nullptr; });
+            created.push_back(node);
+        }
+        nodes.destroy(created[42]);
+        ASSERT(fresh && nodes.create() == created[42],
+               "NodePool blocks are not aligned, not empty or not reused");
+        nodes.clear(nullptr);
+
+        {
+            BTree<TrackedKey> tree(5);
+            for (int i = 0; i < 5000; i++)
+                tree.insert(i * 31 % 5000);
+            for (int i = 0; i < 5000; i += 3)
+                tree.remove(i);
+            tree.clear();
+            ASSERT(TrackedKey::live == 0 && tree.size() == 0, "BTree::clear leaves live keys");
+
+            for (int i = 0; i < 5000; i++)
+                tree.insert(i);
+        }
+        ASSERT(TrackedKey::live == 0, "BTree destructor leaves live keys");
+
+        BTree<std::string, 6> strings;
+        std::set<std::string> expected;
+        for (int i = 0; i < 5000; i++) {
+            const std::string key = "key" + std::to_string(i * 7 % 3000);
+            if (i % 4 == 3) {
+                strings.remove(key);
+                expected.erase(key);
+            } else {
+                strings.insert(key);
+                expected.insert(key);
+            }
+        }
+        ASSERT(strings.check_properties() && same_keys(strings, expected),
+               "BTree<std::string> does not match std::set");
+    }
+
+    // El árbol armado de abajo hacia arriba es válido, tiene las keys en orden y sigue
+    // funcionando con insert y remove, para todos los tamaños chicos (donde el último nodo de cada
+    // nivel es el que se complica) y uno grande. Con fill = 1 las hojas quedan casi llenas.
+    void bulk_build() {
+        bool valid = true;
+        for (const std::size_t M : {3, 4, 7, 64}) {
+            for (const double fill : {1.0, 0.7, 0.5}) {
+                for (int size = 0; size <= 300; size++) {
+                    std::vector<int> keys(static_cast<std::size_t>(size));
+                    for (int i = 0; i < size; i++)
+                        keys[static_cast<std::size_t>(i)] = i * 2;
+
+                    const std::unique_ptr<BTree<int>> tree(
+                        BTree<int>::build_from_ordered_vector(keys, M, fill));
+                    valid = valid && tree->check_properties() && same_keys(*tree, keys);
+                }
+            }
+        }
+        ASSERT(valid, "build_from_ordered_vector builds a wrong tree for some small size");
+
+        std::vector<int> keys(100000);
+        for (int i = 0; i < 100000; i++)
+            keys[static_cast<std::size_t>(i)] = i * 2;
+        const std::unique_ptr<BTree<int, 16>> tree(BTree<int, 16>::build_from_ordered_vector(keys));
+        ASSERT(tree->check_properties() && same_keys(*tree, keys) &&
+                   tree->analyze().levels.back().fill > 0.95,
+               "build_from_ordered_vector with fill 1 does not fill the leaves");
+
+        std::set<int> expected(keys.begin(), keys.end());
+        random_ops(*tree, expected, 50000, 200000, 4);
+        ASSERT(tree->check_properties() && same_keys(*tree, expected),
+               "a bulk-built tree breaks after inserts and removes");
+
+        std::vector<std::string> strings;
+        for (int i = 0; i < 1000; i++)
+            strings.push_back("key" + std::to_string(100000 + i));
+        const std::vector<std::string> copy = strings;
+        const auto first = std::make_move_iterator(strings.begin());
+        const auto last = std::make_move_iterator(strings.end());
+        const std::unique_ptr<BTree<std::string>> moved(
+            BTree<std::string>::build_from_ordered_range(first, last, 5));
+        ASSERT(moved->check_properties() && same_keys(*moved, copy),
+               "build_from_ordered_range with move iterators loses keys");
+    }
+
+    // Si a y b tienen las mismas keys repartidas en la misma cantidad de nodos por nivel
+    template<typename Tree>
+    bool same_shape(const Tree& a, const Tree& b) {
+        const BTreeStats x = a.analyze();
+        const BTreeStats y = b.analyze();
+        return x.height == y.height && x.levels.size() == y.levels.size() &&
+               std::equal(x.levels.begin(), x.levels.end(), y.levels.begin(),
+                          [](const BTreeLevelStats& l, const BTreeLevelStats& r) {
+                              return l.nodes == r.nodes && l.keys == r.keys;
+                          }) &&
+               std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+    // El build paralelo da el mismo árbol que el secuencial, con niveles lo bastante anchos como
+    // para repartirse entre hilos y con cualquier cantidad de hilos
+    void parallel_build() {
+        std::vector<int> keys(300000);
+        for (int i = 0; i < 300000; i++)
+            keys[static_cast<std::size_t>(i)] = i * 3;
+
+        bool same = true;
+        for (const double fill : {1.0, 0.6}) {
+            const std::unique_ptr<BTree<int>> sequential(
+                BTree<int>::build_from_ordered_vector(keys, 8, fill));
+            for (const std::size_t threads : {1, 2, 3, 8, 0}) {
+                const std::unique_ptr<BTree<int>> parallel(
+                    BTree<int>::parallel_build_from_ordered_vector(keys, 8, threads, fill));
+                same = same && parallel->check_properties() && same_shape(*sequential, *parallel);
+            }
+        }
+        ASSERT(same, "parallel_build_from_ordered_vector differs from the sequential build");
+
+        std::vector<std::string> strings;
+        for (int i = 0; i < 50000; i++)
+            strings.push_back("key" + std::to_string(100000 + i));
+        const std::unique_ptr<BTree<std::string, 5>> sequential(
+            BTree<std::string, 5>::build_from_ordered_vector(strings));
+        const std::unique_ptr<BTree<std::string, 5>> parallel(
+            BTree<std::string, 5>::parallel_build_from_ordered_vector(std::move(strings), 4));
+        ASSERT(parallel->check_properties() && same_shape(*sequential, *parallel),
+               "parallel_build_from_ordered_vector with moved strings differs");
+
+        std::set<int> expected(keys.begin(), keys.end());
+        const std::unique_ptr<BTree<int>> tree(
+            BTree<int>::parallel_build_from_ordered_vector(keys, 8, 4));
+        random_ops(*tree, expected, 50000, 900000, 5);
+        ASSERT(tree->check_properties() && same_keys(*tree, expected),
+               "a tree built in parallel breaks after inserts and removes");
+    }
+
+    // search_batch y find_batch responden lo mismo que search y lower_bound, ordenando o no, con
+    // keys repetidas, ausentes y tandas de cualquier tamaño
+    void batched_lookup() {
+        BTree<int, 16> tree;
+        std::set<int> expected;
+        random_ops(tree, expected, 40000, 20000, 6);
+
+        std::mt19937 rng(6);
+        std::uniform_int_distribution<int> keys(-10, 20010);
+        bool same = true;
+        for (const std::size_t size : {0, 1, 2, 7, 64, 1000}) {
+            std::vector<int> batch(size);
+            for (int& key : batch)
+                key = keys(rng);
+            if (size > 1)
+                batch[size - 1] = batch[0];
+
+            for (const bool sort : {false, true}) {
+                const auto found = std::make_unique<bool[]>(size + 1);
+                std::vector<const int*> pointers(size);
+                tree.search_batch(batch, std::span<bool>(found.get(), size), sort);
+                tree.find_batch(batch, pointers, sort);
+
+                for (std::size_t i = 0; i < size; ++i) {
+                    const bool present = expected.contains(batch[i]);
+                    same = same && found[i] == present &&
+                           pointers[i] == (present ? &*tree.lower_bound(batch[i]) : nullptr);
+                }
+            }
+        }
+        ASSERT(same, "search_batch or find_batch differ from search");
+
+        bool rejected = false;
+        try {
+            std::vector<const int*> small(1);
+            tree.find_batch(std::vector<int>{1, 2}, small);
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        ASSERT(rejected, "find_batch accepts an output smaller than its keys");
+    }
+
+    // range(lo, hi) recorre exactamente las keys en [lo, hi], con cotas que están o no en el
+    // árbol, fuera de sus extremos, iguales o invertidas. Con M = 3 casi todas las keys están en
+    // el borde de un nodo.
+    void range_view() {
+        BTree<int, 3> tree;
+        std::set<int> expected;
+        random_ops(tree, expected, 20000, 3000, 7);
+
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<int> bounds(-50, 3050);
+        bool same = true;
+        for (int i = 0; i < 3000; i++) {
+            const int lo = bounds(rng);
+            const int hi = i % 10 == 0 ? lo : bounds(rng);
+            const auto first = expected.lower_bound(lo);
+            const auto last = lo <= hi ? expected.upper_bound(hi) : first;
+
+            const auto range = tree.range(lo, hi);
+            same = same && std::equal(range.begin(), range.end(), first, last) &&
+                   range.empty() == (first == last);
+        }
+        ASSERT(same, "range(lo, hi) does not visit exactly the keys in [lo, hi]");
+
+        std::vector<int> prefix;
+        for (const int key : tree.rangeSearch(100, 2000)) {
+            if (prefix.size() == 5)
+                break;
+            prefix.push_back(key);
+        }
+        const std::vector<int> expected_prefix(
+            expected.lower_bound(100), std::next(expected.lower_bound(100), 5));
+        ASSERT(prefix == expected_prefix, "stopping early in rangeSearch gives the wrong keys");
+
+        const BTree<int> empty(5);
+        ASSERT(empty.range(0, 100).empty() && tree.range(5000, 6000).empty() &&
+                   tree.range(-100, -1).empty(),
+               "a range with no keys is not empty");
+    }
+
+    // Los iteradores recorren en orden hacia adelante y hacia atrás, también en un árbol más alto
+    // que los niveles que guardan sin reservar memoria, y lower_bound y upper_bound caen donde en
+    // std::set
+    void iterators() {
+        static_assert(std::bidirectional_iterator<BTree<int>::const_iterator>);
+
+        BTree<int, 3> tree;
+        std::set<int> expected;
+        random_ops(tree, expected, 150000, 100000, 8);
+        ASSERT(tree.height() > 8, "the iterator test tree is not deep enough");
+
+        ASSERT(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()) &&
+                   std::equal(tree.rbegin(), tree.rend(), expected.rbegin(), expected.rend()),
+               "iterating a BTree forward or backward gives the wrong keys");
+
+        bool backward = true;
+        auto it = tree.end();
+        for (auto set_it = expected.end(); set_it != expected.begin();) {
+            --it;
+            --set_it;
+            backward = backward && *it == *set_it;
+        }
+        ASSERT(backward && it == tree.begin(), "decrementing from end() gives the wrong keys");
+
+        std::mt19937 rng(8);
+        std::uniform_int_distribution<int> keys(-10, 100010);
+        bool bounds = true;
+        for (int i = 0; i < 5000; i++) {
+            const int key = keys(rng);
+            const auto lower = tree.lower_bound(key);
+            const auto upper = tree.upper_bound(key);
+            const auto set_lower = expected.lower_bound(key);
+            const auto set_upper = expected.upper_bound(key);
+
+            bounds = bounds && (lower == tree.end()) == (set_lower == expected.end()) &&
+                     (set_lower == expected.end() || *lower == *set_lower) &&
+                     (upper == tree.end()) == (set_upper == expected.end()) &&
+                     (set_upper == expected.end() || *upper == *set_upper);
+
+            // De un bound se puede seguir en cualquier dirección
+            if (lower != tree.begin() && set_lower != expected.begin())
+                bounds = bounds && *std::prev(lower) == *std::prev(set_lower);
+        }
+        ASSERT(bounds, "lower_bound or upper_bound differ from std::set");
+
+        const BTree<int> empty(4);
+        ASSERT(empty.begin() == empty.end() && empty.lower_bound(1) == empty.end(),
+               "an empty BTree has keys to iterate");
+    }
+
+    // Si map tiene exactamente los pares de expected, en orden
+    template<typename Map, typename Expected>
+    bool same_entries(const Map& map, const Expected& expected) {
+        if (map.size() != expected.size())
+            return false;
+
+        auto it = expected.begin();
+        for (const auto& [key, value] : map) {
+            if (key != it->first || value != it->second)
+                return false;
+            ++it;
+        }
+
+        return true;
+    }
+
+    // BTreeMap se comporta como std::map con cada forma de insertar, y los valores que solo se
+    // pueden mover siguen a sus keys en splits, préstamos y merges
+    void btree_map() {
+        BTreeMap<int, std::string, 4> map;
+        std::map<int, std::string> expected;
+        std::mt19937 rng(9);
+        std::uniform_int_distribution<int> keys(0, 2999);
+        bool inserted = true;
+        for (int i = 0; i < 40000; i++) {
+            const int key = keys(rng);
+            const std::string value = std::to_string(i);
+            switch (rng() % 6) {
+                case 0:
+                    inserted = inserted &&
+                               map.insert(key, value) == expected.emplace(key, value).second;
+                    break;
+                case 1:
+                    map.insert_or_assign(key, value);
+                    expected.insert_or_assign(key, value);
+                    break;
+                case 2:
+                    map[key] += "+";
+                    expected[key] += "+";
+                    break;
+                case 3:
+                    map.try_emplace(key, 3, 'x');
+                    expected.try_emplace(key, 3, 'x');
+                    break;
+                default:
+                    map.remove(key);
+                    expected.erase(key);
+            }
+        }
+        ASSERT(inserted && map.check_properties() && same_entries(map, expected),
+               "BTreeMap does not match std::map");
+
+        bool found = true;
+        for (int key = 0; key < 3000; key++) {
+            const std::string* const value = std::as_const(map).find(key);
+            const auto it = expected.find(key);
+            found = found && (it == expected.end() ? value == nullptr
+                                                   : value != nullptr && *value == it->second);
+        }
+        ASSERT(found, "BTreeMap::find differs from std::map");
+
+        BTreeMap<int, std::unique_ptr<int>> owners(3);
+        for (int i = 0; i < 5000; i++)
+            owners.insert(i * 7 % 5000, std::make_unique<int>(i * 7 % 5000));
+        for (int i = 0; i < 5000; i += 2)
+            owners.remove(i);
+
+        bool moved = owners.size() == 2500;
+        for (const auto& [key, value] : owners)
+            moved = moved && value != nullptr && *value == key && key % 2 == 1;
+        ASSERT(moved, "BTreeMap loses move-only values in splits or merges");
+    }
+
+    // Compara TrackedKey con ints sin construir un TrackedKey
+    struct TrackedLess {
+        using is_transparent = void;
+
+        bool operator()(const TrackedKey& a, const TrackedKey& b) const {
+            return a.value < b.value;
+        }
+
+        bool operator()(const TrackedKey& a, const int b) const {
+            return a.value < b;
+        }
+
+        bool operator()(const int a, const TrackedKey& b) const {
+            return a < b.value;
+        }
+    };
+
+    // Con un comparador transparente las búsquedas no construyen keys temporales, y una key que ya
+    // está no se construye al insertarla. Un comparador propio ordena al revés igual que en
+    // std::set, y std::string se busca con std::string_view y con literales.
+    void heterogeneous_lookup() {
+        BTree<TrackedKey, 5, TrackedLess> tracked;
+        for (int i = 0; i < 2000; i++)
+            tracked.insert(i * 2);
+
+        const int before = TrackedKey::constructed;
+        bool found = true;
+        for (int i = 0; i < 4000; i++)
+            found = found && tracked.search(i) == (i % 2 == 0);
+        found = found && tracked.lower_bound(7)->value == 8 &&
+                tracked.upper_bound(8)->value == 10 &&
+                std::distance(tracked.range(10, 20).begin(), tracked.range(10, 20).end()) == 6;
+        for (int i = 0; i < 2000; i++)
+            tracked.insert(i * 2);
+        tracked.remove(1);
+        ASSERT(found && TrackedKey::constructed == before,
+               "transparent lookups or repeated inserts construct keys");
+
+        tracked.remove(0);
+        ASSERT(!tracked.search(0) && tracked.size() == 1999 && tracked.check_properties(),
+               "remove with a transparent key does not remove it");
+
+        BTree<int, 6, std::greater<int>> descending;
+        std::set<int, std::greater<int>> expected;
+        std::mt19937 rng(10);
+        for (int i = 0; i < 20000; i++) {
+            const int key = static_cast<int>(rng() % 4000);
+            if (i % 3 == 2) {
+                descending.remove(key);
+                expected.erase(key);
+            } else {
+                descending.insert(key);
+                expected.insert(key);
+            }
+        }
+        ASSERT(descending.check_properties() && same_keys(descending, expected) &&
+                   *descending.lower_bound(2000) == *expected.lower_bound(2000),
+               "BTree with std::greater does not match std::set");
+
+        BTree<std::string, dynamic_order, std::less<>> strings(4);
+        for (int i = 0; i < 1000; i++)
+            strings.insert("key" + std::to_string(1000 + i));
+        const std::string_view view = "key1500";
+        strings.remove(std::string_view("key1001"));
+        ASSERT(strings.search(view) && strings.search("key1999") && !strings.search("key1001") &&
+                   !strings.search(std::string_view("key")) && *strings.lower_bound(view) == view &&
+                   std::distance(strings.range(view, "key1509").begin(),
+                                 strings.range(view, "key1509").end()) == 10,
+               "BTree<std::string, std::less<>> lookups by string_view are wrong");
+    }
+
+    // BPlusTree se comporta como std::set con hojas encadenadas que siguen bien enlazadas después
+    // de splits y merges, se recorre en ambas direcciones, se arma de abajo hacia arriba y escribe
+    // cualquier key formateable
+    void bplus_tree() {
+        BPlusTree<int, 4> fixed;
+        BPlusTree<int> dynamic(7);
+        std::set<int> expected_fixed, expected_dynamic;
+        random_ops(fixed, expected_fixed, 40000, 5000, 11);
+        random_ops(dynamic, expected_dynamic, 40000, 5000, 11);
+        ASSERT(fixed.check_properties() && same_keys(fixed, expected_fixed) &&
+                   std::equal(fixed.rbegin(), fixed.rend(), expected_fixed.rbegin(),
+                              expected_fixed.rend()) &&
+                   dynamic.check_properties() && same_keys(dynamic, expected_dynamic),
+               "BPlusTree does not match std::set");
+
+        bool bounds = true;
+        for (int key = -5; key < 5005; key += 3) {
+            const auto range = fixed.range(key, key + 40);
+            bounds = bounds &&
+                     std::equal(range.begin(), range.end(), expected_fixed.lower_bound(key),
+                                expected_fixed.upper_bound(key + 40)) &&
+                     fixed.search(key) == expected_fixed.contains(key);
+        }
+        ASSERT(bounds, "BPlusTree range or search differ from std::set");
+
+        std::vector<int> keys(10000);
+        for (int i = 0; i < 10000; i++)
+            keys[static_cast<std::size_t>(i)] = i;
+        const std::unique_ptr<BPlusTree<int>> built(
+            BPlusTree<int>::build_from_ordered_vector(keys, 5, 0.8));
+        ASSERT(built->check_properties() && same_keys(*built, keys) && built->minKey() == 0 &&
+                   built->maxKey() == 9999,
+               "BPlusTree::build_from_ordered_vector builds a wrong tree");
+
+        BPlusTree<std::string, 4> strings;
+        for (const char* const key : {"pera", "kiwi", "uva", "higo", "lima"})
+            strings.insert(std::string(key));
+        std::ostringstream os;
+        strings.write_to(os, " ");
+        ASSERT(strings.toString(",") == "higo,kiwi,lima,pera,uva" &&
+                   os.str() == "higo kiwi lima pera uva",
+               "BPlusTree<std::string> writes the wrong text");
+    }
+
+    // Inserta keys en el orden dado, validando el árbol después de cada una y al final la altura
+    template<typename Tree>
+    bool insert_all(Tree& tree, const std::vector<int>& keys, const std::size_t M) {
+        std::set<int> expected;
+        for (const int key : keys) {
+            tree.insert(key);
+            expected.insert(key);
+            if (!tree.check_properties() || tree.size() != expected.size())
+                return false;
+        }
+
+        // Con al menos ceil(M / 2) children por nodo interno y dos en la raíz
+        const double min_fanout = static_cast<double>((M + 1) / 2);
+        const double max_height =
+            1 + std::log(static_cast<double>(expected.size() + 1) / 2) / std::log(min_fanout);
+        return same_keys(tree, expected) && static_cast<double>(tree.height()) <= max_height;
+    }
+
+    // Insertar en orden creciente, decreciente, alternando extremos o con repetidas deja en cada
+    // paso un árbol válido, y nunca más alto que lo que permite el mínimo de keys por nodo
+    void insert_order() {
+        std::vector<std::vector<int>> orders(4);
+        for (int i = 0; i < 400; i++) {
+            orders[0].push_back(i);
+            orders[1].push_back(400 - i);
+            orders[2].push_back(i % 2 == 0 ? i : 1000 - i);
+            orders[3].push_back(i * 37 % 101);
+        }
+
+        bool valid = true;
+        for (const std::size_t M : {3, 4, 5, 6, 9}) {
+            for (const auto& keys : orders) {
+                BTree<int> tree(M);
+                valid = valid && insert_all(tree, keys, M);
+            }
+        }
+        BTree<int, 4> fixed;
+        valid = valid && insert_all(fixed, orders[2], 4);
+        ASSERT(valid, "inserting leaves an invalid or too tall tree");
+
+        BTree<std::string> strings(4);
+        std::string key = "movida";
+        strings.insert(std::move(key));
+        strings.insert(std::string("otra"));
+        const std::string copied = "copiada";
+        strings.insert(copied);
+        ASSERT(strings.toString(",") == "copiada,movida,otra" && copied == "copiada",
+               "inserting an lvalue, an rvalue or a temporary gives the wrong keys");
+    }
+
+    // Borrar en orden creciente, decreciente, al azar o keys que no están deja en cada paso un
+    // árbol válido con las keys que quedan, hasta vaciarlo y volver a usarlo. Con std::string, ASan
+    // avisa si una key se pierde o se destruye dos veces al reemplazarla por su predecesora.
+    void remove_order() {
+        std::vector<int> keys(500);
+        for (int i = 0; i < 500; i++)
+            keys[static_cast<std::size_t>(i)] = i * 2;
+
+        std::vector<std::vector<int>> orders = {keys, {keys.rbegin(), keys.rend()}, keys};
+        std::shuffle(orders[2].begin(), orders[2].end(), std::mt19937(13));
+
+        bool valid = true;
+        for (const std::size_t M : {3, 4, 5, 8}) {
+            for (const auto& order : orders) {
+                BTree<std::string> tree(M);
+                std::set<std::string> expected;
+                for (const int key : keys) {
+                    tree.insert(std::to_string(key));
+                    expected.insert(std::to_string(key));
+                }
+
+                for (const int key : order) {
+                    tree.remove(std::to_string(key + 1));
+                    tree.remove(std::to_string(key));
+                    expected.erase(std::to_string(key));
+                    valid = valid && tree.check_properties() && same_keys(tree, expected);
+                }
+
+                tree.insert(std::string("again"));
+                valid = valid && tree.size() == 1 && tree.search(std::string("again"));
+            }
+        }
+        ASSERT(valid, "removing leaves an invalid tree or the wrong keys");
+
+        BTree<int, 5> fixed;
+        std::set<int> expected;
+        random_ops(fixed, expected, 20000, 1000, 13);
+        for (int key = 0; key < 1000; key += 2) {
+            fixed.remove(key);
+            expected.erase(key);
+        }
+        ASSERT(fixed.check_properties() && same_keys(fixed, expected),
+               "removing from a fixed-order tree gives the wrong keys");
+    }
+
+    // insert_sorted y erase_sorted dejan las mismas keys que insertarlas o borrarlas una a una y
+    // retornan cuántas cambiaron, con tandas densas (que llenan hojas enteras), repetidas, que ya
+    // están o desordenadas
+    void sorted_runs() {
+        bool same = true;
+        std::mt19937 rng(14);
+        for (const std::size_t M : {3, 4, 9, 32}) {
+            CountedBTree<int> tree(M);
+            std::set<int> expected;
+            random_ops(tree, expected, 3000, 20000, 14);
+
+            for (int round = 0; round < 30; round++) {
+                const int start = static_cast<int>(rng() % 20000);
+                std::vector<int> run;
+                for (int k = 0; k < 600; k++)
+                    run.push_back(start + k * static_cast<int>(1 + round % 3));
+                if (round % 5 == 4)
+                    std::shuffle(run.begin(), run.end(), rng);
+                run.push_back(run.front());
+
+                std::size_t changed = 0;
+                if (round % 2 == 0) {
+                    for (const int key : run)
+                        changed += expected.insert(key).second ? 1 : 0;
+                    same = same && tree.insert_sorted(run.begin(), run.end()) == changed;
+                } else {
+                    for (const int key : run)
+                        changed += expected.erase(key);
+                    same = same && tree.erase_sorted(run.begin(), run.end()) == changed;
+                }
+                same = same && tree.check_properties() && same_keys(tree, expected);
+            }
+        }
+        ASSERT(same, "insert_sorted or erase_sorted differ from inserting one key at a time");
+
+        BTreeMap<int, std::string, 5> map;
+        std::vector<std::pair<int, std::string>> entries;
+        for (int i = 0; i < 2000; i++)
+            entries.emplace_back(i * 3, std::to_string(i));
+        map.insert(3, "primero");
+        const std::size_t inserted = map.insert_sorted(entries.begin(), entries.end());
+        ASSERT(inserted == 1999 && map.check_properties() && *map.find(3) == "primero" &&
+                   *map.find(5997) == "1999",
+               "BTreeMap::insert_sorted does not keep the first value of each key");
+    }
+
+    // Árbol de orden M con las keys de keys, insertadas una a una
+    template<typename Tree>
+    Tree tree_of(const std::size_t M, const std::set<int>& keys) {
+        Tree tree(M);
+        for (const int key : keys)
+            tree.insert(key);
+        return tree;
+    }
+
+    // split deja dos árboles válidos que se pueden seguir modificando y que join vuelve a unir,
+    // también con árboles de alturas muy distintas y con pivot. Unión, intersección y diferencia
+    // dan lo mismo que los algoritmos de <algorithm> sobre std::set.
+    void join_split() {
+        std::mt19937 rng(15);
+        bool valid = true;
+        for (const std::size_t M : {3, 4, 7}) {
+            std::set<int> keys;
+            for (int i = 0; i < 3000; i++)
+                keys.insert(static_cast<int>(rng() % 10000));
+
+            for (const int at : {-1, 0, 17, 5000, 9999, 20000}) {
+                auto tree = tree_of<BTree<int>>(M, keys);
+                auto [low, high] = tree.split(at);
+                const std::set<int> expected_low(keys.begin(), keys.lower_bound(at));
+                const std::set<int> expected_high(keys.lower_bound(at), keys.end());
+                valid = valid && tree.size() == 0 && low.check_properties() &&
+                        high.check_properties() && same_keys(low, expected_low) &&
+                        same_keys(high, expected_high);
+
+                low.insert(-5);
+                high.insert(30000);
+                low.remove(-5);
+                high.remove(30000);
+                const auto joined = BTree<int>::join(std::move(low), std::move(high));
+                valid = valid && joined.check_properties() && same_keys(joined, keys);
+            }
+
+            std::set<int> small = {-3, -2, -1};
+            auto tall = tree_of<BTree<int>>(M, keys);
+            const auto joined =
+                BTree<int>::join(tree_of<BTree<int>>(M, small), 0, std::move(tall));
+            small.insert(0);
+            small.insert(keys.begin(), keys.end());
+            valid = valid && joined.check_properties() && same_keys(joined, small);
+        }
+        ASSERT(valid, "split or join give the wrong trees");
+
+        bool rejected = false;
+        try {
+            BTree<int>::join(tree_of<BTree<int>>(4, {1, 5}), tree_of<BTree<int>>(4, {3}));
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        ASSERT(rejected, "join accepts overlapping trees");
+
+        std::set<int> a_keys, b_keys;
+        for (int i = 0; i < 5000; i++) {
+            a_keys.insert(static_cast<int>(rng() % 8000));
+            b_keys.insert(static_cast<int>(rng() % 8000) + 2000);
+        }
+        const auto a = tree_of<CountedBTree<int>>(5, a_keys);
+        const auto b = tree_of<CountedBTree<int>>(5, b_keys);
+        std::vector<int> united, common, only_a;
+        std::set_union(a_keys.begin(), a_keys.end(), b_keys.begin(), b_keys.end(),
+                       std::back_inserter(united));
+        std::set_intersection(a_keys.begin(), a_keys.end(), b_keys.begin(), b_keys.end(),
+                              std::back_inserter(common));
+        std::set_difference(a_keys.begin(), a_keys.end(), b_keys.begin(), b_keys.end(),
+                            std::back_inserter(only_a));
+
+        const auto u = CountedBTree<int>::merge_union(a, b);
+        const auto i = CountedBTree<int>::intersection(a, b);
+        const auto d = CountedBTree<int>::difference(a, b);
+        const auto none = CountedBTree<int>::intersection(a, CountedBTree<int>(5));
+        ASSERT(u.check_properties() && same_keys(u, united) && i.check_properties() &&
+                   same_keys(i, common) && d.check_properties() && same_keys(d, only_a) &&
+                   none.size() == 0 && same_keys(a, a_keys),
+               "merge_union, intersection or difference differ from <algorithm>");
+    }
+
+    // rank, select y count_range coinciden con contar en un vector ordenado, después de inserts,
+    // removes y un split (que tiene que dejar bien los tamaños de los subárboles)
+    void order_statistics() {
+        CountedBTree<int> tree(5);
+        std::set<int> expected;
+        random_ops(tree, expected, 30000, 8000, 16);
+
+        const auto matches = [](const CountedBTree<int>& counted, const std::set<int>& keys) {
+            const std::vector<int> sorted(keys.begin(), keys.end());
+            const auto below = [&](const int key) {
+                return static_cast<std::size_t>(
+                    std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin());
+            };
+            const auto upto = [&](const int key) {
+                return static_cast<std::size_t>(
+                    std::upper_bound(sorted.begin(), sorted.end(), key) - sorted.begin());
+            };
+
+            bool same =
+                counted.check_properties() && counted.select(sorted.size()) == counted.end();
+            for (std::size_t k = 0; k < sorted.size(); k += 7)
+                same = same && *counted.select(k) == sorted[k];
+            for (int key = -3; key < 8003; key += 5) {
+                const int hi = key + key % 200;
+                same = same && counted.rank(key) == below(key) &&
+                       counted.count_range(key, hi) == upto(hi) - below(key) &&
+                       counted.count_range(hi + 1, key) == 0;
+            }
+            return same;
+        };
+        ASSERT(matches(tree, expected), "rank, select or count_range are wrong");
+
+        auto [low, high] = tree.split(4000);
+        ASSERT(matches(low, std::set<int>(expected.begin(), expected.lower_bound(4000))) &&
+                   matches(high, std::set<int>(expected.lower_bound(4000), expected.end())),
+               "rank, select or count_range are wrong after split");
+    }
+
+    // Varios escritores, cada uno con sus propias keys (las ≡ w mod 4), insertan y borran mientras
+    // otros hilos leen. Cada insert y remove retorna lo mismo que en el std::set de su escritor, y
+    // al final el árbol tiene la unión de esos sets. Los lectores siempre encuentran las keys
+    // negativas, que nadie borra, nunca encuentran las que nadie inserta, y ven cada rango en
+    // orden. Sin escritores, todos los nodos retirados se terminan liberando.
+    void concurrent() {
+        constexpr int writers = 4;
+        ConcurrentBTree<int, 5> tree(std::less<int>(), 8);
+        for (int key = -1; key >= -2000; key--)
+            tree.insert(key);
+
+        std::vector<std::set<int>> owned(writers);
+        std::atomic<bool> done{false};
+        std::atomic<bool> consistent{true};
+        std::vector<std::thread> threads;
+
+        for (int w = 0; w < writers; w++) {
+            threads.emplace_back([&, w] {
+                std::mt19937 rng(static_cast<unsigned>(17 + w));
+                bool agrees = true;
+                for (int i = 0; i < 20000; i++) {
+                    const int key = static_cast<int>(rng() % 5000) * writers + w;
+                    if (rng() % 3 == 0)
+                        agrees = agrees && tree.remove(key) == (owned[w].erase(key) == 1);
+                    else
+                        agrees = agrees && tree.insert(key) == owned[w].insert(key).second;
+                }
+                if (!agrees)
+                    consistent = false;
+            });
+        }
+
+        for (int r = 0; r < 3; r++) {
+            threads.emplace_back([&, r] {
+                std::mt19937 rng(static_cast<unsigned>(170 + r));
+                bool agrees = true;
+                while (!done) {
+                    const int stable = -1 - static_cast<int>(rng() % 2000);
+                    agrees = agrees && tree.search(stable) && !tree.search(1000000 + stable);
+
+                    const int lo = static_cast<int>(rng() % 20000) - 1000;
+                    int previous = std::numeric_limits<int>::min();
+                    tree.for_each_in_range(lo, lo + 300, [&](const int key) {
+                        agrees = agrees && previous < key && lo <= key && key <= lo + 300;
+                        previous = key;
+                    });
+                }
+                if (!agrees)
+                    consistent = false;
+            });
+        }
+
+        for (int w = 0; w < writers; w++)
+            threads[static_cast<std::size_t>(w)].join();
+        done = true;
+        for (std::size_t t = writers; t < threads.size(); ++t)
+            threads[t].join();
+
+        std::set<int> expected;
+        for (int key = -1; key >= -2000; key--)
+            expected.insert(key);
+        for (const auto& keys : owned)
+            expected.insert(keys.begin(), keys.end());
+
+        std::vector<int> keys;
+        tree.for_each_in_range(std::numeric_limits<int>::min(), std::numeric_limits<int>::max(),
+                               [&](const int key) { keys.push_back(key); });
+        ASSERT(consistent && tree.check_properties() && tree.size() == expected.size() &&
+                   std::equal(keys.begin(), keys.end(), expected.begin(), expected.end()),
+               "ConcurrentBTree gives wrong results with concurrent readers and writers");
+
+        for (int i = 0; i < 3 && tree.pending_garbage() > 0; i++)
+            tree.collect_garbage();
+        ASSERT(tree.pending_garbage() == 0, "ConcurrentBTree does not free retired nodes");
+    }
+
+    // Cada snapshot sigue viendo exactamente las keys del momento en que se tomó, mientras el árbol
+    // cambia, después de clear() y después de destruir el árbol. Un hilo puede recorrer un snapshot
+    // mientras otro escribe. Con std::string, ASan avisa si un nodo compartido se libera antes de
+    // tiempo o nunca.
+    void snapshots() {
+        using Tree = PersistentBTree<std::string, 4>;
+        auto tree = std::make_unique<Tree>();
+        std::set<std::string> expected;
+        std::vector<std::pair<decltype(tree->snapshot()), std::set<std::string>>> taken;
+
+        const auto contents = [](const auto& snapshot) {
+            std::vector<std::string> keys;
+            snapshot.for_each([&](const std::string& key) { keys.push_back(key); });
+            return keys;
+        };
+        const auto unchanged = [&] {
+            bool same = true;
+            for (const auto& [snapshot, keys] : taken)
+                same = same && snapshot.check_properties() && snapshot.size() == keys.size() &&
+                       contents(snapshot) == std::vector<std::string>(keys.begin(), keys.end());
+            return same;
+        };
+
+        std::mt19937 rng(18);
+        for (int i = 0; i < 20000; i++) {
+            const std::string key = std::string(20, 'k') + std::to_string(rng() % 3000);
+            if (rng() % 3 == 0) {
+                tree->remove(key);
+                expected.erase(key);
+            } else {
+                tree->insert(key);
+                expected.insert(key);
+            }
+            if (i % 2500 == 0)
+                taken.emplace_back(tree->snapshot(), expected);
+        }
+        ASSERT(tree->check_properties() && tree->size() == expected.size() && unchanged(),
+               "PersistentBTree snapshots change after later writes");
+
+        std::atomic<bool> reader_ok{true};
+        const auto last = tree->snapshot();
+        const std::vector<std::string> last_keys(expected.begin(), expected.end());
+        std::thread reader([&] {
+            for (int i = 0; i < 20; i++)
+                if (contents(last) != last_keys)
+                    reader_ok = false;
+        });
+        for (int i = 0; i < 3000; i++)
+            tree->remove(std::string(20, 'k') + std::to_string(i));
+        reader.join();
+
+        tree->clear();
+        const bool cleared = tree->empty() && tree->snapshot().empty();
+        tree.reset();
+        ASSERT(reader_ok && cleared && unchanged() && contents(last) == last_keys,
+               "PersistentBTree snapshots do not survive writers, clear() or the tree");
+    }
+
+    template<std::size_t Order, typename Key>
+    bool buffered_matches(const std::size_t capacity, Key (*const key_of)(unsigned)) {
+        BufferedBTree<Key, Order> tree(capacity);
+        std::set<Key> expected;
+        std::mt19937 rng(static_cast<unsigned>(Order * 7 + capacity));
+        bool same = true;
+
+        for (int i = 0; i < 60000; i++) {
+            const Key key = key_of(rng() % 4000);
+            if (rng() % 5 < 3) {
+                tree.insert(key);
+                expected.insert(key);
+            } else {
+                tree.remove(key);
+                expected.erase(key);
+            }
+
+            if (i % 997 == 0) {
+                same = same && tree.check_properties();
+                for (int q = 0; q < 20; q++) {
+                    const Key probe = key_of(rng() % 4000);
+                    same = same && tree.search(probe) == expected.contains(probe);
+                }
+            }
+            if (i % 20000 == 0)
+                same = same && tree.flush_and_size() == expected.size() &&
+                       tree.pending_messages() == 0;
+        }
+
+        std::vector<Key> keys;
+        tree.for_each([&](const Key& key) { keys.push_back(key); });
+        return same && tree.pending_messages() == 0 && tree.check_properties() &&
+               std::equal(keys.begin(), keys.end(), expected.begin(), expected.end());
+    }
+
+    // Con mensajes todavía en los buffers, search responde como std::set; flush_and_size y
+    // for_each aplican todos y dejan las mismas keys. Con buffers chicos los mensajes bajan y
+    // llegan a las hojas todo el tiempo, así que se prueban también los splits y merges que
+    // reparten buffers.
+    void buffered() {
+        const auto number = [](const unsigned i) { return static_cast<int>(i); };
+        const auto text = [](const unsigned i) { return std::string(20, 'k') + std::to_string(i); };
+        const bool numbers = buffered_matches<3, int>(4, number) &&
+                             buffered_matches<4, int>(8, number) &&
+                             buffered_matches<8, int>(64, number) &&
+                             buffered_matches<32, int>(2048, number);
+        ASSERT(numbers, "BufferedBTree<int> does not match std::set");
+
+        const bool strings = buffered_matches<5, std::string>(16, text);
+        ASSERT(strings, "BufferedBTree<std::string> does not match std::set");
+    }
+
+    // Con páginas chicas y un pool que no alcanza para el árbol (así que se desalojan páginas todo
+    // el tiempo), PagedBTree se comporta como std::set, se reabre con las mismas keys y reutiliza
+    // las páginas liberadas en vez de agrandar el archivo
+    void paged_storage() {
+        using Paged = PagedBTree<int, 256>;
+        const TempDir dir("paged_storage");
+        const std::string path = dir.path("tree.db");
+        std::set<int> expected;
+
+        {
+            Paged paged(path, 32);
+            random_ops(paged, expected, 30000, 8000, 20);
+
+            std::vector<int> keys;
+            paged.for_each_in_range(1000, 3000, [&](const int key) { keys.push_back(key); });
+            ASSERT(paged.check_properties() && paged.size() == expected.size() &&
+                       std::equal(keys.begin(), keys.end(), expected.lower_bound(1000),
+                                  expected.upper_bound(3000)),
+                   "PagedBTree does not match std::set");
+        }
+
+        {
+            Paged paged(path, 32);
+            std::vector<int> keys;
+            paged.for_each([&](const int key) { keys.push_back(key); });
+            ASSERT(paged.check_properties() &&
+                       std::equal(keys.begin(), keys.end(), expected.begin(), expected.end()),
+                   "PagedBTree does not reopen with the same keys");
+
+            // Borrar todo y volver a insertar en orden deja siempre la misma forma, así que a
+            // partir de la segunda vuelta todas las páginas salen de la lista de libres
+            std::uintmax_t file_size = 0;
+            for (int round = 0; round < 4; round++) {
+                for (const int key : expected)
+                    paged.remove(key);
+                for (const int key : expected)
+                    paged.insert(key);
+                paged.flush();
+                if (round == 0)
+                    file_size = fs::file_size(path);
+            }
+            ASSERT(paged.check_properties() && paged.size() == expected.size() &&
+                       fs::file_size(path) == file_size,
+                   "PagedBTree does not reuse freed pages");
+
+            paged.clear();
+            paged.flush();
+            ASSERT(paged.size() == 0 && fs::file_size(path) == 256,
+                   "PagedBTree::clear does not truncate the file");
+        }
+
+        bool rejected = false;
+        try {
+            const Paged tiny(dir.path("tiny.db"), 2);
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        ASSERT(rejected, "PagedBTree accepts a pool smaller than a root-to-leaf path");
+    }
+
+    // Si abrir path como un MappedBTree<Key> falla con runtime_error
+    template<typename Key>
+    bool rejects_image(const std::string& path) {
+        try {
+            const auto mapped = MappedBTree<Key>::open(path);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    }
+
+    // La imagen que escribe save se abre con las mismas keys, bounds, rangos y altura que el árbol
+    // original, sea del orden que sea (también vacío). Una imagen cortada o de otro tipo de key se
+    // rechaza.
+    void mapped() {
+        const TempDir dir("mapped");
+        bool same = true;
+
+        const auto matches = [&](const auto& tree, const std::set<int>& expected) {
+            const std::string path = dir.path("tree" + std::to_string(expected.size()) + ".img");
+            tree.save(path);
+            const auto mapped = BTree<int>::open_mapped(path);
+
+            bool ok = mapped.size() == expected.size() && mapped.height() == tree.height() &&
+                      std::equal(mapped.begin(), mapped.end(), expected.begin(), expected.end());
+            if (!expected.empty())
+                ok = ok && mapped.minKey() == *expected.begin() &&
+                     mapped.maxKey() == *expected.rbegin();
+            for (int key = -3; key < 10003; key += 7) {
+                const auto lower = mapped.lower_bound(key);
+                const auto range = mapped.range(key, key + 50);
+                ok = ok && mapped.search(key) == expected.contains(key) &&
+                     (lower == mapped.end() ? expected.lower_bound(key) == expected.end()
+                                            : *lower == *expected.lower_bound(key)) &&
+                     std::equal(range.begin(), range.end(), expected.lower_bound(key),
+                                expected.upper_bound(key + 50));
+            }
+            return ok;
+        };
+
+        std::set<int> expected;
+        BTree<int, 3> small_nodes;
+        random_ops(small_nodes, expected, 30000, 10000, 21);
+        same = same && matches(small_nodes, expected);
+
+        BTree<int> wide(64);
+        std::set<int> expected_wide;
+        random_ops(wide, expected_wide, 20000, 10000, 22);
+        same = same && matches(wide, expected_wide) && matches(BTree<int>(5), {});
+        ASSERT(same, "MappedBTree does not match the tree it was saved from");
+
+        const std::string path = dir.path("tree" + std::to_string(expected.size()) + ".img");
+        fs::copy_file(path, dir.path("cut.img"));
+        fs::resize_file(dir.path("cut.img"), fs::file_size(path) / 2);
+        ASSERT(rejects_image<int>(dir.path("cut.img")) && rejects_image<std::int64_t>(path),
+               "MappedBTree opens a truncated image or one with another key type");
+    }
+
+    // Sin log, una copia hecha justo después de flush() se abre tal cual, y una hecha con cambios
+    // sin flush() se rechaza. Con log, lo que cada operación dejó en el log se recupera.
+    void paged_crash() {
+        const TempDir dir("paged_crash");
+
+        {
+            // Con un pool chico para que se desalojen páginas antes del flush()
+            PagedBTree<int> paged(dir.path("nolog.db"), 16);
+            for (int i = 0; i < 20000; i++)
+                paged.insert(i * 7 % 20000);
+            paged.flush();
+            const std::string flushed = dir.crash_copy("nolog.db");
+            for (int i = 0; i < 20000; i += 2)
+                paged.remove(i);
+            fs::copy_file(dir.path("nolog.db"), dir.path("torn.db"));
+
+            PagedBTree<int> reopened(flushed, 16);
+            ASSERT(reopened.size() == 20000 && reopened.check_properties(),
+                   "PagedBTree without a log does not reopen as of its last flush");
+
+            bool rejected = false;
+            try {
+                const PagedBTree<int> broken(dir.path("torn.db"), 16);
+            } catch (const std::runtime_error&) {
+                rejected = true;
+            }
+            ASSERT(rejected, "PagedBTree without a log opens a file that was not flushed");
+        }
+
+        {
+            PagedBTree<int> paged(dir.path("log.db"), dir.path("log.wal"), SyncPolicy::every_op(),
+                                  64);
+            for (int i = 0; i < 20000; i++)
+                paged.insert(i * 7 % 20000);
+            for (int i = 0; i < 20000; i += 2)
+                paged.remove(i);
+            const std::string pages = dir.crash_copy("log.db");
+            const std::string wal = dir.crash_copy("log.wal");
+
+            PagedBTree<int> recovered(pages, wal, SyncPolicy::every_op(), 64);
+            ASSERT(recovered.size() == 10000 && recovered.check_properties() &&
+                       !recovered.search(10) && recovered.search(11),
+                   "PagedBTree with a log does not recover after a crash");
+        }
+    }
+
+    // Keys parecidas a paths, con prefijos largos en común, algunas que son prefijo de otras, de
+    // largos muy distintos (hasta max_key_size) y con bytes 0 y 0xFF
+    std::string prefix_key(std::mt19937& rng, const std::size_t max_size) {
+        static const char* const roots[] = {"", "a", "ab", "https://example.com/",
+                                            "https://example.com/docs/api/v2/"};
+        std::string key = roots[rng() % 5];
+        const std::size_t parts = rng() % 4;
+        for (std::size_t i = 0; i < parts; ++i)
+            key += std::to_string(rng() % 40) + (rng() % 2 == 0 ? "/" : "");
+        if (rng() % 16 == 0)
+            key += rng() % 2 == 0 ? '\0' : '\xFF';
+        if (rng() % 64 == 0)
+            key.append(max_size - std::min(max_size, key.size()), 'z');
+        return key;
+    }
+
+    template<std::size_t NodeBytes, bool Truncate>
+    bool prefix_matches(const unsigned seed) {
+        using Tree = PrefixBTree<NodeBytes, Truncate>;
+        Tree tree;
+        std::set<std::string> expected;
+        std::mt19937 rng(seed);
+
+        for (int i = 0; i < 20000; i++) {
+            const std::string key = prefix_key(rng, Tree::max_key_size);
+            if (rng() % 5 < 3) {
+                tree.insert(key);
+                expected.insert(key);
+            } else {
+                tree.remove(key);
+                expected.erase(key);
+            }
+        }
+
+        bool same = tree.check_properties() && same_keys(tree, expected);
+        for (int i = 0; i < 500; i++) {
+            const std::string lo = prefix_key(rng, Tree::max_key_size);
+            const std::string hi = lo + "5";
+            const auto lower = tree.lower_bound(lo);
+            const auto range = tree.range(lo, hi);
+            same = same && tree.search(lo) == expected.contains(lo) &&
+                   (lower == tree.end() ? expected.lower_bound(lo) == expected.end()
+                                        : *lower == *expected.lower_bound(lo)) &&
+                   std::equal(range.begin(), range.end(), expected.lower_bound(lo),
+                              expected.upper_bound(hi));
+        }
+
+        Tree moved(std::move(tree));
+        for (const std::string& key : std::set<std::string>(expected))
+            moved.remove(key);
+        return same && moved.empty() && moved.check_properties();
+    }
+
+    // PrefixBTree ordena byte a byte como std::string, con nodos chicos y grandes, separadores
+    // truncados o completos. Keys con prefijos largos ocupan menos que como std::string, y una key
+    // más larga que max_key_size se rechaza.
+    void prefix_tree() {
+        const bool same = prefix_matches<256, true>(23) && prefix_matches<256, false>(24) &&
+                          prefix_matches<1024, true>(25);
+        ASSERT(same, "PrefixBTree does not match std::set<std::string>");
+
+        PrefixBTree<> urls;
+        std::size_t bytes = 0;
+        for (int i = 0; i < 20000; i++) {
+            const std::string key = "https://example.com/docs/api/v2/items/" + std::to_string(i);
+            urls.insert(key);
+            bytes += key.size();
+        }
+        ASSERT(urls.check_properties() && urls.memory_usage() < bytes / 2,
+               "PrefixBTree does not compress shared prefixes");
+
+        bool rejected = false;
+        try {
+            urls.insert(std::string(PrefixBTree<>::max_key_size + 1, 'x'));
+        } catch (const std::length_error&) {
+            rejected = true;
+        }
+        ASSERT(rejected && urls.size() == 20000, "PrefixBTree accepts a key that is too long");
+    }
+
+    // Si search, find, lower_bound, upper_bound y range de frozen coinciden con buscar en keys
+    // (ordenado), para cada key y cada valor entre ellas
+    template<typename Frozen>
+    bool frozen_matches(const Frozen& frozen, const std::vector<int>& keys) {
+        bool same = frozen.size() == keys.size() &&
+                    std::equal(frozen.begin(), frozen.end(), keys.begin(), keys.end());
+        if (keys.empty())
+            return same && frozen.lower_bound(0) == frozen.end() && frozen.range(0, 10).empty();
+
+        same = same && frozen.minKey() == keys.front() && frozen.maxKey() == keys.back();
+        for (int key = keys.front() - 2; key <= keys.back() + 2 && same; key++) {
+            const auto lower = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+            const auto upper = std::upper_bound(keys.begin(), keys.end(), key + 3) - keys.begin();
+            const bool present = std::binary_search(keys.begin(), keys.end(), key);
+            const auto range = frozen.range(key, key + 3);
+            same = frozen.search(key) == present &&
+                   (frozen.find(key) == frozen.end()) == !present &&
+                   frozen.lower_bound(key) - frozen.begin() == lower &&
+                   frozen.upper_bound(key + 3) - frozen.begin() == upper &&
+                   std::equal(range.begin(), range.end(), keys.begin() + lower,
+                              keys.begin() + std::max(lower, upper));
+        }
+        return same;
+    }
+
+    // FrozenBTree responde igual que buscar en un vector ordenado para todos los tamaños chicos
+    // (con el último nodo de cada nivel a medio llenar), con varios B, y con la key máxima del
+    // tipo, que es la que rellena los slots libres. freeze() copia las keys de un BTree.
+    void frozen() {
+        bool same = true;
+        for (int size = 0; size <= 200 && same; size++) {
+            std::vector<int> keys;
+            for (int i = 0; i < size; i++)
+                keys.push_back(i * 3);
+
+            same = frozen_matches(FrozenBTree<int>(keys.begin(), keys.end()), keys) &&
+                   frozen_matches(FrozenBTree<int, std::less<int>, 2>(keys.begin(), keys.end()),
+                                  keys) &&
+                   frozen_matches(FrozenBTree<int, std::less<int>, 3>(keys.begin(), keys.end()),
+                                  keys);
+        }
+        ASSERT(same, "FrozenBTree gives wrong answers for some small size");
+
+        const int top = std::numeric_limits<int>::max();
+        const std::vector<int> edge = {top - 9, top - 5, top - 1, top};
+        const FrozenBTree<int> frozen_edge(edge.begin(), edge.end());
+        ASSERT(frozen_edge.search(top) && !frozen_edge.search(top - 2) &&
+                   *frozen_edge.lower_bound(top - 2) == top - 1 &&
+                   frozen_edge.upper_bound(top) == frozen_edge.end() && frozen_edge.size() == 4,
+               "FrozenBTree confuses the padding with the largest key");
+
+        BTree<int> tree(9);
+        std::set<int> expected;
+        random_ops(tree, expected, 30000, 20000, 24);
+        const auto frozen = tree.freeze();
+        ASSERT(frozen_matches(frozen, std::vector<int>(expected.begin(), expected.end())),
+               "BTree::freeze gives a FrozenBTree with other keys");
+    }
+
+    // Las cargas de bench/ son las que dicen ser (pares en orden, permutados, impares para las
+    // búsquedas fallidas, zipfian sesgada hacia pocas keys) y se repiten igual en cada corrida,
+    // make_key conserva el orden, y State no cuenta el tiempo entre pause() y resume()
+    void bench_harness() {
+        using bench::Workload;
+        constexpr std::size_t n = 10000;
+
+        std::vector<std::uint64_t> evens(n), odds(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            evens[i] = 2 * i;
+            odds[i] = 2 * i + 1;
+        }
+        const auto sorted = [](const Workload workload) {
+            std::vector<std::uint64_t> values = bench::values_of(workload, n);
+            std::sort(values.begin(), values.end());
+            return values;
+        };
+        ASSERT(bench::values_of(Workload::sequential, n) == evens &&
+                   sorted(Workload::random) == evens && sorted(Workload::lookups) == evens &&
+                   sorted(Workload::misses) == odds &&
+                   bench::values_of(Workload::random, n) != evens &&
+                   bench::values_of(Workload::zipfian, n) == bench::values_of(Workload::zipfian, n),
+               "bench workloads are not the keys they describe");
+
+        std::map<std::uint64_t, std::size_t> frequency;
+        for (const std::uint64_t value : bench::values_of(Workload::zipfian, n))
+            ++frequency[value];
+        std::size_t top = 0;
+        for (const auto& [value, count] : frequency)
+            top = std::max(top, count);
+        ASSERT(frequency.rbegin()->first < 2 * n && frequency.begin()->first % 2 == 0 &&
+                   frequency.size() < n / 2 && top > n / 20,
+               "the zipfian workload is not skewed toward a few keys");
+
+        bool ordered = true;
+        for (std::uint64_t value = 0; value < 100000; value += 97)
+            ordered = ordered && bench::make_key<std::string>(value) <
+                                     bench::make_key<std::string>(value + 1 + value % 1000) &&
+                      bench::make_key<std::string>(value).size() == 16;
+        ASSERT(ordered, "bench::make_key<std::string> does not keep the numeric order");
+
+        bench::State state(5);
+        for ([[maybe_unused]] auto _ : state) {
+            state.pause();
+            std::this_thread::sleep_for(std::chrono::milliseconds(4));
+            state.resume();
+        }
+
+        const auto busy = [](bench::State& timed) {
+            std::uint64_t sum = 0;
+            for ([[maybe_unused]] auto _ : timed)
+                for (std::uint64_t i = 0; i < 1000; ++i)
+                    bench::do_not_optimize(sum += i);
+            timed.set_items_processed(timed.iterations());
+        };
+        const bench::Result result = bench::measure({"busy", "", "", "", "", 0, 1, busy}, 0.01);
+        ASSERT(state.real_seconds() < 0.01 && result.iterations > 1 &&
+                   static_cast<double>(result.iterations) * result.real_ns >= 0.01e9 &&
+                   result.items_per_second > 0,
+               "bench::State or bench::measure time the wrong thing");
+    }
+
+    // analyze() describe la forma real del árbol: con un bulk load lleno se sabe exactamente
+    // cuántos nodos y keys hay en cada nivel, y después de updates al azar los niveles siguen
+    // sumando las keys del árbol. Con BTREE_STATS, los contadores siguen lo que pasó.
+    void stats() {
+        std::vector<int> keys(1000);
+        for (int i = 0; i < 1000; i++)
+            keys[static_cast<std::size_t>(i)] = i;
+        const std::unique_ptr<BTree<int>> full(BTree<int>::build_from_ordered_vector(keys, 11));
+
+        // 1000 keys en hojas de 10 y separadores: 91 hojas, 9 nodos internos y la raíz
+        const BTreeStats shape = full->analyze();
+        ASSERT(shape.height == full->height() && shape.height == 2 && shape.levels.size() == 3 &&
+                   shape.levels[0].nodes == 1 && shape.levels[1].nodes == 9 &&
+                   shape.levels[2].nodes == 91 && shape.leaves == 91 && shape.nodes == 101 &&
+                   shape.keys == 1000 && shape.fill > 0.99 &&
+                   shape.memory_bytes > shape.nodes * 10 * sizeof(int),
+               "analyze() does not describe a full bulk-loaded tree");
+
+        BTree<int, 8> tree;
+        std::set<int> expected;
+        random_ops(tree, expected, 30000, 10000, 26);
+        for (int key = 0; key < 1000; key++)
+            (void)tree.search(key);
+
+        const BTreeStats random = tree.stats();
+        std::size_t level_keys = 0;
+        for (const BTreeLevelStats& level : random.levels)
+            level_keys += level.keys;
+        ASSERT(random.keys == expected.size() && level_keys == expected.size() &&
+                   random.height == tree.height() && random.leaves == random.levels.back().nodes &&
+                   random.fill >= 0.5 && random.fill <= 1 && BTree<int>(5).analyze().height == -1,
+               "analyze() does not add up after random updates");
+
+#ifdef BTREE_STATS
+        const BTreeCounters counters = random.counters;
+        ASSERT(counters.searches >= 1000 && counters.node_visits >= counters.searches &&
+                   counters.splits > 0 && counters.merges > 0 &&
+                   counters.node_allocations - counters.node_frees == random.nodes &&
+                   counters.height_increases - counters.height_decreases ==
+                       static_cast<std::uint64_t>(random.height + 1),
+               "BTreeCounters do not match what the tree did");
+
+        tree.reset_counters();
+        ASSERT(tree.counters().searches == 0, "reset_counters() does not reset the counters");
+#else
+        ASSERT(random.counters.searches == 0, "stats() has counters without BTREE_STATS");
+#endif
+    }
+
+    // Con SplitPolicy::append, insertar keys crecientes deja los nodos casi llenos, y volver a
+    // even completa el borde derecho. Con un mínimo de 0.25 los borrados dejan nodos más vacíos
+    // sin romper el árbol, compact() recupera la densidad y las operaciones de conjuntos usan la
+    // política y el mínimo del primer árbol.
+    void fill_policy() {
+        BTree<int> even(16);
+        BTree<int> append(16);
+        append.set_split_policy(SplitPolicy::append);
+        for (int key = 0; key < 10000; key++) {
+            even.insert(key);
+            append.insert(key);
+        }
+        ASSERT(append.check_properties() && append.split_policy() == SplitPolicy::append &&
+                   append.analyze().fill > 0.9 && even.analyze().fill < 0.6,
+               "SplitPolicy::append does not fill nodes with ascending keys");
+
+        append.set_split_policy(SplitPolicy::even);
+        for (int key = 10000; key < 10100; key++)
+            append.insert(key);
+        std::set<int> ascending;
+        for (int key = 0; key < 10100; key++)
+            ascending.insert(key);
+        ASSERT(append.check_properties() && same_keys(append, ascending),
+               "going back to SplitPolicy::even breaks the tree");
+
+        bool threw = false;
+        try {
+            even.set_min_fill(0.2);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        ASSERT(threw && even.min_fill() == 0.5, "set_min_fill accepts a fill below 0.25");
+
+        BTree<int> strict(16);
+        BTree<int> lazy(16);
+        lazy.set_min_fill(0.25);
+        std::set<int> expected;
+        std::set<int> lazy_expected;
+        random_ops(strict, expected, 20000, 5000, 27);
+        random_ops(lazy, lazy_expected, 20000, 5000, 27);
+        for (int key = 0; key < 5000; key += 3) {
+            strict.remove(key);
+            lazy.remove(key);
+            expected.erase(key);
+        }
+        ASSERT(lazy_expected.size() >= expected.size() && same_keys(strict, expected) &&
+                   lazy.check_properties() && same_keys(lazy, expected) &&
+                   lazy.min_fill() == 0.25 && lazy.analyze().nodes >= strict.analyze().nodes,
+               "a lower minimum fill breaks the tree or merges more");
+
+        BTree<int> other(16);
+        other.set_split_policy(SplitPolicy::append);
+        const BTree<int> merged = BTree<int>::merge_union(lazy, other);
+        ASSERT(merged.min_fill() == 0.25 && merged.split_policy() == SplitPolicy::even &&
+                   BTree<int>::merge_union(other, lazy).split_policy() == SplitPolicy::append,
+               "merge_union does not keep the policy and minimum fill of a");
+
+        lazy.compact();
+        ASSERT(lazy.check_properties() && same_keys(lazy, expected) && lazy.analyze().fill > 0.95,
+               "compact() does not restore the density");
+
+        lazy.set_min_fill(0.5);
+        ASSERT(lazy.check_properties() && same_keys(lazy, expected),
+               "raising the minimum fill breaks the tree");
+    }
+
+    // parallel_for_each_in_range visita cada key de [begin, end] una sola vez, con bordes que están
+    // o no en el árbol y con rangos vacíos. parallel_reduce da lo mismo que recorrer en orden: una
+    // suma con cualquier orden y, con ReduceOrder::ordered, también una concatenación, que no es
+    // conmutativa. Funciona igual con un pool propio y con BTreeMap.
+    void parallel_scan() {
+        BTree<int> tree(8);
+        std::set<int> expected;
+        random_ops(tree, expected, 60000, 40000, 28);
+        WorkStealingPool executor(3);
+
+        const auto visits_range = [&](const int begin, const int end) {
+            std::vector<std::atomic<int>> seen(40001);
+            tree.parallel_for_each_in_range(
+                begin, end,
+                [&](const int key) { seen[static_cast<std::size_t>(key)].fetch_add(1); },
+                executor);
+            bool exact = true;
+            for (int key = 0; key <= 40000; key++) {
+                const bool inside = key >= begin && key <= end && expected.contains(key);
+                exact = exact && seen[static_cast<std::size_t>(key)].load() == (inside ? 1 : 0);
+            }
+            return exact;
+        };
+        ASSERT(visits_range(0, 40000) && visits_range(1234, 30001) && visits_range(777, 777) &&
+                   visits_range(20000, 19999) && visits_range(-5, 3),
+               "parallel_for_each_in_range does not visit each key in the range once");
+
+        std::atomic<long long> total{0};
+        tree.parallel_for_each([&](const int key) { total.fetch_add(key); });
+        long long sequential = 0;
+        for (const int key : expected)
+            sequential += key;
+        ASSERT(total.load() == sequential, "parallel_for_each does not visit the whole tree");
+
+        const auto add = [](long long acc, const int key) { return acc + key; };
+        const auto plus = [](const long long a, const long long b) { return a + b; };
+        ASSERT(tree.parallel_reduce(0LL, add, plus) == sequential &&
+                   tree.parallel_reduce(0LL, add, plus, ReduceOrder::unordered, executor) ==
+                       sequential &&
+                   tree.parallel_reduce(50000, 60000, 0LL, add, plus) == 0,
+               "parallel_reduce does not match a sequential sum");
+
+        using Keys = std::vector<int>;
+        const auto append = [](Keys acc, const int key) {
+            acc.push_back(key);
+            return acc;
+        };
+        const auto concat = [](Keys a, const Keys& b) {
+            a.insert(a.end(), b.begin(), b.end());
+            return a;
+        };
+        const Keys in_order(expected.lower_bound(5000), expected.upper_bound(35000));
+        ASSERT(tree.parallel_reduce(Keys{}, append, concat, ReduceOrder::ordered, executor) ==
+                       Keys(expected.begin(), expected.end()) &&
+                   tree.parallel_reduce(5000, 35000, Keys{}, append, concat) == in_order,
+               "ordered parallel_reduce does not keep the order of the keys");
+
+        BTreeMap<int, int> map(6);
+        long long values = 0;
+        for (int key = 0; key < 20000; key++) {
+            map.insert(key, key % 7);
+            values += key % 7;
+        }
+        const long long reduced = map.parallel_reduce(
+            0LL, [](long long acc, const auto& entry) { return acc + entry.second; }, plus);
+        ASSERT(reduced == values, "parallel_reduce over a BTreeMap does not add its values");
+
+        const BTree<int> empty(8);
+        bool called = false;
+        empty.parallel_for_each([&](int) { called = true; });
+        ASSERT(!called && empty.parallel_reduce(Keys{}, append, concat).empty(),
+               "parallel scans of an empty tree call fn");
+    }
+
+    // write_to escribe lo mismo que toString en un ostream y en un output iterator, también
+    // cuando pasa de los bloques de 64 KiB, y los doubles salen en la forma más corta que vuelve
+    // al mismo valor. dump y load devuelven las mismas entradas (en BTreeMap, con sus valores),
+    // y load rechaza un stream cortado, de otro tipo de entradas o con keys fuera de orden.
+    void text_and_dump() {
+        BTree<int> tree(9);
+        std::set<int> expected;
+        random_ops(tree, expected, 100000, 1000000, 29);
+
+        std::string joined;
+        for (const int key : expected)
+            joined += (joined.empty() ? "" : ", ") + std::to_string(key);
+        std::ostringstream stream;
+        tree.write_to(stream, ", ");
+        std::string iterated;
+        tree.write_to(std::back_inserter(iterated), ", ");
+        ASSERT(joined.size() > 64 * 1024 && tree.toString(", ") == joined &&
+                   stream.str() == joined && iterated == joined,
+               "write_to and toString do not write the keys in order");
+
+        BTree<double, 4> doubles;
+        for (const double key : {0.1, -2.5, 1e300, 3.0})
+            doubles.insert(key);
+        ASSERT(doubles.toString(" ") == "-2.5 0.1 3 1e+300" && BTree<int>(5).toString(",").empty(),
+               "toString does not format doubles or an empty tree");
+
+        std::stringstream dumped;
+        tree.dump(dumped);
+        const std::unique_ptr<BTree<int>> loaded(BTree<int>::load(dumped, 17, 0.7));
+        ASSERT(loaded->check_properties() && same_keys(*loaded, expected),
+               "load does not return the dumped keys");
+
+        BTreeMap<int, double, 6> map;
+        std::map<int, double> entries;
+        for (int key = 0; key < 5000; key++) {
+            map.insert(key * 3, key / 4.0);
+            entries.emplace(key * 3, key / 4.0);
+        }
+        std::stringstream map_dump;
+        map.dump(map_dump);
+        const std::unique_ptr<BTreeMap<int, double, 6>> map_loaded(
+            BTreeMap<int, double, 6>::load(map_dump));
+        ASSERT(map_loaded->check_properties() && same_entries(*map_loaded, entries),
+               "load does not return the dumped entries of a BTreeMap");
+
+        const auto rejects = [](const std::string& bytes) {
+            std::istringstream in(bytes);
+            try {
+                const std::unique_ptr<BTree<int>> tree(BTree<int>::load(in, 5));
+            } catch (const std::runtime_error&) {
+                return true;
+            }
+            return false;
+        };
+        const std::string image = dumped.str();
+        std::string bad_magic = image;
+        bad_magic[0] ^= 1;
+        std::string unordered = image;
+        std::swap_ranges(unordered.begin() + sizeof(BTreeDumpHeader),
+                         unordered.begin() + sizeof(BTreeDumpHeader) + sizeof(int),
+                         unordered.begin() + sizeof(BTreeDumpHeader) + sizeof(int));
+        ASSERT(rejects(image.substr(0, image.size() - 1)) && rejects(bad_magic) &&
+                   rejects(map_dump.str()) && rejects(unordered) && rejects(""),
+               "load accepts a stream that is not a valid dump");
+    }
+
+    // El filtro nunca da falsos negativos y da pocos falsos positivos. FilteredBTree responde
+    // igual que std::set con search, search_batch y find después de inserts, removes, split y
+    // join, antes y después de rebuild_filter. Con BTREE_STATS, las búsquedas de keys que no
+    // están se cortan en el filtro casi siempre.
+    void key_filter() {
+        BlockedBloomFilter<int> bloom;
+        ASSERT(bloom.stale() && bloom.may_contain(42), "an unbuilt filter discards keys");
+
+        bloom.rebuild(20000, [](auto&& add) {
+            for (int key = 0; key < 40000; key += 2)
+                add(key);
+        });
+        bool no_false_negatives = true;
+        int false_positives = 0;
+        for (int key = 0; key < 40000; key += 2) {
+            no_false_negatives = no_false_negatives && bloom.may_contain(key);
+            false_positives += bloom.may_contain(key + 1) ? 1 : 0;
+        }
+        ASSERT(no_false_negatives && !bloom.stale() && false_positives < 20000 / 50 &&
+                   bloom.memory_bytes() >= 40000 * 12 / 8,
+               "BlockedBloomFilter has false negatives or too many false positives");
+
+        FilteredBTree<int> tree(8);
+        std::set<int> expected;
+        const auto matches = [&](const FilteredBTree<int>& t, const std::set<int>& keys) {
+            std::vector<int> probes(30000);
+            for (int key = 0; key < 30000; key++)
+                probes[static_cast<std::size_t>(key)] = key - 5000;
+            const auto found = std::make_unique<bool[]>(probes.size());
+            t.search_batch(probes, std::span<bool>(found.get(), probes.size()), true);
+
+            bool same = t.check_properties() && same_keys(t, keys);
+            for (std::size_t i = 0; i < probes.size(); i++) {
+                const bool present = keys.contains(probes[i]);
+                same = same && t.search(probes[i]) == present && found[i] == present &&
+                       (t.find(probes[i]) != t.end()) == present;
+            }
+            return same;
+        };
+        random_ops(tree, expected, 60000, 20000, 30);
+        ASSERT(matches(tree, expected), "FilteredBTree does not match std::set after updates");
+
+        auto [low, high] = tree.split(10000);
+        const std::set<int> expected_low(expected.begin(), expected.lower_bound(10000));
+        const std::set<int> expected_high(expected.lower_bound(10000), expected.end());
+        ASSERT(matches(low, expected_low) && matches(high, expected_high),
+               "FilteredBTree does not find its keys after split");
+
+        low.rebuild_filter();
+        high.rebuild_filter();
+        ASSERT(matches(low, expected_low) && matches(high, expected_high),
+               "FilteredBTree does not find its keys after rebuild_filter");
+
+        tree = FilteredBTree<int>::join(std::move(low), std::move(high));
+        tree.insert(25000);
+        expected.insert(25000);
+        ASSERT(matches(tree, expected), "FilteredBTree does not find its keys after join");
+
+        FilteredBTreeMap<int, int> map(5);
+        for (int key = 0; key < 5000; key++)
+            map.insert(key * 2, key);
+        bool found_values = true;
+        for (int key = 0; key < 10000; key++) {
+            const int* const value = map.find(key);
+            found_values = found_values && (key % 2 == 0 ? value != nullptr && *value == key / 2
+                                                         : value == nullptr);
+        }
+        ASSERT(found_values, "FilteredBTreeMap does not find its values");
+
+#ifdef BTREE_STATS
+        tree.rebuild_filter();
+        tree.reset_counters();
+        for (int key = 100000; key < 110000; key++)
+            (void)tree.search(key);
+        ASSERT(tree.counters().filtered_misses > 9500,
+               "the filter does not cut most searches for missing keys");
+#endif
+    }
+
+    // Keys de un PagedBTree, en orden
+    template<typename Paged>
+    std::vector<int> paged_keys(Paged& paged) {
+        std::vector<int> keys;
+        paged.for_each([&](const int key) { keys.push_back(key); });
+        return keys;
+    }
+
+    // Se recupera todo lo que el log tiene, también con checkpoints (forzados por un pool chico) y
+    // un clear() en el medio. Si el último registro quedó cortado, se recupera todo menos esa
+    // operación. Con varios hilos escribiendo a la vez (group commit), cada operación que retornó
+    // con SyncPolicy::every_op está en el log.
+    void wal_recovery() {
+        using Paged = PagedBTree<int, 512>;
+        const TempDir dir("wal_recovery");
+        std::set<int> expected;
+
+        {
+            Paged paged(dir.path("ops.db"), dir.path("ops.wal"), SyncPolicy::every_op(), 48);
+            random_ops(paged, expected, 4000, 3000, 22);
+            paged.clear();
+            expected.clear();
+            random_ops(paged, expected, 6000, 3000, 23);
+            paged.insert(5000);
+
+            const std::string pages = dir.crash_copy("ops.db");
+            const std::string wal = dir.crash_copy("ops.wal");
+            fs::copy_file(pages, dir.path("torn.db"));
+            fs::copy_file(wal, dir.path("torn.wal"));
+            fs::resize_file(dir.path("torn.wal"), fs::file_size(wal) - 1);
+
+            Paged recovered(pages, wal, SyncPolicy::every_op(), 48);
+            expected.insert(5000);
+            const std::vector<int> keys = paged_keys(recovered);
+            ASSERT(recovered.check_properties() &&
+                       std::equal(keys.begin(), keys.end(), expected.begin(), expected.end()),
+                   "PagedBTree does not recover every logged operation");
+
+            Paged torn(dir.path("torn.db"), dir.path("torn.wal"), SyncPolicy::every_op(), 48);
+            expected.erase(5000);
+            const std::vector<int> torn_keys = paged_keys(torn);
+            ASSERT(torn.check_properties() &&
+                       std::equal(torn_keys.begin(), torn_keys.end(), expected.begin(),
+                                  expected.end()),
+                   "PagedBTree does not drop a torn last log record");
+        }
+
+        for (const SyncPolicy policy : {SyncPolicy::every_op(),
+                                        SyncPolicy::every(std::chrono::milliseconds(2))}) {
+            const std::string name = policy.mode == SyncMode::every_op ? "op" : "interval";
+            Paged paged(dir.path(name + ".db"), dir.path(name + ".wal"), policy, 64);
+
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; t++) {
+                threads.emplace_back([&paged, t] {
+                    for (int i = 0; i < 500; i++)
+                        paged.insert(i * 4 + t);
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+
+            // Con every_op ya es durable; con un intervalo, hay que esperar al próximo fsync
+            if (policy.mode != SyncMode::every_op)
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            const std::string pages = dir.crash_copy(name + ".db");
+            const std::string wal = dir.crash_copy(name + ".wal");
+
+            Paged recovered(pages, wal, policy, 64);
+            ASSERT(recovered.size() == 2000 && recovered.check_properties(),
+                   "PagedBTree loses operations committed by concurrent writers");
+        }
+    }
+
+    const std::vector<std::pair<const char*, void (*)()>> all = {
+        {"fixed_order", fixed_order},
+        {"simd_search", simd_search},
+        {"pool", pool},
+        {"bulk_build", bulk_build},
+        {"parallel_build", parallel_build},
+        {"batched_lookup", batched_lookup},
+        {"range_view", range_view},
+        {"iterators", iterators},
+        {"btree_map", btree_map},
+        {"heterogeneous_lookup", heterogeneous_lookup},
+        {"bplus_tree", bplus_tree},
+        {"insert_order", insert_order},
+        {"remove_order", remove_order},
+        {"sorted_runs", sorted_runs},
+        {"join_split", join_split},
+        {"order_statistics", order_statistics},
+        {"concurrent", concurrent},
+        {"snapshots", snapshots},
+        {"buffered", buffered},
+        {"paged_storage", paged_storage},
+        {"mapped", mapped},
+        {"prefix_tree", prefix_tree},
+        {"frozen", frozen},
+        {"bench_harness", bench_harness},
+        {"stats", stats},
+        {"fill_policy", fill_policy},
+        {"parallel_scan", parallel_scan},
+        {"text_and_dump", text_and_dump},
+        {"key_filter", key_filter},
+        {"paged_crash", paged_crash},
+        {"wal_recovery", wal_recovery},
+    };
+}  // namespace tests
+
+int main(const int argc, char** const argv) {
+    for (const auto& [name, test] : tests::all) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc && !selected; ++i)
+            selected = std::strcmp(argv[i], name) == 0;
+
+        if (selected) {
+            std::cerr << "== " << name << std::endl;
+            test();
+        }
+    }
+
+    return TrueAsserts == TotalAsserts ? 0 : 1;
+}
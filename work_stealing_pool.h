@@ -0,0 +1,240 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "node.h"
+
+// Lo que BasicBTree necesita para repartir un recorrido paralelo: run(tasks, fn) llama
+// fn(task, worker) una vez por cada task en [0, tasks), posiblemente desde varios hilos a la vez,
+// y vuelve cuando terminaron todas. worker identifica al hilo que ejecuta y es menor que
+// concurrency(); dos tasks con el mismo worker nunca corren al mismo tiempo.
+template<typename E>
+concept TaskExecutor = requires(E& executor, void (*fn)(std::size_t, std::size_t)) {
+    { executor.concurrency() } -> std::convertible_to<std::size_t>;
+    executor.run(std::size_t{}, fn);
+};
+
+// Pool de hilos fijos que reparte las tasks de cada run() con work stealing. Al empezar, cada
+// worker recibe un tramo contiguo de tasks y las toma desde el principio; el que se queda sin
+// trabajo le roba la mitad final del tramo a otro. Así las tasks vecinas tienden a correr en el
+// mismo hilo y un worker lento no deja a los demás esperando.
+//
+// El hilo que llama a run() trabaja como worker 0. Si una task vuelve a llamar a run() sobre el
+// mismo pool, esas tasks corren ahí mismo, en orden, con el worker del hilo que las llama.
+// Llamadas desde hilos distintos se ejecutan de a una.
+class WorkStealingPool {
+    // Tramo [begin, end) de tasks sin tomar, empaquetado para poder cambiar ambos con un CAS
+    struct alignas(cache_line_size) Queue {
+        std::atomic<std::uint64_t> range{0};
+    };
+
+    static constexpr std::uint64_t max_tasks = 0xFFFFFFFF;
+
+    static std::uint64_t pack(const std::uint64_t begin, const std::uint64_t end) {
+        return begin << 32 | end;
+    }
+
+    std::size_t workers;
+    std::unique_ptr<Queue[]> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::uint64_t generation = 0;
+    std::size_t running = 0;  // Hilos del pool que todavía trabajan en el run() actual
+    bool stopping = false;
+
+    std::mutex run_mutex;
+
+    // run() actual, con el tipo de fn borrado
+    const void* job = nullptr;
+    void (*invoke)(const void*, std::size_t, std::size_t) = nullptr;
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+
+    static inline thread_local const WorkStealingPool* current = nullptr;
+    static inline thread_local std::size_t current_worker = 0;  // Worker del hilo dentro de current
+
+    bool pop(const std::size_t w, std::size_t& task) {
+        std::atomic<std::uint64_t>& range = queues[w].range;
+        std::uint64_t r = range.load(std::memory_order_relaxed);
+
+        while ((r >> 32) < (r & max_tasks)) {
+            if (range.compare_exchange_weak(r, r + (std::uint64_t{1} << 32),
+                                            std::memory_order_acq_rel)) {
+                task = static_cast<std::size_t>(r >> 32);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Le saca a otro worker la mitad final de su tramo. Se queda con la primera task robada y
+    // deja el resto en su propia cola, que está vacía: los demás solo la achican con CAS, y como
+    // ninguna task se reparte dos veces en un mismo run(), ningún CAS viejo puede coincidir.
+    bool steal(const std::size_t w, std::size_t& task) {
+        for (std::size_t i = 1; i < workers; ++i) {
+            std::atomic<std::uint64_t>& range = queues[(w + i) % workers].range;
+            std::uint64_t r = range.load(std::memory_order_relaxed);
+
+            while (true) {
+                const std::uint64_t begin = r >> 32;
+                const std::uint64_t end = r & max_tasks;
+                if (begin >= end)
+                    break;
+
+                const std::uint64_t taken = (end - begin + 1) / 2;
+                if (range.compare_exchange_weak(r, pack(begin, end - taken),
+                                                std::memory_order_acq_rel)) {
+                    task = static_cast<std::size_t>(end - taken);
+                    queues[w].range.store(pack(end - taken + 1, end), std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // Ejecuta tasks hasta que no quede ninguna sin tomar. Después de un error las que faltan se
+    // toman igual, pero sin ejecutarlas.
+    void work(const std::size_t w) {
+        std::size_t task = 0;
+        while (pop(w, task) || steal(w, task)) {
+            if (failed.load(std::memory_order_relaxed))
+                continue;
+
+            try {
+                invoke(job, task, w);
+            } catch (...) {
+                const std::lock_guard lock(mutex);
+                if (!failed.exchange(true))
+                    error = std::current_exception();
+            }
+        }
+    }
+
+    void run_worker(const std::size_t w) {
+        current = this;
+        current_worker = w;
+        std::uint64_t seen = 0;
+
+        while (true) {
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+
+            work(w);
+
+            const std::lock_guard lock(mutex);
+            if (--running == 0)
+                done.notify_one();
+        }
+    }
+
+public:
+    // thread_count = 0 usa todos los cores
+    explicit WorkStealingPool(const std::size_t thread_count = 0)
+        : workers(thread_count == 0 ? std::max(1U, std::thread::hardware_concurrency())
+                                  : thread_count),
+          queues(new Queue[workers]) {
+        threads.reserve(workers - 1);
+        for (std::size_t w = 1; w < workers; ++w)
+            threads.emplace_back(&WorkStealingPool::run_worker, this, w);
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        {
+            const std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    // Pool con un hilo por core, compartido por todos los que no pasan uno propio
+    static WorkStealingPool& shared() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+    [[nodiscard]] std::size_t concurrency() const {
+        return workers;
+    }
+
+    // Si alguna task lanza, las que todavía no empezaron se descartan y run() relanza la primera
+    // excepción cuando terminan las que estaban corriendo
+    template<typename Fn>
+    void run(const std::size_t tasks, Fn&& fn) {
+        if (tasks > max_tasks)
+            throw std::length_error("too many tasks for a WorkStealingPool");
+
+        if (tasks <= 1 || workers == 1 || current == this) {
+            const std::size_t w = current == this ? current_worker : 0;
+            for (std::size_t task = 0; task < tasks; ++task)
+                fn(task, w);
+            return;
+        }
+
+        const std::lock_guard serial(run_mutex);
+
+        for (std::size_t w = 0; w < workers; ++w) {
+            const std::uint64_t begin = tasks * w / workers;
+            const std::uint64_t end = tasks * (w + 1) / workers;
+            queues[w].range.store(pack(begin, end), std::memory_order_relaxed);
+        }
+
+        job = &fn;
+        invoke = [](const void* const f, const std::size_t task, const std::size_t w) {
+            (*static_cast<std::remove_reference_t<Fn>*>(const_cast<void*>(f)))(task, w);
+        };
+        failed.store(false, std::memory_order_relaxed);
+        error = nullptr;
+
+        {
+            const std::lock_guard lock(mutex);
+            running = workers - 1;
+            ++generation;
+        }
+        wake.notify_all();
+
+        const WorkStealingPool* const outer = current;
+        const std::size_t outer_worker = current_worker;
+        current = this;
+        current_worker = 0;
+        work(0);
+        current = outer;
+        current_worker = outer_worker;
+
+        std::unique_lock lock(mutex);
+        done.wait(lock, [&] { return running == 0; });
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+#endif
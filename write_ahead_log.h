@@ -0,0 +1,355 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Cuándo un cambio registrado en el log cuenta como durable
+enum class SyncMode {
+    every_op,  // commit espera a que el registro llegue al disco
+    interval,  // un hilo hace fsync cada `interval`; se pierde a lo más ese tiempo de cambios
+    none,      // solo se hace fsync en los checkpoints
+};
+
+struct SyncPolicy {
+    SyncMode mode = SyncMode::every_op;
+    std::chrono::milliseconds interval{0};
+
+    static constexpr SyncPolicy every_op() {
+        return {SyncMode::every_op, {}};
+    }
+
+    static constexpr SyncPolicy every(const std::chrono::milliseconds interval) {
+        return {SyncMode::interval, interval};
+    }
+
+    static constexpr SyncPolicy none() {
+        return {SyncMode::none, {}};
+    }
+};
+
+// CRC-32 (polinomio de IEEE 802.3), para reconocer registros escritos a medias
+inline std::uint32_t crc32(const std::span<const std::byte> bytes, std::uint32_t crc = 0) {
+    static constexpr std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int bit = 0; bit < 8; ++bit)
+                c = (c & 1) != 0 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (const std::byte b : bytes)
+        crc = table[(crc ^ std::to_integer<std::uint32_t>(b)) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Log de solo agregar. Cada registro es {largo, crc, tipo, datos}; al abrir, lo que sigue al
+// último registro íntegro (lo que quedó a medias en un crash) se descarta.
+//
+// append solo copia el registro a un buffer en memoria. Lo escribe al archivo quien llegue primero
+// a commit (o el hilo de SyncPolicy::every), y un solo fsync cubre todo lo acumulado hasta ese
+// momento: los hilos que llegan mientras tanto esperan ese fsync o el siguiente en vez de hacer
+// uno cada uno (group commit). Todos los métodos se pueden llamar desde varios hilos.
+class WriteAheadLog {
+public:
+    // Posición en el log contando todos los bytes agregados desde que se abrió, aunque el archivo
+    // se vacíe con reset()
+    using Lsn = std::uint64_t;
+
+    static constexpr std::size_t header_size = 2 * sizeof(std::uint32_t) + 1;
+    static constexpr std::size_t max_record = std::size_t{1} << 30;
+
+    // En interval y none, pasado este tamaño el buffer se escribe al archivo (sin fsync)
+    static constexpr std::size_t buffer_limit = std::size_t{1} << 20;
+
+private:
+    int fd = -1;
+    SyncPolicy policy;
+
+    mutable std::mutex mutex;
+    std::condition_variable done;
+    std::vector<std::byte> pending;
+    std::vector<std::byte> spare;
+    Lsn file_start = 0;  // Lsn del byte 0 del archivo
+    Lsn appended = 0;
+    Lsn written = 0;
+    Lsn durable = 0;
+    bool draining = false;
+    bool stopping = false;
+    std::exception_ptr error;
+    std::thread syncer;
+
+    static std::system_error failure(const std::string& what) {
+        return {errno, std::generic_category(), what};
+    }
+
+    [[nodiscard]] std::vector<std::byte> read_file() const {
+        struct stat info {};
+        if (::fstat(fd, &info) != 0)
+            throw failure("cannot stat log");
+
+        std::vector<std::byte> bytes(static_cast<std::size_t>(info.st_size));
+        std::size_t done = 0;
+        while (done < bytes.size()) {
+            const ::ssize_t got = ::pread(fd, bytes.data() + done, bytes.size() - done,
+                                          static_cast<::off_t>(done));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+                throw failure("cannot read log");
+            if (got == 0)
+                break;
+            done += static_cast<std::size_t>(got);
+        }
+
+        bytes.resize(done);
+        return bytes;
+    }
+
+    // Llama a fn(offset, tipo, datos) por cada registro íntegro de bytes. Retorna dónde termina
+    // el último.
+    template<typename Fn>
+    static std::size_t parse(const std::span<const std::byte> bytes, Fn&& fn) {
+        std::size_t offset = 0;
+        while (bytes.size() - offset >= header_size) {
+            std::uint32_t length = 0;
+            std::uint32_t crc = 0;
+            std::memcpy(&length, bytes.data() + offset, sizeof length);
+            std::memcpy(&crc, bytes.data() + offset + 4, sizeof crc);
+            if (length > bytes.size() - offset - header_size)
+                break;
+
+            // El crc cubre el tipo y los datos
+            const auto body = bytes.subspan(offset + header_size - 1, length + 1);
+            if (crc32(body) != crc)
+                break;
+
+            fn(offset, std::to_integer<std::uint8_t>(body[0]), body.subspan(1));
+            offset += header_size + length;
+        }
+        return offset;
+    }
+
+    void write_all(const std::vector<std::byte>& bytes, const Lsn at) {
+        std::size_t done = 0;
+        while (done < bytes.size()) {
+            const ::ssize_t put = ::pwrite(fd, bytes.data() + done, bytes.size() - done,
+                                           static_cast<::off_t>(at - file_start + done));
+            if (put < 0 && errno == EINTR)
+                continue;
+            if (put < 0)
+                throw failure("cannot write log");
+            done += static_cast<std::size_t>(put);
+        }
+    }
+
+    void check() const {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // Escribe el buffer (y hace fsync si sync) sin tener el mutex, así que los demás pueden seguir
+    // agregando mientras tanto. Se llama con el lock tomado y sin otro drain en curso.
+    void drain(std::unique_lock<std::mutex>& lock, const bool sync) {
+        draining = true;
+        std::vector<std::byte> batch = std::exchange(pending, std::move(spare));
+        const Lsn from = written;
+        const Lsn target = appended;
+        lock.unlock();
+
+        try {
+            write_all(batch, from);
+            if (sync && ::fdatasync(fd) != 0)
+                throw failure("cannot sync log");
+        } catch (...) {
+            lock.lock();
+            error = std::current_exception();
+            draining = false;
+            done.notify_all();
+            throw;
+        }
+
+        lock.lock();
+        written = target;
+        if (sync)
+            durable = target;
+        draining = false;
+        batch.clear();
+        spare = std::move(batch);
+        done.notify_all();
+    }
+
+    // Espera hasta que todo lo agregado antes de lsn esté en el disco
+    void wait_durable(std::unique_lock<std::mutex>& lock, const Lsn lsn) {
+        while (durable < lsn) {
+            check();
+            if (draining)
+                done.wait(lock);
+            else
+                drain(lock, true);
+        }
+    }
+
+    void run_syncer() {
+        std::unique_lock lock(mutex);
+        for (auto next = std::chrono::steady_clock::now() + policy.interval;;
+             next += policy.interval) {
+            if (done.wait_until(lock, next, [this] { return stopping; }))
+                return;
+            if (error || draining || durable == appended)
+                continue;
+
+            try {
+                drain(lock, true);
+            } catch (...) {  // NOLINT(bugprone-empty-catch): queda en error para el próximo commit
+            }
+        }
+    }
+
+public:
+    WriteAheadLog(const std::string& path, const SyncPolicy policy)
+        : policy(policy) {
+        if (policy.mode == SyncMode::interval && policy.interval.count() <= 0)
+            throw std::invalid_argument("sync interval must be positive");
+
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            throw failure("cannot open " + path);
+
+        try {
+            const std::vector<std::byte> bytes = read_file();
+            const std::size_t end = parse(bytes, [](auto&&...) {});
+            if (end != bytes.size() && ::ftruncate(fd, static_cast<::off_t>(end)) != 0)
+                throw failure("cannot truncate log");
+            appended = written = durable = end;
+
+            if (policy.mode == SyncMode::interval)
+                syncer = std::thread(&WriteAheadLog::run_syncer, this);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Escribe lo pendiente con fsync. Para enterarse de un error hay que llamar antes a sync().
+    ~WriteAheadLog() {
+        if (syncer.joinable()) {
+            {
+                const std::scoped_lock lock(mutex);
+                stopping = true;
+            }
+            done.notify_all();
+            syncer.join();
+        }
+
+        try {
+            sync();
+        } catch (...) {  // NOLINT(bugprone-empty-catch)
+        }
+        ::close(fd);
+    }
+
+    // Agrega un registro y retorna el Lsn donde termina, para pasárselo a commit
+    Lsn append(const std::uint8_t type, const std::span<const std::byte> data) {
+        if (data.size() > max_record)
+            throw std::length_error("log record too large");
+
+        const std::scoped_lock lock(mutex);
+        check();
+
+        const auto length = static_cast<std::uint32_t>(data.size());
+        const auto kind = static_cast<std::byte>(type);
+        const std::uint32_t crc = crc32(data, crc32({&kind, 1}));
+
+        const std::size_t at = pending.size();
+        pending.resize(at + header_size + data.size());
+        std::memcpy(pending.data() + at, &length, sizeof length);
+        std::memcpy(pending.data() + at + 4, &crc, sizeof crc);
+        pending[at + 8] = kind;
+        std::copy(data.begin(), data.end(), pending.begin() + at + header_size);
+
+        appended += header_size + data.size();
+        return appended;
+    }
+
+    // Según la política, espera a que lsn sea durable (every_op) o retorna enseguida
+    void commit(const Lsn lsn) {
+        std::unique_lock lock(mutex);
+        if (policy.mode == SyncMode::every_op) {
+            wait_durable(lock, lsn);
+            return;
+        }
+
+        check();
+        if (!draining && pending.size() >= buffer_limit)
+            drain(lock, false);
+    }
+
+    // Lleva al disco todo lo agregado hasta ahora, sea cual sea la política
+    void sync() {
+        std::unique_lock lock(mutex);
+        wait_durable(lock, appended);
+    }
+
+    // Vacía el archivo después de hacer durable todo lo agregado hasta ahora
+    void reset() {
+        std::unique_lock lock(mutex);
+        wait_durable(lock, appended);
+        while (draining)
+            done.wait(lock);
+        check();
+
+        if (::ftruncate(fd, 0) != 0 || ::fsync(fd) != 0)
+            throw failure("cannot reset log");
+        file_start = appended;
+    }
+
+    // Lsn del final del último registro agregado
+    [[nodiscard]] Lsn end() const {
+        const std::scoped_lock lock(mutex);
+        return appended;
+    }
+
+    // Bytes del archivo contando lo que sigue en el buffer. Es el offset que tendrá el próximo
+    // registro en replay.
+    [[nodiscard]] std::uint64_t bytes() const {
+        const std::scoped_lock lock(mutex);
+        return appended - file_start;
+    }
+
+    // Llama a fn(offset, tipo, datos) por cada registro del archivo, en orden. Solo ve lo que ya
+    // se escribió: se usa al abrir, antes de agregar nada.
+    template<typename Fn>
+    void replay(Fn&& fn) const {
+        const std::vector<std::byte> bytes = read_file();
+        parse(bytes, fn);
+    }
+};
+
+#endif